@@ -0,0 +1,608 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <functional>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <memory>
+
+#include "NGram/Utf8Transcoder.h"
+#include "NGram/wz_utilities.h"
+#include "Transform/Transformation.h"
+#include "Transform/Self2Self.h"
+#include "Transform/Uni2Zg.h"
+#include "Transform/Zg2Uni.h"
+#include "Transform/Uni2Ayar.h"
+#include "Transform/Ayar2Uni.h"
+#include "Transform/Uni2WinInnwa.h"
+
+using std::string;
+using std::wstring;
+using std::vector;
+
+
+/**
+ * Converts large UTF-8 text files from one encoding to another, using any of the built-in
+ *  Transformations (the same ones listed in WZFactory, by the same ids).
+ * Usage:
+ *   BulkConverter [-j threads] [-c chunkKB] <transformation> [input|-] [output|-]
+ *   BulkConverter -l
+ * The input is cut into chunks of about "chunkKB" (1024 by default), each ending at a line break.
+ *  A line that won't fit in one chunk is cut where FontConverter::convertDocument() would cut it: on a
+ *  syllable boundary for Zawgyi input, and after a space otherwise. Only if there are none of those is
+ *  it cut at an arbitrary letter. Each line is converted on its own, so the result is the same no matter
+ *  how many threads are used.
+ * Chunks are converted by a pool of worker threads, and written out in their original order.
+ *  If the Transformation is not thread-safe, each worker gets an instance of its own.
+ * The throughput is reported on stderr when done.
+ * With --check, nothing is converted. Instead, we check that Zawgyi text converts the same whether or not
+ *  its lines are cut into pieces:
+ *   BulkConverter --check [-m MB] [words.zawgyi.txt]
+ *  A corpus of about "MB" megabytes (8 by default) is made up of lines of words from FontConvertTester's
+ *  word list (some lines with spaces, some without, and a few very long ones). It is converted to
+ *  Myanmar3 and to WinInnwa by FontConverter::convertDocument(), with lines cut into chunks of several
+ *  sizes, and also by the zg2uni and uni2wi Transformations (the latter from the Unicode text). Every
+ *  result must match the conversion with no lines cut at all. Returns 1 if any of them don't.
+ */
+
+
+namespace {
+	//Everything we can build, by id
+	typedef std::function<Transformation* ()> TransformMaker;
+	const std::map<string, TransformMaker>& getTransformations() {
+		static std::map<string, TransformMaker> res;
+		if (res.empty()) {
+			res["self2self"] = [](){ return new Self2Self(); };
+			res["uni2zg"] = [](){ return new Uni2Zg(); };
+			res["zg2uni"] = [](){ return new Zg2Uni(); };
+			res["uni2ayar"] = [](){ return new Uni2Ayar(); };
+			res["ayar2uni"] = [](){ return new Ayar2Uni(); };
+			res["uni2wi"] = [](){ return new Uni2WinInnwa(); };
+		}
+		return res;
+	}
+
+	//The font each Transformation reads, as far as FontConverter::IsSplitPoint() is concerned. Only Zawgyi
+	//  has syllable boundaries of its own; anything else is only cut after a space.
+	int getSourceFont(const string& id) {
+		return id=="zg2uni" ? Zawgyi_One : Myanmar3;
+	}
+
+
+	//One piece of the input, and its converted form
+	struct Job {
+		string input;
+		string output;
+		size_t lines;
+		bool done;
+		Job() : lines(0), done(false) {}
+	};
+	typedef std::shared_ptr<Job> JobPtr;
+
+
+	//Where to cut the next chunk, given that "data" holds at least "limit" bytes (or is the end of the file).
+	size_t findCut(const string& data, size_t limit, bool atEof, int srcFont) {
+		if (data.size()<=limit && atEof)
+			return data.size();
+
+		//Prefer the last line break
+		limit = std::min(limit, data.size());
+		for (size_t i=limit; i>0; i--) {
+			if (data[i-1]=='\n')
+				return i;
+		}
+
+		//Then wherever FontConverter would split the line. We decode a little past "limit", so that it can look ahead.
+		size_t end = std::min(data.size(), limit+64);
+		if (end==data.size() && !atEof) { //The last letter may not all be here yet
+			while (end>0 && (data[end-1]&0xC0)==0x80)
+				end--;
+			end -= (end>0) ? 1 : 0;
+		}
+		while (end<data.size() && end>0 && (data[end]&0xC0)==0x80)
+			end--;
+		wstring text;
+		text.resize(waitzar::Utf8Decoder::MaxDecodedLength(end));
+		text.resize(waitzar::Utf8Decoder::Decode(data.data(), end, text.empty()?NULL:&text[0]));
+		vector<size_t> offsets; //Where each letter starts
+		for (size_t i=0; i<end; i++) {
+			if ((data[i]&0xC0)!=0x80)
+				offsets.push_back(i);
+		}
+		if (offsets.size()==text.size() && !text.empty()) { //Surrogate pairs (on Windows) throw this off; just skip to the fallback.
+			size_t pos = std::upper_bound(offsets.begin(), offsets.end(), limit) - offsets.begin() - 1;
+			for (pos=std::min(pos, text.size()-1); pos>0; pos--) {
+				if (waitzar::FontConverter::IsSplitPoint(srcFont, text, pos))
+					return offsets[pos];
+			}
+		}
+
+		//Then anywhere that isn't in the middle of a UTF-8 sequence
+		size_t cut = limit;
+		while (cut>0 && (data[cut]&0xC0)==0x80)
+			cut--;
+		return cut>0 ? cut : limit;
+	}
+
+
+	//Convert one chunk, line by line. Line endings ("\n" or "\r\n") are preserved.
+	void convertChunk(const Transformation& trans, Job& job) {
+		wstring text;
+		text.resize(waitzar::Utf8Decoder::MaxDecodedLength(job.input.size()));
+		text.resize(waitzar::Utf8Decoder::Decode(job.input.data(), job.input.size(), text.empty()?NULL:&text[0]));
+
+		wstring res;
+		res.reserve(text.size()+text.size()/8);
+		wstring line;
+		for (size_t start=0; start<text.size();) {
+			size_t end = text.find(L'\n', start);
+			size_t next = text.size();
+			if (end==wstring::npos)
+				end = text.size();
+			else {
+				next = end+1;
+				job.lines++;
+			}
+			size_t lineEnd = (end>start && text[end-1]==L'\r') ? end-1 : end;
+
+			line.assign(text, start, lineEnd-start);
+			trans.convertInPlace(line);
+			res += line;
+			res.append(text, lineEnd, next-lineEnd);
+			start = next;
+		}
+
+		job.output.resize(waitzar::Utf8Encoder::MaxEncodedLength(res.size()));
+		job.output.resize(waitzar::Utf8Encoder::Encode(res.data(), res.size(), job.output.empty()?NULL:&job.output[0]));
+	}
+
+
+	//Reads chunks on one thread, converts them on several, and writes them (in order) on the calling thread.
+	class Pipeline {
+	public:
+		Pipeline(FILE* in, FILE* out, size_t chunkSize, size_t maxInFlight, int srcFont)
+			: in(in), out(out), chunkSize(chunkSize), maxInFlight(maxInFlight), srcFont(srcFont), readerDone(false), failed(false),
+			  bytesIn(0), bytesOut(0), lines(0), lastChar('\n') {}
+
+		//Each worker uses the Transformation at the same index.
+		void run(const vector<const Transformation*>& workerTransforms) {
+			std::thread reader([this](){ this->readAll(); });
+			vector<std::thread> workers;
+			for (size_t i=0; i<workerTransforms.size(); i++) {
+				const Transformation* trans = workerTransforms[i];
+				workers.push_back(std::thread([this, trans](){ this->work(*trans); }));
+			}
+
+			writeAll();
+
+			reader.join();
+			for (size_t i=0; i<workers.size(); i++)
+				workers[i].join();
+			if (failed)
+				throw std::runtime_error(error);
+		}
+
+		size_t getBytesIn() const { return bytesIn; }
+		size_t getBytesOut() const { return bytesOut; }
+		size_t getLines() const { return lines; }
+
+	private:
+		FILE* in;
+		FILE* out;
+		size_t chunkSize;
+		size_t maxInFlight;
+		int srcFont;
+
+		//Shared state
+		std::mutex lock;
+		std::condition_variable workReady;
+		std::condition_variable jobDone;
+		std::condition_variable slotFree;
+		std::deque<JobPtr> todo;    //Not started yet
+		std::deque<JobPtr> inOrder; //Not written yet
+		bool readerDone;
+		bool failed;
+		string error;
+
+		//Stats
+		size_t bytesIn;
+		size_t bytesOut;
+		size_t lines;
+		char lastChar;
+
+		void fail(const string& msg) {
+			std::lock_guard<std::mutex> guard(lock);
+			if (!failed) {
+				failed = true;
+				error = msg;
+			}
+			workReady.notify_all();
+			jobDone.notify_all();
+			slotFree.notify_all();
+		}
+
+		void readAll() {
+			string pending;
+			vector<char> buff(chunkSize);
+			bool atEof = false;
+			bool first = true;
+			for (;;) {
+				//Fill up
+				while (!atEof && pending.size()<chunkSize) {
+					size_t read = fread(&buff[0], 1, buff.size(), in);
+					pending.append(&buff[0], read);
+					bytesIn += read;
+					if (read<buff.size()) {
+						if (ferror(in)) {
+							fail("Error reading input file");
+							return;
+						}
+						atEof = true;
+					}
+				}
+
+				//Leave a byte-order mark as it is.
+				JobPtr job(new Job());
+				if (first && pending.compare(0, 3, "\xEF\xBB\xBF")==0) {
+					job->output = pending.substr(0, 3);
+					pending.erase(0, 3);
+				}
+				first = false;
+
+				size_t cut = 0;
+				try {
+					cut = findCut(pending, chunkSize, atEof, srcFont);
+				} catch (std::exception& ex) {
+					fail(string("Error reading input file: ") + ex.what());
+					return;
+				}
+				job->input = pending.substr(0, cut);
+				pending.erase(0, cut);
+
+				//Queue it, once there's room.
+				{
+					std::unique_lock<std::mutex> guard(lock);
+					slotFree.wait(guard, [this](){ return this->failed || this->inOrder.size()<this->maxInFlight; });
+					if (failed)
+						return;
+					todo.push_back(job);
+					inOrder.push_back(job);
+					workReady.notify_one();
+
+					if (atEof && pending.empty()) {
+						readerDone = true;
+						workReady.notify_all();
+						jobDone.notify_all();
+						return;
+					}
+				}
+			}
+		}
+
+		void work(const Transformation& trans) {
+			for (;;) {
+				JobPtr job;
+				{
+					std::unique_lock<std::mutex> guard(lock);
+					workReady.wait(guard, [this](){ return this->failed || this->readerDone || !this->todo.empty(); });
+					if (failed || todo.empty())
+						return;
+					job = todo.front();
+					todo.pop_front();
+				}
+
+				try {
+					string bom = job->output;
+					convertChunk(trans, *job);
+					job->output.insert(0, bom);
+				} catch (std::exception& ex) {
+					fail(string("Error converting text: ") + ex.what());
+					return;
+				}
+
+				std::lock_guard<std::mutex> guard(lock);
+				job->done = true;
+				jobDone.notify_all();
+			}
+		}
+
+		void writeAll() {
+			for (;;) {
+				JobPtr job;
+				{
+					std::unique_lock<std::mutex> guard(lock);
+					jobDone.wait(guard, [this](){
+						return this->failed || (!this->inOrder.empty() && this->inOrder.front()->done) || (this->readerDone && this->inOrder.empty());
+					});
+					if (failed || inOrder.empty())
+						break;
+					job = inOrder.front();
+					inOrder.pop_front();
+					slotFree.notify_one();
+				}
+
+				if (fwrite(job->output.data(), 1, job->output.size(), out)!=job->output.size()) {
+					fail("Error writing output file");
+					break;
+				}
+				bytesOut += job->output.size();
+				lines += job->lines;
+				if (!job->output.empty())
+					lastChar = job->output[job->output.size()-1];
+			}
+
+			//Count the last line, even if it has no line break
+			if (lastChar!='\n' && bytesOut>0)
+				lines++;
+
+			//Drop anything left over after an error. Jobs are shared with whichever thread is using them,
+			//  so one a worker is still converting is freed when that worker lets go of it.
+			std::lock_guard<std::mutex> guard(lock);
+			if (failed) {
+				inOrder.clear();
+				todo.clear();
+			}
+		}
+	};
+
+
+	//Make up a Zawgyi corpus of about "numBytes" UTF-8 bytes, from a list of words (one per line).
+	//  The same corpus is made every time.
+	wstring makeZawgyiCorpus(const string& wordsPath, size_t numBytes) {
+		//Read our words
+		wstring wordList = waitzar::readUTF8File(wordsPath);
+		vector<wstring> words;
+		for (size_t start=0; start<wordList.size();) {
+			size_t end = wordList.find(L'\n', start);
+			if (end==wstring::npos)
+				end = wordList.size();
+			wstring word = wordList.substr(start, end-start);
+			while (!word.empty() && (word[word.size()-1]==L'\r' || word[word.size()-1]==L' '))
+				word.erase(word.size()-1);
+			if (!word.empty() && word[0]==L'\uFEFF')
+				word.erase(0, 1);
+			if (!word.empty())
+				words.push_back(word);
+			start = end+1;
+		}
+		if (words.empty())
+			throw std::runtime_error("No words in: " + wordsPath);
+
+		//Lines of 20 to 320 words; every other line has no spaces (as most Myanmar text doesn't), and
+		//  every 64th line is a few thousand words long.
+		wstring res;
+		size_t numChars = numBytes/3; //Myanmar letters are 3 bytes each in UTF-8
+		unsigned int rand = 12345;
+		for (size_t line=0; res.size()<numChars; line++) {
+			rand = rand*1103515245 + 12345;
+			size_t numWords = (line%64==63) ? 5000 : 20 + (rand>>16)%301;
+			for (size_t i=0; i<numWords; i++) {
+				rand = rand*1103515245 + 12345;
+				if (i>0 && line%2==0)
+					res += L' ';
+				res += words[(rand>>16)%words.size()];
+			}
+			res += L"\r\n";
+		}
+		return res;
+	}
+
+
+	//The length of the longest line, which is the smallest chunk that never cuts one.
+	size_t longestLine(const wstring& text) {
+		size_t res = 0;
+		for (size_t start=0; start<text.size();) {
+			size_t end = text.find(L'\n', start);
+			if (end==wstring::npos)
+				end = text.size();
+			res = std::max(res, end-start);
+			start = end+1;
+		}
+		return res;
+	}
+
+
+	double secondsSince(const std::chrono::high_resolution_clock::time_point& start) {
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now()-start).count()/1000000.0;
+	}
+
+
+	//Compare a result against what we expected, and say so.
+	bool reportSame(const wstring& res, const wstring& expected) {
+		if (res==expected) {
+			printf("same\n");
+			return true;
+		}
+		size_t diff = 0;
+		while (diff<res.size() && diff<expected.size() && res[diff]==expected[diff])
+			diff++;
+		printf("DIFFERENT, from letter %u\n", (unsigned int)diff);
+		return false;
+	}
+
+
+	//Convert "text" with lines cut into chunks of several sizes; each must match "expected". The smallest
+	//  chunk is longer than any syllable in FontConvertTester's words, so no cut falls inside one.
+	bool checkChunks(const waitzar::FontConverter& conv, const wstring& text, const wstring& expected) {
+		bool same = true;
+		const size_t chunkSizes[] = {16, 37, 64, 1024};
+		for (size_t i=0; i<sizeof(chunkSizes)/sizeof(chunkSizes[0]); i++) {
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			wstring res = conv.convertDocument(text, chunkSizes[i]);
+			printf("  chunks of %4u:  %.3f s  ", (unsigned int)chunkSizes[i], secondsSince(start));
+			same = reportSame(res, expected) && same;
+		}
+		return same;
+	}
+
+
+	int selfCheck(const string& wordsPath, size_t megabytes) {
+		wstring zawgyi = makeZawgyiCorpus(wordsPath, megabytes*1024*1024);
+		printf("Corpus: %.2f MB of UTF-8, the longest line %u letters\n", waitzar::Utf8Encoder::Encode(zawgyi.data(), zawgyi.size(), NULL)/(1024.0*1024.0), (unsigned int)longestLine(zawgyi));
+
+		//Zawgyi to Unicode
+		const waitzar::FontConverter& toUni = waitzar::FontConverter::Get(Zawgyi_One, Myanmar3);
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		wstring unicode = toUni.convertDocument(zawgyi, longestLine(zawgyi));
+		printf("zg2uni, unchunked:  %.3f s\n", secondsSince(start));
+		bool same = checkChunks(toUni, zawgyi, unicode);
+
+		wstring res = zawgyi;
+		start = std::chrono::high_resolution_clock::now();
+		Zg2Uni().convertInPlace(res);
+		printf("  Transformation:  %.3f s  ", secondsSince(start));
+		same = reportSame(res, unicode) && same;
+
+		//Zawgyi to WinInnwa; the Transformation starts from Unicode, and renders it as Zawgyi first.
+		const waitzar::FontConverter& toWI = waitzar::FontConverter::Get(Zawgyi_One, WinInnwa);
+		start = std::chrono::high_resolution_clock::now();
+		wstring winInnwa = toWI.convertDocument(zawgyi, longestLine(zawgyi));
+		printf("uni2wi, unchunked:  %.3f s\n", secondsSince(start));
+		same = checkChunks(toWI, zawgyi, winInnwa) && same;
+
+		wstring rendered = waitzar::renderAsZawgyi(unicode);
+		wstring expected = toWI.convertDocument(rendered, longestLine(rendered));
+		res = unicode;
+		start = std::chrono::high_resolution_clock::now();
+		Uni2WinInnwa().convertInPlace(res);
+		printf("  Transformation:  %.3f s  ", secondsSince(start));
+		same = reportSame(res, expected) && same;
+
+		return same ? 0 : 1;
+	}
+
+
+	void printUsage() {
+		fprintf(stderr, "Usage: BulkConverter [-j threads] [-c chunkKB] <transformation> [input|-] [output|-]\n");
+		fprintf(stderr, "       BulkConverter -l    (list transformations)\n");
+		fprintf(stderr, "       BulkConverter --check [-m MB] [words.zawgyi.txt]\n");
+	}
+}
+
+
+int main(int argc, const char* argv[])
+{
+	//Read our arguments
+	size_t numThreads = std::thread::hardware_concurrency();
+	size_t chunkKB = 1024;
+	bool check = false;
+	size_t checkMB = 8;
+	vector<string> files;
+	for (int i=1; i<argc; i++) {
+		if (strcmp(argv[i], "-l")==0) {
+			for (auto it=getTransformations().begin(); it!=getTransformations().end(); it++)
+				printf("%s\n", it->first.c_str());
+			return 0;
+		} else if (strcmp(argv[i], "-j")==0 && i+1<argc)
+			numThreads = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "-c")==0 && i+1<argc)
+			chunkKB = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--check")==0)
+			check = true;
+		else if (strcmp(argv[i], "-m")==0 && i+1<argc)
+			checkMB = strtoul(argv[++i], NULL, 10);
+		else
+			files.push_back(argv[i]);
+	}
+	if (check) {
+		if (files.size()>1 || checkMB==0) {
+			printUsage();
+			return 1;
+		}
+		try {
+			return selfCheck(files.empty() ? "../FontConvertTester/words.zawgyi.txt" : files[0], checkMB);
+		} catch (std::exception& ex) {
+			fprintf(stderr, "%s\n", ex.what());
+			return 1;
+		}
+	}
+	if (files.empty() || files.size()>3 || chunkKB==0) {
+		printUsage();
+		return 1;
+	}
+	if (numThreads==0)
+		numThreads = 1;
+	auto maker = getTransformations().find(files[0]);
+	if (maker==getTransformations().end()) {
+		fprintf(stderr, "Error: unknown transformation \"%s\" (use -l for a list)\n", files[0].c_str());
+		return 1;
+	}
+
+	//Open our files
+	FILE* in = stdin;
+	FILE* out = stdout;
+	if (files.size()>1 && files[1]!="-")
+		in = fopen(files[1].c_str(), "rb");
+	if (files.size()>2 && files[2]!="-")
+		out = fopen(files[2].c_str(), "wb");
+	if (in==NULL || out==NULL) {
+		fprintf(stderr, "Error: could not open %s file\n", in==NULL?"input":"output");
+		return 1;
+	}
+
+	int res = 0;
+	try {
+		//Share one Transformation between all workers, if we can.
+		vector< std::shared_ptr<Transformation> > owned;
+		owned.push_back(std::shared_ptr<Transformation>(maker->second()));
+		bool shared = owned[0]->isThreadSafe();
+		while (!shared && owned.size()<numThreads)
+			owned.push_back(std::shared_ptr<Transformation>(maker->second()));
+		vector<const Transformation*> workerTransforms;
+		for (size_t i=0; i<numThreads; i++)
+			workerTransforms.push_back(owned[shared?0:i].get());
+
+		//Convert
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		Pipeline pipeline(in, out, chunkKB*1024, numThreads*4, getSourceFont(files[0]));
+		pipeline.run(workerTransforms);
+		fflush(out);
+		double secs = secondsSince(start);
+
+		//Report
+		double mb = pipeline.getBytesIn()/(1024.0*1024.0);
+		fprintf(stderr, "Converted %.2f MB (%lu lines) to %.2f MB in %.3f s: %.2f MB/s, %.0f lines/s\n",
+			mb, (unsigned long)pipeline.getLines(), pipeline.getBytesOut()/(1024.0*1024.0), secs,
+			secs>0 ? mb/secs : 0.0, secs>0 ? pipeline.getLines()/secs : 0.0);
+		fprintf(stderr, "Used %lu thread(s), with %s\n", (unsigned long)numThreads, shared?"one shared Transformation":"one Transformation per thread");
+	} catch (std::exception& ex) {
+		fprintf(stderr, "%s\n", ex.what());
+		res = 1;
+	}
+
+	if (in!=stdin)
+		fclose(in);
+	if (out!=stdout)
+		fclose(out);
+	return res;
+}
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
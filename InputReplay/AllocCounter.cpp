@@ -0,0 +1,87 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#include <stdlib.h>
+#include <new>
+
+#include "AllocCounter.h"
+
+
+size_t AllocCounter::numAllocs = 0;
+size_t AllocCounter::numAllocBytes = 0;
+
+
+namespace {
+	//Every replacement goes through this pair, so that memory from any form of "new" can be released
+	// by any form of "delete", just like with the library's versions.
+	void* countedAlloc(size_t size) throw() {
+		AllocCounter::numAllocs++;
+		AllocCounter::numAllocBytes += size;
+		return malloc(size>0 ? size : 1);
+	}
+	void countedFree(void* ptr) throw() {
+		free(ptr);
+	}
+}
+
+
+void* operator new(size_t size) {
+	void* res = countedAlloc(size);
+	if (res==NULL)
+		throw std::bad_alloc();
+	return res;
+}
+void* operator new[](size_t size) {
+	void* res = countedAlloc(size);
+	if (res==NULL)
+		throw std::bad_alloc();
+	return res;
+}
+void* operator new(size_t size, const std::nothrow_t&) throw() {
+	return countedAlloc(size);
+}
+void* operator new[](size_t size, const std::nothrow_t&) throw() {
+	return countedAlloc(size);
+}
+
+void operator delete(void* ptr) throw() {
+	countedFree(ptr);
+}
+void operator delete[](void* ptr) throw() {
+	countedFree(ptr);
+}
+void operator delete(void* ptr, const std::nothrow_t&) throw() {
+	countedFree(ptr);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) throw() {
+	countedFree(ptr);
+}
+
+#if defined(__cpp_sized_deallocation)
+//Only C++14 compilers call these; we don't need the size.
+void operator delete(void* ptr, size_t) throw() {
+	countedFree(ptr);
+}
+void operator delete[](void* ptr, size_t) throw() {
+	countedFree(ptr);
+}
+#endif
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#ifndef _ALLOC_COUNTER
+#define _ALLOC_COUNTER
+
+#include <stddef.h>
+
+//Every form of the global operator new and delete is replaced in AllocCounter.cpp, which counts each
+//  allocation. These live in their own file so that the compiler can't inline "delete" into code that
+//  it also sees calling "new" (GCC mistakes the malloc/free pair for a mismatch if it can).
+//We're single-threaded, so there's no need for anything fancier.
+namespace AllocCounter {
+	extern size_t numAllocs;
+	extern size_t numAllocBytes;
+}
+
+#endif //_ALLOC_COUNTER
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
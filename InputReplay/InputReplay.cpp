@@ -0,0 +1,601 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+//Don't let Visual Studio warn us to use the _s functions
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <chrono>
+#include <algorithm>
+
+#include "AllocCounter.h"
+#include "MyWin32Window.h"
+#include "OnscreenKeyboard.h"
+#include "Input/VirtKey.h"
+#include "Input/KeyMagicInputMethod.h"
+#include "Input/keymagic_vkeys.h"
+#include "Settings/ConfigManager.h"
+#include "Settings/RuntimeConfig.h"
+#include "Settings/WZFactory.h"
+#include "NGram/wz_utilities.h"
+
+using std::string;
+using std::wstring;
+using std::vector;
+using std::pair;
+
+
+/**
+ * Replays keystrokes through an input method, without any windows, and reports how long each one took.
+ *  The config directory is loaded through the ConfigManager exactly as WaitZar does, and the input methods
+ *  are built by the headless WZFactory (see headless/Settings/WZFactory.h).
+ * Usage:
+ *   InputReplay [-c configDir] [-r resourceDir] [-n repeat] [-t trace]... [tests]...
+ * Each "tests" file is a regression test file, like test_cases/myanmar3_tests.txt; it's checked the same
+ *  way "WaitZar.exe -t" checks it. Key Magic tests are then typed once more, untimed, with the automaton
+ *  checked against the old matcher (as "WaitZar.exe -t" does). Each "trace" is a recorded typing session,
+ *  which is only timed:
+ *    # A comment
+ *    @language = myanmar
+ *    @input-method = waitzar
+ *    @output-encoding = unicode
+ *    kote<VK_SPACE>tha<VK_SPACE><VK_RETURN>
+ *  Letters are typed on an en-US keyboard (so "A" is Shift+A); anything else is written by name, with
+ *  optional modifiers, like <VK_BACK> or <Shift+VK_OEM_COMMA> (which is how you type "<"). Line breaks
+ *  are ignored.
+ * Every keystroke is timed from the key press to the point where the windows would be ready to repaint.
+ *  We also count every call to "new" made while handling it. With "-n", each file is replayed that many
+ *  times, to get more samples. Returns 1 if any test failed.
+ */
+
+
+namespace {
+	//Everything we measured for one file.
+	struct Stats {
+		vector<double> keyMicros;
+		size_t allocs;
+		size_t allocBytes;
+		size_t tests;
+		size_t failed;
+		Stats() : allocs(0), allocBytes(0), tests(0), failed(0) {}
+	};
+
+
+	//One key to press. (VirtKeys point into themselves, so we can't keep copies of them.)
+	struct KeyPress {
+		unsigned int vkCode;
+		bool shift;
+		bool alt;
+		bool ctrl;
+		KeyPress(unsigned int vkCode, bool shift, bool alt, bool ctrl) : vkCode(vkCode), shift(shift), alt(alt), ctrl(ctrl) {}
+	};
+
+
+	//Stand-ins for the windows that WaitZar would show.
+	MyWin32Window mainWindow;
+	MyWin32Window sentenceWindow;
+	MyWin32Window helpWindow;
+	MyWin32Window memoryWindow;
+	OnscreenKeyboard helpKeyboard;
+
+
+	//The input method we're typing into, and the transformations MainFile would use with it.
+	struct Session {
+		RuntimeConfig* config;
+		InputMethod* input;
+		const TransNode* input2Uni;
+		const TransNode* uni2Output;
+		const TransNode* uni2Disp;
+		bool canDisplay;
+		wstring typed; //Everything sent to the "foreground" window
+	};
+
+
+	double microsSince(const std::chrono::high_resolution_clock::time_point& start) {
+		return std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+
+	//Convert from the input method's encoding to another one, the way MainFile does.
+	void convert(const Session& s, const TransNode* toEnc, wstring& str) {
+		if (toEnc->toEncoding==s.input->getEncoding())
+			return;
+		s.input2Uni->getImpl()->convertInPlace(str);
+		toEnc->getImpl()->convertInPlace(str);
+	}
+
+
+	//Same as MainFile's function of the same name.
+	void checkAllHotkeysAndWindows(Session& s) {
+		//Should the main window be visible?
+		if (!s.input->getTypedRomanString(false).empty() || s.input->isHelpInput()) {
+			mainWindow.showWindow(true);
+		} else {
+			mainWindow.showWindow(false);
+			s.input->reset(true, true, false, false);
+		}
+
+		//Should the sentence window be visible?
+		if (!s.input->getTypedSentenceStrings()[3].empty() || s.input->isHelpInput() || mainWindow.isVisible()) {
+			sentenceWindow.showWindow(true);
+			s.input->forceViewChanged();
+		} else {
+			sentenceWindow.showWindow(false);
+			s.input->reset(true, true, true, true);
+		}
+	}
+
+
+	//Everything MainFile's recalculate() asks the input method for, converted to the display encoding.
+	void recalculate(Session& s) {
+		if (!s.canDisplay)
+			return;
+		wstring roman = s.input->getTypedRomanString(false);
+		convert(s, s.uni2Disp, roman);
+		vector<wstring> sentence = s.input->getTypedSentenceStrings();
+		for (auto it=sentence.begin(); it!=sentence.end(); it++)
+			convert(s, s.uni2Disp, *it);
+		vector< pair<wstring, unsigned int> > candidates = s.input->getTypedCandidateStrings();
+		for (auto it=candidates.begin(); it!=candidates.end(); it++)
+			convert(s, s.uni2Disp, it->first);
+		s.input->getPagingInfo();
+	}
+
+
+	//One keystroke, handled the way MainFile's WM_HOTKEY handler does it. Tests skip the hotkey
+	//   dispatch (and so never type anything), just like "WaitZar.exe -t" does.
+	void typeKey(Session& s, VirtKey& vk, bool asTest) {
+		if (asTest) {
+			s.input->handleKeyPress(vk);
+			if (s.input->getAndClearViewChanged())
+				recalculate(s);
+			return;
+		}
+
+		bool wasProvidingHelp = s.input->isHelpInput();
+		bool wasEmptySentence = s.input->getTypedSentenceStrings()[3].empty();
+		bool wasEmptyRoman = s.input->getTypedRomanString(false).empty();
+
+		s.input->handleVKey(vk);
+		wstring stringToType = s.input->getTypedSentenceStrings()[3];
+
+		//Did something change?
+		if (    (wasEmptySentence != s.input->getTypedSentenceStrings()[3].empty())
+			||  (wasEmptyRoman != s.input->getTypedRomanString(false).empty())
+			||  (wasProvidingHelp != s.input->isHelpInput()))
+			checkAllHotkeysAndWindows(s);
+
+		//Type the sentence?
+		if (s.input->getAndClearRequestToTypeSentence()) {
+			convert(s, s.uni2Output, stringToType);
+			s.typed += waitzar::removeZWS(stringToType, s.config->getSettings().ignoredCharacters);
+			s.input->reset(true, true, true, true);
+			mainWindow.showWindow(false);
+			sentenceWindow.showWindow(false);
+		}
+
+		//Repaint?
+		if (s.input->getAndClearViewChanged())
+			recalculate(s);
+	}
+
+
+	//Time one keystroke, starting from the hotkey message.
+	void timeKey(Session& s, const KeyPress& key, bool asTest, Stats& stats) {
+		size_t startAllocs = AllocCounter::numAllocs;
+		size_t startBytes = AllocCounter::numAllocBytes;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		VirtKey vk(key.vkCode, key.shift, key.alt, key.ctrl);
+		typeKey(s, vk, asTest);
+		double micros = microsSince(start);
+		stats.allocs += AllocCounter::numAllocs - startAllocs;
+		stats.allocBytes += AllocCounter::numAllocBytes - startBytes;
+		stats.keyMicros.push_back(micros);
+	}
+
+
+	//The key you'd press to type an ASCII letter on an en-US keyboard; false if there isn't one.
+	bool asciiToKey(char c, unsigned int& vkCode, bool& shift) {
+		static const string unshifted = "`-=[]\\;',./";
+		static const string shifted = "~_+{}|:\"<>?";
+		static const unsigned int oemKeys[] = {VK_OEM_3, VK_OEM_MINUS, VK_OEM_PLUS, VK_OEM_4, VK_OEM_6, VK_OEM_5, VK_OEM_1, VK_OEM_7, VK_OEM_COMMA, VK_OEM_PERIOD, VK_OEM_2};
+		static const string shiftedNumbers = ")!@#$%^&*(";
+		shift = false;
+		if (c>='a' && c<='z') {
+			vkCode = c - 'a' + 'A';
+		} else if (c>='A' && c<='Z') {
+			vkCode = c;
+			shift = true;
+		} else if (c>='0' && c<='9') {
+			vkCode = c;
+		} else if (c==' ') {
+			vkCode = VK_SPACE;
+		} else if (shiftedNumbers.find(c)!=string::npos) {
+			vkCode = '0' + shiftedNumbers.find(c);
+			shift = true;
+		} else if (unshifted.find(c)!=string::npos) {
+			vkCode = oemKeys[unshifted.find(c)];
+		} else if (shifted.find(c)!=string::npos) {
+			vkCode = oemKeys[shifted.find(c)];
+			shift = true;
+		} else {
+			return false;
+		}
+		return true;
+	}
+
+
+	//Parse a named key, like "Shift+VK_LEFT"
+	KeyPress namedKey(const wstring& name) {
+		//Modifiers
+		bool shift=false, alt=false, ctrl=false;
+		wstring key = name;
+		for (;;) {
+			if (key.find(L"Shift+")==0) {
+				shift = true;
+				key = key.substr(6);
+			} else if (key.find(L"Alt+")==0) {
+				alt = true;
+				key = key.substr(4);
+			} else if (key.find(L"Ctrl+")==0) {
+				ctrl = true;
+				key = key.substr(5);
+			} else {
+				break;
+			}
+		}
+
+		//Key Magic's names, plus the arrow keys (which it doesn't need)
+		for (size_t i=0; !KeyMagicVKeys[i].keyName.empty(); i++) {
+			if (KeyMagicVKeys[i].keyName==key)
+				return KeyPress(KeyMagicVKeys[i].keyValue, shift, alt, ctrl);
+		}
+		const wchar_t* arrowNames[] = {L"VK_LEFT", L"VK_UP", L"VK_RIGHT", L"VK_DOWN"};
+		for (size_t i=0; i<4; i++) {
+			if (key==arrowNames[i])
+				return KeyPress(VK_LEFT+i, shift, alt, ctrl);
+		}
+		throw std::runtime_error(waitzar::glue(L"Unknown key: <", name, L">").c_str());
+	}
+
+
+	//Find the input method (and its transformations) for these options, or throw.
+	Session startSession(RuntimeConfig& config, const wstring& language, const wstring& inputMethod, const wstring& outEncoding) {
+		if (language.empty())
+			throw std::runtime_error("Missing the \"language\" option.");
+		if (inputMethod.empty())
+			throw std::runtime_error("Missing the \"input-method\" option.");
+		if (outEncoding.empty())
+			throw std::runtime_error("Missing the \"output-encoding\" option.");
+
+		//Check that each of these exist.
+		{
+			const vector<LangNode>& vec = config.getLanguages();
+			bool found = false;
+			for (auto it=vec.begin(); it!=vec.end() && !found; it++)
+				found = (it->id==language);
+			if (!found)
+				throw std::runtime_error(waitzar::glue(L"Unknown language: \"", language, L"\"").c_str());
+			config.setActiveLanguage(language);
+		}
+		{
+			const vector<InMethNode>& vec = config.getActiveInputMethods();
+			bool found = false;
+			for (auto it=vec.begin(); it!=vec.end() && !found; it++)
+				found = (it->id==inputMethod);
+			if (!found)
+				throw std::runtime_error(waitzar::glue(L"Unknown input method: \"", inputMethod, L"\"").c_str());
+			config.setActiveInputMethod(inputMethod);
+		}
+		{
+			const vector<EncNode>& vec = config.getActiveEncodings();
+			bool found = false;
+			for (auto it=vec.begin(); it!=vec.end() && !found; it++)
+				found = (it->id==outEncoding);
+			if (!found)
+				throw std::runtime_error(waitzar::glue(L"Unknown output encoding: \"", outEncoding, L"\"").c_str());
+			config.setActiveOutputEncoding(outEncoding);
+		}
+
+		//Build it
+		Session res;
+		res.config = &config;
+		res.input = config.getActiveInputMethod().getImpl();
+		res.input2Uni = &config.getActiveTransformation(config.getActiveInputMethod().encoding, L"unicode");
+		res.uni2Output = &config.getActiveTransformation(L"unicode", config.getActiveOutputEncoding().id);
+		res.uni2Disp = &config.getActiveTransformation(L"unicode", config.getActiveDisplayMethodPair().first.encoding);
+
+		//We can't show the input if it's converted by a javascript transformation; that's a DLL.
+		try {
+			res.input2Uni->getImpl();
+			res.uni2Disp->getImpl();
+			res.canDisplay = true;
+		} catch (std::exception&) {
+			res.canDisplay = false;
+		}
+
+		//Start with a clean slate, like WaitZar does when switching to it. Key Magic keyboards match the
+		// way the config says to, in case a previous test file left the automaton cross-check on.
+		res.input->reset(true, true, true, true);
+		KeyMagicInputMethod* kmInput = dynamic_cast<KeyMagicInputMethod*>(res.input);
+		if (kmInput!=NULL)
+			kmInput->setUseAutomaton(config.getActiveInputMethod().useAutomaton);
+		mainWindow.showWindow(false);
+		sentenceWindow.showWindow(false);
+		return res;
+	}
+
+
+	//Check a regression test file, as "WaitZar.exe -t" would. If "crossCheck" is set, Key Magic keyboards
+	// also check their automaton against the normal matcher. That finds every match twice, so it's
+	// never timed, and the results aren't counted again.
+	void runTests(RuntimeConfig& config, const string& path, Stats& stats, bool crossCheck) {
+		//Open our test file, read it into a Key Magic Keyboard
+		KeyMagicInputMethod testFile;
+		testFile.loadTextRulesFile(path);
+		Session s = startSession(config, testFile.getOption(L"language"), testFile.getOption(waitzar::sanitize_id(L"input-method")), testFile.getOption(waitzar::sanitize_id(L"output-encoding")));
+		vector< pair<wstring, wstring> > testPairs = testFile.convertToRulePairs();
+
+		KeyMagicInputMethod* kmInput = dynamic_cast<KeyMagicInputMethod*>(s.input);
+		if (crossCheck) {
+			if (kmInput==NULL)
+				return;
+			kmInput->setUseAutomaton(true, true);
+		}
+
+		for (auto currTest=testPairs.begin(); currTest!=testPairs.end(); currTest++) {
+			//Reset the input method
+			s.input->reset(true, true, true, true);
+
+			//Type each letter
+			for (size_t i=0; i<currTest->first.length(); i++) {
+				unsigned int vkCode = 0;
+				bool shift = false;
+				wchar_t wc = currTest->first[i];
+				if (wc>=0x7F || !asciiToKey(static_cast<char>(wc), vkCode, shift))
+					throw std::runtime_error(waitzar::glue(L"Unknown input letter in test: ", currTest->first).c_str());
+				if (crossCheck) {
+					VirtKey vk(vkCode, shift, false, false);
+					typeKey(s, vk, true);
+				} else
+					timeKey(s, KeyPress(vkCode, shift, false, false), true, stats);
+			}
+			if (crossCheck)
+				continue;
+
+			//Retrieve the output, in the correct encoding.
+			wstring resOut = s.input->getTypedSentenceStrings()[3];
+			convert(s, s.uni2Output, resOut);
+			resOut = waitzar::removeZWS(resOut, config.getSettings().ignoredCharacters);
+
+			//Compare
+			stats.tests++;
+			if (currTest->second != resOut) {
+				stats.failed++;
+				printf("  FAIL: %s => %s\n", waitzar::wcs2mbs(currTest->first).c_str(), waitzar::wcs2mbs(currTest->second).c_str());
+				printf("        Actual result: %s\n", waitzar::wcs2mbs(resOut).c_str());
+			}
+		}
+	}
+
+
+	//Replay a recorded typing session
+	void runTrace(RuntimeConfig& config, const string& path, Stats& stats) {
+		//Read options and keys
+		wstring trace = waitzar::readUTF8File(path);
+		std::map<wstring, wstring> options;
+		vector<KeyPress> keys;
+		size_t lineStart = 0;
+		while (lineStart<trace.size()) {
+			size_t lineEnd = trace.find(L'\n', lineStart);
+			if (lineEnd==wstring::npos)
+				lineEnd = trace.size();
+			wstring line = trace.substr(lineStart, lineEnd-lineStart);
+			lineStart = lineEnd + 1;
+			if (!line.empty() && line[line.size()-1]==L'\r')
+				line.erase(line.size()-1);
+			if (!line.empty() && line[0]==0xFEFF)
+				line.erase(0, 1);
+
+			//Comments and options
+			if (line.empty() || line[0]==L'#')
+				continue;
+			if (line[0]==L'@') {
+				size_t eq = line.find(L'=');
+				if (eq==wstring::npos)
+					throw std::runtime_error(waitzar::glue(L"Invalid option line: ", line).c_str());
+				wstring key = line.substr(1, eq-1);
+				wstring val = line.substr(eq+1);
+				key.erase(std::remove(key.begin(), key.end(), L' '), key.end());
+				val.erase(std::remove(val.begin(), val.end(), L' '), val.end());
+				options[key] = val;
+				continue;
+			}
+
+			//Keys
+			for (size_t i=0; i<line.size(); i++) {
+				if (line[i]==L'<') {
+					size_t end = line.find(L'>', i);
+					if (end==wstring::npos)
+						throw std::runtime_error(waitzar::glue(L"Unterminated key name: ", line.substr(i)).c_str());
+					keys.push_back(namedKey(line.substr(i+1, end-i-1)));
+					i = end;
+				} else {
+					unsigned int vkCode = 0;
+					bool shift = false;
+					if (line[i]>=0x7F || !asciiToKey(static_cast<char>(line[i]), vkCode, shift))
+						throw std::runtime_error(waitzar::glue(L"Can't type this letter: ", line.substr(i, 1)).c_str());
+					keys.push_back(KeyPress(vkCode, shift, false, false));
+				}
+			}
+		}
+
+		//Replay them
+		Session s = startSession(config, options[L"language"], options[L"input-method"], options[L"output-encoding"]);
+		stats.keyMicros.reserve(stats.keyMicros.size() + keys.size());
+		for (auto it=keys.begin(); it!=keys.end(); it++)
+			timeKey(s, *it, false, stats);
+	}
+
+
+	//Every sub-directory of "dir" that contains "fileName", in sorted order (as MainFile's GetConfigSubDirs)
+	vector<string> getConfigSubDirs(const string& dir, const string& fileName) {
+		vector<string> res;
+		DIR* d = opendir(dir.c_str());
+		if (d==NULL)
+			return res;
+		for (dirent* ent=readdir(d); ent!=NULL; ent=readdir(d)) {
+			string name = ent->d_name;
+			if (name=="." || name=="..")
+				continue;
+			FILE* f = fopen((dir + "/" + name + "/" + fileName).c_str(), "rb");
+			if (f!=NULL) {
+				fclose(f);
+				res.push_back(name);
+			}
+		}
+		closedir(d);
+		std::sort(res.begin(), res.end());
+		return res;
+	}
+
+
+	//Merge in every config file, in the same order that WaitZar does.
+	RuntimeConfig loadConfig(ConfigManager& cfgMgr, const string& cfgDir) {
+		const string cfgFile = "config.json.txt";
+		cfgMgr.mergeInConfigFile(cfgDir + "/" + cfgFile, PrimaryCfgPerm());
+		vector<string> langFolderNames = getConfigSubDirs(cfgDir, cfgFile);
+		for (auto fold=langFolderNames.begin(); fold!=langFolderNames.end(); fold++) {
+			string langCfgDir = cfgDir + "/" + *fold;
+			if (*fold == "Common") {
+				cfgMgr.mergeInConfigFile(langCfgDir + "/" + cfgFile, ExtendCfgPerm());
+				continue;
+			}
+			cfgMgr.mergeInConfigFile(langCfgDir + "/" + cfgFile, LangLevelCfgPerm());
+			vector<string> modFolders = getConfigSubDirs(langCfgDir, cfgFile);
+			for (auto mod=modFolders.begin(); mod!=modFolders.end(); mod++)
+				cfgMgr.mergeInConfigFile(langCfgDir + "/" + *mod + "/" + cfgFile, LangLevelCfgPerm());
+		}
+
+		//Nothing was "last used"
+		return RuntimeConfig(cfgMgr.sealConfig(std::map<wstring, vector<wstring> >()));
+	}
+
+
+	//Print one row of our table
+	void printStats(const string& name, Stats& stats) {
+		std::sort(stats.keyMicros.begin(), stats.keyMicros.end());
+		size_t n = stats.keyMicros.size();
+		double p50=0, p99=0, p999=0, max=0;
+		if (n>0) {
+			p50 = stats.keyMicros[(n-1)*50/100];
+			p99 = stats.keyMicros[(n-1)*99/100];
+			p999 = stats.keyMicros[(n-1)*999/1000];
+			max = stats.keyMicros[n-1];
+		}
+		double keys = n>0 ? n : 1;
+		printf("%-28s %7u %6u %6u %9.1f %9.1f %9.1f %9.1f %9.1f %11.1f\n", name.c_str(), (unsigned int)n, (unsigned int)stats.tests, (unsigned int)stats.failed, p50, p99, p999, max, stats.allocs/keys, stats.allocBytes/keys);
+	}
+
+
+	void printUsage() {
+		printf("Usage: InputReplay [-c configDir] [-r resourceDir] [-n repeat] [-t trace]... [tests]...\n");
+	}
+}
+
+
+
+int main(int argc, const char* argv[])
+{
+	//Read our arguments
+	string cfgDir = "../win32_source/config";
+	string resDir = "../win32_source/Resources";
+	size_t repeat = 1;
+	vector< pair<string, bool> > files; //path, isTrace
+	for (int i=1; i<argc; i++) {
+		if (strcmp(argv[i], "-c")==0 && i+1<argc)
+			cfgDir = argv[++i];
+		else if (strcmp(argv[i], "-r")==0 && i+1<argc)
+			resDir = argv[++i];
+		else if (strcmp(argv[i], "-n")==0 && i+1<argc)
+			repeat = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "-t")==0 && i+1<argc)
+			files.push_back(pair<string, bool>(argv[++i], true));
+		else if (argv[i][0]=='-') {
+			printUsage();
+			return 1;
+		} else
+			files.push_back(pair<string, bool>(argv[i], false));
+	}
+	if (files.empty() || repeat==0) {
+		printUsage();
+		return 1;
+	}
+
+	//Load the config, building every input method we can.
+	RuntimeConfig config;
+	try {
+		WZFactory::InitAll(resDir, &mainWindow, &sentenceWindow, &helpWindow, &memoryWindow, &helpKeyboard);
+		ConfigManager cfgMgr;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		config = loadConfig(cfgMgr, cfgDir);
+		printf("Config loaded in %.1f ms\n\n", microsSince(start)/1000);
+	} catch (std::exception& ex) {
+		printf("Error loading config: %s\n", ex.what());
+		return 1;
+	}
+
+	//Replay each file
+	printf("%-28s %7s %6s %6s %9s %9s %9s %9s %9s %11s\n", "file", "keys", "tests", "failed", "p50(us)", "p99(us)", "p999(us)", "max(us)", "allocs/key", "bytes/key");
+	size_t totalFailed = 0;
+	bool anyError = false;
+	for (auto it=files.begin(); it!=files.end(); it++) {
+		string name = it->first.substr(it->first.find_last_of("/\\")==string::npos ? 0 : it->first.find_last_of("/\\")+1);
+		Stats stats;
+		try {
+			for (size_t i=0; i<repeat; i++) {
+				if (it->second)
+					runTrace(config, it->first, stats);
+				else
+					runTests(config, it->first, stats, false);
+			}
+			if (!it->second)
+				runTests(config, it->first, stats, true);
+		} catch (std::exception& ex) {
+			printf("%-28s skipped: %s\n", name.c_str(), ex.what());
+			anyError = true;
+			continue;
+		}
+		totalFailed += stats.failed;
+		printStats(name, stats);
+	}
+
+	return (totalFailed>0 || anyError) ? 1 : 0;
+}
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
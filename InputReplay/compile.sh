@@ -0,0 +1,2 @@
+SRC=../win32_source
+g++ -std=c++0x -O2 -pthread -Iheadless -I$SRC -I$SRC/Contrib -o InputReplay InputReplay.cpp AllocCounter.cpp headless/Settings/WZFactory.cpp $SRC/Settings/WZFactoryVerify.cpp $SRC/Settings/WZFactoryInput.cpp $SRC/Settings/ConfigManager.cpp $SRC/Settings/ConfigTreeWalker.cpp $SRC/Settings/RuntimeConfig.cpp $SRC/Settings/OptionStack.cpp $SRC/Settings/ConfigSnapshot.cpp $SRC/Input/InputMethod.cpp $SRC/Input/RomanInputMethod.cpp $SRC/Input/LetterInputMethod.cpp $SRC/Input/KeyMagicInputMethod.cpp $SRC/Input/KeyMagicAutomaton.cpp $SRC/Input/VirtKey.cpp $SRC/Contrib/NGram/wz_utilities.cpp $SRC/Contrib/NGram/Logger.cpp $SRC/Contrib/NGram/WordBuilder.cpp $SRC/Contrib/NGram/BurglishBuilder.cpp $SRC/Contrib/NGram/SentenceList.cpp $SRC/Contrib/NGram/TrigramLookup.cpp $SRC/Contrib/NGram/BinaryModel.cpp $SRC/Contrib/NGram/BinaryTrigramModel.cpp $SRC/Contrib/NGram/MappedFile.cpp $SRC/Contrib/NGram/NexusTrie.cpp $SRC/Contrib/NGram/Utf8Transcoder.cpp $SRC/Contrib/MD5/md5simple.c "$SRC/Contrib/Json CPP/json_reader.cpp" "$SRC/Contrib/Json CPP/json_value.cpp" "$SRC/Contrib/Json CPP/json_valueiterator.cpp" $SRC/Contrib/Burglish/fontconv.cpp $SRC/Contrib/Burglish/fontmap.cpp $SRC/Contrib/Burglish/lib.cpp $SRC/Contrib/Burglish/regex.cpp
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#pragma once
+
+#include <windows_wz.h>
+
+
+/**
+ * Headless stand-in for MyWin32Window. The input methods only ask if a window is visible,
+ *   so that's all we track; the driver shows and hides windows the way MainFile does.
+ */
+class MyWin32Window
+{
+public:
+	MyWin32Window() : is_visible(false) {}
+
+	bool showWindow(bool show) {
+		is_visible = show;
+		return true;
+	}
+	bool isVisible() {
+		return is_visible;
+	}
+
+private:
+	bool is_visible;
+};
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
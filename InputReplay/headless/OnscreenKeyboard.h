@@ -0,0 +1,43 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#pragma once
+
+#include <string>
+
+#include <windows_wz.h>
+#include "MyWin32Window.h"
+#include "Input/VirtKey.h"
+
+
+/**
+ * Headless stand-in for the on-screen keyboard. The real one also holds the myWin 2.2 layout
+ *   (see typeLetter()), which needs its images and fonts; the headless factory doesn't build
+ *   "mywin", so nothing here is ever asked to type a letter.
+ */
+class OnscreenKeyboard
+{
+public:
+	std::wstring typeLetter(unsigned int vkCode, char alphanum, bool modShift) {
+		return L"";
+	}
+};
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
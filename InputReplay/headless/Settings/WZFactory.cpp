@@ -0,0 +1,110 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+//Only the parts of WZFactory that need Win32; everything else is built from WaitZar's own
+//  Settings/WZFactoryVerify.cpp and Settings/WZFactoryInput.cpp.
+#include "WZFactory.h"
+
+
+using std::wstring;
+using std::string;
+using waitzar::WordBuilder;
+
+
+
+//Static initializations
+string WZFactory::resourceDir = string();
+
+
+
+/**
+ * Load the Wait Zar language model, from the same files WaitZarRes.rc embeds.
+ */
+WordBuilder* WZFactory::readModel() {
+	//The model may be compiled, in which case the WordBuilder uses it in place; so it has to
+	//   outlive the model (just like a locked resource would).
+	string* modelData = new string(waitzar::ReadBinaryFile(resourceDir + "/Myanmar.model"));
+	WordBuilder* model = new WordBuilder(&(*modelData)[0], modelData->size(), false);
+
+	//We also need to load our easy pat-sint combinations
+	string easyPS = waitzar::ReadBinaryFile(resourceDir + "/easypatsint.txt");
+	if (!model->addShortcuts(easyPS.c_str(), easyPS.size()))
+		throw std::runtime_error(waitzar::escape_wstr(model->getLastError(), false).c_str());
+
+	return model;
+}
+
+
+
+LetterInputMethod* WZFactory::getMywinInput(std::wstring langID, InMethNode& node)
+{
+	//myWin types each letter through the on-screen keyboard, which we don't have.
+	return NULL;
+}
+
+
+
+//We always parse the keyboard file; a replay should never depend on what a previous run cached.
+string WZFactory::getKeyMagicCacheFile(const wstring& fullID, const string& wordlistFileName)
+{
+	return string();
+}
+
+
+
+//There's no interpreter DLL, so these get no "impl".
+Transformation* WZFactory::makeJavaScriptTransformation(ConfigRoot& conf, TransNode& tm)
+{
+	return NULL;
+}
+
+
+
+void WZFactory::InitAll(const string& resourceDir, MyWin32Window* mainWindow, MyWin32Window* sentenceWindow, MyWin32Window* helpWindow, MyWin32Window* memoryWindow, OnscreenKeyboard* helpKeyboard)
+{
+	//Save
+	WZFactory::resourceDir = resourceDir;
+	WZFactory::mainWindow = mainWindow;
+	WZFactory::sentenceWindow = sentenceWindow;
+	WZFactory::helpWindow = helpWindow;
+	WZFactory::memoryWindow = memoryWindow;
+	WZFactory::helpKeyboard = helpKeyboard;
+
+	//Initialize our system word lookup
+	WZFactory::buildSystemWordLookup();
+}
+
+
+
+//We don't load DLLs; every extension is simply disabled.
+Extension* WZFactory::makeAndVerifyExtension(const std::wstring& id, ExtendNode& ex)
+{
+	ex.enabled = false;
+	return NULL;
+}
+
+
+//Nothing is drawn, so there's nothing to build.
+DisplayMethod* WZFactory::makeAndVerifyDisplayMethod(const LangNode& lang, const std::wstring& id, DispMethNode& dm)
+{
+	return NULL;
+}
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#pragma once
+
+
+#include <map>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+
+#include "windows_wz.h"
+
+#include "Input/RomanInputMethod.h"
+#include "Input/LetterInputMethod.h"
+#include "Input/KeyMagicInputMethod.h"
+#include "NGram/WordBuilder.h"
+#include "NGram/BurglishBuilder.h"
+#include "NGram/SentenceList.h"
+#include "NGram/wz_utilities.h"
+#include "Settings/ConfigTreeContainers.h"
+#include "Settings/Types.h"
+#include "Transform/Zg2Uni.h"
+#include "Transform/Uni2Zg.h"
+#include "Transform/Uni2Ayar.h"
+#include "Transform/Ayar2Uni.h"
+#include "Transform/Uni2WinInnwa.h"
+#include "Transform/Self2Self.h"
+
+
+
+//Grr... notepad...
+const unsigned int UNICOD_BOM = 0xFEFF;
+const unsigned int BACKWARDS_BOM = 0xFFFE;
+
+
+/**
+ * Headless stand-in for the real WZFactory, used by InputReplay. The config tree is checked, and the
+ *   input methods and built-in transformations are built, by the same code as WaitZar's
+ *   (WZFactoryVerify.cpp and WZFactoryInput.cpp); headless/Settings/WZFactory.cpp only replaces the
+ *   parts that need Win32. Extensions, display methods and javascript transformations get no "impl"; the
+ *   same goes for the myWin keyboard, which types through the on-screen keyboard.
+ * Resources (the model and easy pat-sint file) are read from a directory instead of the executable.
+ */
+class WZFactory
+{
+public:
+	//New builders
+	static Extension* makeAndVerifyExtension(const std::wstring& id, ExtendNode& ex);
+	static InputMethod* makeAndVerifyInputMethod(const LangNode& lang, const std::wstring& id, InMethNode& im);
+	static DisplayMethod* makeAndVerifyDisplayMethod(const LangNode& lang, const std::wstring& id, DispMethNode& dm);
+	static Transformation* makeAndVerifyTransformation(ConfigRoot& conf, const LangNode& lang, const std::wstring& id, TransNode& tm);
+
+	//Used to "verify" things which don't need to be built
+	//NOTE: These (and makeAndVerifyInputMethod) are in WZFactoryVerify.cpp
+	static void verifyEncoding(const std::wstring& id, EncNode& enc);
+	static void verifyLanguage(const std::wstring& id, LangNode& lang, const std::wstring& lastUsedInMethID, const std::wstring& lastUsedOutEncID);
+	static void verifySettings(ConfigRoot& cfg, SettingsNode& set, const std::wstring& lastUsedLangID);
+
+	//Helper for that crazy Flash-save format
+	static std::wstring InterpretFlashSave(const std::map<std::wstring, std::vector<std::wstring> >& flashSave, const std::wstring& langID, size_t resIndex);
+	static std::wstring MatchAvoidBackwards(const std::vector<std::wstring>& vec, const std::wstring& avoidStr);
+
+	//More specific builders/instances
+	//NOTE: All but getMywinInput are shared with WaitZar, in WZFactoryInput.cpp
+	static RomanInputMethod* getWaitZarInput(std::wstring langID, const std::wstring& extraWordsFileName, const std::wstring& userWordsFileName, InMethNode& node);
+	static RomanInputMethod* getBurglishInput(std::wstring langID, InMethNode& node);
+	static RomanInputMethod* getWordlistBasedInput(std::wstring langID, std::wstring inputID, std::string wordlistFileName, InMethNode& node);
+	static LetterInputMethod* getKeyMagicBasedInput(std::wstring langID, std::wstring inputID, std::string wordlistFileName, bool disableCache, InMethNode& node);
+	static LetterInputMethod* getMywinInput(std::wstring langID, InMethNode& node);
+
+	//Init; resourceDir holds Myanmar.model and easypatsint.txt
+	static void InitAll(const std::string& resourceDir, MyWin32Window* mainWindow, MyWin32Window* sentenceWindow, MyWin32Window* helpWindow, MyWin32Window* memoryWindow, OnscreenKeyboard* helpKeyboard);
+
+	//Helper
+	static bool FileExists(const std::wstring& fileName) {
+		WIN32_FILE_ATTRIBUTE_DATA InfoFile;
+		return (GetFileAttributesEx(NativePath(fileName).c_str(), GetFileExInfoStandard, &InfoFile)==TRUE);
+	}
+
+	//The config tree builds Windows paths; turn them into ours.
+	static std::wstring NativePath(std::wstring path) {
+		std::replace(path.begin(), path.end(), L'\\', L'/');
+		return path;
+	}
+	static std::string NativePath(std::string path) {
+		std::replace(path.begin(), path.end(), '\\', '/');
+		return path;
+	}
+
+
+private:
+	//For loading
+	static std::string resourceDir;
+	static MyWin32Window* mainWindow;
+	static MyWin32Window* sentenceWindow;
+	static MyWin32Window* helpWindow;
+	static MyWin32Window* memoryWindow;
+	static OnscreenKeyboard* helpKeyboard;
+
+	//Special "words" used in our keyboard, like "(" and "`"
+	static std::vector< std::pair <int, unsigned short> > systemWordLookup;
+
+	//Instance Mappings, to save memory
+	static std::map<std::wstring, RomanInputMethod*> cachedWBInputs;
+	static std::map<std::wstring, RomanInputMethod*> cachedBGInputs;
+	static std::map<std::wstring, LetterInputMethod*> cachedLetterInputs;
+
+	//Helper methods
+	static void buildSystemWordLookup();
+	static waitzar::WordBuilder* readModel();
+	static void addWordsToModel(waitzar::WordBuilder* model, std::string userWordsFileName);
+	static std::string getKeyMagicCacheFile(const std::wstring& fullID, const std::string& wordlistFileName);
+	static Transformation* makeJavaScriptTransformation(ConfigRoot& conf, TransNode& tm);
+};
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
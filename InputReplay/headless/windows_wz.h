@@ -0,0 +1,149 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+
+#pragma once
+
+/**
+ * Headless stand-in for windows_wz.h, used by InputReplay to build the input methods and config
+ *   tree without windows.h. It declares only the handful of Win32 types, constants and calls that
+ *   code actually uses. Keyboard layout queries always report "en-US", so VirtKey.cpp compiles
+ *   unchanged and never has to re-map a key.
+ * If you get an "undefined" error after using a new Win32 function in the input layer, add a
+ *   portable version of it here.
+ */
+
+#include <string>
+#include <sys/stat.h>
+
+
+//Types
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned long DWORD;
+typedef unsigned int UINT;
+typedef long LPARAM;
+typedef unsigned long WPARAM;
+typedef DWORD COLORREF;
+typedef void* HANDLE;
+typedef HANDLE HWND;
+typedef HANDLE HDC;
+typedef HANDLE HINSTANCE;
+typedef HANDLE HKL;
+
+#define TRUE  1
+#define FALSE 0
+
+//Macros
+#define LOWORD(l)           ((WORD)(((DWORD)(l)) & 0xFFFF))
+#define HIWORD(l)           ((WORD)((((DWORD)(l)) >> 16) & 0xFFFF))
+#define MAKELPARAM(lo, hi)  ((LPARAM)(((WORD)(lo)) | (((DWORD)((WORD)(hi))) << 16)))
+#define RGB(r, g, b)        ((COLORREF)(((BYTE)(r)) | (((WORD)((BYTE)(g))) << 8) | (((DWORD)(BYTE)(b)) << 16)))
+
+//Hotkey modifiers
+#define MOD_ALT     0x0001
+#define MOD_CONTROL 0x0002
+#define MOD_SHIFT   0x0004
+
+//Virtual key codes
+#define VK_BACK       0x08
+#define VK_TAB        0x09
+#define VK_RETURN     0x0D
+#define VK_SHIFT      0x10
+#define VK_CONTROL    0x11
+#define VK_MENU       0x12
+#define VK_ESCAPE     0x1B
+#define VK_SPACE      0x20
+#define VK_PRIOR      0x21
+#define VK_NEXT       0x22
+#define VK_LEFT       0x25
+#define VK_UP         0x26
+#define VK_RIGHT      0x27
+#define VK_DOWN       0x28
+#define VK_DELETE     0x2E
+#define VK_NUMPAD0    0x60
+#define VK_NUMPAD1    0x61
+#define VK_NUMPAD2    0x62
+#define VK_NUMPAD3    0x63
+#define VK_NUMPAD4    0x64
+#define VK_NUMPAD5    0x65
+#define VK_NUMPAD6    0x66
+#define VK_NUMPAD7    0x67
+#define VK_NUMPAD8    0x68
+#define VK_NUMPAD9    0x69
+#define VK_LSHIFT     0xA0
+#define VK_RSHIFT     0xA1
+#define VK_OEM_1      0xBA
+#define VK_OEM_PLUS   0xBB
+#define VK_OEM_COMMA  0xBC
+#define VK_OEM_MINUS  0xBD
+#define VK_OEM_PERIOD 0xBE
+#define VK_OEM_2      0xBF
+#define VK_OEM_3      0xC0
+#define VK_OEM_4      0xDB
+#define VK_OEM_5      0xDC
+#define VK_OEM_6      0xDD
+#define VK_OEM_7      0xDE
+#define MAPVK_VSC_TO_VK 1
+
+
+//Keyboard layouts: there's only one, and it's en-US.
+namespace {
+	const HKL HeadlessLayout = reinterpret_cast<HKL>(0x04090409);
+}
+inline HKL LoadKeyboardLayout(const wchar_t*, UINT) { return HeadlessLayout; }
+inline HKL GetKeyboardLayout(DWORD) { return HeadlessLayout; }
+inline UINT MapVirtualKeyEx(UINT, UINT, HKL) { return 0; }
+inline HWND GetForegroundWindow() { return NULL; }
+inline HWND GetDesktopWindow() { return NULL; }
+inline HWND ImmGetDefaultIMEWnd(HWND) { return NULL; }
+inline DWORD GetWindowThreadProcessId(HWND, DWORD*) { return 0; }
+
+
+//Files: we only ever ask if one exists.
+struct WIN32_FILE_ATTRIBUTE_DATA {
+	DWORD dwFileAttributes;
+};
+enum GET_FILEEX_INFO_LEVELS { GetFileExInfoStandard };
+inline BOOL GetFileAttributesEx(const wchar_t* fileName, GET_FILEEX_INFO_LEVELS, WIN32_FILE_ATTRIBUTE_DATA* info) {
+	//Paths are UTF-8 on the systems we build this for.
+	std::string path;
+	for (const wchar_t* c=fileName; *c!=L'\0'; c++) {
+		unsigned int cp = *c;
+		if (cp<0x80) {
+			path += static_cast<char>(cp);
+		} else if (cp<0x800) {
+			path += static_cast<char>(0xC0|(cp>>6));
+			path += static_cast<char>(0x80|(cp&0x3F));
+		} else {
+			path += static_cast<char>(0xE0|(cp>>12));
+			path += static_cast<char>(0x80|((cp>>6)&0x3F));
+			path += static_cast<char>(0x80|(cp&0x3F));
+		}
+	}
+	struct stat res;
+	if (stat(path.c_str(), &res)!=0)
+		return FALSE;
+	info->dwFileAttributes = 0;
+	return TRUE;
+}
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
@@ -0,0 +1,277 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+//Don't let Visual Studio warn us to use the _s functions
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "NGram/WordBuilder.h"
+#include "NGram/TrigramLookup.h"
+
+using std::string;
+using std::vector;
+using waitzar::WordBuilder;
+using waitzar::TrigramLookup;
+
+
+/**
+ * Compiles a text WordBuilder model (e.g., Myanmar.model) plus any number of "mywords.txt"-style
+ *  files into the binary model format, which WordBuilder can memory-map and use in place.
+ * With --trigram, it instead compiles a TrigramLookup JSON model (e.g., WZModel.json.txt).
+ * Usage:
+ *   ModelCompiler [--verify] <Myanmar.model> <output.bin> [mywords.txt ...]
+ *   ModelCompiler --trigram [--verify] <WZModel.json.txt> <output.bin>
+ *   ModelCompiler --bench [-n repeat] <WZModel.json.txt|output.bin> <trace>
+ * With --verify, the compiled model is re-loaded and compared against the text model, and the time
+ *  taken to load each one is reported.
+ * With --bench, the words typed in a recorded typing trace (like InputReplay/traces/waitzar.trace) are
+ *  typed into a TrigramLookup model, a letter at a time, and the number of lookups per second is reported.
+ */
+
+
+namespace {
+	double msSince(const std::chrono::high_resolution_clock::time_point& start) {
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now()-start).count()/1000.0;
+	}
+
+	//Dump a model's contents, so that we can compare them.
+	string dumpModel(WordBuilder& model) {
+		FILE* temp = tmpfile();
+		if (temp==NULL)
+			return "";
+		model.debugOut(temp);
+		string res;
+		res.resize(ftell(temp));
+		rewind(temp);
+		size_t read = fread(&res[0], 1, res.size(), temp);
+		res.resize(read);
+		fclose(temp);
+		return res;
+	}
+
+	//Compile a TrigramLookup model. Since the binary format is canonical, we verify it by
+	//  re-saving the compiled model and comparing the bytes.
+	int compileTrigramModel(const string& modelPath, const string& binPath, bool verify) {
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		TrigramLookup jsonModel(modelPath);
+		double jsonMs = msSince(start);
+
+		jsonModel.saveBinaryModel(binPath);
+		printf("Compiled %u words to: %s\n", (unsigned int)jsonModel.getTotalDefinedNonShortcutWords(), binPath.c_str());
+
+		if (verify) {
+			start = std::chrono::high_resolution_clock::now();
+			TrigramLookup binModel(binPath);
+			double binMs = msSince(start);
+
+			string checkPath = binPath + ".verify";
+			binModel.saveBinaryModel(checkPath);
+			bool same = waitzar::ReadBinaryFile(binPath) == waitzar::ReadBinaryFile(checkPath);
+			remove(checkPath.c_str());
+			if (!same) {
+				printf("Error: compiled model does not match the JSON model.\n");
+				return 1;
+			}
+			printf("Verified. Load time: %.3f ms (JSON), %.3f ms (binary)\n", jsonMs, binMs);
+		}
+		return 0;
+	}
+
+
+	//A word typed in a trace; "newSentence" is set if it's the first word of its sentence.
+	struct TracedWord {
+		string roman;
+		bool newSentence;
+		TracedWord(const string& roman, bool newSentence) : roman(roman), newSentence(newSentence) {}
+	};
+
+	//Read the words typed in an InputReplay trace. Letters are typed, <VK_SPACE> picks the word, <VK_BACK>
+	//  erases a letter, and "." or <VK_RETURN> ends the sentence. Other keys are ignored.
+	vector<TracedWord> readTrace(const string& tracePath) {
+		std::wstring trace = waitzar::readUTF8File(tracePath);
+		vector<TracedWord> res;
+		string roman;
+		bool newSentence = true;
+		bool lineStart = true;
+		for (size_t i=0; i<trace.size(); i++) {
+			wchar_t c = trace[i];
+
+			//Comments and options take up the whole line
+			if (lineStart && (c==L'#' || c==L'@')) {
+				while (i<trace.size() && trace[i]!=L'\n')
+					i++;
+				continue;
+			}
+			lineStart = (c==L'\n');
+
+			//Named keys
+			std::wstring key;
+			if (c==L'<') {
+				size_t end = trace.find(L'>', i);
+				if (end==std::wstring::npos)
+					throw std::runtime_error("Unterminated key name in trace.");
+				key = trace.substr(i+1, end-i-1);
+				i = end;
+			}
+
+			if (c>=L'a' && c<=L'z') {
+				roman += static_cast<char>(c);
+			} else if (key==L"VK_BACK") {
+				if (!roman.empty())
+					roman.erase(roman.size()-1);
+			} else if (key==L"VK_SPACE" || key==L"VK_RETURN" || c==L'.') {
+				if (!roman.empty())
+					res.push_back(TracedWord(roman, newSentence));
+				newSentence = (key!=L"VK_SPACE");
+				roman.clear();
+			}
+		}
+		return res;
+	}
+
+	//Type each word in a trace into a TrigramLookup model. After every letter, the candidates are looked
+	//  up again for the previous three words (as the candidate window would do); on space, the default
+	//  candidate is picked.
+	int benchTrigramModel(const string& modelPath, const string& tracePath, size_t repeat) {
+		TrigramLookup model(modelPath);
+		vector<TracedWord> words = readTrace(tracePath);
+		if (words.empty()) {
+			printf("Error: no words typed in: %s\n", tracePath.c_str());
+			return 1;
+		}
+
+		//Type it
+		vector<std::wstring> prevWords(3);
+		string letter = " ";
+		size_t numLookups = 0;
+		size_t numNgrams = 0;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (size_t rep=0; rep<repeat; rep++) {
+			for (auto word=words.begin(); word!=words.end(); word++) {
+				if (word->newSentence) {
+					for (size_t i=0; i<prevWords.size(); i++)
+						prevWords[i].clear();
+				}
+
+				model.reset();
+				for (size_t i=0; i<word->roman.size(); i++) {
+					letter[0] = word->roman[i];
+					if (!model.continueLookup(letter))
+						break;
+					if (model.moveLookupOnTrigram(prevWords[0], prevWords[1], prevWords[2]))
+						numNgrams++;
+					model.getMatchedDefaultIndex();
+					numLookups++;
+				}
+
+				//Pick the default word
+				if (model.getMatchedWordCount()>0) {
+					prevWords[2].swap(prevWords[1]);
+					prevWords[1].swap(prevWords[0]);
+					waitzar::FlatRow<wchar_t> picked = model.getMatchedWord(model.getMatchedDefaultIndex());
+					prevWords[0].assign(picked.begin(), picked.end());
+				}
+			}
+		}
+		double ms = msSince(start);
+
+		printf("Typed %u words (%u lookups) %u times in %.3f ms\n", (unsigned int)words.size(), (unsigned int)(numLookups/repeat), (unsigned int)repeat, ms);
+		printf("%.0f lookups/sec; %.1f%% of them matched an n-gram\n", numLookups/(ms/1000), numNgrams*100.0/numLookups);
+		return 0;
+	}
+}
+
+
+int main(int argc, const char* argv[])
+{
+	//Read our arguments
+	bool verify = false;
+	bool trigram = false;
+	bool bench = false;
+	size_t repeat = 1000;
+	vector<string> files;
+	for (int i=1; i<argc; i++) {
+		if (strcmp(argv[i], "--verify")==0)
+			verify = true;
+		else if (strcmp(argv[i], "--trigram")==0)
+			trigram = true;
+		else if (strcmp(argv[i], "--bench")==0)
+			bench = true;
+		else if (strcmp(argv[i], "-n")==0 && i+1<argc)
+			repeat = strtoul(argv[++i], NULL, 10);
+		else
+			files.push_back(argv[i]);
+	}
+	if (files.size()<2 || repeat==0) {
+		printf("Usage: ModelCompiler [--verify] <Myanmar.model> <output.bin> [mywords.txt ...]\n");
+		printf("       ModelCompiler --trigram [--verify] <WZModel.json.txt> <output.bin>\n");
+		printf("       ModelCompiler --bench [-n repeat] <WZModel.json.txt|output.bin> <trace>\n");
+		return 1;
+	}
+	string modelPath = files[0];
+	string binPath = files[1];
+	vector<string> userWordsPaths(files.begin()+2, files.end());
+
+	try {
+		if (bench)
+			return benchTrigramModel(modelPath, binPath, repeat);
+		if (trigram)
+			return compileTrigramModel(modelPath, binPath, verify);
+
+		//Load the text model
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		WordBuilder textModel(modelPath.c_str(), userWordsPaths);
+		double textMs = msSince(start);
+		if (textModel.isInError()) {
+			printf("Error loading model: %ls\n", textModel.getLastError().c_str());
+			return 1;
+		}
+
+		//Save it
+		textModel.saveBinaryModel(binPath);
+		printf("Compiled %u words to: %s\n", textModel.getTotalDefinedWords(), binPath.c_str());
+
+		//Optionally check it
+		if (verify) {
+			start = std::chrono::high_resolution_clock::now();
+			WordBuilder binModel(binPath.c_str(), vector<string>());
+			double binMs = msSince(start);
+
+			if (dumpModel(textModel) != dumpModel(binModel)) {
+				printf("Error: compiled model does not match the text model.\n");
+				return 1;
+			}
+			printf("Verified. Load time: %.3f ms (text), %.3f ms (binary)\n", textMs, binMs);
+		}
+	} catch (std::exception& ex) {
+		printf("Error: %s\n", ex.what());
+		return 1;
+	}
+
+	return 0;
+}
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
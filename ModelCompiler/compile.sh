@@ -0,0 +1,2 @@
+SRC=../win32_source/Contrib
+g++ -std=c++0x -O2 -pthread -I$SRC -I$SRC/.. -o ModelCompiler ModelCompiler.cpp $SRC/NGram/WordBuilder.cpp $SRC/NGram/BinaryModel.cpp $SRC/NGram/MappedFile.cpp $SRC/NGram/NexusTrie.cpp $SRC/NGram/Utf8Transcoder.cpp $SRC/NGram/TrigramLookup.cpp $SRC/NGram/BinaryTrigramModel.cpp $SRC/NGram/wz_utilities.cpp $SRC/NGram/Logger.cpp $SRC/MD5/md5simple.c "$SRC/Json CPP/json_reader.cpp" "$SRC/Json CPP/json_value.cpp" "$SRC/Json CPP/json_valueiterator.cpp" $SRC/Burglish/fontconv.cpp $SRC/Burglish/fontmap.cpp $SRC/Burglish/lib.cpp $SRC/Burglish/regex.cpp
@@ -0,0 +1,362 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+//Don't let Visual Studio warn us to use the _s functions
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <chrono>
+#include <algorithm>
+
+#include "Jazzlib/Inflater.h"
+#include "Jazzlib/StreamManipulator.h"
+#include "Pulp Core/PngDecoder.h"
+
+using std::string;
+using std::vector;
+
+
+/**
+ * Times PulpCore's PNG decoding, old against new, without any windows.
+ * Usage:
+ *   PngBench [-n repeat] [images]...
+ * The default image is the test display font, config/Myanmar/TestDisplays/WZTest.png. Each image is
+ *  decoded "repeat" times (default 200) by both decoders:
+ *    jazzlib:  The original PulpCoreImage::readData() loop, which inflates each scanline with the Jazzlib
+ *              port (one call for the filter byte, one for the row) and un-filters it a byte at a time.
+ *    decoder:  waitzar::PngDecoder, which inflates all the image data at once and un-filters and
+ *              converts each row with SSE2 (where available).
+ * The pixels from both must match exactly. Returns 1 if they don't (or if an image can't be read).
+ */
+
+
+namespace {
+	//A copy of PulpCoreImage's reading code, as it was, minus the DIB. Like PulpCoreImage::init(),
+	//  this leaves the pixels top-down.
+	class JazzlibPng {
+	public:
+		void decode(const string& file, vector<unsigned int>& pixels) {
+			res_data = file.data();
+			res_size = file.size();
+			currPos = 8;
+			palette.clear();
+			for (;;) {
+				int length = readInt();
+				int chunkType = readInt();
+				if (chunkType == CHUNK_IHDR) {
+					width = readInt();
+					height = readInt();
+					bitDepth = readByte();
+					colorType = readByte();
+					currPos += 3;
+					pixels.resize(width*height);
+				} else if (chunkType == CHUNK_PLTE) {
+					for (int i=0; i<length/3; i++) {
+						int r = readByte();
+						int g = readByte();
+						int b = readByte();
+						palette.push_back((0xff << 24) | (r << 16) | (g << 8) | b);
+					}
+				} else if (chunkType == CHUNK_TRNS) {
+					for (int i=0; i<length; i++) {
+						int a = readByte();
+						palette[i] = waitzar::PngDecoder::Premultiply((a << 24) | (palette[i] & 0xffffff));
+					}
+				} else if (chunkType == CHUNK_IDAT)
+					readData(length, &pixels[0]);
+				else
+					currPos += length;
+				currPos += 4;
+				if (chunkType == CHUNK_IEND)
+					break;
+			}
+		}
+
+	private:
+		static const int CHUNK_IHDR = 0x49484452;
+		static const int CHUNK_PLTE = 0x504c5445;
+		static const int CHUNK_TRNS = 0x74524e53;
+		static const int CHUNK_IDAT = 0x49444154;
+		static const int CHUNK_IEND = 0x49454e44;
+
+		const char* res_data;
+		size_t res_size;
+		int currPos;
+		int width;
+		int height;
+		int bitDepth;
+		int colorType;
+		vector<int> palette;
+
+		int readInt() {
+			unsigned int retVal = (((0xFF&res_data[currPos])<<24)  | ((0xFF&res_data[currPos+1])<<16) | ((0xFF&res_data[currPos+2])<<8) | ((0xFF&res_data[currPos+3]))) ;
+			currPos += 4;
+			return retVal;
+		}
+		char readByte() {
+			return (0xFF&res_data[currPos++]);
+		}
+
+		void readData(int length, unsigned int* directPixels) {
+			const int SAMPLES_PER_PIXEL[] = { 1, 0, 3, 1, 2, 0, 4 };
+			Inflater* inflater = new Inflater();
+			inflater->setInput(res_data, currPos, length);
+
+			int bitsPerPixel = bitDepth * SAMPLES_PER_PIXEL[colorType];
+			int bytesPerPixel = (bitsPerPixel + 7) / 8;
+			int bytesPerScanline = (width * bitsPerPixel + 7) / 8;
+			vector<char> prevBuffer(bytesPerScanline, 0);  //The original never cleared this one.
+			vector<char> currBuffer(bytesPerScanline, 0);
+			char* prevScanline = &prevBuffer[0];
+			char* currScanline = &currBuffer[0];
+			char filterBuffer[1] = {0};
+			int index = 0;
+
+			for (int i=0; i<height; i++) {
+				inflateFully(inflater, filterBuffer, 1);
+				inflateFully(inflater, currScanline, bytesPerScanline);
+				int filter = filterBuffer[0];
+				if (filter > 0 && filter < 5)
+					decodeFilter(currScanline, bytesPerScanline, prevScanline, filter, bytesPerPixel);
+				else if (filter!=0)
+					throw std::runtime_error("Illegal filter type");
+
+				int srcIndex = 0;
+				switch (colorType) {
+					default: case 0:
+						for (int j = 0; j < width; j++) {
+							int v = currScanline[j] & 0xff;
+							directPixels[index++] = (0xff << 24) | (v << 16) | (v << 8) | v;
+						}
+						break;
+					case 2:
+						for (int j = 0; j < width; j++) {
+							int r = currScanline[srcIndex++] & 0xff;
+							int g = currScanline[srcIndex++] & 0xff;
+							int b = currScanline[srcIndex++] & 0xff;
+							directPixels[index++] = (0xff << 24) | (r << 16) | (g << 8) | b;
+						}
+						break;
+					case 3:
+						if (bitDepth == 8) {
+							for (int j = 0; j < width; j++)
+								directPixels[index++] = palette[currScanline[j] & 0xff];
+						} else {
+							bool isOdd = (width & 1) == 1;
+							int s = width & ~1;
+							for (int j = 0; j < s; j+=2) {
+								int b = currScanline[srcIndex++] & 0xff;
+								directPixels[index++] = palette[doubleRightShift(b, 4)];
+								directPixels[index++] = palette[b & 0x0f];
+							}
+							if (isOdd) {
+								int b = currScanline[srcIndex++] & 0xff;
+								directPixels[index++] = palette[doubleRightShift(b, 4)];
+							}
+						}
+						break;
+					case 4:
+						for (int j = 0; j < width; j++) {
+							int v = currScanline[srcIndex++] & 0xff;
+							int a = currScanline[srcIndex++] & 0xff;
+							directPixels[index++] = (a << 24) | (v << 16) | (v << 8) | v;
+						}
+						break;
+					case 6:
+						for (int j = 0; j < width; j++) {
+							int r = currScanline[srcIndex++] & 0xff;
+							int g = currScanline[srcIndex++] & 0xff;
+							int b = currScanline[srcIndex++] & 0xff;
+							int a = currScanline[srcIndex++] & 0xff;
+							directPixels[index++] = (a << 24) | (r << 16) | (g << 8) | b;
+						}
+						break;
+				}
+				std::swap(currScanline, prevScanline);
+			}
+
+			if (colorType == 4 || colorType == 6) {
+				for (int i=0; i<width*height; i++)
+					directPixels[i] = waitzar::PngDecoder::Premultiply(directPixels[i]);
+			}
+
+			inflater->end();
+			currPos += length;
+			delete inflater;
+		}
+
+		void inflateFully(Inflater* inflater, char* result, int res_length) {
+			int bytesRead = 0;
+			while (bytesRead < res_length) {
+				if (inflater->needsInput())
+					throw std::runtime_error("Inflater ran out of input");
+				int res = inflater->inflate(result, res_length, bytesRead, res_length - bytesRead);
+				if (res==-1)
+					throw std::runtime_error("0 > off || off > off + len || off + len > buf_length");
+				bytesRead += res;
+			}
+		}
+
+		void decodeFilter(char* curr, int curr_len, char* prev, int filter, int bpp) {
+			int length = curr_len;
+			if (filter == 1) {
+				for (int i = bpp; i < length; i++)
+					curr[i] = (char)(curr[i] + curr[i - bpp]);
+			} else if (filter == 2) {
+				for (int i = 0; i < length; i++)
+					curr[i] = (char)(curr[i] + prev[i]);
+			} else if (filter == 3) {
+				for (int i = 0; i < bpp; i++)
+					curr[i] = (char)(curr[i] + doubleRightShift((prev[i] & 0xff), 1));
+				for (int i = bpp; i < length; i++)
+					curr[i] = (char)(curr[i] + doubleRightShift(((curr[i - bpp] & 0xff) + (prev[i] & 0xff)), 1));
+			} else if (filter == 4) {
+				for (int i = 0; i < bpp; i++)
+					curr[i] = (char)(curr[i] + prev[i]);
+				for (int i = bpp; i < length; i++)
+					curr[i] = (char)(curr[i] + paethPredictor(curr[i - bpp] & 0xff, prev[i] & 0xff, prev[i - bpp] & 0xff));
+			}
+		}
+
+		int paethPredictor(int a, int b, int c) {
+			int p = a + b - c;
+			int pa = abs(p - a);
+			int pb = abs(p - b);
+			int pc = abs(p - c);
+			if (pa <= pb && pa <= pc)
+				return a;
+			else if (pb <= pc)
+				return b;
+			else
+				return c;
+		}
+	};
+
+
+	string readFile(const string& path) {
+		FILE* f = fopen(path.c_str(), "rb");
+		if (f==NULL)
+			throw std::runtime_error("Can't open file");
+		string res;
+		char buffer[4096];
+		for (size_t n; (n=fread(buffer, 1, sizeof(buffer), f))>0;)
+			res.append(buffer, n);
+		fclose(f);
+		return res;
+	}
+
+
+	double microsSince(const std::chrono::high_resolution_clock::time_point& start) {
+		return std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+
+	//Returns the median time (in microseconds) of "repeat" decodes.
+	template <class Decoder>
+	double timeDecodes(const Decoder& decode, size_t repeat, vector<unsigned int>& pixels) {
+		vector<double> times;
+		for (size_t i=0; i<repeat; i++) {
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			decode(pixels);
+			times.push_back(microsSince(start));
+		}
+		std::sort(times.begin(), times.end());
+		return times[times.size()/2];
+	}
+
+
+	void printUsage() {
+		printf("Usage: PngBench [-n repeat] [images]...\n");
+	}
+}
+
+
+
+int main(int argc, const char* argv[])
+{
+	//Read our arguments
+	size_t repeat = 200;
+	vector<string> files;
+	for (int i=1; i<argc; i++) {
+		if (strcmp(argv[i], "-n")==0 && i+1<argc)
+			repeat = strtoul(argv[++i], NULL, 10);
+		else if (argv[i][0]=='-') {
+			printUsage();
+			return 1;
+		} else
+			files.push_back(argv[i]);
+	}
+	if (files.empty())
+		files.push_back("../win32_source/config/Myanmar/TestDisplays/WZTest.png");
+	if (repeat==0) {
+		printUsage();
+		return 1;
+	}
+
+	//Decode each file
+	printf("%-28s %11s %12s %12s %8s\n", "file", "size", "jazzlib(us)", "decoder(us)", "speedup");
+	bool anyError = false;
+	for (auto it=files.begin(); it!=files.end(); it++) {
+		string name = it->substr(it->find_last_of("/\\")==string::npos ? 0 : it->find_last_of("/\\")+1);
+		try {
+			string file = readFile(*it);
+			int width = 0;
+			int height = 0;
+
+			vector<unsigned int> oldPixels;
+			double oldTime = timeDecodes([&file](vector<unsigned int>& pixels) {
+				JazzlibPng().decode(file, pixels);
+			}, repeat, oldPixels);
+
+			vector<unsigned int> newPixels;
+			double newTime = timeDecodes([&file, &width, &height](vector<unsigned int>& pixels) {
+				waitzar::PngDecoder::DecodeFile(file.data(), file.size(), pixels, width, height);
+			}, repeat, newPixels);
+
+			//Both must agree
+			size_t diffs = 0;
+			for (size_t i=0; i<oldPixels.size() && i<newPixels.size(); i++) {
+				if (oldPixels[i]!=newPixels[i])
+					diffs++;
+			}
+			if (diffs>0 || oldPixels.size()!=newPixels.size()) {
+				printf("%-28s MISMATCH: %u of %u pixels differ\n", name.c_str(), (unsigned int)diffs, (unsigned int)newPixels.size());
+				anyError = true;
+				continue;
+			}
+
+			char size[32];
+			sprintf(size, "%dx%d", width, height);
+			printf("%-28s %11s %12.1f %12.1f %7.1fx\n", name.c_str(), size, oldTime, newTime, oldTime/newTime);
+		} catch (std::exception& ex) {
+			printf("%-28s skipped: %s\n", name.c_str(), ex.what());
+			anyError = true;
+		}
+	}
+
+	return anyError ? 1 : 0;
+}
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
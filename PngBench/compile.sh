@@ -0,0 +1,2 @@
+SRC=../win32_source
+g++ -std=c++0x -O2 -I../InputReplay/headless -I$SRC -I$SRC/Contrib -o PngBench PngBench.cpp "$SRC/Contrib/Pulp Core/PngDecoder.cpp" $SRC/Contrib/Jazzlib/Adler32.cpp $SRC/Contrib/Jazzlib/Inflater.cpp $SRC/Contrib/Jazzlib/InflaterDynHeader.cpp $SRC/Contrib/Jazzlib/InflaterHuffmanTree.cpp $SRC/Contrib/Jazzlib/OutputWindow.cpp $SRC/Contrib/Jazzlib/StreamManipulator.cpp
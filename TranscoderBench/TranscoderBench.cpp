@@ -0,0 +1,215 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+//Don't let Visual Studio warn us to use the _s functions
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+#include <chrono>
+#include <algorithm>
+
+#include "NGram/Utf8Transcoder.h"
+#include "NGram/wz_utilities.h"
+
+using std::string;
+using std::wstring;
+using std::vector;
+using waitzar::Utf8Decoder;
+using waitzar::Utf8Encoder;
+
+
+/**
+ * Times UTF-8 decoding and encoding, old against new, in MB/s of UTF-8.
+ * Usage:
+ *   TranscoderBench [-n repeat] [files]...
+ * The default files are Resources/Myanmar.model (all ASCII) and Resources/WZModel.json.txt (Zawgyi
+ *  words in JSON; about 60% of its bytes are ASCII). Each file is repeated until it's at least 16MB,
+ *  and then transcoded "repeat" times (default 5) by:
+ *    stringstream:  The original mbs2wcs, which wrote one character at a time to a std::wstringstream.
+ *    decode:        Utf8Decoder::Decode, in one call.
+ *    decode 16KB:   Utf8Decoder::decode, in 16KB chunks (as readUTF8File does).
+ *    encode:        Utf8Encoder::Encode, back to UTF-8.
+ * All of these must give the same result. Returns 1 if they don't (or if a file can't be read).
+ */
+
+
+namespace {
+	//The original mbs2wcs, as it was.
+	wstring stringstreamDecode(const string& src)
+	{
+		std::wstringstream res;
+		for (size_t i=0; i<src.size(); i++) {
+			unsigned short curr = (src[i]&0xFF);
+			if (((curr>>3)^0x1E)==0) {
+				//We can't handle anything outside the BMP
+				throw std::runtime_error("Error: mbs2wcs does not handle bytes outside the BMP");
+			} else if (((curr>>4)^0xE)==0) {
+				//Verify the next two bytes
+				if (i>=src.length()-2 || (((src[i+1]&0xFF)>>6)^0x2)!=0 || (((src[i+2]&0xFF)>>6)^0x2)!=0)
+					throw std::runtime_error("Error: 2-byte character error in UTF-8 file");
+
+				//Combine all three bytes, check, increment
+				wchar_t destVal = 0x0000 | ((curr&0xF)<<12) | ((src[i+1]&0x3F)<<6) | (src[i+2]&0x3F);
+				if (destVal>=0x0800 && destVal<=0xFFFF) {
+					i+=2;
+				} else
+					throw std::runtime_error("Error: 2-byte character error in UTF-8 file");
+
+				//Set
+				res <<destVal;
+			} else if (((curr>>5)^0x6)==0) {
+				//Verify the next byte
+				if (i>=src.length()-1 || (((src[i+1]&0xFF)>>6)^0x2)!=0)
+					throw std::runtime_error("Error: 1-byte character error in UTF-8 file");
+
+				//Combine both bytes, check, increment
+				wchar_t destVal = 0x0000 | ((curr&0x1F)<<6) | (src[i+1]&0x3F);
+				if (destVal>=0x80 && destVal<=0x07FF) {
+					i++;
+				} else
+					throw std::runtime_error("Error: 1-byte character error in UTF-8 file");
+
+				//Set
+				res <<destVal;
+			} else if ((curr>>7)==0) {
+				wchar_t destVal = 0x0000 | curr;
+
+				//Set
+				res <<destVal;
+			} else {
+				throw std::runtime_error("Error: Unknown sequence in UTF-8 file");
+			}
+		}
+
+		return res.str();
+	}
+
+
+	double secondsSince(const std::chrono::high_resolution_clock::time_point& start) {
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now()-start).count()/1000000.0;
+	}
+
+
+	//Time one file; returns false if the results differ.
+	bool benchFile(const string& path, size_t repeat) {
+		//Read it, and repeat it until it's long enough to time.
+		string file = waitzar::ReadBinaryFile(path);
+		if (file.empty())
+			throw std::runtime_error("File is empty: " + path);
+		string src;
+		while (src.size() < 16*1024*1024)
+			src += file;
+		double mb = src.size()*repeat/(1024.0*1024.0);
+
+		//Old
+		wstring expected;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (size_t i=0; i<repeat; i++)
+			expected = stringstreamDecode(src);
+		double oldSecs = secondsSince(start);
+
+		//New, all at once.
+		wstring decoded(Utf8Decoder::MaxDecodedLength(src.size()), L'\0');
+		size_t numDecoded = 0;
+		start = std::chrono::high_resolution_clock::now();
+		for (size_t i=0; i<repeat; i++)
+			numDecoded = Utf8Decoder::Decode(src.data(), src.size(), &decoded[0]);
+		double decodeSecs = secondsSince(start);
+		decoded.resize(numDecoded);
+		bool same = (decoded==expected);
+
+		//New, in chunks.
+		wstring chunked(Utf8Decoder::MaxDecodedLength(src.size()), L'\0');
+		size_t numChunked = 0;
+		start = std::chrono::high_resolution_clock::now();
+		for (size_t i=0; i<repeat; i++) {
+			Utf8Decoder decoder;
+			numChunked = 0;
+			for (size_t pos=0; pos<src.size(); pos+=16*1024)
+				numChunked += decoder.decode(src.data()+pos, std::min<size_t>(16*1024, src.size()-pos), &chunked[numChunked]);
+			decoder.finish();
+		}
+		double chunkedSecs = secondsSince(start);
+		chunked.resize(numChunked);
+		same = same && (chunked==expected);
+
+		//And back
+		string encoded(Utf8Encoder::MaxEncodedLength(decoded.size()), '\0');
+		size_t numEncoded = 0;
+		start = std::chrono::high_resolution_clock::now();
+		for (size_t i=0; i<repeat; i++)
+			numEncoded = Utf8Encoder::Encode(decoded.data(), decoded.size(), &encoded[0]);
+		double encodeSecs = secondsSince(start);
+		encoded.resize(numEncoded);
+		same = same && (encoded==src);
+
+		string name = path.substr(path.find_last_of("/\\")==string::npos ? 0 : path.find_last_of("/\\")+1);
+		printf("%-24s %7.1f %12.0f %10.0f %12.0f %10.0f  %s\n", name.c_str(), src.size()/(1024.0*1024.0), mb/oldSecs, mb/decodeSecs, mb/chunkedSecs, mb/encodeSecs, same?"":"MISMATCH");
+		return same;
+	}
+}
+
+
+int main(int argc, const char* argv[])
+{
+	//Read our arguments
+	size_t repeat = 5;
+	vector<string> files;
+	for (int i=1; i<argc; i++) {
+		if (strcmp(argv[i], "-n")==0 && i+1<argc)
+			repeat = strtoul(argv[++i], NULL, 10);
+		else if (argv[i][0]=='-') {
+			printf("Usage: TranscoderBench [-n repeat] [files]...\n");
+			return 1;
+		} else
+			files.push_back(argv[i]);
+	}
+	if (repeat==0) {
+		printf("Usage: TranscoderBench [-n repeat] [files]...\n");
+		return 1;
+	}
+	if (files.empty()) {
+		files.push_back("../win32_source/Resources/Myanmar.model");
+		files.push_back("../win32_source/Resources/WZModel.json.txt");
+	}
+
+	//Time each file
+	printf("%-24s %7s %12s %10s %12s %10s  (MB/s)\n", "file", "MB", "stringstream", "decode", "decode 16KB", "encode");
+	bool allSame = true;
+	for (auto it=files.begin(); it!=files.end(); it++) {
+		try {
+			allSame = benchFile(*it, repeat) && allSame;
+		} catch (std::exception& ex) {
+			printf("%-24s skipped: %s\n", it->c_str(), ex.what());
+			allSame = false;
+		}
+	}
+
+	return allSame ? 0 : 1;
+}
+
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
@@ -0,0 +1,2 @@
+SRC=../win32_source
+g++ -std=c++0x -O2 -pthread -I$SRC -I$SRC/Contrib -o TranscoderBench TranscoderBench.cpp $SRC/Contrib/NGram/Utf8Transcoder.cpp $SRC/Contrib/NGram/wz_utilities.cpp $SRC/Contrib/NGram/Logger.cpp $SRC/Contrib/MD5/md5simple.c $SRC/Contrib/Burglish/fontconv.cpp $SRC/Contrib/Burglish/fontmap.cpp $SRC/Contrib/Burglish/lib.cpp $SRC/Contrib/Burglish/regex.cpp
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+//Don't let Visual Studio warn us to use the _s functions
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "NGram/NexusTrie.h"
+
+using std::string;
+using std::vector;
+using waitzar::NexusTrie;
+using waitzar::FlatRow;
+
+
+/**
+ * Times NexusTrie::jump(), old against new, when the trie doesn't fit in the cache.
+ * Usage:
+ *   TrieBench [-w words] [-n jumps]
+ * A trie is built from "words" (default 300000) random romanisations of 2 to 8 letters, which gives
+ *  about half a million nodes (3.7MB, bigger than most L2 caches; "-w 3000000" gives 26MB). The root and
+ *  the nodes near it have most of the links, and about half the nodes are leaves, as in a real model.
+ *  Then "jumps" (default 20000000) jumps are timed in three ways:
+ *    hot:   Random letters from the first 1000 nodes, which stay in the cache.
+ *    cold:  Random letters from random nodes; nearly every jump misses the cache.
+ *    walk:  Words typed from the root, a letter at a time; each jump depends on the last one.
+ *  ...by both of:
+ *    scan:    The original jump(), which checks every link in the node with a conditional move.
+ *    binary:  NexusTrie::jump(), which binary-searches the node's links.
+ * The trie is copied into one flat array first, as a loaded model would be.
+ * Both must agree on every jump; each is timed three times, alternating, and the best is kept. Returns 1 if they don't.
+ */
+
+
+namespace {
+	//The original NexusTrie::jump(), as it was.
+	int scanJump(const NexusTrie& trie, unsigned int nodeID, char letter) {
+		FlatRow<unsigned int> links = trie[nodeID];
+		unsigned int key = 0xFF&letter;
+		int res = -1;
+		for (const unsigned int* link=links.end(); link!=links.begin();) {
+			link--;
+			res = ((*link&0xFF)==key) ? (int)(*link>>8) : res;
+		}
+		return res;
+	}
+
+
+	//Our random numbers; the same every time.
+	unsigned int nextRand(unsigned int& seed) {
+		seed = seed*1103515245 + 12345;
+		return seed>>8;
+	}
+
+
+	double nsPerJump(const std::chrono::high_resolution_clock::time_point& start, size_t numJumps) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now()-start).count() / (double)numJumps;
+	}
+
+
+	//One way of picking jumps. Each jump is a node and a letter; for "walk", the node is wherever
+	//  the last jump went (or the root, if it went nowhere).
+	struct Pattern {
+		const char* name;
+		vector<unsigned int> nodes;
+		string letters;
+		bool walk;
+	};
+
+
+	//Time every jump in "pattern"; returns a checksum of the results, so both can be compared.
+	template <class JumpFunc>
+	long long timeJumps(const NexusTrie& trie, const Pattern& pattern, JumpFunc jump, double& ns) {
+		long long sum = 0;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		if (pattern.walk) {
+			int node = 0;
+			for (size_t i=0; i<pattern.letters.size(); i++) {
+				node = jump(trie, node, pattern.letters[i]);
+				sum += node;
+				node = (node==-1) ? 0 : node;
+			}
+		} else {
+			for (size_t i=0; i<pattern.letters.size(); i++)
+				sum += jump(trie, pattern.nodes[i], pattern.letters[i]);
+		}
+		ns = nsPerJump(start, pattern.letters.size());
+		return sum;
+	}
+}
+
+
+int main(int argc, const char* argv[])
+{
+	//Read our arguments
+	size_t numWords = 300000;
+	size_t numJumps = 20000000;
+	for (int i=1; i<argc; i++) {
+		if (strcmp(argv[i], "-w")==0 && i+1<argc)
+			numWords = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "-n")==0 && i+1<argc)
+			numJumps = strtoul(argv[++i], NULL, 10);
+		else {
+			printf("Usage: TrieBench [-w words] [-n jumps]\n");
+			return 1;
+		}
+	}
+	if (numWords==0 || numJumps==0) {
+		printf("Usage: TrieBench [-w words] [-n jumps]\n");
+		return 1;
+	}
+
+	//Build our trie. Letters are skewed towards the start of the alphabet, so that some links are
+	//  far more common than others (as "a" and "k" are in real romanisations).
+	unsigned int seed = 12345;
+	NexusTrie built;
+	built.addNode();
+	for (size_t w=0; w<numWords; w++) {
+		unsigned int node = 0;
+		size_t len = 2 + nextRand(seed)%7;
+		for (size_t i=0; i<len; i++) {
+			unsigned int r = nextRand(seed);
+			char letter = 'a' + (r%26)*(r/26%26)/26;
+			int next = built.jump(node, letter);
+			if (next==-1) {
+				next = built.addNode();
+				built.addLink(node, letter, next);
+			}
+			node = next;
+		}
+	}
+
+	//addLink() leaves most rows in their own vectors; copy them into one flat array, as a loaded model would be.
+	NexusTrie trie;
+	trie.reserve(built.size());
+	for (size_t i=0; i<built.size(); i++) {
+		FlatRow<unsigned int> links = built[i];
+		trie.pushNode(vector<unsigned int>(links.begin(), links.end()));
+	}
+	built = NexusTrie();
+	size_t numLinks = 0;
+	for (size_t i=0; i<trie.size(); i++)
+		numLinks += trie[i].size();
+	printf("Trie: %u nodes, %u links (%.1f MB), root has %u links\n", (unsigned int)trie.size(), (unsigned int)numLinks, (numLinks+trie.size())*sizeof(unsigned int)/(1024.0*1024.0), (unsigned int)trie[0].size());
+
+	//Our jumps. Half of the "hot" and "cold" letters are links out of that node; the rest are random.
+	Pattern patterns[3];
+	patterns[0].name = "hot";
+	patterns[1].name = "cold";
+	patterns[2].name = "walk";
+	for (size_t p=0; p<3; p++) {
+		patterns[p].walk = (p==2);
+		patterns[p].letters.resize(numJumps);
+		if (!patterns[p].walk)
+			patterns[p].nodes.resize(numJumps);
+		for (size_t i=0; i<numJumps; i++) {
+			unsigned int r = nextRand(seed);
+			if (patterns[p].walk) {
+				patterns[p].letters[i] = 'a' + (r%26)*(r/26%26)/26;
+				continue;
+			}
+			unsigned int node = nextRand(seed) % (p==0 ? std::min<size_t>(1000, trie.size()) : trie.size());
+			FlatRow<unsigned int> links = trie[node];
+			patterns[p].nodes[i] = node;
+			patterns[p].letters[i] = (r%2==0 && links.size()>0) ? NexusTrie::Letter(links[r/2%links.size()]) : (char)('a' + r/2%26);
+		}
+	}
+
+	//Time them
+	printf("%-6s %12s %12s\n", "", "scan(ns)", "binary(ns)");
+	bool same = true;
+	for (size_t p=0; p<3; p++) {
+		//Alternate the two, and keep the best of three runs each.
+		double scanNs = 0;
+		double binaryNs = 0;
+		long long scanSum = 0;
+		long long binarySum = 0;
+		for (size_t run=0; run<3; run++) {
+			double ns = 0;
+			scanSum = timeJumps(trie, patterns[p], scanJump, ns);
+			scanNs = (run==0 || ns<scanNs) ? ns : scanNs;
+			binarySum = timeJumps(trie, patterns[p], [](const NexusTrie& trie, unsigned int node, char letter){ return trie.jump(node, letter); }, ns);
+			binaryNs = (run==0 || ns<binaryNs) ? ns : binaryNs;
+		}
+		printf("%-6s %12.2f %12.2f  %s\n", patterns[p].name, scanNs, binaryNs, scanSum==binarySum?"":"MISMATCH");
+		same = same && (scanSum==binarySum);
+	}
+
+	return same ? 0 : 1;
+}
+
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
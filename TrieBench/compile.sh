@@ -0,0 +1,2 @@
+SRC=../win32_source
+g++ -std=c++0x -O2 -I$SRC -I$SRC/Contrib -o TrieBench TrieBench.cpp $SRC/Contrib/NGram/NexusTrie.cpp
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+//Don't let Visual Studio warn us to use the _s functions
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <chrono>
+
+#include "NGram/WordBuilder.h"
+#include "NGram/wz_utilities.h"
+
+using std::string;
+using std::wstring;
+using std::vector;
+using waitzar::WordBuilder;
+
+
+/**
+ * Times how long WordBuilder takes to load a large "mywords.txt", without any windows.
+ * Usage:
+ *   UserWordsBench [-n words] [-m Myanmar.model]
+ * Generates "words" (default 100000) distinct user words, each a string of consonants with its own
+ *  romanisation, and writes them to UserWordsBench.mywords.txt (deleted afterwards). The model is loaded
+ *  with and without this file, and the difference is reported as the time taken to add the user words.
+ *  Every word is then checked, by reverse lookup, to have been added with the right romanisation.
+ * Returns 1 if any word is missing.
+ */
+
+
+namespace {
+	const char* MyWordsFile = "UserWordsBench.mywords.txt";
+
+	double msSince(const std::chrono::high_resolution_clock::time_point& start) {
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now()-start).count()/1000.0;
+	}
+
+	//User word "id": its digits in base 33, as the consonants U+1000 to U+1020. We start at four
+	//  consonants, so none of these can already be in the model.
+	wstring makeWord(size_t id) {
+		wstring res;
+		for (size_t i=0; i<4 || id>0; i++) {
+			res += static_cast<wchar_t>(0x1000 + id%33);
+			id /= 33;
+		}
+		return res;
+	}
+
+	//Its romanisation: the same, in base 26, after a "q" (so that these don't overlap the model's own
+	//  romanisations any more than they must).
+	string makeRoman(size_t id) {
+		string res = "q";
+		for (size_t i=0; i<4 || id>0; i++) {
+			res += static_cast<char>('a' + id%26);
+			id /= 26;
+		}
+		return res;
+	}
+
+	//Write every word as "word = roman", in UTF-8, the way users do.
+	void writeMyWords(size_t numWords) {
+		FILE* out = fopen(MyWordsFile, "wb");
+		if (out==NULL)
+			throw std::runtime_error(string("Can't write: ") + MyWordsFile);
+		fputs("\xEF\xBB\xBF#Generated by UserWordsBench\n", out);
+		for (size_t i=0; i<numWords; i++)
+			fprintf(out, "%s = %s\n", waitzar::wcs2mbs(makeWord(i)).c_str(), makeRoman(i).c_str());
+		fclose(out);
+	}
+}
+
+
+int main(int argc, const char* argv[])
+{
+	//Read our arguments
+	size_t numWords = 100000;
+	string modelPath = "../win32_source/Resources/Myanmar.model";
+	for (int i=1; i<argc; i++) {
+		if (strcmp(argv[i], "-n")==0 && i+1<argc)
+			numWords = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "-m")==0 && i+1<argc)
+			modelPath = argv[++i];
+		else {
+			printf("Usage: UserWordsBench [-n words] [-m Myanmar.model]\n");
+			return 1;
+		}
+	}
+
+	try {
+		writeMyWords(numWords);
+
+		//The model alone
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		WordBuilder baseModel(modelPath.c_str(), vector<string>());
+		double baseMs = msSince(start);
+
+		//The model, plus our words
+		start = std::chrono::high_resolution_clock::now();
+		WordBuilder model(modelPath.c_str(), vector<string>(1, MyWordsFile));
+		double userMs = msSince(start);
+		remove(MyWordsFile);
+		if (model.isInError()) {
+			printf("Error loading model: %ls\n", model.getLastError().c_str());
+			return 1;
+		}
+
+		printf("Model: %u words, loaded in %.1f ms\n", baseModel.getTotalDefinedWords(), baseMs);
+		printf("Model + %u user words: loaded in %.1f ms (%.0f user words/sec)\n", (unsigned int)numWords, userMs, numWords/((userMs-baseMs)/1000));
+
+		//Check them
+		size_t numMissing = 0;
+		for (size_t i=0; i<numWords; i++) {
+			std::pair<int, string> found = model.reverseLookupWord(makeWord(i));
+			if (found.first==-1 || found.second!=makeRoman(i)) {
+				if (numMissing++ < 10)
+					printf("  Missing: %s = %s\n", waitzar::wcs2mbs(makeWord(i)).c_str(), makeRoman(i).c_str());
+			}
+		}
+		if (model.getTotalDefinedWords() != baseModel.getTotalDefinedWords()+numWords || numMissing>0) {
+			printf("Error: %u of %u user words were not added.\n", (unsigned int)numMissing, (unsigned int)numWords);
+			return 1;
+		}
+	} catch (std::exception& ex) {
+		remove(MyWordsFile);
+		printf("Error: %s\n", ex.what());
+		return 1;
+	}
+
+	return 0;
+}
+
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
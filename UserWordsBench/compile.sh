@@ -0,0 +1,2 @@
+SRC=../win32_source
+g++ -std=c++0x -O2 -pthread -I$SRC -I$SRC/Contrib -o UserWordsBench UserWordsBench.cpp $SRC/Contrib/NGram/WordBuilder.cpp $SRC/Contrib/NGram/BinaryModel.cpp $SRC/Contrib/NGram/MappedFile.cpp $SRC/Contrib/NGram/NexusTrie.cpp $SRC/Contrib/NGram/Utf8Transcoder.cpp $SRC/Contrib/NGram/wz_utilities.cpp $SRC/Contrib/NGram/Logger.cpp $SRC/Contrib/MD5/md5simple.c $SRC/Contrib/Burglish/fontconv.cpp $SRC/Contrib/Burglish/fontmap.cpp $SRC/Contrib/Burglish/lib.cpp $SRC/Contrib/Burglish/regex.cpp
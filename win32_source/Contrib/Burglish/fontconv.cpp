@@ -17,40 +17,131 @@
 
 #include "fontconv.h"
 
+#include <algorithm>
+#include <stdexcept>
+#include <mutex>
+
 
 namespace waitzar 
 {
 
 
+namespace {
+	/* copy a fixed-width, zero-padded field into a null-terminated string */
+	std::wstring fixedStr(const wchar_t* start, size_t width) {
+		return std::wstring(start, std::find(start, start+width, 0x0));
+	}
+
+	/* substitute in place, with a pattern compiled in advance */
+	void applyRegex(const Regex& re, const wchar_t* repl, wchar_t* str, Burglish_Regex_Scratch& scratch) {
+		if(re.test(str,scratch)){
+			re.sub(str,repl,str,scratch);
+		}
+	}
+
+	bool isLineBreak(wchar_t c) {
+		return c==L'\n' || c==L'\r' || c==0x0;
+	}
+
+	/* Zawgyi stores the "e" vowel and medial "ra" before the consonant they belong to */
+	bool isZawgyiPrefix(wchar_t c) {
+		return c==0x1031 || c==0x103B || (c>=0x107E && c<=0x1084);
+	}
+
+	/* consonants, independent vowels, digits and punctuation (and anything that isn't Myanmar) */
+	bool isZawgyiInitial(wchar_t c) {
+		return (c>=0x1000 && c<=0x102A) || (c>=0x1040 && c<=0x104F) || c==0x106A || c==0x106B || c==0x1086 || c==0x108F || c==0x1090 || c<0x1000 || c>0x109F;
+	}
+
+	/* Zawgyi's asat (killer) */
+	bool isZawgyiAsat(wchar_t c) {
+		return c==0x1039;
+	}
+}
+
+
 void convertFont(wchar_t* dst, const wchar_t* src, int srcFont, int dstFont){
-	/* declare hash style buffers */
-	wchar_t srcValHash[CHAR_RANGE]={0};
-	/*wchar_t dstValHash[CHAR_RANGE]={0};*/
-	wchar_t srcExtHash[CHAR_RANGE]={0};
-	//wchar_t dstExtHash[CHAR_RANGE]={0};
-	
-	wchar_t tmpBuffer[CHAR_BUFFER]={0}; /* tmp buffer for converting process */
+	FontConverter::Get(srcFont, dstFont).convert(dst, src);
+}
+
 
+const FontConverter& FontConverter::Get(int srcFont, int dstFont)
+{
+	static FontConverter* cache[FLEN][FLEN] = {{NULL}};
+	static std::once_flag built[FLEN][FLEN];
+	if (srcFont<0 || srcFont>=FLEN || dstFont<0 || dstFont>=FLEN)
+		throw std::runtime_error("Invalid font ID in FontConverter::Get()");
+
+	/* several threads may ask for the same pair at once; only one builds it, and the rest wait */
+	std::call_once(built[srcFont][dstFont], [srcFont, dstFont](){
+		cache[srcFont][dstFont] = new FontConverter(srcFont, dstFont);
+	});
+	return *cache[srcFont][dstFont];
+}
+
+
+FontConverter::FontConverter(int srcFont, int dstFont) : srcFont(srcFont), dstFont(dstFont), srcValHash(CHAR_RANGE, 0x0), srcExtHash(CHAR_RANGE, 0x0)
+{
+	const FontMap& sf = _f[srcFont];
+	const FontMap& df = _f[dstFont];
+
+	/* build reverse index for "val" in source, like hash */
 	for(int i=0; i<FVLEN;i++){
-		/* build reverse index for "val" in source, like hash */
-		if(_f[srcFont].val[i]!=0x0){
-			srcValHash[_f[srcFont].val[i]]= i+VIRTUAL_OFFSET;
+		if(sf.val[i]!=0x0){
+			srcValHash[sf.val[i]]= i+VIRTUAL_OFFSET;
 		}
-		///* build reverse index for "val" in dest, like hash */
-		//if(_f[dstFont].val[i]!=0x0){
-		//	dstValHash[_f[dstFont].val[i]]= i+VIRTUAL_OFFSET;
-		//}
 	}
 
 	/* build reverse index for "ext" in source, like hash */
-	for(int i=0;i<_f[srcFont].ext_len;i++){
-		srcExtHash[getExtKey(_f[srcFont], i)] = (0xff & srcValHash[getExtKey(_f[srcFont], i)]) + (i << 8);
+	for(int i=0;i<sf.ext_len;i++){
+		srcExtHash[getExtKey(sf, i)] = (0xff & srcValHash[getExtKey(sf, i)]) + (i << 8);
+		srcExtVal.push_back(fixedStr(&sf.ext[i*7 + 2], 5));
 	}
-	
-	/* build reverse index for "ext" in dest, like hash */
-	//for(int i=0;i<_f[dstFont].ext_len;i++){
-	//	dstExtHash[_f[dstFont].ext[i].key] = (0xff & dstValHash[_f[dstFont].ext[i].key]) + (i << 8);
-	//}
+
+	/* re-combination candidates in dest; a candidate can only match a string starting with its own first char */
+	dstRecombine.resize(FVLEN);
+	for(int i=0;i<df.ext_len;i++){
+		dstExtVal.push_back(fixedStr(&df.ext[i*7 + 2], 5));
+		wchar_t first = dstExtVal.back()[0];
+		if(getExtLength(df, i)>1 && first>=VIRTUAL_OFFSET && first<VIRTUAL_OFFSET+FVLEN){ /* no need if ext char length is 1 */
+			dstRecombine[first-VIRTUAL_OFFSET].push_back(i);
+		}
+	}
+
+	/* consonent forward re-order */
+	for(int i=0;i<df.fwd_len;i++){
+		fwdKeys.push_back(Regex(fixedStr(&df.fwd[i*30], 25).c_str(), true));
+		fwdVals.push_back(fixedStr(&df.fwd[i*30 + 25], 5));
+	}
+
+	/* re-ordering vowel: prepare the regex pattern. 
+	 * var vowel=abcd...z; 
+	 * regex = (["+vowel.slice(i+1).join("")+"]+)("+vowel[i]+") 
+	 * example regex => ([b-z]+)(a) 
+	 * why looping? to generate ([c-z]+)(b) .... ([z]+)(y) */
+	for(int i=0;i<df.vowel_len-1;i++){
+		std::wstring restr = L"([";
+		restr += std::wstring(&df.vowel[i+1], &df.vowel[df.vowel_len]);
+		restr += L"]+)(";
+		restr += df.vowel[i];
+		restr += L")";
+		vowelPatterns.push_back(Regex(restr.c_str(), true));
+	}
+
+	/* adjusting something after vowel re-order */
+	for(int i=0;i<df.after_len;i++){
+		afterKeys.push_back(Regex(fixedStr(&df.after[i*30], 25).c_str(), true));
+		afterVals.push_back(fixedStr(&df.after[i*30 + 25], 5));
+	}
+}
+
+
+void FontConverter::convert(wchar_t* dst, const wchar_t* src) const
+{
+	const FontMap& sf = _f[srcFont];
+	const FontMap& df = _f[dstFont];
+	wchar_t tmpBuffer[CHAR_BUFFER]; /* tmp buffer for converting process (always null-terminated before use) */
+	Burglish_Regex_Scratch scratch; /* match results for the re-ordering patterns; one per call, so threads don't share it */
 	
 	const wchar_t* srcTmp = src;
 	wchar_t* dstTmp = dst;
@@ -61,19 +152,16 @@ void convertFont(wchar_t* dst, const wchar_t* src, int srcFont, int dstFont){
 	while(*srcTmp){
 	
 		/* if known char range */
-		if(*srcTmp>=_f[srcFont].min && *srcTmp<=_f[srcFont].max){
+		if(*srcTmp>=sf.min && *srcTmp<=sf.max){
 			
 			/* "ext", decomposition */
-			if(srcExtHash[*srcTmp]!=0x0
-				&& _f[dstFont].val[LOBYTE2(srcExtHash[*srcTmp])]==0x0){ /* only done when dest font dont have this char */
-				wchar_t *retVal = getExtValue(_f[srcFont], HIBYTE2(srcExtHash[*srcTmp]));
-				wchar_t *extval = retVal;
+			wchar_t ext = srcExtHash[*srcTmp];
+			if(ext!=0x0 && df.val[LOBYTE2(ext)]==0x0){ /* only done when dest font dont have this char */
+				const wchar_t *extval = srcExtVal[HIBYTE2(ext)].c_str();
 				while(*extval){ 
 					*dstTmp++=*extval++;
 				}
 				srcTmp++;
-
-				delete [] retVal;
 				continue;
 			}
 			
@@ -101,28 +189,25 @@ void convertFont(wchar_t* dst, const wchar_t* src, int srcFont, int dstFont){
 	
 	/* Convert from Global font to dest font */
 	while(*srcTmp){
-		if(*srcTmp>=VIRTUAL_OFFSET){
-			if(_f[dstFont].val[*srcTmp-VIRTUAL_OFFSET]!=0x0){
+		if(*srcTmp>=VIRTUAL_OFFSET && *srcTmp<VIRTUAL_OFFSET+FVLEN){
+			unsigned int vid = *srcTmp-VIRTUAL_OFFSET;
+			if(df.val[vid]!=0x0){
 				/* re-combination process */
 				bool match=false;
 				if(srcTmp[1]!=0x0){ /* no need when string len is 1 */
-					for(int i=0;i<_f[dstFont].ext_len;i++){
-						wchar_t *cmpTmp = getExtValue(_f[dstFont], i);
-						if( getExtLength(_f[dstFont], i)>1 /* no need if ext char length is 1 */
-						&& cmp(cmpTmp, srcTmp)==0){
-							*dstTmp++ = getExtKey(_f[dstFont], i);
-							srcTmp += getExtLength(_f[dstFont], i);
+					const std::vector<unsigned short>& candidates = dstRecombine[vid];
+					for(size_t c=0;c<candidates.size();c++){
+						if(cmp(dstExtVal[candidates[c]].c_str(), srcTmp)==0){
+							*dstTmp++ = getExtKey(df, candidates[c]);
+							srcTmp += getExtLength(df, candidates[c]);
 							match=true; /* re-combined */
-
-							delete [] cmpTmp;
 							break;
 						}
-						delete [] cmpTmp;
 					}
 				}
 				/* if !combined */
 				if(!match)
-					*dstTmp++=_f[dstFont].val[*srcTmp++-VIRTUAL_OFFSET];
+					*dstTmp++=df.val[*srcTmp++-VIRTUAL_OFFSET];
 				continue;
 			}
 		}
@@ -133,57 +218,97 @@ void convertFont(wchar_t* dst, const wchar_t* src, int srcFont, int dstFont){
 	dstTmp = tmpBuffer;
 	
 	/* consonent forward re-order */
-	for(int i=0;i<_f[dstFont].fwd_len;i++){
-		wchar_t *dstKey = getFwdKey(_f[dstFont], i);
-		wchar_t *dstVal = getFwdValue(_f[dstFont], i);
-
-		Regex re(dstKey,true);
-		if(re.test(dstTmp)){
-			re.sub(dstTmp,dstVal,dstTmp);
-		}
-
-		delete [] dstKey;
-		delete [] dstVal;
+	for(size_t i=0;i<fwdKeys.size();i++){
+		applyRegex(fwdKeys[i], fwdVals[i].c_str(), dstTmp, scratch);
 	}
 	
 	/* re-ordering vowel */
-	for(int i=0;i<_f[dstFont].vowel_len-1;i++){
-		/* prepare the regex pattern. 
-		 * var vowel=abcd...z; 
-		 * regex = (["+vowel.slice(i+1).join("")+"]+)("+vowel[i]+") 
-		 * example regex => ([b-z]+)(a) 
-		 * why looping? to generate ([c-z]+)(b) .... ([z]+)(y) */
-			
-		wchar_t restr[40]=L"(["; wchar_t bracket[]=L"]+)("; 
-		cpy(restr+2,&_f[dstFont].vowel[i+1]);// b-z
-		cpy(restr+_f[dstFont].vowel_len-i+1,bracket);// ]+)(
-		restr[_f[dstFont].vowel_len-i+5]=_f[dstFont].vowel[i]; // tmp[i]
-		restr[_f[dstFont].vowel_len-i+6]=')';// )
-		
-		Regex re(restr,true);
-		if(re.test(dstTmp)){
-			re.sub(dstTmp,L"\2\1",dstTmp); /* just do re-ordering, according to pattern */
-		}
+	for(size_t i=0;i<vowelPatterns.size();i++){
+		applyRegex(vowelPatterns[i], L"\2\1", dstTmp, scratch); /* just do re-ordering, according to pattern */
 	}
 	
 	/* adjusting something after vowel re-order */
-	for(int i=0;i<_f[dstFont].after_len;i++){
-		wchar_t *dstKey = getAfterKey(_f[dstFont], i);
-		wchar_t *dstVal = getAfterValue(_f[dstFont], i);
-
-		Regex re(dstKey,true);
-		if(re.test(dstTmp)){
-			re.sub(dstTmp,dstVal,dstTmp);
-		}
-
-		delete [] dstKey;
-		delete [] dstVal;
+	for(size_t i=0;i<afterKeys.size();i++){
+		applyRegex(afterKeys[i], afterVals[i].c_str(), dstTmp, scratch);
 	}
 	
 	/* copy to return string  */
 	cpy(dst,dstTmp);
-	
-	return;
+}
+
+
+std::wstring FontConverter::convertDocument(const std::wstring& src, size_t maxChunk) const
+{
+	std::wstring res;
+	res.reserve(src.size());
+
+	/* scratch space, shared by every chunk. A chunk can grow by up to 8x when decomposed, and convert() works on
+	 *  it in fixed-size buffers (tmpBuffer, and the regex scratch), so chunks are capped to what those can hold. */
+	const size_t maxFits = std::min<size_t>(CHAR_BUFFER-1, MAXSOURCESTRLEN-1)/8;
+	maxChunk = std::min<size_t>(std::max<size_t>(maxChunk, 1), maxFits);
+	std::vector<wchar_t> srcBuff(maxChunk+1);
+	std::vector<wchar_t> dstBuff(maxChunk*8+1);
+
+	size_t start = 0;
+	while(start<src.size()){
+		/* find the end of this line */
+		size_t end = start;
+		while(end<src.size() && !isLineBreak(src[end]))
+			end++;
+
+		/* split long lines on the last boundary that fits (or, failing that, wherever we must) */
+		while(end-start > maxChunk){
+			size_t cut = start+maxChunk;
+			while(cut>start && !IsSplitPoint(srcFont, src, cut))
+				cut--;
+			if(cut==start)
+				cut = start+maxChunk;
+			convertChunk(&src[start], cut-start, srcBuff, dstBuff, res);
+			start = cut;
+		}
+		convertChunk(&src[0]+start, end-start, srcBuff, dstBuff, res);
+
+		/* line breaks are copied as-is */
+		while(end<src.size() && isLineBreak(src[end]))
+			res += src[end++];
+		start = end;
+	}
+
+	return res;
+}
+
+
+/* can we convert src[..pos) and src[pos..) separately, and get the same result as converting them together? */
+bool FontConverter::IsSplitPoint(int srcFont, const std::wstring& src, size_t pos)
+{
+	if(srcFont!=Zawgyi_One)
+		return src[pos-1]==L' ';
+
+	/* a new syllable starts with a prefix, or with an initial that has no prefix... */
+	wchar_t curr = src[pos];
+	if(isZawgyiPrefix(src[pos-1]))
+		return false;
+	if(isZawgyiPrefix(curr))
+		return true;
+	if(!isZawgyiInitial(curr))
+		return false;
+
+	/* ...unless the initial is "killed", in which case it ends the previous syllable */
+	size_t next = pos+1;
+	while(next<src.size() && (src[next]==0x1037 || src[next]==0x1094 || src[next]==0x1095))
+		next++;
+	return next>=src.size() || !isZawgyiAsat(src[next]);
+}
+
+
+void FontConverter::convertChunk(const wchar_t* src, size_t length, std::vector<wchar_t>& srcBuff, std::vector<wchar_t>& dstBuff, std::wstring& res) const
+{
+	if (length==0)
+		return;
+	std::copy(src, src+length, srcBuff.begin());
+	srcBuff[length] = 0x0;
+	convert(&dstBuff[0], &srcBuff[0]);
+	res += &dstBuff[0];
 }
 
 
@@ -18,6 +18,8 @@
 #ifndef __FONTCONV_H__
 #define __FONTCONV_H__
 
+#include <string>
+#include <vector>
 #include "fontmap.h"
 #include "regex.h"
 #include "lib.h"
@@ -36,6 +38,59 @@ namespace waitzar
 
 void convertFont(wchar_t* dst, const wchar_t* src, int srcFont, int dstFont);
 
+
+/* 
+ * Converts text from one font to another. Building the reverse indexes and compiling the re-ordering 
+ *  patterns is most of the work of a conversion, so this is done once per (srcFont, dstFont) pair; 
+ *  convert() then allocates nothing. A FontConverter is never modified after it is built, so one 
+ *  instance may be shared between threads, and Get() may be called from any thread.
+ */
+class FontConverter {
+public:
+	FontConverter(int srcFont, int dstFont);
+
+	/* same contract as convertFont(): dst must be large enough for the (decomposed) result */
+	void convert(wchar_t* dst, const wchar_t* src) const;
+
+	/* convert a string or document of any length, in linear time. Lines are converted separately, and
+	 *  lines longer than maxChunk are split on syllable boundaries (for Zawgyi; on spaces otherwise). 
+	 *  The result is the same as converting each line in one go, unless a line has no boundary within 
+	 *  maxChunk letters; then it is cut wherever it must be, and the syllable at that cut may differ. 
+	 *  maxChunk is capped at (CHAR_BUFFER-1)/8, the most that convert()'s buffers can hold. */
+	std::wstring convertDocument(const std::wstring& src, size_t maxChunk=1024) const;
+
+	/* shared converter for this font pair, built on first use */
+	static const FontConverter& Get(int srcFont, int dstFont);
+
+	/* can text in srcFont be cut before src[pos] (0<pos<length), and each side converted separately, with the
+	 *  same result as converting it in one go? This is where convertDocument() splits long lines. */
+	static bool IsSplitPoint(int srcFont, const std::wstring& src, size_t pos);
+
+private:
+	void convertChunk(const wchar_t* src, size_t length, std::vector<wchar_t>& srcBuff, std::vector<wchar_t>& dstBuff, std::wstring& res) const;
+
+	int srcFont;
+	int dstFont;
+
+	/* reverse indexes for the source font, as in the original convertFont() */
+	std::vector<wchar_t> srcValHash;
+	std::vector<wchar_t> srcExtHash;
+
+	/* "ext" values, null-terminated, for both fonts */
+	std::vector<std::wstring> srcExtVal;
+	std::vector<std::wstring> dstExtVal;
+
+	/* re-combination candidates in the dest font, indexed by their first (virtual) character */
+	std::vector< std::vector<unsigned short> > dstRecombine;
+
+	/* re-ordering patterns for the dest font, compiled */
+	std::vector<Regex> fwdKeys;
+	std::vector<std::wstring> fwdVals;
+	std::vector<Regex> vowelPatterns;
+	std::vector<Regex> afterKeys;
+	std::vector<std::wstring> afterVals;
+};
+
 } //End waitzar namespace
 	
 #endif //__FONTCONV_H__
@@ -46,17 +46,20 @@ namespace waitzar
 
 /* pass regex pattern to constructor */
 Regex::Regex(const wchar_t* pat, bool global, bool greedy){
-	this->pattern=pat;
 	this->global=global;
 	this->greedy=greedy;
-	this->compile();
+	this->compile(pat);
 }
 
 Regex::~Regex(){
 	//free(this->buffer);
 }
 
-void Regex::compile(){
+void Regex::compile(const wchar_t* pattern){
+	/* an empty (or missing) pattern never matches */
+	error=true;
+	r.length=0;
+
 	/* if pattern is nothing, stop here 
 	 * !!! need to revise this !!! */
 	if(pattern==NULL) return;
@@ -67,6 +70,9 @@ void Regex::compile(){
 	/* if blank regex pattern OR 
 	 * pattern length is too long, stop here */
 	if(patlen<1) return;
+
+	/* one char per pattern char is always enough; the extra (blank) one matches nothing */
+	r.ch.assign(patlen+1, Burglish_Regex_Char());
 	
 	/* indexes */
 	int chIdx=0;int rgIdx=0;int grIdx=0;
@@ -75,8 +81,6 @@ void Regex::compile(){
 	bool sq=false;bool cr=false;bool eaten=true;
 	
 	/* initialize regex default data */
-	error=true;
-	r.length =0;
 	r.mustEnd=false;
 	r.mustStart=false;
 	
@@ -186,7 +190,7 @@ void Regex::compile(){
 }
 
 /* pattern matching for one regex char */
-unsigned int Regex::check(unsigned int chIdx, wchar_t* inputStr, unsigned int strIdx){
+unsigned int Regex::check(unsigned int chIdx, wchar_t* inputStr, unsigned int strIdx) const{
 	unsigned int matchCount=0;
 	unsigned int repeatCount=0;
 	
@@ -257,12 +261,13 @@ unsigned int Regex::check(unsigned int chIdx, wchar_t* inputStr, unsigned int st
 }
 
 /* regex test */
-bool Regex::test(wchar_t*str){
-	return this->exec(str);
+bool Regex::test(wchar_t*str, Burglish_Regex_Scratch& scratch) const{
+	return this->exec(str, scratch.gr);
 }
 
-bool Regex::exec(wchar_t*str){
+bool Regex::exec(wchar_t*str, Burglish_Regex_Results& gr, int from) const{
 	/* if compile doesnt succeeded, stop here */
+	gr.next=-1;
 	if(this->error) 
 		return false;
 	
@@ -275,13 +280,13 @@ bool Regex::exec(wchar_t*str){
 		return false;
 	
 	/* if pattern have ^ and not match first character, 
-	 * no need to continue anymore. */
-	if(r.mustStart && !this->check(0,str, 0)) 
+	 * no need to continue anymore. (checked once, when from==0) */
+	if(from==0 && r.mustStart && !this->check(0,str, 0)) 
 		return false;
 
 	/* if pattern have $ and not match with last character, 
 	 * no need to continue anymore. */
-	if(r.mustEnd && !this->check(r.length-1,str, strlen-1)) 
+	if(from==0 && r.mustEnd && !this->check(r.length-1,str, strlen-1)) 
 		return false;
 	
 	/* set pointer to NULL 
@@ -289,7 +294,7 @@ bool Regex::exec(wchar_t*str){
 	gr.pointer=NULL;
 	
 	bool match;
-	int strIdx=0;
+	int strIdx=from;
 	int resIdx=0;
 
 	do{
@@ -384,6 +389,11 @@ bool Regex::exec(wchar_t*str){
 			/* increment the matching groups counter */
 			resIdx++;
 
+			/* out of room; sub() will resume from here */
+			if(resIdx==MAXRESULT && strIdx<strlen && this->global){
+				gr.next=strIdx;
+				break;
+			}
 		}
 	
 	/* if global flag is true, 
@@ -400,12 +410,13 @@ bool Regex::exec(wchar_t*str){
 }
 
 /* regex substitution */
-void Regex::sub(wchar_t*srcStr, const wchar_t* replStr, wchar_t* destStr){
+void Regex::sub(wchar_t*srcStr, const wchar_t* replStr, wchar_t* destStr, Burglish_Regex_Scratch& scratch) const{
+	Burglish_Regex_Results& gr = scratch.gr;
 
 	/* check string is not compile yet, 
 	* try to compile here */
 	if(gr.pointer!=srcStr){
-		if(!this->exec(srcStr)){
+		if(!this->exec(srcStr, gr)){
 			/* if compile fail, no replacing will occur */
 			destStr=srcStr;
 			return;
@@ -415,11 +426,19 @@ void Regex::sub(wchar_t*srcStr, const wchar_t* replStr, wchar_t* destStr){
 	/* once .test with regex no more needed */
 	int resIdx=0;
 	
-	wchar_t*ds=this->buffer;
+	wchar_t*ds=scratch.buffer;
 	
 	int srcIdx=0;
 	
 	do{
+		/* more than MAXRESULT matches: find the next batch, starting where the last one stopped */
+		if(gr.next!=-1 && srcIdx==gr.next){
+			if(!this->exec(srcStr, gr, srcIdx))
+				gr.length=0;
+			gr.pointer=srcStr;
+			resIdx=0;
+		}
+
 		/* if within range of "replace" source string */
 		if(resIdx<(int)gr.length &&
 			srcIdx>=gr.res[resIdx].range[0].start && srcIdx<=gr.res[resIdx].range[0].end ){
@@ -471,7 +490,7 @@ void Regex::sub(wchar_t*srcStr, const wchar_t* replStr, wchar_t* destStr){
 	//*ds=NULL;/* very important :P */
 	*ds='\0';  //Terminate string
 	
-	cpy(destStr,this->buffer);
+	cpy(destStr,scratch.buffer);
 }
 
 } //End waitzar namespace
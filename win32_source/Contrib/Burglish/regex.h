@@ -20,6 +20,7 @@
 #define __REGEX_H__
 
 #include <wchar.h>
+#include <vector>
 
 namespace waitzar 
 {
@@ -54,7 +55,7 @@ struct Burglish_Regex_Char{
 
 struct Burglish_Regex{
 	unsigned int length;/* length of regex source string */
-	Burglish_Regex_Char ch[MAXMATCHSTRLEN];
+	std::vector<Burglish_Regex_Char> ch;/* sized to the pattern, plus one blank char at the end */
 	bool mustStart; /* ^ */
 	bool mustEnd; /* $ */
 };
@@ -68,25 +69,31 @@ struct Burglish_Regex_Results{
 	unsigned int length;
 	Burglish_Regex_Match res[MAXRESULT];
 	wchar_t* pointer;
+	int next; /* if there were more than MAXRESULT matches, where to resume matching; else -1 */
 };
 
-/* regex headers */
+/* everything test() and sub() write to; kept out of Regex so that one compiled Regex can be shared */
+struct Burglish_Regex_Scratch{
+	Burglish_Regex_Results gr;/* executed group result */
+	wchar_t buffer[MAXSOURCESTRLEN];
+};
+
+/* regex headers 
+ * a Regex is never changed after it is compiled, so any number of threads may use one at once, 
+ *  each with its own Burglish_Regex_Scratch. sub() re-uses the results of the last test() on the same string. */
 class Regex{
 	public:
 		Regex(const wchar_t* pattern, bool global=false, bool greedy=false);
 		~Regex();
-		void compile();
-		bool test(wchar_t* srcStr);
-		void sub(wchar_t*srcStr, const wchar_t* replStr, wchar_t* destStr);
-		const wchar_t* pattern;
+		bool test(wchar_t* srcStr, Burglish_Regex_Scratch& scratch) const;
+		void sub(wchar_t*srcStr, const wchar_t* replStr, wchar_t* destStr, Burglish_Regex_Scratch& scratch) const;
 		bool global;
 		bool greedy;
 	private:
-		bool exec(wchar_t* srcStr);
-		unsigned int check(unsigned int chIdx, wchar_t* inputStr, unsigned int strIdx);
+		void compile(const wchar_t* pattern);
+		bool exec(wchar_t* srcStr, Burglish_Regex_Results& gr, int from=0) const;
+		unsigned int check(unsigned int chIdx, wchar_t* inputStr, unsigned int strIdx) const;
 		Burglish_Regex r;/* compiled regex */
-		Burglish_Regex_Results gr;/* executed group result */
-		wchar_t buffer[MAXSOURCESTRLEN];
 		bool error;
 };
 
@@ -19,7 +19,7 @@
 */
 
 
-#include ".\adler32.h"
+#include "Adler32.h"
 
 
 /**
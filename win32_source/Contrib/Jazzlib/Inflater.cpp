@@ -19,7 +19,7 @@
 */
 
 
-#include ".\inflater.h"
+#include "Inflater.h"
 
 
 /**
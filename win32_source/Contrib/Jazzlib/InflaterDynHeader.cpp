@@ -19,7 +19,7 @@
 */
 
 
-#include ".\inflaterdynheader.h"
+#include "InflaterDynHeader.h"
 
 
 /**
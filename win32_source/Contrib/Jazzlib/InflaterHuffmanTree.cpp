@@ -19,7 +19,7 @@
 */
 
 
-#include ".\inflaterhuffmantree.h"
+#include "InflaterHuffmanTree.h"
 
 
 /** 
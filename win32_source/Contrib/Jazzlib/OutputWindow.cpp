@@ -19,7 +19,7 @@
 */
 
 
-#include ".\outputwindow.h"
+#include "OutputWindow.h"
 
 OutputWindow::OutputWindow()
 {
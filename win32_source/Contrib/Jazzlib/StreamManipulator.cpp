@@ -19,7 +19,7 @@
 */
 
 
-#include ".\streammanipulator.h"
+#include "StreamManipulator.h"
 
 
 /**
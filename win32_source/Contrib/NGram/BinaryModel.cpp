@@ -0,0 +1,183 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#include "BinaryModel.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+
+using std::string;
+using std::vector;
+
+
+namespace waitzar
+{
+
+
+namespace {
+	//Throw a consistently-formatted error
+	const string ErrPrefix = "Invalid binary model: ";
+	void fail(const string& msg) {
+		throw std::runtime_error(ErrPrefix + msg);
+	}
+	void fail(const char* table, size_t row, const char* msg) {
+		std::stringstream res;
+		res <<table <<" row " <<row <<" " <<msg;
+		fail(res.str());
+	}
+}
+
+
+BinaryModel::BinaryModel(const char* data, size_t size, bool verifyChecksum) : file(data, size)
+{
+	validate(verifyChecksum);
+}
+
+
+BinaryModel::BinaryModel(const string& path, bool verifyChecksum) : file(path)
+{
+	validate(verifyChecksum);
+}
+
+
+bool BinaryModel::IsBinaryModel(const char* data, size_t size)
+{
+	if (size < sizeof(Header))
+		return false;
+	unsigned int magic = 0;
+	memcpy(&magic, data, sizeof(magic));
+	return magic == Magic;
+}
+
+
+void BinaryModel::validate(bool verifyChecksum) const
+{
+	const char* data = file.data();
+	size_t size = file.size();
+	if (!IsBinaryModel(data, size))
+		fail("bad magic number");
+
+	//Check the header
+	const Header& head = header();
+	if (head.byteOrder != ByteOrderMark)
+		fail("model was compiled on a machine with a different byte order");
+	if (head.version != Version) {
+		std::stringstream msg;
+		msg <<"version " <<head.version <<" is not supported (expected " <<Version <<")";
+		fail(msg.str());
+	}
+	if (head.fileSize != size)
+		fail("file has been truncated");
+
+	//Check the contents
+	if (verifyChecksum && MappedFile::Checksum(data+sizeof(Header), size-sizeof(Header))!=head.checksum)
+		fail("checksum mismatch");
+
+	//Check each section
+	head.dictionary.validate(data, size, sizeof(unsigned short), ErrPrefix, "dictionary");
+	head.nexus.validate(data, size, sizeof(unsigned int), ErrPrefix, "nexus");
+	head.prefix.validate(data, size, sizeof(unsigned int), ErrPrefix, "prefix");
+	if (head.nexus.rows==0)
+		fail("nexus can't be empty");
+
+	//Check every link and word ID, so that lookups never have to.
+	FlatTable<unsigned int> nexus;
+	FlatTable<unsigned int> prefix;
+	head.nexus.attach(data, nexus);
+	head.prefix.attach(data, prefix);
+	for (size_t i=0; i<nexus.size(); i++) {
+		FlatRow<unsigned int> links = nexus[i];
+		for (const unsigned int* link=links.begin(); link!=links.end(); link++) {
+			//Links are sorted by letter; NexusTrie::jump() relies on this.
+			if (link!=links.begin() && NexusTrie::Letter(*(link-1))>NexusTrie::Letter(*link))
+				fail("nexus", i, "is not sorted by letter");
+			size_t limit = (NexusTrie::Letter(*link)==NexusTrie::PrefixLink) ? prefix.size() : nexus.size();
+			if (NexusTrie::Target(*link) >= limit)
+				fail("nexus", i, "links past the end of its table");
+		}
+	}
+	for (size_t i=0; i<prefix.size(); i++) {
+		//{numPairs, (wordID, prefixID)*numPairs, wordID...}
+		FlatRow<unsigned int> row = prefix[i];
+		if (row.empty() || row[0] > (row.size()-1)/2)
+			fail("prefix", i, "has the wrong number of values");
+		for (size_t p=0; p<row[0]; p++) {
+			if (row[p*2+1]>=head.dictionary.rows || row[p*2+2]>=head.prefix.rows)
+				fail("prefix", i, "links past the end of its table");
+		}
+		for (size_t w=row[0]*2+1; w<row.size(); w++) {
+			if (row[w]>=head.dictionary.rows)
+				fail("prefix", i, "has a word that isn't in the dictionary");
+		}
+	}
+}
+
+
+bool BinaryModel::allowsAnyChar() const
+{
+	return (header().flags&FlagAllowAnyChar)!=0;
+}
+
+
+void BinaryModel::attach(FlatTable<unsigned short>& dictionary, NexusTrie& nexus, FlatTable<unsigned int>& prefix) const
+{
+	const Header& head = header();
+	const char* data = file.data();
+	head.dictionary.attach(data, dictionary);
+	nexus.attach(reinterpret_cast<const unsigned int*>(data+head.nexus.offsetsPos), reinterpret_cast<const unsigned int*>(data+head.nexus.valuesPos), head.nexus.rows);
+	head.prefix.attach(data, prefix);
+}
+
+
+void BinaryModel::Write(const string& path, const FlatTable<unsigned short>& dictionary, const NexusTrie& nexus, const FlatTable<unsigned int>& prefix, bool allowAnyChar)
+{
+	//Build the whole file in memory; models are only a few hundred kB.
+	Header head;
+	memset(&head, 0, sizeof(head));
+	vector<char> out(sizeof(Header), 0);
+	head.dictionary.write(out, dictionary);
+	head.nexus.write(out, nexus.getEdges());
+	head.prefix.write(out, prefix);
+
+	//Fill in the header
+	head.magic = Magic;
+	head.version = Version;
+	head.byteOrder = ByteOrderMark;
+	head.flags = allowAnyChar ? FlagAllowAnyChar : 0;
+	head.fileSize = out.size();
+	head.checksum = MappedFile::Checksum(&out[sizeof(Header)], out.size()-sizeof(Header));
+	memcpy(&out[0], &head, sizeof(Header));
+
+	//Save it
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL)
+		throw std::runtime_error(string("Can't write binary model: ") + path);
+	size_t written = fwrite(&out[0], 1, out.size(), file);
+	fclose(file);
+	if (written != out.size())
+		throw std::runtime_error(string("Error writing binary model: ") + path);
+}
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
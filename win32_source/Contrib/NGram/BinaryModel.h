@@ -0,0 +1,99 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "NGram/FlatTable.h"
+#include "NGram/NexusTrie.h"
+#include "NGram/MappedFile.h"
+
+namespace waitzar
+{
+
+
+/**
+ * The compiled ("binary") form of a WordBuilder model. This contains exactly the same data
+ *   as Myanmar.model (dictionary, nexus, prefix), but laid out as flat offset tables so
+ *   that it can be memory-mapped read-only and used in place without any parsing.
+ *   Since the mapping is read-only, every process which loads the same file shares its pages.
+ * Layout (all values are little-endian, 32-bit unless noted; sections are 4-byte aligned):
+ *   [Header]
+ *   [dictionary offsets : numWords+1]   [dictionary letters : 16-bit code units]
+ *   [nexus offsets : numNexi+1]         [nexus links, packed as (nexusID<<8)|letter, sorted by letter]
+ *   [prefix offsets : numPrefixes+1]    [prefix values, same layout as the text model]
+ * The checksum is an Adler-32 of everything following the header.
+ * Compile new binary models with the ModelCompiler tool; see that directory for details.
+ */
+class BinaryModel {
+public:
+	//Constants
+	static const unsigned int Magic = 0x4D425A57; //"WZBM"
+	static const unsigned int Version = 2; //v2: nexus links are sorted by letter
+	static const unsigned int ByteOrderMark = 0x01020304;
+	static const unsigned int FlagAllowAnyChar = 0x1;
+
+	//Each table is stored as an array of offsets followed by an array of values
+	typedef FileSection Section;
+
+	struct Header {
+		unsigned int magic;
+		unsigned int version;
+		unsigned int byteOrder;
+		unsigned int checksum;
+		unsigned int flags;
+		unsigned int fileSize;
+		Section dictionary;
+		Section nexus;
+		Section prefix;
+	};
+
+	//Map a binary model file from disk. Throws on any error.
+	explicit BinaryModel(const std::string& path, bool verifyChecksum=true);
+
+	//Use a buffer that's already in memory (e.g., a locked resource). The buffer must outlive
+	//  this object (and any WordBuilder that uses it).
+	BinaryModel(const char* data, size_t size, bool verifyChecksum=true);
+
+	//Attach our data to a series of tables. These will reference the mapped memory directly.
+	void attach(FlatTable<unsigned short>& dictionary, NexusTrie& nexus, FlatTable<unsigned int>& prefix) const;
+	bool allowsAnyChar() const;
+
+	//Helpers
+	static bool IsBinaryModel(const char* data, size_t size);
+
+	//Save a model in our binary format
+	static void Write(const std::string& path, const FlatTable<unsigned short>& dictionary, const NexusTrie& nexus, const FlatTable<unsigned int>& prefix, bool allowAnyChar);
+
+private:
+	//The data, and how we got it
+	MappedFile file;
+
+	void validate(bool verifyChecksum) const;
+	const Header& header() const { return *reinterpret_cast<const Header*>(file.data()); }
+};
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
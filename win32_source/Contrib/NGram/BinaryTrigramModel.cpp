@@ -0,0 +1,189 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#include "BinaryTrigramModel.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+
+using std::string;
+using std::vector;
+
+
+namespace waitzar
+{
+
+
+namespace {
+	//Throw a consistently-formatted error
+	const string ErrPrefix = "Invalid binary trigram model: ";
+	void fail(const string& msg) {
+		throw std::runtime_error(ErrPrefix + msg);
+	}
+}
+
+
+BinaryTrigramModel::BinaryTrigramModel(const char* data, size_t size, bool verifyChecksum) : file(data, size)
+{
+	validate(verifyChecksum);
+}
+
+
+BinaryTrigramModel::BinaryTrigramModel(const string& path, bool verifyChecksum) : file(path)
+{
+	validate(verifyChecksum);
+}
+
+
+bool BinaryTrigramModel::IsBinaryModel(const char* data, size_t size)
+{
+	if (size < sizeof(Header))
+		return false;
+	unsigned int magic = 0;
+	memcpy(&magic, data, sizeof(magic));
+	return magic == Magic;
+}
+
+
+void BinaryTrigramModel::validate(bool verifyChecksum) const
+{
+	const char* data = file.data();
+	size_t size = file.size();
+	if (!IsBinaryModel(data, size))
+		fail("bad magic number");
+
+	//Check the header
+	const Header& head = header();
+	if (head.byteOrder != ByteOrderMark)
+		fail("model was compiled on a machine with a different byte order");
+	if (head.version != Version) {
+		std::stringstream msg;
+		msg <<"version " <<head.version <<" is not supported (expected " <<Version <<")";
+		fail(msg.str());
+	}
+	if (head.charSize != sizeof(wchar_t))
+		fail("model was compiled on a machine with a different wchar_t size");
+	if (head.fileSize != size)
+		fail("file has been truncated");
+
+	//Check the contents
+	if (verifyChecksum && MappedFile::Checksum(data+sizeof(Header), size-sizeof(Header))!=head.checksum)
+		fail("checksum mismatch");
+
+	//Check each section
+	head.words.validate(data, size, sizeof(wchar_t), ErrPrefix, "words");
+	head.romans.validate(data, size, sizeof(char), ErrPrefix, "romans");
+	head.wordHash.validate(data, size, sizeof(unsigned int), ErrPrefix, "word hash");
+	head.trie.validate(data, size, sizeof(unsigned int), ErrPrefix, "trie");
+	head.nodeWords.validate(data, size, sizeof(unsigned int), ErrPrefix, "node words");
+	head.ngramHash.validate(data, size, sizeof(unsigned int), ErrPrefix, "ngram hash");
+	head.ngramValues.validate(data, size, sizeof(unsigned int), ErrPrefix, "ngram values");
+	head.shortcutKeys.validate(data, size, sizeof(wchar_t), ErrPrefix, "shortcut keys");
+	head.shortcutValues.validate(data, size, sizeof(wchar_t), ErrPrefix, "shortcut values");
+	head.lastChance.validate(data, size, sizeof(char), ErrPrefix, "last-chance patterns");
+
+	//Check that the tables agree with each other
+	if (head.trie.rows==0)
+		fail("trie can't be empty");
+	if (head.romans.rows!=head.words.rows)
+		fail("romans don't match words");
+	if (head.wordHash.rows!=1 || head.wordHash.numValues<=head.words.rows || (head.wordHash.numValues&(head.wordHash.numValues-1))!=0)
+		fail("word hash is malformed");
+	const unsigned int* wordSlot = reinterpret_cast<const unsigned int*>(data+head.wordHash.valuesPos);
+	for (unsigned int i=0; i<head.wordHash.numValues; i++) {
+		if (wordSlot[i]!=TrigramTables::NoWord && wordSlot[i]>=head.words.rows)
+			fail("word hash references a word that doesn't exist");
+	}
+	if (head.nodeWords.rows!=head.trie.rows)
+		fail("node words don't match trie");
+	if (head.ngramHash.rows!=1 || head.ngramHash.numValues%TrigramTables::NgramSlotSize!=0)
+		fail("ngram hash is malformed");
+	unsigned int numSlots = head.ngramHash.numValues/TrigramTables::NgramSlotSize;
+	if ((numSlots&(numSlots-1))!=0)
+		fail("ngram hash size is not a power of two");
+	const unsigned int* slot = reinterpret_cast<const unsigned int*>(data+head.ngramHash.valuesPos);
+	for (unsigned int i=0; i<numSlots; i++, slot+=TrigramTables::NgramSlotSize) {
+		if (slot[0]!=TrigramTables::NoWord && (slot[0]>=head.trie.rows || slot[4]>=head.ngramValues.rows))
+			fail("ngram hash references a row that doesn't exist");
+	}
+	if (head.shortcutValues.rows!=head.shortcutKeys.rows)
+		fail("shortcut values don't match keys");
+}
+
+
+void BinaryTrigramModel::attach(TrigramTables& tables) const
+{
+	const Header& head = header();
+	const char* data = file.data();
+	head.words.attach(data, tables.words);
+	head.romans.attach(data, tables.romans);
+	head.wordHash.attach(data, tables.wordHash);
+	tables.trie.attach(reinterpret_cast<const unsigned int*>(data+head.trie.offsetsPos), reinterpret_cast<const unsigned int*>(data+head.trie.valuesPos), head.trie.rows);
+	head.nodeWords.attach(data, tables.nodeWords);
+	head.ngramHash.attach(data, tables.ngramHash);
+	head.ngramValues.attach(data, tables.ngramValues);
+	head.shortcutKeys.attach(data, tables.shortcutKeys);
+	head.shortcutValues.attach(data, tables.shortcutValues);
+	head.lastChance.attach(data, tables.lastChance);
+}
+
+
+void BinaryTrigramModel::Write(const string& path, const TrigramTables& tables)
+{
+	//Build the whole file in memory; models are only a few hundred kB.
+	Header head;
+	memset(&head, 0, sizeof(head));
+	vector<char> out(sizeof(Header), 0);
+	head.words.write(out, tables.words);
+	head.romans.write(out, tables.romans);
+	head.wordHash.write(out, tables.wordHash);
+	head.trie.write(out, tables.trie.getEdges());
+	head.nodeWords.write(out, tables.nodeWords);
+	head.ngramHash.write(out, tables.ngramHash);
+	head.ngramValues.write(out, tables.ngramValues);
+	head.shortcutKeys.write(out, tables.shortcutKeys);
+	head.shortcutValues.write(out, tables.shortcutValues);
+	head.lastChance.write(out, tables.lastChance);
+
+	//Fill in the header
+	head.magic = Magic;
+	head.version = Version;
+	head.byteOrder = ByteOrderMark;
+	head.charSize = sizeof(wchar_t);
+	head.fileSize = out.size();
+	head.checksum = MappedFile::Checksum(&out[sizeof(Header)], out.size()-sizeof(Header));
+	memcpy(&out[0], &head, sizeof(Header));
+
+	//Save it
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL)
+		throw std::runtime_error(string("Can't write binary trigram model: ") + path);
+	size_t written = fwrite(&out[0], 1, out.size(), file);
+	fclose(file);
+	if (written != out.size())
+		throw std::runtime_error(string("Error writing binary trigram model: ") + path);
+}
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
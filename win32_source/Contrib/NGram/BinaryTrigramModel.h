@@ -0,0 +1,134 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "NGram/FlatTable.h"
+#include "NGram/NexusTrie.h"
+#include "NGram/MappedFile.h"
+
+namespace waitzar
+{
+
+
+/**
+ * Everything a TrigramLookup knows, as flat tables. These are either built from the JSON
+ *   model, or attached directly to a BinaryTrigramModel.
+ * Words are interned with an open-addressing hash table (linear probing) of word IDs, keyed
+ *   on the word's letters (see HashWord). Only the first of any duplicate words is in it.
+ * Keys of the "shortcut" tables are joined with KeySeparator, and sorted (as wchar_t strings)
+ *   so that they can be binary-searched in place.
+ * N-grams are keyed by integers: the trie node of the romanization, and the IDs of up to three
+ *   previous words (NoWord if unused). These live in an open-addressing hash table with linear
+ *   probing; each slot is NgramSlotSize values: {node, ultimate, penultimate, antepenultimate, row},
+ *   where "row" is the matching row of ngramValues. Empty slots have node==NoWord.
+ */
+struct TrigramTables {
+	static const wchar_t KeySeparator = L'\x1F';
+	static const unsigned int NoWord = 0xFFFFFFFF;
+	static const unsigned int NgramSlotSize = 5;
+
+	FlatTable<wchar_t> words;            //One row per word ID
+	FlatTable<char> romans;              //The romanization we report for each word (empty for duplicates)
+	FlatTable<unsigned int> wordHash;    //A single row: the hash table's slots (NoWord if empty). The number of slots is a power of two.
+	NexusTrie trie;                      //Node 0 is the root
+	FlatTable<unsigned int> nodeWords;   //Word IDs matched at each trie node
+	FlatTable<unsigned int> ngramHash;   //A single row: the hash table's slots. The number of slots is a power of two.
+	FlatTable<unsigned int> ngramValues; //Word IDs, in order of preference
+	FlatTable<wchar_t> shortcutKeys;     //base + sep + toStack
+	FlatTable<wchar_t> shortcutValues;   //The stacked result
+	FlatTable<char> lastChance;          //Escaped recovery patterns, like "a?g=aung"
+
+	//FNV-1a over a word's letters
+	static unsigned int HashWord(const wchar_t* begin, const wchar_t* end) {
+		unsigned int res = 2166136261U;
+		for (const wchar_t* letter=begin; letter!=end; letter++)
+			res = (res^(unsigned int)*letter) * 16777619U;
+		return res;
+	}
+};
+
+
+/**
+ * The compiled ("binary") form of a TrigramLookup model. This contains the same data as the
+ *   JSON model, but laid out as flat offset tables so that it can be memory-mapped read-only
+ *   and used in place; loading it costs the same no matter how large the model is.
+ * Layout (native byte order and wchar_t size; sections are 4-byte aligned):
+ *   [Header]
+ *   [offsets : rows+1] [values] for each section, in the order they appear in the Header.
+ * The checksum is an Adler-32 of everything following the header.
+ * Compile new binary models with "ModelCompiler --trigram"; see that directory for details.
+ */
+class BinaryTrigramModel {
+public:
+	//Constants
+	static const unsigned int Magic = 0x4D545A57; //"WZTM"
+	static const unsigned int Version = 2; //v2: n-grams are keyed by trie node and word IDs
+	static const unsigned int ByteOrderMark = 0x01020304;
+
+	struct Header {
+		unsigned int magic;
+		unsigned int version;
+		unsigned int byteOrder;
+		unsigned int checksum;
+		unsigned int charSize;  //sizeof(wchar_t) on the machine that compiled it
+		unsigned int fileSize;
+		FileSection words;
+		FileSection romans;
+		FileSection wordHash;
+		FileSection trie;
+		FileSection nodeWords;
+		FileSection ngramHash;
+		FileSection ngramValues;
+		FileSection shortcutKeys;
+		FileSection shortcutValues;
+		FileSection lastChance;
+	};
+
+	//Map a binary model file from disk. Throws on any error.
+	explicit BinaryTrigramModel(const std::string& path, bool verifyChecksum=true);
+
+	//Use a buffer that's already in memory. The buffer must outlive this object.
+	BinaryTrigramModel(const char* data, size_t size, bool verifyChecksum=true);
+
+	//Attach our data to a set of tables. These will reference the mapped memory directly.
+	void attach(TrigramTables& tables) const;
+
+	//Helpers
+	static bool IsBinaryModel(const char* data, size_t size);
+
+	//Save a model in our binary format
+	static void Write(const std::string& path, const TrigramTables& tables);
+
+private:
+	MappedFile file;
+
+	void validate(bool verifyChecksum) const;
+	const Header& header() const { return *reinterpret_cast<const Header*>(file.data()); }
+};
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
@@ -6,6 +6,8 @@
 
 #include "BurglishBuilder.h"
 
+#include <algorithm>
+
 
 //Import needed stl
 using std::string;
@@ -31,6 +33,15 @@ BurglishBuilder::~BurglishBuilder() {}
 map<wstring, wstring> BurglishBuilder::onsetPairs;
 map<wstring, wstring> BurglishBuilder::rhymePairs;
 map<wstring, wstring> BurglishBuilder::specialWords;
+NexusTrie BurglishBuilder::standardTrie;
+FlatTable<wchar_t> BurglishBuilder::standardWords;
+FlatTable<unsigned int> BurglishBuilder::standardNodeWords;
+FlatTable<unsigned int> BurglishBuilder::stackedNodeWords;
+std::unordered_map<wstring, unsigned int> BurglishBuilder::standardWordIDs;
+vector<string> BurglishBuilder::standardWordRomans;
+std::unordered_map<wstring, string> BurglishBuilder::specialIndex;
+std::unordered_map<wstring, pair<string, bool> > BurglishBuilder::onsetIndex;
+std::unordered_map<wstring, pair<string, bool> > BurglishBuilder::rhymeIndex;
 vector<wstring> BurglishBuilder::savedDigitIDs;
 void BurglishBuilder::InitStatic()
 {
@@ -70,6 +81,10 @@ void BurglishBuilder::InitStatic()
 		}
 	}
 
+	//Expand them, and index them for reverse lookup
+	BuildStandardWords();
+	BuildReverseIndex();
+
 	//onsetPairs = onsetRoot.get_value<json_spirit::wmObject>();
 	//rhymePairs = rhymeRoot.get_value<json_spirit::wmObject>();
 	//specialWords = specialRoot.get_value<json_spirit::wmObject>();
@@ -196,112 +211,263 @@ std::wstring BurglishBuilder::PatSintCombine(const std::wstring& base, const std
 
 
 
-void BurglishBuilder::addStandardWords(wstring roman, std::set<std::wstring>& resultsKeyset, std::vector< std::pair<std::wstring, int> >& resultSet, bool firstLetterUppercase, const std::wstring& prevWord, std::vector<std::wstring>& combinationSaveLocation)
+void BurglishBuilder::StackOnset(wstring& onset)
 {
-	//Nothing to do?
-	if (roman.empty())
-		return;
-
-	//Step 1: Duplicate vowels at the beginning of the word
-	if (IsVowel(roman[0]))
-		roman = wstring(1, roman[0]) + roman;
-
-	//Step 2: Find the longest matching prefix.
-	wstring prefix;
-	wstring suffix;
-	for (size_t i=1; i<=roman.size(); i++) {
-		//Done?
-		wstring candPrefix = roman.substr(0, i);
-		if (onsetPairs.count(candPrefix)==0)
-			break;
-
-		//Update (suffix is "a" if prefix takes up the whole string)
-		prefix = candPrefix;
-		suffix = (i==roman.size() ? L"a" : roman.substr(i, roman.size()-i));
+	//Stacking only occurs with single-letter onsets (exception: the ya medials)
+	wchar_t c = onset[0];
+	if (onset.length()==1 || (onset.length()==2 && c!=L'\u1004' && (onset[1]==L'\u103B' || onset[1]==L'\u103C'))) {
+		if (  (c>=L'\u1000' && c<=L'\u1008')
+			||(c==L'\u100B' || c==L'\u100C' || c==L'\u100D' || c==L'\u101C' || c==L'\u101E')
+			||(c>=L'\u100F' && c<=L'\u1019'))
+		{
+			//Stack it
+			if (c==L'\u1004')
+				onset = L"\u1004\u103A\u1039";
+			else
+				onset = L'\u1039' + onset;
+		}
 	}
+}
 
-	//Step 3: Null pair? If not, pull their values
-	if (onsetPairs.count(prefix)==0 || rhymePairs.count(suffix)==0)
-		return;
-	wstring prefixStr = onsetPairs[prefix];
-	wstring suffixStr = rhymePairs[suffix];
-
-	//Step 4: For each prefix, for each suffix, get the combined word.
-	// Prefixes & suffixes are just strings separated by pipe marks: ".....|.....|...."
-	// Suffixes, in addition, have a "-" to show where the inserted prefix should go.
-	wstringstream onset;
-	for (size_t onsID=0; onsID<prefixStr.size(); onsID++) {
-		//Append?
-		if (prefixStr[onsID]!=L'|' && prefixStr[onsID]!=L'+')
-			onset <<prefixStr[onsID];
-		//Skip?
-		if (prefixStr[onsID]!=L'|' && onsID<prefixStr.size()-1)
-			continue;
 
-		//Never do anything if the onset is empty
-		if (onset.str().empty())
+//Split a list of onsets or rhymes: ".....|.....|....", ignoring "+" (preference) marks and empty entries.
+vector<wstring> BurglishBuilder::SplitEntries(const wstring& entries)
+{
+	vector<wstring> res;
+	wstring entry;
+	for (size_t i=0; i<entries.size(); i++) {
+		if (entries[i]!=L'|' && entries[i]!=L'+')
+			entry += entries[i];
+		if (entries[i]!=L'|' && i<entries.size()-1)
 			continue;
+		if (!entry.empty())
+			res.push_back(entry);
+		entry.clear();
+	}
+	return res;
+}
 
-		//Replace the current prefix with a pat-sint equivalent if the first letter is capital
-		if (firstLetterUppercase) {
-			//Stacking only occurs with single-letter onsets (exception: the ya medials)
-			wstring oldPrefix = onset.str();
-			wchar_t c = oldPrefix[0];
-			if (oldPrefix.length()==1 || (oldPrefix.length()==2 && c!=L'\u1004' && (oldPrefix[1]==L'\u103B' || oldPrefix[1]==L'\u103C'))) {
-
-				if (  (c>=L'\u1000' && c<=L'\u1008')
-					||(c==L'\u100B' || c==L'\u100C' || c==L'\u100D' || c==L'\u101C' || c==L'\u101E')
-					||(c>=L'\u100F' && c<=L'\u1019'))
-				{
-					//Stack it
-					onset.str(L"");
-					if (c==L'\u1004')
-						onset <<L"\u1004\u103A\u1039";
-					else
-						onset <<L'\u1039' <<oldPrefix;
+
+//Expand every onset/rhyme combination once, so that typing only has to walk the trie.
+void BurglishBuilder::BuildStandardWords()
+{
+	standardTrie = NexusTrie();
+	standardWords.clear();
+	standardNodeWords.clear();
+	stackedNodeWords.clear();
+	standardWordIDs.clear();
+	standardWordRomans.clear();
+
+	//Split each rhyme into its alternatives. Suffixes have a "-" to show where the onset should go.
+	vector<wstring> rhymeKeys;
+	vector<bool> rhymePrefs;
+	vector< vector<unsigned int> > rhymeAlts;
+	vector<wstring> rhymeAltStrs;
+	for (auto rhy=rhymePairs.begin(); rhy!=rhymePairs.end(); rhy++) {
+		vector<wstring> alts = SplitEntries(rhy->second);
+		rhymeKeys.push_back(rhy->first);
+		rhymePrefs.push_back(!rhy->second.empty() && rhy->second[rhy->second.size()-1]==L'+');
+		rhymeAlts.push_back(vector<unsigned int>());
+		for (auto alt=alts.begin(); alt!=alts.end(); alt++) {
+			rhymeAlts.back().push_back(rhymeAltStrs.size());
+			rhymeAltStrs.push_back(*alt);
+		}
+	}
+
+	//Split each onset into its alternatives, and their pat-sint (stacked) equivalents.
+	//Onsets are shared between many keys, so we number them.
+	vector< vector<unsigned int> > onsetAlts[2];
+	vector<wstring> onsetAltStrs;
+	map<wstring, unsigned int> onsetAltIDs;
+	for (auto ons=onsetPairs.begin(); ons!=onsetPairs.end(); ons++) {
+		vector<wstring> alts = SplitEntries(ons->second);
+		for (size_t i=0; i<2; i++) {
+			onsetAlts[i].push_back(vector<unsigned int>());
+			for (auto alt=alts.begin(); alt!=alts.end(); alt++) {
+				wstring onset = *alt;
+				if (i==1)
+					StackOnset(onset);
+				auto it = onsetAltIDs.find(onset);
+				if (it==onsetAltIDs.end()) {
+					it = onsetAltIDs.insert(pair<wstring, unsigned int>(onset, onsetAltStrs.size())).first;
+					onsetAltStrs.push_back(onset);
 				}
+				onsetAlts[i].back().push_back(it->second);
 			}
 		}
+	}
+
+	//Each onset+rhyme word is built (and normalized) the first time we need it.
+	const int Unknown = -2;
+	const int Invalid = -1;
+	vector<int> comboWords(onsetAltStrs.size()*rhymeAltStrs.size(), Unknown);
+	wstring combined;
+
+	//We also save the best romanisation of each word, for reverse lookup. Preference goes: preferred onset
+	//  and rhyme, preferred onset, preferred rhyme, neither; then the roman string that lists this word
+	//  first; then the longest (most explicit) roman string, since the shortest are usually abbreviations.
+	vector<unsigned int> romanRanks;
+
+	//Any roman string with standard words is an onset followed by a rhyme (or just an onset, which
+	//  uses the rhyme "a"). We only keep strings where this onset is the longest one that matches
+	//  (the one addStandardWords always found), and which can actually be typed (a leading vowel
+	//  is typed once, but looked up twice).
+	vector< vector<unsigned int> > links(1);
+	vector< vector<unsigned int> > matched[2];
+	matched[0].resize(1);
+	matched[1].resize(1);
+	size_t onsetID = 0;
+	for (auto ons=onsetPairs.begin(); ons!=onsetPairs.end(); ons++,onsetID++) {
+		for (size_t rhymeID=0; rhymeID<=rhymeKeys.size(); rhymeID++) {
+			//The empty rhyme comes last
+			wstring roman = ons->first;
+			wstring rhymeKey = L"a";
+			if (rhymeID<rhymeKeys.size()) {
+				roman += rhymeKeys[rhymeID];
+				rhymeKey = rhymeKeys[rhymeID];
+			}
 
+			//Would a longer onset match?
+			size_t onsetLen = 0;
+			while (onsetLen<roman.size() && onsetPairs.count(roman.substr(0, onsetLen+1))>0)
+				onsetLen++;
+			if (onsetLen!=ons->first.size())
+				continue;
+
+			//Undo the duplicated vowel
+			if (IsVowel(roman[0])) {
+				if (roman.size()<2 || roman[1]!=roman[0])
+					continue;
+				roman = roman.substr(1);
+			}
 
-		//Ok, we have our onset.
-		wstringstream rhyme;
-		for (size_t rhymeID=0; rhymeID<suffixStr.size(); rhymeID++) {
-			//Append?
-			if (suffixStr[rhymeID]==L'-')
-				rhyme <<onset.str(); //Insert our onset
-			else if (suffixStr[rhymeID]!=L'|' && suffixStr[rhymeID]!=L'+')
-				rhyme <<suffixStr[rhymeID];
-			//Skip?
-			if (suffixStr[rhymeID]!=L'|' && rhymeID<suffixStr.size()-1)
+			//The trie only holds 8-bit letters
+			bool narrow = true;
+			for (size_t i=0; i<roman.size(); i++)
+				narrow = narrow && roman[i]<=0xFF;
+			if (!narrow)
 				continue;
 
-			//Again, skip empty strings
-			if (rhyme.str().empty())
+			//Is there a rhyme?
+			size_t rhymeRow = std::lower_bound(rhymeKeys.begin(), rhymeKeys.end(), rhymeKey) - rhymeKeys.begin();
+			if (rhymeRow==rhymeKeys.size() || rhymeKeys[rhymeRow]!=rhymeKey)
 				continue;
 
-			//We've built our onset + rhyme into rhyme directly.
-			//Now, we just need to test for errors, etc.
-			wstring word = waitzar::normalize_bgunicode(rhyme.str());
-			if (IsValid(word) && resultsKeyset.count(word)==0 && !word.empty()) {
-				//If this is a pat-sint word, we have to add an entry to the combination array
-				int combID = -1;
-				if (firstLetterUppercase) {
-					wstring newCombine = PatSintCombine(prevWord, word);
-					if (!newCombine.empty()) {
-						combID = combinationSaveLocation.size();
-						combinationSaveLocation.push_back(newCombine);
+			//For each onset, for each rhyme, get the combined word (and skip duplicates).
+			vector<unsigned int> words[2];
+			for (size_t i=0; i<2; i++) {
+				const vector<unsigned int>& onsets = onsetAlts[i][onsetID];
+				const vector<unsigned int>& rhymes = rhymeAlts[rhymeRow];
+				for (auto onsAlt=onsets.begin(); onsAlt!=onsets.end(); onsAlt++) {
+					for (auto rhyAlt=rhymes.begin(); rhyAlt!=rhymes.end(); rhyAlt++) {
+						int& wordID = comboWords[(*onsAlt)*rhymeAltStrs.size() + *rhyAlt];
+						if (wordID==Unknown) {
+							//Insert our onset, then test for errors, etc.
+							const wstring& rhyme = rhymeAltStrs[*rhyAlt];
+							combined.clear();
+							for (size_t j=0; j<rhyme.size(); j++) {
+								if (rhyme[j]==L'-')
+									combined += onsetAltStrs[*onsAlt];
+								else
+									combined += rhyme[j];
+							}
+							wstring word = waitzar::normalize_bgunicode(combined);
+							wordID = Invalid;
+							if (IsValid(word) && !word.empty()) {
+								auto it = standardWordIDs.find(word);
+								if (it==standardWordIDs.end()) {
+									it = standardWordIDs.insert(pair<wstring, unsigned int>(word, standardWords.size())).first;
+									standardWords.pushRow(word.c_str(), word.size());
+									standardWordRomans.push_back("");
+									romanRanks.push_back(0xFFFFFFFF);
+								}
+								wordID = it->second;
+							}
+						}
+						if (wordID!=Invalid && std::find(words[i].begin(), words[i].end(), (unsigned int)wordID)==words[i].end())
+							words[i].push_back(wordID);
 					}
 				}
-				resultSet.push_back(pair<wstring, int>(word, combID)); //This is the only place we can add pat-sint words
-				resultsKeyset.insert(word);
 			}
+			if (words[0].empty() && words[1].empty())
+				continue;
+
+			//Can we romanise these words any better?
+			bool onsetPref = !ons->second.empty() && ons->second[ons->second.size()-1]==L'+';
+			unsigned int rank = (onsetPref?0:2) + (rhymePrefs[rhymeRow]?0:1);
+			for (auto id=words[0].begin(); id!=words[0].end(); id++) {
+				unsigned int wordRank = (rank<<16) + (std::min<size_t>(id-words[0].begin(), 0xFF)<<8) + (0xFF-std::min<size_t>(roman.size(), 0xFF));
+				if (wordRank<romanRanks[*id]) {
+					romanRanks[*id] = wordRank;
+					standardWordRomans[*id] = waitzar::escape_wstr(roman, false);
+				}
+			}
+
+			//Walk (or extend) the trie
+			unsigned int node = 0;
+			for (size_t i=0; i<roman.size(); i++) {
+				char letter = (char)roman[i];
+				int next = -1;
+				for (size_t j=0; j<links[node].size() && next==-1; j++) {
+					if (NexusTrie::Letter(links[node][j])==letter)
+						next = NexusTrie::Target(links[node][j]);
+				}
+				if (next==-1) {
+					next = links.size();
+					links[node].push_back(NexusTrie::Pack(next, letter));
+					links.push_back(vector<unsigned int>());
+					matched[0].push_back(vector<unsigned int>());
+					matched[1].push_back(vector<unsigned int>());
+				}
+				node = next;
+			}
+			matched[0][node] = words[0];
+			matched[1][node] = words[1];
+		}
+	}
+
+	//Save the trie
+	standardTrie.reserve(links.size());
+	for (size_t i=0; i<links.size(); i++) {
+		standardTrie.pushNode(links[i]);
+		standardNodeWords.pushRow(matched[0][i]);
+		stackedNodeWords.pushRow(matched[1][i]);
+	}
+}
+
+
+void BurglishBuilder::addStandardWords(const wstring& roman, std::set<std::wstring>& resultsKeyset, std::vector< std::pair<std::wstring, int> >& resultSet, bool firstLetterUppercase, const std::wstring& prevWord, std::vector<std::wstring>& combinationSaveLocation)
+{
+	//Find this roman string's node
+	unsigned int node = 0;
+	for (size_t i=0; i<roman.size(); i++) {
+		if (roman[i]>0xFF) //The trie only holds 8-bit letters
+			return;
+		int next = standardTrie.jump(node, (char)roman[i]);
+		if (next==-1)
+			return;
+		node = next;
+	}
+
+	//Add its words
+	FlatRow<unsigned int> wordIDs = firstLetterUppercase ? stackedNodeWords[node] : standardNodeWords[node];
+	for (const unsigned int* id=wordIDs.begin(); id!=wordIDs.end(); id++) {
+		FlatRow<wchar_t> letters = standardWords[*id];
+		wstring word(letters.begin(), letters.end());
+		if (resultsKeyset.count(word)>0)
+			continue;
 
-			//Finally: reset
-			rhyme.str(L"");
+		//If this is a pat-sint word, we have to add an entry to the combination array
+		int combID = -1;
+		if (firstLetterUppercase) {
+			wstring newCombine = PatSintCombine(prevWord, word);
+			if (!newCombine.empty()) {
+				combID = combinationSaveLocation.size();
+				combinationSaveLocation.push_back(newCombine);
+			}
 		}
-		//Finally: reset
-		onset.str(L"");
+		resultSet.push_back(pair<wstring, int>(word, combID)); //This is the only place we can add pat-sint words
+		resultsKeyset.insert(word);
 	}
 }
 
@@ -479,6 +645,8 @@ void BurglishBuilder::reGenerateWordlist(const std::wstring& prevWord)
 		//Expand the set of words with common substitutions
 		expandCurrentWords(resultLookup, generatedWords);
 	}
+
+	updateWordIDs();
 }
 
 
@@ -498,6 +666,8 @@ void BurglishBuilder::reset(bool fullReset)
 		savedWordIDs.clear();
 		savedCombinationIDs.clear();
 	}
+
+	updateWordIDs();
 }
 
 
@@ -547,22 +717,28 @@ std::wstring BurglishBuilder::getParenString() const
 //IDs are numbered starting after those in savedWordIDs() and savedDigitIDs()
 //Note that a word in savedWordIDs and generatedWords might have 1..N
 //   possible IDs. This isn't really a problem, as the words only build up as sentences are typed.
-std::vector<unsigned int> BurglishBuilder::getPossibleWords() const
+const std::vector<unsigned int>& BurglishBuilder::getPossibleWords() const
 {
-	//TEMP: For now, the word's ID is just its index. (We might need to hack around this for 0..9)
-	//NOTE: This might be a problem. Isn't res.size() < generatedWords.size() for PS words?
-	vector<unsigned int> res;
-	while (res.size()<generatedWords.size())
-		res.push_back(savedDigitIDs.size() + savedWordIDs.size() + savedCombinationIDs.size() + res.size());
-	return res;
+	return possibleWords;
+}
+
+const std::vector<int>& BurglishBuilder::getWordCombinations() const
+{
+	return wordCombinations;
 }
 
-std::vector<int> BurglishBuilder::getWordCombinations() const
+//Called whenever generatedWords (or one of the "saved" arrays) changes.
+void BurglishBuilder::updateWordIDs()
 {
-	vector<int> res;
+	//TEMP: For now, the word's ID is just its index. (We might need to hack around this for 0..9)
+	//NOTE: This might be a problem. Isn't possibleWords.size() < generatedWords.size() for PS words?
+	possibleWords.clear();
+	while (possibleWords.size()<generatedWords.size())
+		possibleWords.push_back(savedDigitIDs.size() + savedWordIDs.size() + savedCombinationIDs.size() + possibleWords.size());
+
+	wordCombinations.clear();
 	for (vector< pair<wstring, int> >::const_iterator it=generatedWords.begin(); it!=generatedWords.end(); it++)
-		res.push_back((it->second==-1) ? -1 : (savedDigitIDs.size() + savedWordIDs.size()) + it->second);
-	return res;
+		wordCombinations.push_back((it->second==-1) ? -1 : (savedDigitIDs.size() + savedWordIDs.size()) + it->second);
 }
 
 
@@ -591,6 +767,51 @@ std::wstring BurglishBuilder::getWordString(unsigned int id) const
 
 
 
+//Index every onset, rhyme and special word by its Myanmar spelling, so that reverse lookups
+//  don't have to scan our maps. Where several roman keys share a spelling, we keep the one the
+//  scan would have found: the first "preferred" key (whose value ends in "+"), otherwise the first key.
+void BurglishBuilder::BuildReverseIndex()
+{
+	specialIndex.clear();
+	onsetIndex.clear();
+	rhymeIndex.clear();
+
+	//Special words are split on "|" only. Entries starting with "-" have every "-" removed.
+	for (auto it=specialWords.begin(); it!=specialWords.end(); it++) {
+		string roman = waitzar::escape_wstr(it->first, false);
+		vector<wstring> entries = waitzar::separate(it->second, L'|');
+		for (auto entry=entries.begin(); entry!=entries.end(); entry++) {
+			wstring matcher = *entry;
+			if (!matcher.empty() && matcher[0]==L'-') {
+				wstring stripped;
+				for (size_t x=0; x<matcher.length(); x++) {
+					if (matcher[x]!=L'-')
+						stripped += matcher[x];
+				}
+				matcher = stripped;
+			}
+			specialIndex.insert(pair<wstring, string>(matcher, roman)); //Never replaces an earlier key
+		}
+	}
+
+	//Onsets and rhymes
+	for (size_t i=0; i<2; i++) {
+		const map<wstring, wstring>& pairs = (i==0) ? onsetPairs : rhymePairs;
+		std::unordered_map<wstring, pair<string, bool> >& index = (i==0) ? onsetIndex : rhymeIndex;
+		for (auto it=pairs.begin(); it!=pairs.end(); it++) {
+			bool isPref = !it->second.empty() && it->second[it->second.size()-1]==L'+';
+			vector<wstring> entries = SplitEntries(it->second);
+			for (auto entry=entries.begin(); entry!=entries.end(); entry++) {
+				auto res = index.insert(pair<wstring, pair<string, bool> >(*entry, pair<string, bool>(waitzar::escape_wstr(it->first, false), isPref)));
+				if (!res.second && isPref && !res.first->second.second)
+					res.first->second = pair<string, bool>(waitzar::escape_wstr(it->first, false), true);
+			}
+		}
+	}
+}
+
+
+
 //Turns the current myanmar word into a list of all possible spellings.
 //The original word is the first item in the list.
 //Does not check for validity.
@@ -674,148 +895,32 @@ vector<wstring> BurglishBuilder::reverseExpandWords(const wstring& myanmar)
 //Match the given myanmar word to its romanisation. Returns "" if no match can be made
 string BurglishBuilder::matchSpecialWord(const wstring& myanmar)
 {
-	for (auto pair=specialWords.begin(); pair!=specialWords.end(); pair++) {
-		wstring roman = pair->first;
-
-		//Have to generate the myanmar words individually
-		wstring specialStrs = pair->second;
-		wstringstream entry;
-		for (size_t specID=0; specID<specialStrs.size(); specID++) {
-			//Append?
-			if (specialStrs[specID]!=L'|')
-				entry <<specialStrs[specID];
-			//Skip?
-			if (specialStrs[specID]!=L'|' && specID<specialStrs.size()-1)
-				continue;
-
-			//Boundary reached; check
-			wstring matcher = entry.str();
-			if (matcher.length()>0 && matcher[0]==L'-') {
-				entry.str(L"");
-				for (size_t x=0; x<matcher.length(); x++) {
-					if (matcher[x]!=L'-')
-						entry <<matcher[x];
-				}
-				matcher = entry.str();
-			}
-			if (myanmar == matcher)
-				return waitzar::escape_wstr(roman, false);
-
-			//Finally: reset
-			entry.str(L"");
-		}
-	}
-
-	//No matches
-	return "";
+	auto it = specialIndex.find(myanmar);
+	return it==specialIndex.end() ? "" : it->second;
 }
 
 
 
-//TODO: Since we cache onset extensions, why not cache all possible onsets as well?
-//      This will greatly speed up this function.
 bool BurglishBuilder::matchOnsetFirstLetter(wchar_t letter)
 {
-	return BURGLISH_ONSET_CONSONANTS.find(wstring(1, letter))!=wstring::npos;
-
-	//TEMP
-/*	wstringstream temp;
-	set<wchar_t> tempSet;
-
-	//Iterate through each pair.
-	for (json_spirit::wmObject::iterator it=onsetPairs.begin(); it!=onsetPairs.end(); it++) {
-		const wstring& myanmar = it->second.get_value<wstring>();
-		for (size_t i=0; i<myanmar.size(); i++) {
-			//Does it match?
-			//if (myanmar[i] == letter)
-			//	return true;
-			if (tempSet.find(myanmar[i])==tempSet.end()) {
-				tempSet.insert(myanmar[i]);
-				temp <<myanmar[i];
-			}
-
-			//Else, fast-forward to the next pipe character, "|"
-			while (i<myanmar.size() && myanmar[i]!=L'|')
-				i++;
-		}
-	}
-
-	wstring temp2 = temp.str();
-
-	//No matches
-	return false;*/
+	return BURGLISH_ONSET_CONSONANTS.find(letter)!=wstring::npos;
 }
 
 
 
+//Returns the onset's romanisation, and whether it is "preferred". Returns "" if no match can be made
 pair<string, bool> BurglishBuilder::matchOnset(const wstring& myanmar)
 {
-	//Iterate through each pair.
-	string unprefRes;
-	for (auto it=onsetPairs.begin(); it!=onsetPairs.end(); it++) {
-		wstring roman = it->first;
-		const wstring& myStrs = it->second;
-		wstringstream entry;
-		bool isPref = myStrs.size()>0 && myStrs[myStrs.size()-1] == L'+';
-		for (size_t itemID=0; itemID<myStrs.size(); itemID++) {
-			//Append?
-			if (myStrs[itemID]!=L'|' && myStrs[itemID]!=L'+')
-				entry <<myStrs[itemID];
-			//Skip?
-			if (myStrs[itemID]!=L'|' && itemID<myStrs.size()-1)
-				continue;
-
-			//Boundary reached; check
-			if (myanmar == entry.str() && !entry.str().empty()) {
-				if (isPref)
-					return pair<string, bool>(waitzar::escape_wstr(roman, false), true);
-				else if (unprefRes.empty())
-					unprefRes = waitzar::escape_wstr(roman, false);
-			}
-
-
-			//Finally: reset
-			entry.str(L"");
-		}
-	}
-
-	//No matches, or an "unpreferred" match
-	return pair<string, bool>(unprefRes, false);
+	auto it = onsetIndex.find(myanmar);
+	return it==onsetIndex.end() ? pair<string, bool>("", false) : it->second;
 }
 
 
+//As above, for rhymes. Rhymes contain a "-" where the onset goes.
 pair<string, bool> BurglishBuilder::matchRhyme(const wstring& myanmar)
 {
-	//Iterate through each pair.
-	string unprefRes;
-	for (auto it=rhymePairs.begin(); it!=rhymePairs.end(); it++) {
-		wstring roman = it->first;
-		const wstring& myStrs = it->second;
-		wstringstream entry;
-		bool isPref = myStrs.size()>0 && myStrs[myStrs.size()-1] == L'+';
-		for (size_t itemID=0; itemID<myStrs.size(); itemID++) {
-			//Append?
-			if (myStrs[itemID]!=L'|' && myStrs[itemID]!=L'+')
-				entry <<myStrs[itemID];
-			//Skip?
-			if (myStrs[itemID]!=L'|' && itemID<myStrs.size()-1)
-				continue;
-
-			//Boundary reached; check
-			if (myanmar == entry.str() && !entry.str().empty()) {
-				if (isPref)
-					return pair<string, bool>(waitzar::escape_wstr(roman, false), true);
-				else if (unprefRes.empty())
-					unprefRes = waitzar::escape_wstr(roman, false);
-			}
-
-			//Finally: reset
-			entry.str(L"");
-		}
-	}
-
-	//No matches, or an "unpreferred" result
-	return pair<string, bool>(unprefRes, false);
+	auto it = rhymeIndex.find(myanmar);
+	return it==rhymeIndex.end() ? pair<string, bool>("", false) : it->second;
 }
 
 
@@ -914,7 +1019,7 @@ pair<int, string> BurglishBuilder::reverseLookupWord(std::wstring word)
 					//Are we done?
 					if (myID!=onsetIndex) {
 						//Only allow a few medials/vowels after the consonant.
-						if (BURGLISH_ONSET_EXTENSIONS.find(wstring(1,my[myID]))==wstring::npos)
+						if (BURGLISH_ONSET_EXTENSIONS.find(my[myID])==wstring::npos)
 							break;
 					}
 
@@ -965,6 +1070,14 @@ pair<int, string> BurglishBuilder::reverseLookupWord(std::wstring word)
 			for (size_t consID=0; consID<my2rom.size()&&roman.empty(); consID++) {
 				roman = my2rom[consID].second;
 			}
+
+			//Failing that, see if it's a word we'd generate. This catches medials and tall "ar", which the
+			//  onset/rhyme matching above doesn't.
+			for (size_t consID=0; consID<my2rom.size()&&roman.empty(); consID++) {
+				auto it = standardWordIDs.find(my2rom[consID].first);
+				if (it!=standardWordIDs.end())
+					roman = standardWordRomans[it->second];
+			}
 		}
 	}
 
@@ -978,6 +1091,72 @@ pair<int, string> BurglishBuilder::reverseLookupWord(std::wstring word)
 }
 
 
+//Does a new syllable start at this letter? Letters outside the Myanmar block always start a new "syllable".
+bool BurglishBuilder::IsSyllableStart(const wstring& text, size_t pos)
+{
+	wchar_t prev = pos>0 ? text[pos-1] : L'\0';
+	wchar_t next = pos+1<text.size() ? text[pos+1] : L'\0';
+	unsigned int letter = waitzar::GetMyanmarLetter(text[pos]).classes;
+	unsigned int prevLetter = waitzar::GetMyanmarLetter(prev).classes;
+	if ((letter&waitzar::MC_BLOCK)==0 || (prevLetter&waitzar::MC_BLOCK)==0)
+		return true;
+
+	//Numbers are read as one word; punctuation stands alone.
+	if ((letter&waitzar::MC_DIGIT)!=0)
+		return (prevLetter&waitzar::MC_DIGIT)==0;
+	if ((letter&waitzar::MC_SIGN)!=0)
+		return true;
+	if ((prevLetter&(waitzar::MC_DIGIT|waitzar::MC_SIGN))!=0)
+		return true;
+
+	//Otherwise, a syllable starts with a consonant (or independent vowel), unless that consonant
+	//  is stacked, or killed (which includes kinzi).
+	if ((letter&waitzar::MC_BASE)!=0)
+		return prev!=L'\u1039' && next!=L'\u103A' && next!=L'\u1039';
+	return false;
+}
+
+
+//Romanise a whole document, one syllable at a time. Romanised syllables are separated by spaces;
+//  anything else (including syllables we can't romanise) is copied through unchanged.
+//Returns UTF-8.
+string BurglishBuilder::reverseLookupText(const wstring& text)
+{
+	wstring res;
+	std::unordered_map<wstring, string> romanised; //Documents repeat most of their syllables
+	bool prevWasRoman = false;
+	for (size_t start=0; start<text.size();) {
+		//Find the end of this syllable
+		size_t end = start+1;
+		while (end<text.size() && !IsSyllableStart(text, end))
+			end++;
+		wstring syllable = text.substr(start, end-start);
+		start = end;
+
+		//Look it up
+		string roman;
+		if ((waitzar::GetMyanmarLetter(syllable[0]).classes&waitzar::MC_BLOCK)!=0) {
+			auto it = romanised.find(syllable);
+			if (it==romanised.end())
+				it = romanised.insert(pair<wstring, string>(syllable, reverseLookupWord(syllable).second)).first;
+			roman = it->second;
+		}
+
+		//Append it
+		if (roman.empty()) {
+			res += syllable;
+			prevWasRoman = false;
+		} else {
+			if (prevWasRoman)
+				res += L' ';
+			res += wstring(roman.begin(), roman.end());
+			prevWasRoman = true;
+		}
+	}
+	return waitzar::wcs2mbs(res);
+}
+
+
 //Just cut a letter off the string and update our list.
 bool BurglishBuilder::backspace(const std::wstring& prevWord)
 {
@@ -9,11 +9,14 @@
 
 #include <vector>
 #include <set>
+#include <unordered_map>
 #include <string>
 #include <sstream>
 #include <stdexcept>
 
 #include "NGram/LookupEngine.h"
+#include "NGram/FlatTable.h"
+#include "NGram/NexusTrie.h"
 #include "Input/burglish_data.h"
 #include "Json CPP/value.h"
 #include "Json CPP/reader.h"
@@ -43,10 +46,11 @@ public:
 	std::wstring getParenString() const;
 
 	//Requires hacking (mostly b/c WordBuilder assumes word IDs)
-	std::vector<unsigned int> getPossibleWords() const;
-	std::vector<int> getWordCombinations() const; //Tied to getPossibleWords
+	const std::vector<unsigned int>& getPossibleWords() const;
+	const std::vector<int>& getWordCombinations() const; //Tied to getPossibleWords
 	std::wstring getWordString(unsigned int id) const;
 	std::pair<int, std::string> reverseLookupWord(std::wstring word);
+	std::string reverseLookupText(const std::wstring& text);
 	unsigned short getSingleDigitID(unsigned short arabicNumeral);
 
 	//Requires copying of WordBuilder code. (Unfortunate, but unavoidable).
@@ -71,17 +75,24 @@ public:
 private:
 	static bool IsVowel(wchar_t letter);
 	static bool IsValid(const std::wstring& word);
-	static void addStandardWords(std::wstring roman, std::set<std::wstring>& resultsKeyset, std::vector< std::pair<std::wstring, int> >& resultSet, bool firstLetterUppercase, const std::wstring& prevWord, std::vector<std::wstring>& combinationSaveLocation);
+	static void addStandardWords(const std::wstring& roman, std::set<std::wstring>& resultsKeyset, std::vector< std::pair<std::wstring, int> >& resultSet, bool firstLetterUppercase, const std::wstring& prevWord, std::vector<std::wstring>& combinationSaveLocation);
 	static void addSpecialWords(std::wstring roman, std::set<std::wstring>& resultsKeyset, std::vector< std::pair<std::wstring, int> >& resultSet, std::wstringstream& parenStr);
 	static void addNumerals(std::wstring roman, std::set<std::wstring>& resultsKeyset, std::vector< std::pair<std::wstring, int> >& resultSet);
 	static void expandCurrentWords(std::set<std::wstring>& resultsKeyset, std::vector< std::pair<std::wstring, int> >& resultSet);
 
+	//Precomputing standard words
+	static void BuildStandardWords();
+	static std::vector<std::wstring> SplitEntries(const std::wstring& entries);
+	static void StackOnset(std::wstring& onset);
+
 	//Looking backwards
+	static void BuildReverseIndex();
 	static std::vector<std::wstring> reverseExpandWords(const std::wstring& myanmar);
 	static std::string matchSpecialWord(const std::wstring& myanmar);
 	static bool matchOnsetFirstLetter(wchar_t letter);
 	static std::pair<std::string, bool> matchOnset(const std::wstring& myanmar);
 	static std::pair<std::string, bool> matchRhyme(const std::wstring& myanmar);
+	static bool IsSyllableStart(const std::wstring& text, size_t pos);
 	
 
 	//Helper
@@ -100,6 +111,23 @@ private:
 	static std::map<std::wstring, std::wstring> rhymePairs;
 	static std::map<std::wstring, std::wstring> specialWords;
 
+	//Every standard word (onset+rhyme) that can be typed, precomputed from onsetPairs and rhymePairs.
+	//The trie is keyed on the roman letters as typed (node 0 is the root); each node lists the IDs
+	//  of the words its roman string generates, in the order Burglish lists them. Capitalised
+	//  (pat-sint) strings have their own list, since their onsets are stacked.
+	static NexusTrie standardTrie;
+	static FlatTable<wchar_t> standardWords;
+	static FlatTable<unsigned int> standardNodeWords;
+	static FlatTable<unsigned int> stackedNodeWords;
+	static std::unordered_map<std::wstring, unsigned int> standardWordIDs;
+	static std::vector<std::string> standardWordRomans; //The preferred roman string for each word ID ("" for stacked words)
+
+	//Reverse lookup: each Myanmar onset, rhyme and special word, and the roman key that it matches.
+	//Onsets and rhymes also say whether that key is "preferred".
+	static std::unordered_map<std::wstring, std::string> specialIndex;
+	static std::unordered_map<std::wstring, std::pair<std::string, bool> > onsetIndex;
+	static std::unordered_map<std::wstring, std::pair<std::string, bool> > rhymeIndex;
+
 	static std::wstring PatSintCombine(const std::wstring& base, const std::wstring& stacked);
 
 	//New candidate words are added like so:
@@ -115,6 +143,12 @@ private:
 	std::vector<std::wstring> savedWordIDs;
 	std::vector<std::wstring> savedCombinationIDs;
 	std::vector< std::pair<std::wstring, int> > generatedWords; //int refers to the id of its combination in savedCombinationIDs (or -1 if none)
+
+	//The IDs of generatedWords (and of their combinations), as reported by getPossibleWords() and getWordCombinations().
+	//   These depend on the sizes of the "saved" arrays too, so rebuild them whenever any of those change.
+	std::vector<unsigned int> possibleWords;
+	std::vector<int> wordCombinations;
+	void updateWordIDs();
 	
 	int currSelectedID;
 	int currSelectedPage;
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+namespace waitzar
+{
+
+
+/**
+ * A read-only view of one row of a FlatTable. Rows are plain [first, last) ranges,
+ *   so this is cheap to copy around. Any modification of the owning table may
+ *   invalidate it; re-fetch the row after calling append() or pushRow().
+ */
+template <class T>
+class FlatRow {
+public:
+	FlatRow() : first(NULL), last(NULL) {}
+	FlatRow(const T* first, const T* last) : first(first), last(last) {}
+
+	size_t size() const { return last-first; }
+	bool empty() const { return first==last; }
+	const T& operator[](size_t id) const { return first[id]; }
+	const T& back() const { return *(last-1); }
+	const T* begin() const { return first; }
+	const T* end() const { return last; }
+
+private:
+	const T* first;
+	const T* last;
+};
+
+
+/**
+ * A table of variable-length rows, stored as one contiguous array of values plus an
+ *   array of (rows+1) offsets into it (so row "i" is values[offsets[i]..offsets[i+1]]).
+ * The base rows can either be owned by the table or "attached" from an external
+ *   buffer (e.g., a memory-mapped binary model), in which case they are never copied.
+ * Rows added (or appended to) after the base was sealed are kept on the side, so the
+ *   attached memory is always treated as read-only.
+ * Note that T must be a POD type.
+ */
+template <class T>
+class FlatTable {
+public:
+	FlatTable() : extOffsets(NULL), extValues(NULL), baseRows(0) {
+		ownOffsets.push_back(0);
+	}
+
+	//Use a pre-built offset/value array in place. The memory must outlive this table.
+	void attach(const unsigned int* offsets, const T* values, size_t rows) {
+		clear();
+		extOffsets = offsets;
+		extValues = values;
+		baseRows = rows;
+	}
+
+	//Remove everything, including attached memory
+	void clear() {
+		extOffsets = NULL;
+		extValues = NULL;
+		baseRows = 0;
+		ownOffsets.assign(1, 0);
+		ownValues.clear();
+		extraRows.clear();
+		patchIndex.clear();
+		patchedRows.clear();
+	}
+
+	void reserve(size_t rows) {
+		if (extOffsets==NULL && extraRows.empty())
+			ownOffsets.reserve(rows+1);
+	}
+
+	size_t size() const {
+		return baseRows + extraRows.size();
+	}
+
+	bool isAttached() const {
+		return extOffsets!=NULL;
+	}
+
+	FlatRow<T> operator[](size_t id) const {
+		if (id < baseRows) {
+			if (id<patchIndex.size() && patchIndex[id]!=0)
+				return makeRow(patchedRows[patchIndex[id]-1]);
+			const unsigned int* offsets = extOffsets ? extOffsets : &ownOffsets[0];
+			const T* values = extOffsets ? extValues : (ownValues.empty() ? NULL : &ownValues[0]);
+			return FlatRow<T>(values+offsets[id], values+offsets[id+1]);
+		}
+		return makeRow(extraRows[id-baseRows]);
+	}
+
+	//Add a new row to the end of the table
+	void pushRow() {
+		pushRow(NULL, 0);
+	}
+	void pushRow(const std::vector<T>& vals) {
+		pushRow(vals.empty()?NULL:&vals[0], vals.size());
+	}
+	void pushRow(const T* vals, size_t count) {
+		if (canGrowBase()) {
+			ownValues.insert(ownValues.end(), vals, vals+count);
+			ownOffsets.push_back(ownValues.size());
+			baseRows++;
+		} else
+			extraRows.push_back(std::vector<T>(vals, vals+count));
+	}
+
+	//Add a value to the end of an existing row
+	void append(size_t id, const T& val) {
+		insert(id, (*this)[id].size(), val);
+	}
+
+	//Add a value to an existing row, before the value at index "pos"
+	void insert(size_t id, size_t pos, const T& val) {
+		if (id >= size())
+			throw std::runtime_error("FlatTable::insert() - row does not exist");
+		if (pos > (*this)[id].size())
+			throw std::runtime_error("FlatTable::insert() - position is out of bounds");
+
+		if (id >= baseRows) {
+			std::vector<T>& row = extraRows[id-baseRows];
+			row.insert(row.begin()+pos, val);
+		} else if (canGrowBase() && id+1==baseRows && (id>=patchIndex.size() || patchIndex[id]==0)) {
+			//Last owned row; we can just extend the value array.
+			ownValues.insert(ownValues.begin()+ownOffsets[id]+pos, val);
+			ownOffsets.back()++;
+		} else {
+			//Copy this row to the side, then modify the copy.
+			if (patchIndex.size() < baseRows)
+				patchIndex.resize(baseRows, 0);
+			if (patchIndex[id]==0) {
+				FlatRow<T> orig = (*this)[id];
+				patchedRows.push_back(std::vector<T>(orig.begin(), orig.end()));
+				patchIndex[id] = patchedRows.size();
+			}
+			std::vector<T>& row = patchedRows[patchIndex[id]-1];
+			row.insert(row.begin()+pos, val);
+		}
+	}
+
+	//Produce a single offset/value array pair for this table (for saving to disk).
+	void flatten(std::vector<unsigned int>& offsets, std::vector<T>& values) const {
+		offsets.clear();
+		values.clear();
+		offsets.reserve(size()+1);
+		offsets.push_back(0);
+		for (size_t i=0; i<size(); i++) {
+			FlatRow<T> row = (*this)[i];
+			values.insert(values.end(), row.begin(), row.end());
+			offsets.push_back(values.size());
+		}
+	}
+
+private:
+	//External (read-only) storage
+	const unsigned int* extOffsets;
+	const T* extValues;
+
+	//Owned storage
+	std::vector<unsigned int> ownOffsets;
+	std::vector<T> ownValues;
+	size_t baseRows;
+
+	//Rows added or modified after the base was sealed.
+	std::vector< std::vector<T> > extraRows;
+	std::vector<unsigned int> patchIndex; //1-based index into patchedRows; 0 means "not patched"
+	std::vector< std::vector<T> > patchedRows;
+
+	//We can only add to the owned arrays while they are the newest thing in the table
+	bool canGrowBase() const {
+		return extOffsets==NULL && extraRows.empty();
+	}
+
+	static FlatRow<T> makeRow(const std::vector<T>& row) {
+		if (row.empty())
+			return FlatRow<T>();
+		return FlatRow<T>(&row[0], &row[0]+row.size());
+	}
+};
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
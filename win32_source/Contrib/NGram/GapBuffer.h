@@ -0,0 +1,125 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+namespace waitzar
+{
+
+
+/**
+ * A contiguous array with a "gap" at the cursor. Everything before the cursor sits at the
+ *   start of the array and everything after it sits at the end, so inserting or erasing at
+ *   the cursor never moves the rest of the contents. Moving the cursor by "n" moves "n" items
+ *   across the gap.
+ * Both sides are contiguous, so they can be read (or copied out) in one go.
+ * Note that T must be a POD type.
+ */
+template <class T>
+class GapBuffer {
+public:
+	GapBuffer() : gapStart(0), gapEnd(0) {}
+
+	void clear() {
+		data.clear();
+		gapStart = gapEnd = 0;
+	}
+
+	//Sizes
+	size_t size() const { return data.size() - (gapEnd-gapStart); }
+	size_t sizeBefore() const { return gapStart; }
+	size_t sizeAfter() const { return data.size() - gapEnd; }
+
+	//Logical access; items after the cursor are numbered as if there were no gap.
+	const T& operator[](size_t id) const {
+		return id<gapStart ? data[id] : data[id + (gapEnd-gapStart)];
+	}
+
+	//Each side of the gap, as a contiguous array
+	const T* before() const { return data.empty() ? NULL : &data[0]; }
+	const T* after() const { return data.empty() ? NULL : &data[0] + gapEnd; }
+
+	//Insert before the cursor
+	void insert(const T& val) {
+		reserveGap(1);
+		data[gapStart++] = val;
+	}
+	void insert(const T* vals, size_t count) {
+		reserveGap(count);
+		std::copy(vals, vals+count, data.begin()+gapStart);
+		gapStart += count;
+	}
+
+	//Erase on either side of the cursor
+	void eraseBefore(size_t count) {
+		if (count>sizeBefore())
+			throw std::runtime_error("GapBuffer: can't erase past the start");
+		gapStart -= count;
+	}
+	void eraseAfter(size_t count) {
+		if (count>sizeAfter())
+			throw std::runtime_error("GapBuffer: can't erase past the end");
+		gapEnd += count;
+	}
+
+	//Move the cursor left (negative) or right (positive)
+	void moveCursor(int amt) {
+		if (amt<0) {
+			size_t count = -amt;
+			if (count>sizeBefore())
+				throw std::runtime_error("GapBuffer: can't move past the start");
+			std::copy_backward(data.begin()+(gapStart-count), data.begin()+gapStart, data.begin()+gapEnd);
+			gapStart -= count;
+			gapEnd -= count;
+		} else if (amt>0) {
+			size_t count = amt;
+			if (count>sizeAfter())
+				throw std::runtime_error("GapBuffer: can't move past the end");
+			std::copy(data.begin()+gapEnd, data.begin()+(gapEnd+count), data.begin()+gapStart);
+			gapStart += count;
+			gapEnd += count;
+		}
+	}
+
+private:
+	std::vector<T> data;
+	size_t gapStart;
+	size_t gapEnd;
+
+	//Grow geometrically, so that typing one item at a time is amortized O(1)
+	void reserveGap(size_t count) {
+		if (gapEnd-gapStart >= count)
+			return;
+		size_t afterSize = sizeAfter();
+		size_t newSize = std::max<size_t>(std::max<size_t>(data.size()*2, size()+count), 16);
+		data.resize(newSize);
+		std::copy_backward(data.begin()+gapEnd, data.begin()+(gapEnd+afterSize), data.end());
+		gapEnd = newSize - afterSize;
+	}
+};
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
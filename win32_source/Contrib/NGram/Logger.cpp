@@ -6,6 +6,11 @@
 
 #include "Logger.h"
 
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 
 
 
@@ -16,16 +21,16 @@ const std::string Logger::uni2ZawgyiLogFileName =  "wz_log_uni2zawgyi.txt";
 const std::string Logger::typingLogFileName =      "wz_log_typing.txt";
 const std::string Logger::configLogFileName =      "wz_log_config.txt";
 
-//For some reason, if we define these in the header file then our
-// map initializer list can't find them.
-const char Logger::waitzarLogchar =    'L';
-const char Logger::keymagicLogchar =   'K';
-const char Logger::uni2ZawgyiLogchar = 'Z';
-const char Logger::typingLogchar =     'T';
-const char Logger::configLogchar =     'C';
+//These are initialized in the header (so that isLogging() folds away), but
+// our map initializer list takes them by reference, so they need storage.
+const char Logger::waitzarLogchar;
+const char Logger::keymagicLogchar;
+const char Logger::uni2ZawgyiLogchar;
+const char Logger::typingLogchar;
+const char Logger::configLogchar;
 
 //Variables:
-std::map< char, std::vector<FILETIME> > Logger::filetimeStacks;
+std::map< char, std::vector<Logger::Clock::time_point> > Logger::timerStacks;
 std::map< char, std::string > Logger::filePaths = {
 		{waitzarLogchar, mainLogFileName},
 		{keymagicLogchar, keymagicLogFileName},
@@ -34,28 +39,218 @@ std::map< char, std::string > Logger::filePaths = {
 		{configLogchar, configLogFileName}
 };
 
-//Helper 1
-bool Logger::isLogging(char logLetter)
-{
-	if (WZ_LOG_MAIN && (logLetter==waitzarLogchar))
-		return true;
-	if (WZ_LOG_KEYMAGIC && (logLetter==keymagicLogchar))
-		return true;
-	if (WZ_LOG_UNI2ZAWGYI && (logLetter==uni2ZawgyiLogchar))
-		return true;
-	if (WZ_LOG_TYPING && (logLetter==typingLogchar))
-		return true;
-	if (WZ_LOG_CONFIG && (logLetter==configLogchar))
+
+
+namespace {
+
+//A bounded, lock-free queue of log lines (Vyukov's array queue). Any thread may push; only
+// the flush thread pops. Each cell's sequence number says whose turn it is: a cell at "pos"
+// is free for a producer when seq==pos, and ready for the consumer when seq==pos+1.
+//If the queue is full we drop the line (and say so in the log) rather than wait on the disk.
+//When it runs out of work, the flush thread sleeps on a condition variable. Producers only take
+// the lock to wake it, so logging stays lock-free while the thread is busy.
+class LogQueue {
+public:
+	static const size_t NumCells = 4096; //Must be a power of two
+
+	struct Cell {
+		std::atomic<size_t> seq;
+		char logLetter;
+		bool resetFile;
+		std::wstring line;
+	};
+
+	LogQueue() : head(0), tail(0), processed(0), flushed(0), stopping(false), sleeping(false) {
+		for (size_t i=0; i<NumCells; i++)
+			cells[i].seq.store(i, std::memory_order_relaxed);
+		for (size_t i=0; i<256; i++)
+			dropped[i].store(0, std::memory_order_relaxed);
+	}
+
+	//Stop the flush thread (after it writes everything) when the program exits.
+	~LogQueue() {
+		stopping.store(true, std::memory_order_release);
+		wakeWorker();
+		if (worker.joinable())
+			worker.join();
+	}
+
+	//Call after pushing; cheap unless the flush thread is asleep.
+	void wakeWorker() {
+		//Pairs with the fence in flushThread(): either we see it sleeping, or it sees our line.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (sleeping.load(std::memory_order_relaxed)) {
+			std::lock_guard<std::mutex> lock(wakeLock);
+			wake.notify_one();
+		}
+	}
+
+	//Producer side. Takes the contents of "line".
+	bool push(char logLetter, bool resetFile, std::wstring& line) {
+		size_t pos = tail.load(std::memory_order_relaxed);
+		Cell* cell = NULL;
+		for (;;) {
+			cell = &cells[pos&(NumCells-1)];
+			size_t seq = cell->seq.load(std::memory_order_acquire);
+			ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+			if (diff==0) {
+				if (tail.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+					break;
+			} else if (diff<0) {
+				dropped[(unsigned char)logLetter].fetch_add(1, std::memory_order_relaxed);
+				return false;
+			} else
+				pos = tail.load(std::memory_order_relaxed);
+		}
+
+		cell->logLetter = logLetter;
+		cell->resetFile = resetFile;
+		cell->line.swap(line);
+		cell->seq.store(pos+1, std::memory_order_release);
 		return true;
-	return false;
+	}
+
+	//Consumer side. Returns NULL if the next cell isn't ready; call release() when done with it.
+	Cell* front() {
+		Cell* cell = &cells[head&(NumCells-1)];
+		if (cell->seq.load(std::memory_order_acquire) != head+1)
+			return NULL;
+		return cell;
+	}
+	void release(Cell* cell) {
+		cell->line.clear();
+		cell->seq.store(head+NumCells, std::memory_order_release);
+		head++;
+		processed.store(head, std::memory_order_release);
+	}
+
+	//Everything pushed so far
+	size_t pushed() const {
+		return tail.load(std::memory_order_acquire);
+	}
+
+	Cell cells[NumCells];
+	size_t head;                 //Only touched by the flush thread
+	std::atomic<size_t> tail;
+	std::atomic<size_t> processed;
+	std::atomic<size_t> flushed; //Lines that have reached the disk
+	std::atomic<unsigned int> dropped[256];
+	std::atomic<bool> stopping;
+
+	//Sleeping and waking
+	std::atomic<bool> sleeping;  //Only set while the flush thread holds wakeLock
+	std::mutex wakeLock;
+	std::condition_variable wake;        //Work to do (or stopping)
+	std::condition_variable wroteToDisk; //"flushed" went up
+
+	std::thread worker;
+	std::once_flag started;
+};
+
+//Defined after filePaths, so it's destroyed (and the flush thread stopped) before them.
+LogQueue logQueue;
+
+//Guards Logger::timerStacks; any thread may start, stop, or read a timer. The lock is only held
+// while touching the map, never while queueing a line.
+std::mutex timerLock;
+
+//Append a line, escaping anything that won't fit in a byte.
+void writeEscaped(std::ofstream& log, const std::wstring& line)
+{
+	for (size_t i=0; i<line.length(); i++) {
+		if (line[i]<=0xFF && line[i]!=0x00)
+			log <<(char)line[i];
+		else
+			log <<"\\u" <<std::hex <<std::uppercase <<(unsigned int)line[i] <<std::dec <<std::nouppercase;
+	}
+	log <<'\n';
+}
+
+} //End anonymous namespace
+
+
+
+//Hand a line to the flush thread, starting it if needed.
+void Logger::queueLine(char logLetter, bool resetFile, const std::wstring& logLine)
+{
+	std::call_once(logQueue.started, [](){
+		logQueue.worker = std::thread(&Logger::flushThread);
+	});
+
+	std::wstring line = logLine;
+	logQueue.push(logLetter, resetFile, line);
+	logQueue.wakeWorker();
+}
+
+
+//Write queued lines until the program exits. Files stay open between lines, and are
+// flushed whenever we run out of work; then we sleep until more arrives.
+void Logger::flushThread()
+{
+	std::map<char, std::ofstream> files;
+	unsigned int reported[256] = {0};
+	for (;;) {
+		LogQueue::Cell* cell = logQueue.front();
+		if (cell==NULL) {
+			//Out of work; let the disk catch up.
+			for (auto it=files.begin(); it!=files.end(); it++)
+				it->second.flush();
+
+			std::unique_lock<std::mutex> lock(logQueue.wakeLock);
+			logQueue.flushed.store(logQueue.processed.load(std::memory_order_acquire), std::memory_order_release);
+			logQueue.wroteToDisk.notify_all();
+
+			//Stop only once everything pushed has been written.
+			if (logQueue.stopping.load(std::memory_order_acquire) && logQueue.pushed()==logQueue.head)
+				break;
+
+			//Sleep until a producer (or the destructor) wakes us. Re-check the queue after saying
+			//  we're asleep, in case a line arrived just before.
+			logQueue.sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			logQueue.wake.wait(lock, [](){
+				return logQueue.front()!=NULL || logQueue.stopping.load(std::memory_order_acquire);
+			});
+			logQueue.sleeping.store(false, std::memory_order_relaxed);
+			continue;
+		}
+
+		//Open (or truncate) the file
+		char logLetter = cell->logLetter;
+		std::ofstream& log = files[logLetter];
+		if (cell->resetFile || !log.is_open()) {
+			if (log.is_open())
+				log.close();
+			log.clear();
+			log.open(filePaths[logLetter].c_str(), cell->resetFile ? std::ios::out : std::ios::app);
+		}
+
+		//Note any lines we lost since last time
+		unsigned int numDropped = logQueue.dropped[(unsigned char)logLetter].load(std::memory_order_relaxed);
+		if (numDropped != reported[(unsigned char)logLetter]) {
+			log <<"<" <<(numDropped-reported[(unsigned char)logLetter]) <<" log lines dropped>" <<'\n';
+			reported[(unsigned char)logLetter] = numDropped;
+		}
+
+		if (!cell->resetFile)
+			writeEscaped(log, cell->line);
+		logQueue.release(cell);
+	}
 }
 
-//Helper 2 (to-do: fix the timer if the high words differ)
-unsigned long Logger::getTimeDifferenceMS(const FILETIME &st, const FILETIME &end)
+
+//Block until everything logged so far is on disk.
+void Logger::flush()
 {
-	if (st.dwHighDateTime != end.dwHighDateTime)
-		return 12345; //TODO: Fix this
-	return (end.dwLowDateTime - st.dwLowDateTime)/10000L;
+	//Nothing has ever been logged.
+	if (!logQueue.worker.joinable())
+		return;
+
+	size_t target = logQueue.pushed();
+	std::unique_lock<std::mutex> lock(logQueue.wakeLock);
+	logQueue.wroteToDisk.wait(lock, [target](){
+		return logQueue.flushed.load(std::memory_order_acquire) >= target;
+	});
 }
 
 
@@ -64,47 +259,33 @@ unsigned long Logger::getTimeDifferenceMS(const FILETIME &st, const FILETIME &en
 void Logger::resetLogFile(char logLetter) 
 {
 	if (isLogging(logLetter)) {
-		//Reset the saved filetimes
-		filetimeStacks[logLetter].clear();
-
-		//Ensure the file path has been added.
-		//filePaths[logLetter] = (logLetter==waitzarLogchar) ? mainLogFileName : (logLetter==keymagicLogchar) ? keymagicLogFileName : (logLetter==typingLogchar) ? typingLogFileName : uni2ZawgyiLogFileName;
+		//Reset the saved timers
+		{
+			std::lock_guard<std::mutex> lock(timerLock);
+			timerStacks[logLetter].clear();
+		}
 
-		//Reset log file contents
-		std::ofstream log(filePaths[logLetter].c_str(), std::ios::out);
-		log.close();
+		//Reset log file contents (in order with any lines still queued)
+		queueLine(logLetter, true, L"");
 	}
 }
 
 //Write a single line (indent based on number of running timers; just ignore tabs for no timings)
-//Escapes unicode
+//Escapes unicode (on the flush thread)
 void Logger::writeLogLine(char logLetter, const std::wstring& logLine)
 {
 	if (isLogging(logLetter)) {
-		//Open file
-		std::ofstream log(filePaths[logLetter].c_str(), std::ios::app);
-
-		//Append main line if non-empty.
-		if (!logLine.empty()) {
-			//Indent
-			std::wstring newLine = std::wstring(filetimeStacks[logLetter].size()*logTabDepth, L' ') + logLine;
-
-			//Generate line
-			std::stringstream msg;
-			for (size_t i=0; i<newLine.length(); i++) {
-				if (newLine[i]<=0xFF && newLine[i]!=0x00)
-					msg <<(char)newLine[i];
-				else
-					msg <<"\\u" <<std::hex <<std::uppercase <<newLine[i] <<std::dec <<std::nouppercase;
+		//Indent, if non-empty. (We write a trailing newline anyway.)
+		if (logLine.empty())
+			queueLine(logLetter, false, logLine);
+		else {
+			size_t numTimers = 0;
+			{
+				std::lock_guard<std::mutex> lock(timerLock);
+				numTimers = timerStacks[logLetter].size();
 			}
-
-			//Write line
-			log <<msg.str();
+			queueLine(logLetter, false, std::wstring(numTimers*logTabDepth, L' ') + logLine);
 		}
-
-		//Write a trailing newline anyway
-		log <<std::endl;
-		log.close();
 	}
 }
 void Logger::writeLogLine(char logLetter)
@@ -116,14 +297,16 @@ void Logger::writeLogLine(char logLetter)
 //Start the timer with an optional line in the log file
 void Logger::startLogTimer(char logLetter, const std::wstring& logLine)
 {
+	if (!isLogging(logLetter))
+		return;
+
 	//Write line
 	if (!logLine.empty())
 		writeLogLine(logLetter, logLine);
 
 	//Start timer
-	FILETIME time;
-	GetSystemTimeAsFileTime(&time);
-	filetimeStacks[logLetter].push_back(time);
+	std::lock_guard<std::mutex> lock(timerLock);
+	timerStacks[logLetter].push_back(Clock::now());
 }
 void Logger::startLogTimer(char logLetter)
 {
@@ -134,8 +317,16 @@ void Logger::startLogTimer(char logLetter)
 //Stop the timer with an optional line in the log file
 void Logger::endLogTimer(char logLetter, const std::wstring& logLine)
 {
+	if (!isLogging(logLetter))
+		return;
+
 	//Stop timer
-	filetimeStacks[logLetter].pop_back();
+	{
+		std::lock_guard<std::mutex> lock(timerLock);
+		std::vector<Clock::time_point>& timers = timerStacks[logLetter];
+		if (!timers.empty())
+			timers.pop_back();
+	}
 
 	//Write line
 	if (!logLine.empty())
@@ -151,18 +342,23 @@ void Logger::endLogTimer(char logLetter)
 //Mark a given time with a log line
 void Logger::markLogTime(char logLetter, const std::wstring& logLine)
 {
+	if (!isLogging(logLetter))
+		return;
+
 	//Generate a timed line
 	std::wstringstream linePrefix;
-	if (filetimeStacks[logLetter].empty())
-		linePrefix <<L"<NULL> ms - ";
-	else {
-		//Time the event
-		FILETIME endTime;
-		GetSystemTimeAsFileTime(&endTime);
-		FILETIME startTime = filetimeStacks[logLetter][filetimeStacks[logLetter].size()-1];
-		DWORD timeMS = getTimeDifferenceMS(startTime, endTime);
-		linePrefix <<timeMS <<L" ms - ";
-		filetimeStacks[logLetter][filetimeStacks[logLetter].size()-1] = endTime;
+	{
+		std::lock_guard<std::mutex> lock(timerLock);
+		std::vector<Clock::time_point>& timers = timerStacks[logLetter];
+		if (timers.empty())
+			linePrefix <<L"<NULL> ms - ";
+		else {
+			//Time the event
+			Clock::time_point endTime = Clock::now();
+			long long timeMS = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - timers.back()).count();
+			linePrefix <<timeMS <<L" ms - ";
+			timers.back() = endTime;
+		}
 	}
 
 	//Write line
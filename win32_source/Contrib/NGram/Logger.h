@@ -6,8 +6,9 @@
 
 #pragma once
 
-//Our FILETIME structure
+#ifdef _WIN32
 #include "../../../win32_source/windows_wz.h"
+#endif
 
 #include <sstream>
 #include <fstream>
@@ -15,10 +16,14 @@
 #include <vector>
 #include <limits>
 #include <map>
+#include <chrono>
 
 
 //Some simple static functions for managing a series of log files
-// We assume decent inlining removes these when the respective const flags are false.
+// Lines are queued in a lock-free ring buffer and written out by a background thread, so
+// logging never waits on the disk. Callers should check isLogging() before building a line;
+// it is inline and constant for each log letter, so a disabled log costs (at most) one branch.
+// Timers may be used from any thread; they share one stack per log letter, guarded by a mutex.
 class Logger {
 private:
 	//Generic constants
@@ -26,41 +31,51 @@ private:
 
 	//Main log file: constants
 	const static bool WZ_LOG_MAIN = false;
-	const static char waitzarLogchar;
+	const static char waitzarLogchar = 'L';
 	const static std::string mainLogFileName;
 
 	//Keymagic log file: constants
 	const static bool WZ_LOG_KEYMAGIC = false;
-	const static char keymagicLogchar;
+	const static char keymagicLogchar = 'K';
 	const static std::string keymagicLogFileName;
 
 	//Uni2Zawgyi log file: constants
 	const static bool WZ_LOG_UNI2ZAWGYI = false;
-	const static char uni2ZawgyiLogchar;
+	const static char uni2ZawgyiLogchar = 'Z';
 	const static std::string uni2ZawgyiLogFileName;
 
 	//"Typing" log file: constants
 	const static bool WZ_LOG_TYPING = false;
-	const static char typingLogchar;
+	const static char typingLogchar = 'T';
 	const static std::string typingLogFileName;
 
 	//"Config" log file: constants
 	const static bool WZ_LOG_CONFIG = true;
-	const static char configLogchar;
+	const static char configLogchar = 'C';
 	const static std::string configLogFileName;
 
 private:
+	//Timers use a monotonic clock, so they can't jump (or go backwards) with the system time.
+	typedef std::chrono::steady_clock Clock;
+
 	//Variables
-	static std::map< char, std::vector<FILETIME> > filetimeStacks;
+	static std::map< char, std::vector<Clock::time_point> > timerStacks;
 	static std::map< char, std::string > filePaths;
 
 private:
-	//Helper function
-	static unsigned long getTimeDifferenceMS(const FILETIME &st, const FILETIME &end);
+	//Helper functions
+	static void queueLine(char logLetter, bool resetFile, const std::wstring& logLine);
+	static void flushThread();
 
 public:
 	//Exposed functionality
-	static bool isLogging(char logLetter);
+	static bool isLogging(char logLetter) {
+		return (WZ_LOG_MAIN && logLetter==waitzarLogchar)
+			|| (WZ_LOG_KEYMAGIC && logLetter==keymagicLogchar)
+			|| (WZ_LOG_UNI2ZAWGYI && logLetter==uni2ZawgyiLogchar)
+			|| (WZ_LOG_TYPING && logLetter==typingLogchar)
+			|| (WZ_LOG_CONFIG && logLetter==configLogchar);
+	}
 	static void resetLogFile(char logLetter);
 	static void writeLogLine(char logLetter);
 	static void writeLogLine(char logLetter, const std::wstring& logLine);
@@ -69,6 +84,9 @@ public:
 	static void endLogTimer(char logLetter);
 	static void endLogTimer(char logLetter, const std::wstring& logLine);
 	static void markLogTime(char logLetter, const std::wstring& logLine);
+
+	//Wait until everything logged so far is on disk.
+	static void flush();
 };
 
 
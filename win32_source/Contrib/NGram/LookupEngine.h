@@ -25,8 +25,10 @@ public:
 
 	//Requires hacking (mostly b/c WordBuilder assumes word IDs)
 	//TODO: Replace these!
-	virtual std::vector<unsigned int> getPossibleWords() const = 0;
-	virtual std::vector<int> getWordCombinations() const = 0; //Tied to getPossibleWords
+	//These are asked for on every repaint, so they return a reference to the engine's own list
+	//   (valid until the next call that changes the model).
+	virtual const std::vector<unsigned int>& getPossibleWords() const = 0;
+	virtual const std::vector<int>& getWordCombinations() const = 0; //Tied to getPossibleWords
 	virtual std::wstring getWordString(unsigned int id) const = 0;
 	virtual std::pair<int, std::string> reverseLookupWord(std::wstring word) = 0;
 	virtual unsigned short getSingleDigitID(unsigned short arabicNumeral) = 0;
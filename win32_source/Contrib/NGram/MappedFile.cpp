@@ -0,0 +1,146 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+  #include "windows_wz.h"
+#else
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+
+using std::string;
+
+
+namespace waitzar
+{
+
+
+MappedFile::MappedFile(const string& path) : bytes(NULL), numBytes(0), mapHandle(NULL), fileHandle(NULL)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error(string("Can't open binary model: ") + path);
+	DWORD sizeHigh = 0;
+	numBytes = GetFileSize(file, &sizeHigh);
+	if ((numBytes==INVALID_FILE_SIZE && GetLastError()!=NO_ERROR) || sizeHigh!=0) {
+		CloseHandle(file);
+		throw std::runtime_error(string("Can't read the size of binary model: ") + path);
+	}
+	HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		CloseHandle(file);
+		throw std::runtime_error(string("Can't map binary model: ") + path);
+	}
+	bytes = reinterpret_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (bytes == NULL) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error(string("Can't map binary model: ") + path);
+	}
+	fileHandle = file;
+	mapHandle = mapping;
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file == -1)
+		throw std::runtime_error(string("Can't open binary model: ") + path);
+	struct stat info;
+	if (fstat(file, &info)!=0) {
+		close(file);
+		throw std::runtime_error(string("Can't stat binary model: ") + path);
+	}
+	numBytes = info.st_size;
+	void* res = mmap(NULL, numBytes, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if (res == MAP_FAILED)
+		throw std::runtime_error(string("Can't map binary model: ") + path);
+	bytes = reinterpret_cast<const char*>(res);
+	mapHandle = res;
+#endif
+}
+
+
+MappedFile::~MappedFile()
+{
+	if (mapHandle==NULL)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(bytes);
+	CloseHandle(reinterpret_cast<HANDLE>(mapHandle));
+	CloseHandle(reinterpret_cast<HANDLE>(fileHandle));
+#else
+	munmap(mapHandle, numBytes);
+#endif
+	mapHandle = NULL;
+	fileHandle = NULL;
+}
+
+
+unsigned int MappedFile::Checksum(const char* data, size_t size)
+{
+	const unsigned int MOD_ADLER = 65521;
+	unsigned int a = 1;
+	unsigned int b = 0;
+	while (size > 0) {
+		//5552 is the largest block for which "b" can't overflow
+		size_t block = size<5552 ? size : 5552;
+		size -= block;
+		for (size_t i=0; i<block; i++) {
+			a += static_cast<unsigned char>(*data++);
+			b += a;
+		}
+		a %= MOD_ADLER;
+		b %= MOD_ADLER;
+	}
+	return (b<<16) | a;
+}
+
+
+void FileSection::validate(const char* data, size_t size, size_t valueSize, const string& errPrefix, const char* name) const
+{
+	//Offsets and values must fit. We divide rather than multiply, so that nothing can wrap around
+	//  (rows+1 offsets fit only if "rows" is less than the number that fit).
+	if (offsetsPos%4!=0 || valuesPos%4!=0)
+		throw std::runtime_error(errPrefix + name + " is not aligned");
+	if (offsetsPos>size || (size_t)rows >= (size-offsetsPos)/sizeof(unsigned int))
+		throw std::runtime_error(errPrefix + name + " offsets are out of bounds");
+	if (valuesPos>size || (size_t)numValues > (size-valuesPos)/valueSize)
+		throw std::runtime_error(errPrefix + name + " values are out of bounds");
+
+	//Every row must start where the last one ended, and the last must end at the number of values.
+	const unsigned int* offsets = reinterpret_cast<const unsigned int*>(data + offsetsPos);
+	if (offsets[0]!=0 || offsets[rows]!=numValues)
+		throw std::runtime_error(errPrefix + name + " offsets don't match the number of values");
+	for (size_t i=0; i<rows; i++) {
+		if (offsets[i]>offsets[i+1])
+			throw std::runtime_error(errPrefix + name + " offsets are out of order");
+	}
+}
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
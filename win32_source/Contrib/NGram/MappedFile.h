@@ -0,0 +1,111 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+
+#include "NGram/FlatTable.h"
+
+namespace waitzar
+{
+
+
+/**
+ * The bytes of a compiled model file. Either the file is memory-mapped read-only (so every
+ *   process which loads the same file shares its pages), or we borrow a buffer that's
+ *   already in memory (e.g., a locked resource), which must outlive this object.
+ */
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path);
+	MappedFile(const char* data, size_t size) : bytes(data), numBytes(size), mapHandle(NULL), fileHandle(NULL) {}
+	~MappedFile();
+
+	const char* data() const { return bytes; }
+	size_t size() const { return numBytes; }
+
+	//Adler-32, as used by zlib. Fast, and good enough to catch truncated or corrupted files.
+	static unsigned int Checksum(const char* data, size_t size);
+
+private:
+	const char* bytes;
+	size_t numBytes;
+	void* mapHandle;  //Platform-dependent mapping handle; NULL if we don't own the memory
+	void* fileHandle;
+
+	//Not copyable; we might own a mapping.
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
+
+
+/**
+ * One FlatTable, as stored in a compiled model: an array of (rows+1) offsets followed by an
+ *   array of values. Positions are from the start of the file, and are 4-byte aligned.
+ */
+struct FileSection {
+	unsigned int rows;
+	unsigned int offsetsPos;
+	unsigned int valuesPos;
+	unsigned int numValues;
+
+	//Append a table's offsets and values to "out", recording their positions
+	template <class T>
+	void write(std::vector<char>& out, const FlatTable<T>& table) {
+		std::vector<unsigned int> offsets;
+		std::vector<T> values;
+		table.flatten(offsets, values);
+
+		rows = table.size();
+		numValues = values.size();
+
+		offsetsPos = out.size();
+		out.resize(Align4(out.size() + offsets.size()*sizeof(unsigned int)));
+		memcpy(&out[offsetsPos], &offsets[0], offsets.size()*sizeof(unsigned int));
+
+		valuesPos = out.size();
+		out.resize(Align4(out.size() + values.size()*sizeof(T)));
+		if (!values.empty())
+			memcpy(&out[valuesPos], &values[0], values.size()*sizeof(T));
+	}
+
+	//Make sure this section fits in the file, and that every row lies within its values. Throws a
+	//  std::runtime_error (prefixed by "errPrefix") if not.
+	void validate(const char* data, size_t size, size_t valueSize, const std::string& errPrefix, const char* name) const;
+
+	//Use this section in place
+	template <class T>
+	void attach(const char* data, FlatTable<T>& table) const {
+		table.attach(reinterpret_cast<const unsigned int*>(data+offsetsPos), reinterpret_cast<const T*>(data+valuesPos), rows);
+	}
+
+	static size_t Align4(size_t val) {
+		return (val+3) & ~((size_t)3);
+	}
+};
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
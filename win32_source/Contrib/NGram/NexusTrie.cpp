@@ -0,0 +1,66 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#include "NexusTrie.h"
+
+#include <algorithm>
+
+using std::vector;
+
+
+namespace waitzar
+{
+
+
+namespace {
+	//Sort links by (unsigned) letter
+	bool letterLess(unsigned int a, unsigned int b) {
+		return (a&0xFF) < (b&0xFF);
+	}
+}
+
+
+void NexusTrie::pushNode(vector<unsigned int> links)
+{
+	std::stable_sort(links.begin(), links.end(), letterLess);
+	edges.pushRow(links);
+}
+
+
+unsigned int NexusTrie::addNode()
+{
+	edges.pushRow();
+	return edges.size()-1;
+}
+
+
+void NexusTrie::addLink(unsigned int nodeID, char letter, unsigned int target)
+{
+	//Keep the node's links sorted
+	unsigned int link = Pack(target, letter);
+	FlatRow<unsigned int> links = edges[nodeID];
+	size_t pos = std::upper_bound(links.begin(), links.end(), link, letterLess) - links.begin();
+	edges.insert(nodeID, pos, link);
+}
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
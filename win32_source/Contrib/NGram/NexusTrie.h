@@ -0,0 +1,99 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "NGram/FlatTable.h"
+
+namespace waitzar
+{
+
+
+/**
+ * The WordBuilder's romanisation trie, stored in compressed-sparse-row form: every node's
+ *   outgoing links live in one contiguous edge array (sorted by letter within each node), and
+ *   a per-node offset array says where each node's links start. Each link is packed as
+ *   (targetID<<8)|letter, exactly as in the text model. The special letter '~' links
+ *   to the prefix entry that resolves words at this node.
+ * Lookups binary-search the node's links, choosing each half with a conditional move rather
+ *   than a branch (see TrieBench for how this compares to a linear scan).
+ */
+class NexusTrie {
+public:
+	//The special "letter" linking a node to its prefix (word resolution) entry
+	static const char PrefixLink = '~';
+
+	//Packing helpers
+	static unsigned int Pack(unsigned int target, char letter) { return (target<<8) | (0xFF&letter); }
+	static char Letter(unsigned int link) { return (char)(link&0xFF); }
+	static unsigned int Target(unsigned int link) { return link>>8; }
+
+	//Basic properties
+	size_t size() const { return edges.size(); }
+	FlatRow<unsigned int> operator[](size_t nodeID) const { return edges[nodeID]; }
+
+	//Returns the node linked from "nodeID" on "letter", or -1 if there is no such link.
+	//  Inlined, since the WordBuilder calls this for every key it's given.
+	inline int jump(unsigned int nodeID, char letter) const;
+
+	//Building the trie. Links may be given in any order; they are sorted on the way in.
+	void pushNode(std::vector<unsigned int> links);
+	unsigned int addNode();
+	void addLink(unsigned int nodeID, char letter, unsigned int target);
+
+	//Storage
+	void reserve(size_t nodes) { edges.reserve(nodes); }
+	void attach(const unsigned int* offsets, const unsigned int* values, size_t nodes) { edges.attach(offsets, values, nodes); }
+	const FlatTable<unsigned int>& getEdges() const { return edges; }
+
+private:
+	FlatTable<unsigned int> edges;
+};
+
+
+inline int NexusTrie::jump(unsigned int nodeID, char letter) const
+{
+	//Binary search for the first link with this letter (so, if a letter somehow appears twice, the first
+	//  link wins, as it always has). Each step adds either half or nothing, so there is no branch to mispredict.
+	FlatRow<unsigned int> links = edges[nodeID];
+	unsigned int key = 0xFF&letter;
+	size_t count = links.size();
+	if (count==0)
+		return -1;
+	const unsigned int* base = links.begin();
+	size_t last = count-1;
+	size_t id = 0;
+	while (count>1) {
+		size_t half = count/2;
+		id += ((base[id+half]&0xFF) < key) * half;
+		count -= half;
+	}
+
+	//"id" is now the first link, or the last one before "letter"; if it's before, try the next one.
+	id += ((base[id]&0xFF) < key) & (id<last);
+	return ((base[id]&0xFF)==key) ? (int)(base[id]>>8) : -1;
+}
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
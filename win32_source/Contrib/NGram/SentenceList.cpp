@@ -26,60 +26,60 @@ SentenceList::~SentenceList()
 
 void SentenceList::clear()
 {
-	prevTypedWords.clear();
-	cursor = prevTypedWords.begin();
-	cursorIndex = -1;
+	words.clear();
+	letters.clear();
 }
 
 
-void SentenceList::insert(int val)
+void SentenceList::insert(int val, const std::wstring& text)
 {
-	prevTypedWords.insert(cursor, val);
-	cursorIndex++;
+	Word word;
+	word.id = val;
+	word.length = text.length();
+	words.insert(word);
+	letters.insert(text.c_str(), text.length());
 }
 
 
 int SentenceList::getCursorIndex() const
 {
-	return cursorIndex;
+	return ((int)words.sizeBefore()) - 1;
 }
 
 
 size_t SentenceList::size() const
 {
-	return prevTypedWords.size();
+	return words.size();
 }
 
 
 bool SentenceList::moveCursorRight(int amt, bool allowSameIndex, LookupEngine &model)
 {
 	//Any words?
-	if (prevTypedWords.size()==0)
+	if (words.size()==0)
 		return false;
 
 	//Are we in bounds?
-	int newCursorIndex = cursorIndex + amt;
-	newCursor = cursor;
-	while (amt!=0) {
-		if (amt>0 && newCursor!=prevTypedWords.end()) {
-			newCursor++;
-			amt--;
-		} else if (amt<0 && newCursor!=prevTypedWords.begin()) {
-			newCursor--;
-			amt++;
-		} else {
-			//Ignore this update
-			return false;
-		}
-	}
+	int newCursor = ((int)words.sizeBefore()) + amt;
+	if (newCursor<0 || newCursor>(int)words.size())
+		return false;
 
 	//Did we make any change?
-	if (newCursor==cursor && !allowSameIndex)
+	if (amt==0 && !allowSameIndex)
 		return false;
 
-	//Update our model
-	cursor = newCursor;
-	cursorIndex = newCursorIndex;
+	//Update our model; each word carries its text across the gap.
+	size_t numLetters = 0;
+	if (amt<0) {
+		for (int i=newCursor; i<(int)words.sizeBefore(); i++)
+			numLetters += words[i].length;
+		letters.moveCursor(-(int)numLetters);
+	} else {
+		for (int i=words.sizeBefore(); i<newCursor; i++)
+			numLetters += words[i].length;
+		letters.moveCursor((int)numLetters);
+	}
+	words.moveCursor(amt);
 
 	//Set the trigram
 	this->updateTrigrams(model);
@@ -99,16 +99,13 @@ bool SentenceList::moveCursorRight(int amt, LookupEngine &model)
 
 bool SentenceList::deleteNext()
 {
-	//No words?
-	if (prevTypedWords.size()==0)
-		return false;
-
-	//At end?
-	if (cursor == prevTypedWords.end())
+	//At end? (or no words)
+	if (words.sizeAfter()==0)
 		return false;
 
 	//Ok, delete it. No need to advance the cursor
-	cursor = prevTypedWords.erase(cursor);
+	letters.eraseAfter(words.after()->length);
+	words.eraseAfter(1);
 	return true;
 }
 
@@ -116,18 +113,13 @@ bool SentenceList::deleteNext()
 
 bool SentenceList::deletePrev(LookupEngine &model)
 {
-	//No words?
-	if (prevTypedWords.size()==0)
-		return false;
-
-	//At beginning?
-	if (cursor == prevTypedWords.begin())
+	//At beginning? (or no words)
+	if (words.sizeBefore()==0)
 		return false;
 
 	//Ok, delete it, update the cursor.
-	cursor--;
-	cursorIndex--;
-	cursor = prevTypedWords.erase(cursor);
+	letters.eraseBefore(words.before()[words.sizeBefore()-1].length);
+	words.eraseBefore(1);
 
 	//Update the trigrams...
 	this->updateTrigrams(model);
@@ -136,26 +128,28 @@ bool SentenceList::deletePrev(LookupEngine &model)
 
 
 
-std::wstring SentenceList::getPrevTypedWord(LookupEngine &model, const std::vector<std::wstring>& userDefinedWords) const
+std::wstring SentenceList::getPrevTypedWord() const
 {
-	std::wstring prevWord = L"";
-	std::list<int>::const_iterator it=this->begin();
-	for (int currID=0; currID<=this->getCursorIndex(); currID++) {
-		if (*it>=0)
-			prevWord = model.getWordString(*it);
-		else {
-			int adjID = -1 - (*it);
-			size_t sysSize = waitzar::WZSystemDefinedWords.size();
-			if (adjID < (int)sysSize) {
-				prevWord = std::wstring(1, waitzar::WZSystemDefinedWords[adjID]);
-			} else {
-				adjID -= sysSize;
-				prevWord = userDefinedWords[adjID];
-			}
-		}
-		it++;
-	}
-	return prevWord;
+	if (words.sizeBefore()==0)
+		return L"";
+	size_t length = words.before()[words.sizeBefore()-1].length;
+	return std::wstring(letters.before()+letters.sizeBefore()-length, length);
+}
+
+
+std::wstring SentenceList::getTextBeforeCursor(bool skipPrevWord) const
+{
+	size_t length = letters.sizeBefore();
+	if (skipPrevWord && words.sizeBefore()>0)
+		length -= words.before()[words.sizeBefore()-1].length;
+	return length>0 ? std::wstring(letters.before(), length) : L"";
+}
+
+
+std::wstring SentenceList::getTextAfterCursor() const
+{
+	size_t length = letters.sizeAfter();
+	return length>0 ? std::wstring(letters.after(), length) : L"";
 }
 
 
@@ -164,35 +158,20 @@ std::wstring SentenceList::getPrevTypedWord(LookupEngine &model, const std::vect
 void SentenceList::updateTrigrams(LookupEngine &model)
 {
 	std::vector<unsigned int> trigrams;
-	std::list<int>::iterator considered = cursor;
-	while (considered!=prevTypedWords.begin() && trigrams.size()<3) {
+	const Word* considered = words.before() + words.sizeBefore();
+	while (considered!=words.before() && trigrams.size()<3) {
 		considered--;
 
-		if (*considered<0)
+		if (considered->id<0)
 			break;
 
-		trigrams.push_back(*considered);
+		trigrams.push_back(considered->id);
 	}
 	model.insertTrigram(trigrams);
 }
 
 
 
-
-//Iterate
-
-std::list<int>::const_iterator SentenceList::begin() const
-{
-	return prevTypedWords.begin();
-}
-
-std::list<int>::const_iterator SentenceList::end() const
-{
-	return prevTypedWords.end();
-}
-
-
-
 } //End waitzar namespace
 
 
@@ -11,10 +11,11 @@
 #include <wchar.h>
 #include <string.h>
 #include <stdio.h>
-#include <list>
+#include <string>
 #include <vector>
 
 #include "NGram/LookupEngine.h"
+#include "NGram/GapBuffer.h"
 #include "NGram/wz_utilities.h"
 
 
@@ -25,6 +26,9 @@ namespace waitzar
 /**
  * Intended to encapsulate the cursor & the list of possible words into a single class,
  *   and to fix the reverse-insertion error at the same time.
+ * Words are kept in a gap buffer split at the cursor, along with their text (another gap
+ *   buffer, laid out the same way). So the previous word, the trigram context, and the text
+ *   on either side of the cursor never require walking the sentence, however long it gets.
  */
 class SentenceList
 {
@@ -35,31 +39,33 @@ public:
 
 	//Extracted interface
 	void clear();
-	void insert(int val);
+	void insert(int val, const std::wstring& text);
 	int getCursorIndex() const;
 	bool moveCursorRight(int amt, bool allowSameIndex, LookupEngine &model);
 	bool moveCursorRight(int amt, LookupEngine &model);
 	size_t size() const;
 	bool deleteNext();
 	bool deletePrev(LookupEngine &model);
-	std::wstring getPrevTypedWord(LookupEngine &model, const std::vector<std::wstring>& userDefinedWords) const;
+	std::wstring getPrevTypedWord() const;
 
-	//Iterating
-	std::list<int>::const_iterator begin() const;
-	std::list<int>::const_iterator end() const;
+	//The sentence's text on either side of the cursor. The first can leave off
+	//  the previous word (e.g., if it's about to be replaced).
+	std::wstring getTextBeforeCursor(bool skipPrevWord=false) const;
+	std::wstring getTextAfterCursor() const;
 
 	//Consistency
 	void updateTrigrams(LookupEngine &model);
 
 
 private:
-	//Main wrapped variables
-	int cursorIndex;
-	std::list<int> prevTypedWords;
-	std::list<int>::iterator cursor;
-
-	//Helper
-	std::list<int>::iterator newCursor;
+	struct Word {
+		int id;
+		unsigned int length; //Of its text
+	};
+
+	//Main wrapped variables; the cursor is the gap.
+	GapBuffer<Word> words;
+	GapBuffer<wchar_t> letters;
 };
 
 
@@ -5,6 +5,10 @@
  */
 
 #include "TrigramLookup.h"
+#include "NGram/Utf8Transcoder.h"
+
+#include <algorithm>
+#include <cstdio>
 
 
 using std::wstring;
@@ -17,19 +21,116 @@ namespace waitzar
 {
 
 
+namespace {
+	//Romanizations are matched case-insensitively.
+	char toLower(char c) {
+		if (c>='A'&&c<='Z')
+			return (c-'A')+'a';
+		return c;
+	}
+
+	//N-grams, however, are keyed on exactly what was typed.
+	bool hasUpper(const string& roman) {
+		for (auto ch=roman.begin(); ch!=roman.end(); ch++) {
+			if (*ch>='A'&&*ch<='Z')
+				return true;
+		}
+		return false;
+	}
+
+	bool sameWord(const FlatRow<wchar_t>& a, const wchar_t* begin, const wchar_t* end) {
+		return a.size()==(size_t)(end-begin) && std::equal(begin, end, a.begin());
+	}
+
+	//Find a word's slot in the word hash: either the slot holding it, or the empty slot where it belongs.
+	const unsigned int* findWordSlot(const FlatTable<wchar_t>& words, const FlatRow<unsigned int>& slots, const wchar_t* begin, const wchar_t* end) {
+		size_t mask = slots.size()-1;
+		for (size_t id=TrigramTables::HashWord(begin, end)&mask;; id=(id+1)&mask) {
+			if (slots[id]==TrigramTables::NoWord || sameWord(words[slots[id]], begin, end))
+				return &slots[id];
+		}
+	}
+
+	//Hash every word, keeping the first of any duplicates. At most half full.
+	vector<unsigned int> buildWordHash(const FlatTable<wchar_t>& words) {
+		size_t numSlots = 2;
+		while (numSlots < words.size()*2)
+			numSlots *= 2;
+		vector<unsigned int> res(numSlots, (unsigned int)TrigramTables::NoWord);
+		FlatRow<unsigned int> slots(&res[0], &res[0]+res.size());
+		for (size_t i=0; i<words.size(); i++) {
+			FlatRow<wchar_t> word = words[i];
+			unsigned int* slot = &res[findWordSlot(words, slots, word.begin(), word.end()) - slots.begin()];
+			if (*slot==TrigramTables::NoWord)
+				*slot = i;
+		}
+		return res;
+	}
+
+	//Save a map as a pair of sorted key/value tables
+	void fillKeyTable(const map<wstring, wstring>& src, FlatTable<wchar_t>& keys, FlatTable<wchar_t>& values) {
+		for (auto it=src.begin(); it!=src.end(); it++) {
+			keys.pushRow(it->first.c_str(), it->first.size());
+			values.pushRow(it->second.c_str(), it->second.size());
+		}
+	}
+}
+
+
 
-//TODO: Make our binary format more uniform, so that we only need to branch when storing data (not when loading it).
-//      We might consider using JSON for this; not sure how it'll work on Linux.
 TrigramLookup::TrigramLookup(const string& modelBufferOrFile, bool stringIsBuffer)
 {
-	//Get the actual, wide-character stream
-	wstring buffer = stringIsBuffer ? waitzar::mbs2wcs(modelBufferOrFile) : waitzar::readUTF8File(modelBufferOrFile);
+	//Compiled models are used in place; JSON models are parsed into the same tables.
+	if (stringIsBuffer) {
+		if (BinaryTrigramModel::IsBinaryModel(modelBufferOrFile.data(), modelBufferOrFile.size())) {
+			modelBuffer = modelBufferOrFile;
+			binaryModel.reset(new BinaryTrigramModel(modelBuffer.data(), modelBuffer.size()));
+		} else
+			loadJsonModel(modelBufferOrFile);
+	} else {
+		//Peek at the header
+		FILE* modelFile = fopen(modelBufferOrFile.c_str(), "rb");
+		if (modelFile == NULL)
+			throw std::runtime_error(string("File doesn't exist: " + modelBufferOrFile).c_str());
+		char header[sizeof(BinaryTrigramModel::Header)];
+		size_t headerSize = fread(header, 1, sizeof(header), modelFile);
+		fclose(modelFile);
+
+		if (BinaryTrigramModel::IsBinaryModel(header, headerSize))
+			binaryModel.reset(new BinaryTrigramModel(modelBufferOrFile));
+		else
+			loadJsonModel(waitzar::ReadBinaryFile(modelBufferOrFile));
+	}
+	if (binaryModel)
+		binaryModel->attach(tables);
+
+	//Compile our last-chance patterns.
+	for (size_t i=0; i<tables.lastChance.size(); i++) {
+		FlatRow<char> pattern = tables.lastChance[i];
+		LastChanceRule rule;
+		if (CompileLastChance(string(pattern.begin(), pattern.end()), rule))
+			lastChanceRules.push_back(rule);
+	}
+
+	//Nothing is cached yet
+	modelRevision = 1;
+	cachedRevision = 0;
+	currStamp = 0;
+	reset();
+}
+
+
+void TrigramLookup::loadJsonModel(const string& buffer)
+{
+	//The json reader works on UTF-8 directly, so there's no need to round-trip through
+	//  wide characters; we just make sure the stream is valid.
+	Utf8Decoder::Decode(buffer.data(), buffer.size(), NULL);
 
 	//Now, read it into a json object
 	Json::Value fileRoot;
 	{
 		Json::Reader reader;
-		if (!reader.parse(waitzar::wcs2mbs(buffer), fileRoot))
+		if (!reader.parse(buffer, fileRoot))
 			throw std::runtime_error("Can't parse TrigramLookup model file/stream!");
 		if (!fileRoot.isObject())
 			throw std::runtime_error("Can't parse TrigramLookup model: JSON root is not an object!");
@@ -43,12 +144,12 @@ TrigramLookup::TrigramLookup(const string& modelBufferOrFile, bool stringIsBuffe
 	if (!dictObj.isArray())
 		throw std::runtime_error("Can't parse TrigramLookup model: \"words\" is not an array.");
 	for (auto it=dictObj.begin(); it!=dictObj.end(); it++) {
-	//for (size_t i=0; i<dictObj.size(); i++) {
 		if (!(*it).isString())
 			throw std::runtime_error("Can't parse TrigramLookup model: \"words\" contains a non-string entry.");
 		wstring word = waitzar::mbs2wcs((*it).asString());
-		words.push_back(word);
+		tables.words.pushRow(word.c_str(), word.size());
 	}
+	tables.wordHash.pushRow(buildWordHash(tables.words));
 
 	//REQUIRED: Lookup table
 	if (std::find(rootKeys.begin(), rootKeys.end(), "lookup")==rootKeys.end())
@@ -56,17 +157,41 @@ TrigramLookup::TrigramLookup(const string& modelBufferOrFile, bool stringIsBuffe
 	Json::Value lookupObj = fileRoot["lookup"];
 	if (!lookupObj.isObject())
 		throw std::runtime_error("Can't parse TrigramLookup model: \"lookup\" is not an object.");
-	buildLookupRecursively("", lookupObj, lookup);
+	{
+		//Nodes are numbered in the order we find them, so the root is node 0.
+		vector< vector<unsigned int> > links(1);
+		vector< vector<unsigned int> > matched(1);
+		map<wstring, string> revLookup;
+		buildLookupRecursively("", lookupObj, 0, links, matched, revLookup);
+		tables.trie.reserve(links.size());
+		for (size_t i=0; i<links.size(); i++) {
+			tables.trie.pushNode(links[i]);
+			tables.nodeWords.pushRow(matched[i]);
+		}
+
+		//Only the first of any duplicate words gets a romanization.
+		for (size_t i=0; i<tables.words.size(); i++) {
+			FlatRow<wchar_t> word = tables.words[i];
+			wstring myanmar(word.begin(), word.end());
+			auto it = revLookup.find(myanmar);
+			if (it!=revLookup.end() && findWordID(myanmar)==(int)i)
+				tables.romans.pushRow(it->second.c_str(), it->second.size());
+			else
+				tables.romans.pushRow();
+		}
+	}
 
 	//OPTIONAL: n-grams prefix lookups
 	if (std::find(rootKeys.begin(), rootKeys.end(), "ngrams")!=rootKeys.end()) {
 		Json::Value ngramObj = fileRoot["ngrams"];
 		if (!ngramObj.isObject())
 			throw std::runtime_error("Can't parse TrigramLookup model: \"ngrams\" is not an object.");
+		map<vector<unsigned int>, vector<unsigned int> > ngrams;
 		auto romanKeys = ngramObj.getMemberNames();
 		for (auto romanIt=romanKeys.begin(); romanIt!=romanKeys.end(); romanIt++) {
 			if (romanIt->empty())
 				throw std::runtime_error("Can't parse TrigramLookup model: \"ngrams\" contains an empty romanized key.");
+			int romanNode = walkRomanizedString(*romanIt);
 			Json::Value matchesObj = ngramObj[*romanIt];
 			if (!matchesObj.isObject())
 				throw std::runtime_error("Can't parse TrigramLookup model: \"ngrams\" contains a non-object ngram.");
@@ -81,14 +206,33 @@ TrigramLookup::TrigramLookup(const string& modelBufferOrFile, bool stringIsBuffe
 				for (auto it=mmResultObj.begin(); it!=mmResultObj.end(); it++) {
 					if (!(*it).isIntegral())
 						throw std::runtime_error("Can't parse TrigramLookup model: \"ngrams\" referenes a non-integral reordering.");
+					if ((*it).asUInt()>=tables.words.size())
+						throw std::runtime_error("Can't parse TrigramLookup model: \"ngrams\" references a word that doesn't exist.");
 					reorder.push_back((*it).asUInt());
 				}
 
-				//Add it
-				ngrams[*romanIt][waitzar::mbs2wcs(*mmIt)] = reorder;
+				//Intern it. We can only ever reach n-grams whose romanization is in the trie, and
+				//  whose previous words (at most three) are in the dictionary. The trie ignores case, but
+				//  n-grams never have: typing capitals matches no n-gram, so a key with capitals can't be reached.
+				vector<unsigned int> key(1, romanNode);
+				wstring context = waitzar::mbs2wcs(*mmIt);
+				bool reachable = romanNode!=-1 && !hasUpper(*romanIt);
+				for (size_t start=0; start<=context.size() && reachable; ) {
+					size_t end = std::min(context.find(L'/', start), context.size());
+					int wordID = findWordID(context.substr(start, end-start));
+					reachable = wordID!=-1 && key.size()<=3;
+					key.push_back(wordID);
+					start = end+1;
+				}
+				if (!reachable)
+					continue;
+				key.resize(4, (unsigned int)TrigramTables::NoWord);
+				ngrams[key] = reorder;
 			}
 		}
-	}
+		buildNgramHash(ngrams);
+	} else
+		buildNgramHash(map<vector<unsigned int>, vector<unsigned int> >());
 
 	//OPTIONAL: Last-chance recovery regexes
 	if (std::find(rootKeys.begin(), rootKeys.end(), "lastchance")!=rootKeys.end()) {
@@ -98,8 +242,8 @@ TrigramLookup::TrigramLookup(const string& modelBufferOrFile, bool stringIsBuffe
 		for (auto it=lcObj.begin(); it!=lcObj.end(); it++) {
 			if (!(*it).isString())
 				throw std::runtime_error("Can't parse TrigramLookup model: \"lastchance\" contains a non-string entry.");
-			wstring recover = waitzar::mbs2wcs((*it).asString());
-			lastChanceRegexes.push_back(recover);
+			string recover = waitzar::escape_wstr(waitzar::mbs2wcs((*it).asString()));
+			tables.lastChance.pushRow(recover.c_str(), recover.size());
 		}
 	}
 
@@ -108,6 +252,7 @@ TrigramLookup::TrigramLookup(const string& modelBufferOrFile, bool stringIsBuffe
 		Json::Value shortcutObj = fileRoot["shortcuts"];
 		if (!shortcutObj.isObject())
 			throw std::runtime_error("Can't parse TrigramLookup model: \"shortcuts\" is not an object.");
+		map<wstring, wstring> shortcuts;
 		auto baseKeys = shortcutObj.getMemberNames();
 		for (auto baseIt=baseKeys.begin(); baseIt!=baseKeys.end(); baseIt++) {
 			if (baseIt->empty())
@@ -124,14 +269,15 @@ TrigramLookup::TrigramLookup(const string& modelBufferOrFile, bool stringIsBuffe
 					throw std::runtime_error("Can't parse TrigramLookup model: \"shortcuts\" contains a non-string result value.");
 
 				//Add it
-				shortcuts[waitzar::mbs2wcs(*baseIt)][waitzar::mbs2wcs(*stackedIt)] = waitzar::mbs2wcs(mmResultObj.asString());
+				shortcuts[makeKey(waitzar::mbs2wcs(*baseIt), waitzar::mbs2wcs(*stackedIt))] = waitzar::mbs2wcs(mmResultObj.asString());
 			}
 		}
+		fillKeyTable(shortcuts, tables.shortcutKeys, tables.shortcutValues);
 	}
 }
 
 
-void TrigramLookup::buildLookupRecursively(string roman, Json::Value& currObj, Nexus& currNode)
+void TrigramLookup::buildLookupRecursively(const string& roman, Json::Value& currObj, unsigned int currNode, vector< vector<unsigned int> >& links, vector< vector<unsigned int> >& matched, map<wstring, string>& revLookup)
 {
 	auto keys = currObj.getMemberNames();
 	for (auto it=keys.begin(); it!=keys.end(); it++) {
@@ -149,139 +295,324 @@ void TrigramLookup::buildLookupRecursively(string roman, Json::Value& currObj, N
 			for (auto wordID=nextObj.begin(); wordID!=nextObj.end(); wordID++) {
 				if (!(*wordID).isIntegral())
 					throw std::runtime_error("Can't parse TrigramLookup model: \"lookup\" contains a non-integral value.");
-				currNode.matchedWords.push_back((*wordID).asUInt());
+				if ((*wordID).asUInt()>=tables.words.size())
+					throw std::runtime_error("Can't parse TrigramLookup model: \"lookup\" references a word that doesn't exist.");
+				matched[currNode].push_back((*wordID).asUInt());
 
 				//Update the reverse lookup
-				wstring myanmar = words[(*wordID).asUInt()];
-				if (revLookup.count(myanmar)==0)
-					revLookup[myanmar] =  roman;
+				FlatRow<wchar_t> myanmar = tables.words[(*wordID).asUInt()];
+				revLookup.insert(std::make_pair(wstring(myanmar.begin(), myanmar.end()), roman));
 			}
 		} else {
 			//Append the key, and a blank node for it
-			currNode.moveOn += key;
-			currNode.moveTo.push_back(Nexus());
+			unsigned int nextNode = links.size();
+			links[currNode].push_back(NexusTrie::Pack(nextNode, key[0]));
+			links.push_back(vector<unsigned int>());
+			matched.push_back(vector<unsigned int>());
 
 			//Recurse
 			if (!nextObj.isObject())
 				throw std::runtime_error("Can't parse TrigramLookup model: \"lookup\" contains a non-object entry.");
-			buildLookupRecursively(roman+key, nextObj, currNode.moveTo[currNode.moveTo.size()-1]);
+			buildLookupRecursively(roman+key, nextObj, nextNode, links, matched, revLookup);
 		}
 	}
+}
+
+
+//Joins the parts of an ngram or shortcut key
+wstring TrigramLookup::makeKey(const wstring& prefix, const wstring& suffix)
+{
+	return prefix + wstring(1, TrigramTables::KeySeparator) + suffix;
+}
+
+
+//Compare a key row against makeKey(prefix, suffix), without building that key.
+//  With prefixOnly, any row that starts with the key is considered equal to it.
+int TrigramLookup::compareKey(const FlatRow<wchar_t>& row, const wstring& prefix, const wchar_t* suffix, size_t suffixLen, bool prefixOnly)
+{
+	const wchar_t separator = TrigramTables::KeySeparator;
+	size_t keyLen = prefix.size() + 1 + suffixLen;
+	for (size_t i=0; i<row.size() && i<keyLen; i++) {
+		wchar_t letter = i<prefix.size() ? prefix[i] : i==prefix.size() ? separator : suffix[i-prefix.size()-1];
+		if (row[i]!=letter)
+			return row[i]<letter ? -1 : 1;
+	}
+	if (row.size()<keyLen)
+		return -1;
+	return (row.size()==keyLen || prefixOnly) ? 0 : 1;
+}
+
 
+//Binary search over rows [first, last) of a sorted key table for makeKey(prefix, suffix). Returns the row ID, or -1.
+int TrigramLookup::findKey(const FlatTable<wchar_t>& keys, size_t first, size_t last, const wstring& prefix, const wchar_t* suffix, size_t suffixLen)
+{
+	while (first<last) {
+		size_t mid = first + (last-first)/2;
+		int cmp = compareKey(keys[mid], prefix, suffix, suffixLen, false);
+		if (cmp==0)
+			return mid;
+		if (cmp<0)
+			first = mid+1;
+		else
+			last = mid;
+	}
+	return -1;
+}
+
+
+//Find the rows [first, last) of a sorted key table that start with makeKey(prefix, L"").
+void TrigramLookup::findKeyRange(const FlatTable<wchar_t>& keys, const wstring& prefix, size_t& first, size_t& last)
+{
+	size_t low = 0;
+	size_t high = keys.size();
+	while (low<high) {
+		size_t mid = low + (high-low)/2;
+		if (compareKey(keys[mid], prefix, NULL, 0, true)<0)
+			low = mid+1;
+		else
+			high = mid;
+	}
+	first = low;
+	for (high=keys.size(); low<high;) {
+		size_t mid = low + (high-low)/2;
+		if (compareKey(keys[mid], prefix, NULL, 0, true)<=0)
+			low = mid+1;
+		else
+			high = mid;
+	}
+	last = low;
+}
+
+
+//Mixes the parts of an n-gram key
+unsigned int TrigramLookup::HashNgram(unsigned int node, unsigned int ultimate, unsigned int penultimate, unsigned int antepenultimate)
+{
+	unsigned int res = 2166136261U;
+	res = (res^node) * 16777619U;
+	res = (res^ultimate) * 16777619U;
+	res = (res^penultimate) * 16777619U;
+	res = (res^antepenultimate) * 16777619U;
+	return res ^ (res>>15);
+}
+
+
+//Returns the row of ngramValues for this key, or -1
+int TrigramLookup::findNgram(unsigned int node, unsigned int ultimate, unsigned int penultimate, unsigned int antepenultimate) const
+{
+	FlatRow<unsigned int> slots = tables.ngramHash[0];
+	unsigned int numSlots = slots.size()/TrigramTables::NgramSlotSize;
+	if (numSlots==0)
+		return -1;
+
+	//Linear probing; the table is never full, so we'll always hit an empty slot.
+	for (unsigned int id=HashNgram(node, ultimate, penultimate, antepenultimate)&(numSlots-1);; id=(id+1)&(numSlots-1)) {
+		const unsigned int* slot = &slots[id*TrigramTables::NgramSlotSize];
+		if (slot[0]==TrigramTables::NoWord)
+			return -1;
+		if (slot[0]==node && slot[1]==ultimate && slot[2]==penultimate && slot[3]==antepenultimate)
+			return slot[4];
+	}
+}
+
+
+//Build the n-gram hash table and values from a map of {node, w1, w2, w3} => word IDs
+void TrigramLookup::buildNgramHash(const map<vector<unsigned int>, vector<unsigned int> >& ngrams)
+{
+	//At most half full
+	unsigned int numSlots = 1;
+	while (numSlots < ngrams.size()*2)
+		numSlots *= 2;
+	vector<unsigned int> slots(numSlots*TrigramTables::NgramSlotSize, (unsigned int)TrigramTables::NoWord);
+
+	for (auto it=ngrams.begin(); it!=ngrams.end(); it++) {
+		const vector<unsigned int>& key = it->first;
+		unsigned int id = HashNgram(key[0], key[1], key[2], key[3])&(numSlots-1);
+		while (slots[id*TrigramTables::NgramSlotSize]!=TrigramTables::NoWord)
+			id = (id+1)&(numSlots-1);
+		std::copy(key.begin(), key.end(), slots.begin()+id*TrigramTables::NgramSlotSize);
+		slots[id*TrigramTables::NgramSlotSize+4] = tables.ngramValues.size();
+		tables.ngramValues.pushRow(it->second);
+	}
+	tables.ngramHash.pushRow(slots);
+}
 
 
+//Returns the lowest ID of this word, or -1
+int TrigramLookup::findWordID(const wstring& word) const
+{
+	const wchar_t* begin = word.c_str();
+	unsigned int id = *findWordSlot(tables.words, tables.wordHash[0], begin, begin+word.size());
+	if (id!=TrigramTables::NoWord)
+		return id;
+
+	//Added later?
+	auto it = extraWordIDs.find(word);
+	if (it!=extraWordIDs.end())
+		return it->second;
+	return -1;
 }
 
+
 //Add a word from a non-model file.
 bool TrigramLookup::addRomanizationToModel(const string& roman, const wstring& myanmar, bool errorOnDuplicates)
 {
 	//Step 1: Do we need to add it? (Also, retrieve its ID)
-	size_t currWordID = 0;
-	for (; currWordID<words.size(); currWordID++) {
-		if (words[currWordID] == myanmar)
-			break;
+	int currWordID = findWordID(myanmar);
+	if (currWordID==-1) {
+		tables.words.pushRow(myanmar.c_str(), myanmar.size());
+		tables.romans.pushRow();
+		currWordID = tables.words.size()-1;
+		extraWordIDs[myanmar] = currWordID;
 	}
-	if (currWordID==words.size())
-		words.push_back(myanmar);
 
 	//Update the reverse lookup?
-	if (revLookup.count(myanmar)==0)
-		revLookup[myanmar] =  roman;
+	if (tables.romans[currWordID].empty()) {
+		for (auto ch=roman.begin(); ch!=roman.end(); ch++)
+			tables.romans.append(currWordID, *ch);
+	}
 
 	//Step 2: Update the nexus path to this romanization
-	Nexus* currNode = &lookup;
+	unsigned int currNode = 0;
 	for (auto ch=roman.begin(); ch!=roman.end(); ch++) {
 		//Add a path if needed
-		if (currNode->getMoveID(*ch)==-1) {
-			currNode->moveOn = currNode->moveOn + string(1, *ch);
-			currNode->moveTo.push_back(Nexus());
+		int nextNode = tables.trie.jump(currNode, toLower(*ch));
+		if (nextNode==-1) {
+			nextNode = tables.trie.addNode();
+			tables.nodeWords.pushRow();
+			tables.trie.addLink(currNode, toLower(*ch), nextNode);
 		}
 
 		//Advance
-		currNode = &currNode->moveTo[currNode->getMoveID(*ch)];
+		currNode = nextNode;
 	}
 
 	//Step 3: Add this word's ID
-	if (std::find(currNode->matchedWords.begin(), currNode->matchedWords.end(), currWordID)==currNode->matchedWords.end())
-		currNode->matchedWords.push_back(currWordID);
+	FlatRow<unsigned int> matched = tables.nodeWords[currNode];
+	if (std::find(matched.begin(), matched.end(), (unsigned int)currWordID)==matched.end())
+		tables.nodeWords.append(currNode, currWordID);
 
+	//Our cached words may point to rows that have moved.
+	modelRevision++;
+	cacheDirty = true;
 	return true;
-
 }
 
 
 bool TrigramLookup::addShortcut(const wstring& baseWord, const wstring& toStack, const wstring& resultStacked)
 {
-	//Add/Get
-	shortcuts[baseWord][toStack] = resultStacked;
+	//Add/Get. These take precedence over the model's shortcuts.
+	extraShortcuts[makeKey(baseWord, toStack)] = resultStacked;
+	modelRevision++;
+	cacheDirty = true;
 
 	return true;
 }
 
 
-//TODO: We might merge this with "continueLookup" somehow.
-Nexus* TrigramLookup::walkRomanizedString(const std::string& roman)
+string TrigramLookup::reverseLookupWord(const wstring& myanmar) const
 {
-	if (roman.empty())
-		return false;
+	int wordID = findWordID(myanmar);
+	if (wordID==-1)
+		return "";
+	FlatRow<char> roman = tables.romans[wordID];
+	return string(roman.begin(), roman.end());
+}
 
-	Nexus* retNexus = &lookup;
-	for (auto ch=roman.begin(); ch!=roman.end(); ch++) {
-		//Does an entry exist?
-		int id = retNexus->getMoveID(*ch);
-		if (id==-1)
-			return NULL;
 
-		//Jump to that entry
-		retNexus = &retNexus->moveTo[id];
+void TrigramLookup::saveBinaryModel(const string& path) const
+{
+	//Attached tables are shared, not copied; we only rebuild the ones that don't support later additions.
+	TrigramTables res = tables;
+	res.wordHash.clear();
+	res.wordHash.pushRow(buildWordHash(tables.words));
+
+	if (!extraShortcuts.empty()) {
+		map<wstring, wstring> shortcuts;
+		for (size_t i=0; i<tables.shortcutKeys.size(); i++) {
+			FlatRow<wchar_t> key = tables.shortcutKeys[i];
+			FlatRow<wchar_t> value = tables.shortcutValues[i];
+			shortcuts[wstring(key.begin(), key.end())] = wstring(value.begin(), value.end());
+		}
+		for (auto it=extraShortcuts.begin(); it!=extraShortcuts.end(); it++)
+			shortcuts[it->first] = it->second;
+		res.shortcutKeys.clear();
+		res.shortcutValues.clear();
+		fillKeyTable(shortcuts, res.shortcutKeys, res.shortcutValues);
 	}
 
-	//Done
-	return retNexus;
+	BinaryTrigramModel::Write(path, res);
 }
 
 
-//Apply a pattern.
-string TrigramLookup::getAltString(const string& orig, const string& pattern)
+//Walk a romanization from the root. Returns -1 if it's not in the trie.
+int TrigramLookup::walkRomanizedString(const std::string& roman)
 {
-	//Avoid weird behavior.
-	if (orig.empty() || pattern.empty())
-		return "";
+	if (roman.empty())
+		return -1;
 
-	//Now, break the regex apart. (TODO: We can cache this in the "init" phase, and throw an exception on error)
-	size_t eqID = pattern.find(L'=');
+	int retNode = 0;
+	for (auto ch=roman.begin(); ch!=roman.end() && retNode!=-1; ch++)
+		retNode = tables.trie.jump(retNode, toLower(*ch));
+
+	//Done
+	return retNode;
+}
+
+
+//Compile a last-chance pattern. Returns false (and the pattern is ignored) if it's malformed.
+bool TrigramLookup::CompileLastChance(const string& pattern, LastChanceRule& rule)
+{
+	//Break the regex apart.
+	size_t eqID = pattern.find('=');
 	if (eqID==string::npos || eqID==0 || eqID==pattern.size()-1)
-		return "";
+		return false;
 	string lhs = pattern.substr(0, eqID);
-	string rhs = pattern.substr(eqID+1, pattern.size());
+	rule.replacement = pattern.substr(eqID+1, pattern.size());
 
-	//Now, attempt to apply it.
-	// We match from right-to-left starting at the end of the string. Each character consumes
-	//   a single character in the original string, except "?" which makes the next character
-	//   optional (in the greedy sense of the word).
-	int dotID = orig.size()-1; //dotID can go negative, we just can't match anything at that point.
+	//Each character consumes a single character in the original string, except "?" which
+	//  makes the previous character optional.
+	rule.letters.clear();
+	rule.optional.clear();
 	for (auto it=lhs.rbegin(); it!=lhs.rend(); it++) {
 		bool optional = false;
 		if (*it == '?') {
 			optional = true;
 			it++;
 			if (it==lhs.rend() || *it == '?')
-				return ""; //Can't have '??' or trailing '?'
+				return false; //Can't have '??' or trailing '?'
 		}
-
-		if (dotID>=0 && orig[dotID] == *it) {
-			dotID--;
-		} else if (!optional)
-			return ""; //No match.
+		rule.letters += *it;
+		rule.optional.push_back(optional);
 	}
+	return true;
+}
 
-	//Should never happen, but...
-	if (dotID<-1)
-		return "";
 
-	//Done! Now substitute
-	string prefix = orig.substr(0, dotID+1);
-	return prefix + rhs;
+//Apply a compiled pattern to typedRoman+letter, and return the node the result leads to (or -1).
+int TrigramLookup::applyLastChance(const LastChanceRule& rule, char letter) const
+{
+	// We match from right-to-left starting at the end of the string. Optional characters
+	//   are matched greedily.
+	size_t len = typedRoman.size()+1;
+	size_t dot = len; //Number of characters not yet consumed
+	for (size_t i=0; i<rule.letters.size(); i++) {
+		if (dot>0 && (dot==len ? letter : typedRoman[dot-1])==rule.letters[i])
+			dot--;
+		else if (!rule.optional[i])
+			return -1; //No match.
+	}
+
+	//The rest of the typed string has already been walked; pick up where it left off.
+	int node = -1;
+	if (dot<len)
+		node = typedNodes[dot];
+	else if (typedNodes.back()!=-1)
+		node = tables.trie.jump(typedNodes.back(), toLower(letter));
+
+	//Now substitute
+	for (auto ch=rule.replacement.begin(); ch!=rule.replacement.end() && node!=-1; ch++)
+		node = tables.trie.jump(node, toLower(*ch));
+	return node;
 }
 
 
@@ -293,54 +624,51 @@ bool TrigramLookup::continueLookup(const string& roman)
 		return false;
 
 	//Where were we _exactly_ ?
-	if (actualLookup!=NULL) {
+	if (actualLookup!=-1) {
 		currLookup = actualLookup;
-		actualLookup = NULL;
+		actualLookup = -1;
 	}
 
 	//Apply to each letter
 	bool found = true;
 	for (auto ch=roman.begin(); ch!=roman.end(); ch++) {
 		//Does an entry exist?
-		int id = currLookup->getMoveID(*ch);
-		Nexus* nextNexus = NULL;
-		if (id!=-1)
-			nextNexus = &currLookup->moveTo[id];
-		else {
+		int nextNode = tables.trie.jump(currLookup, toLower(*ch));
+		if (nextNode==-1) {
 			//Last-chance matches.
-			for (auto it=lastChanceRegexes.begin(); it!=lastChanceRegexes.end() && nextNexus==NULL; it++) {
-				string altString = getAltString(typedRoman+string(1, *ch), waitzar::escape_wstr(*it));
-				nextNexus = walkRomanizedString(altString);
-			}
+			for (auto it=lastChanceRules.begin(); it!=lastChanceRules.end() && nextNode==-1; it++)
+				nextNode = applyLastChance(*it, *ch);
 		}
 
 		//Can't move?
-		if (nextNexus==NULL) {
+		if (nextNode==-1) {
 			found = false;
 			break;
 		}
 
 		//Jump
-		currLookup = nextNexus;
+		currLookup = nextNode;
 
 		//Append
-		typedRoman += string(1, *ch);
+		typedRoman += *ch;
+		typedNodes.push_back(typedNodes.back()==-1 ? -1 : tables.trie.jump(typedNodes.back(), toLower(*ch)));
 	}
 
 	//Reset trigrams, cache
-	currNgram = NULL;
-	currShortcutLookup = NULL;
+	currNgram = -1;
+	currShortcutBase.clear();
 	cacheDirty = true;
 
 	//Perform a "skip ahead"
 	//Paren string
 	cachedParenStr = "(";
-	Nexus* parenLookup = currLookup;
-	while (parenLookup->moveOn.size()==1) {
-		cachedParenStr += parenLookup->moveOn;
-		parenLookup = &parenLookup->moveTo[0];
+	unsigned int parenLookup = currLookup;
+	while (tables.trie[parenLookup].size()==1) {
+		unsigned int link = tables.trie[parenLookup][0];
+		cachedParenStr += string(1, NexusTrie::Letter(link));
+		parenLookup = NexusTrie::Target(link);
 	}
-	if (parenLookup->moveOn.empty() && !parenLookup->matchedWords.empty()) {
+	if (tables.trie[parenLookup].empty() && !tables.nodeWords[parenLookup].empty()) {
 		cachedParenStr += ")";
 		actualLookup = currLookup;
 		currLookup = parenLookup;
@@ -360,51 +688,68 @@ bool TrigramLookup::moveLookupOnTrigram(const std::wstring& ultimate, const std:
 	resolvePatSint(ultimate);
 
 	//Reset
-	currNgram = NULL;
+	currNgram = -1;
 	cacheDirty = true;
 
-	//Jump
-	auto pairs = ngrams.find(typedRoman);
-	if (pairs==ngrams.end())
+	//Only words in the dictionary can be part of an n-gram. N-grams are keyed on the literal
+	//  romanization, so (unlike the trie) typing any capital letters matches none of them.
+	int typedNode = typedNodes.back();
+	if (typedNode==-1 || ultimate.empty() || hasUpper(typedRoman))
+		return false;
+	int ult = findWordID(ultimate);
+	int penult = (ult==-1 || penultimate.empty()) ? -1 : findWordID(penultimate);
+	int antepenult = (penult==-1 || antepenultimate.empty()) ? -1 : findWordID(antepenultimate);
+	if (ult==-1)
 		return false;
 
-	//Make a list of candidates to try
-	vector<wstring> attempts;
-	if (!ultimate.empty()) {
-		if (!penultimate.empty()) {
-			if (!antepenultimate.empty())
-				attempts.push_back(ultimate+L"/"+penultimate+L"/"+antepenultimate);
-			attempts.push_back(ultimate+L"/"+penultimate);
-		}
-		attempts.push_back(ultimate);
-	}
-
-	//Try each candidate
-	for (auto it=attempts.begin(); it!=attempts.end(); it++) {
-		auto match = pairs->second.find(*it);
-		if (match!=pairs->second.end()) {
-			currNgram = &(match->second);
-			return true;
-		}
-	}
-
-	//Nothing matched.
-	return false;
+	//Try the longest match first
+	if (antepenult!=-1)
+		currNgram = findNgram(typedNode, ult, penult, antepenult);
+	if (currNgram==-1 && penult!=-1)
+		currNgram = findNgram(typedNode, ult, penult, TrigramTables::NoWord);
+	if (currNgram==-1)
+		currNgram = findNgram(typedNode, ult, TrigramTables::NoWord, TrigramTables::NoWord);
+	return currNgram!=-1;
 }
 
 
 
 void TrigramLookup::resolvePatSint(const wstring& prevWord)
 {
-	currShortcutLookup = NULL;
+	currShortcutBase.clear();
+	shortcutFirst = shortcutLast = 0;
 
 	if (prevWord.empty())
 		return;
 
-	//Retrieve this entry from the shortcut table
-	auto options = shortcuts.find(prevWord);
-	if (options!=shortcuts.end())
-		currShortcutLookup = &(options->second);
+	//Does this word have any entries in the shortcut table?
+	findKeyRange(tables.shortcutKeys, prevWord, shortcutFirst, shortcutLast);
+	bool found = shortcutFirst!=shortcutLast;
+	if (!found && !extraShortcuts.empty()) {
+		wstring prefix = makeKey(prevWord, L"");
+		auto it = extraShortcuts.lower_bound(prefix);
+		found = it!=extraShortcuts.end() && it->first.compare(0, prefix.size(), prefix)==0;
+	}
+	if (found)
+		currShortcutBase = prevWord;
+}
+
+
+bool TrigramLookup::findShortcut(const FlatRow<wchar_t>& word, FlatRow<wchar_t>& result) const
+{
+	if (!extraShortcuts.empty()) {
+		auto extra = extraShortcuts.find(makeKey(currShortcutBase, wstring(word.begin(), word.end())));
+		if (extra!=extraShortcuts.end()) {
+			result = FlatRow<wchar_t>(extra->second.c_str(), extra->second.c_str()+extra->second.size());
+			return true;
+		}
+	}
+
+	int row = findKey(tables.shortcutKeys, shortcutFirst, shortcutLast, currShortcutBase, word.begin(), word.size());
+	if (row==-1)
+		return false;
+	result = tables.shortcutValues[row];
+	return true;
 }
 
 
@@ -413,47 +758,75 @@ void TrigramLookup::resolvePatSint(const wstring& prevWord)
 /**
  * Based on the current nexus, what letters are valid moves, and what words
  *   should we present to the user?
+ * This only deals in word IDs; views into the model are made when they're asked for.
  */
 void TrigramLookup::rebuildCachedResults()
 {
 	//Only once
 	if (!cacheDirty)
 		return;
+	cacheDirty = false;
 
-	//Add prefixes
+	//Moving around often lands us back where we started (e.g., continueLookup() followed by
+	//  moveLookupOnTrigram() with no n-gram), so don't rebuild unless something changed.
+	//Shortcuts added at runtime aren't in the shortcut table's rows, so we can't tell if those changed.
+	if (cachedRevision==modelRevision && cachedNode==currLookup && cachedNgram==currNgram && cachedShortcutFirst==shortcutFirst && cachedShortcutLast==shortcutLast && extraShortcuts.empty())
+		return;
+	cachedRevision = modelRevision;
+	cachedNode = currLookup;
+	cachedNgram = currNgram;
+	cachedShortcutFirst = shortcutFirst;
+	cachedShortcutLast = shortcutLast;
 	cachedMatchedWords.clear();
-	std::set<unsigned int> normalWordIDs;
-	if (currNgram!=NULL) {
-		for (auto it=currNgram->begin(); it!=currNgram->end(); it++) {
-			cachedMatchedWords.push_back(words[*it]);
-			normalWordIDs.insert(*it);
-		}
+
+	//Start a new generation of stamps
+	if (wordStamps.size()<tables.words.size())
+		wordStamps.resize(tables.words.size(), 0);
+	if (++currStamp==0) {
+		std::fill(wordStamps.begin(), wordStamps.end(), 0);
+		currStamp = 1;
+	}
+
+	//Add prefixes
+	cachedWordIDs.clear();
+	if (currNgram!=-1) {
+		FlatRow<unsigned int> ngram = tables.ngramValues[currNgram];
+		cachedWordIDs.insert(cachedWordIDs.end(), ngram.begin(), ngram.end());
+		for (auto it=ngram.begin(); it!=ngram.end(); it++)
+			wordStamps[*it] = currStamp;
 	}
 
 	//Add words
-	for (auto it=currLookup->matchedWords.begin(); it!=currLookup->matchedWords.end(); it++) {
-		if (normalWordIDs.count(*it)>0)
-			continue;
-		cachedMatchedWords.push_back(words[*it]);
-	}
-
-	//Build up shortcut words
-	vector<wstring> shortcutWords;
-	if (currShortcutLookup!=NULL) {
-		for (auto it=cachedMatchedWords.begin(); it!=cachedMatchedWords.end(); it++) {
-			auto pat = currShortcutLookup->find(*it);
-			if (pat!=currShortcutLookup->end()) {
-				shortcutWords.push_back(pat->second);
-			}
+	FlatRow<unsigned int> matched = tables.nodeWords[currLookup];
+	for (auto it=matched.begin(); it!=matched.end(); it++) {
+		if (wordStamps[*it]!=currStamp)
+			cachedWordIDs.push_back(*it);
+	}
+
+	//Build up shortcut words; these go in front.
+	cachedShortcutWords.clear();
+	if (!currShortcutBase.empty()) {
+		for (auto it=cachedWordIDs.begin(); it!=cachedWordIDs.end(); it++) {
+			FlatRow<wchar_t> pat;
+			if (findShortcut(tables.words[*it], pat))
+				cachedShortcutWords.push_back(pat);
 		}
 	}
 
-	//Matched+Shortcuts, StartID
-	cachedMatchedWords.insert(cachedMatchedWords.begin(), shortcutWords.begin(), shortcutWords.end());
-	cachedStartID = shortcutWords.size();
+	//StartID
+	cachedStartID = cachedShortcutWords.size();
+}
 
-	//Done
-	cacheDirty = false;
+
+//Produce strings for only the candidates the user can see.
+void TrigramLookup::getMatchedPage(size_t first, size_t count, vector<wstring>& page)
+{
+	page.clear();
+	size_t total = getMatchedWordCount();
+	for (size_t id=first; id<total && id<first+count; id++) {
+		FlatRow<wchar_t> word = getMatchedWord(id);
+		page.push_back(wstring(word.begin(), word.end()));
+	}
 }
 
 
@@ -13,9 +13,13 @@
 #include <map>
 #include <set>
 #include <vector>
+#include <memory>
 #include <stdexcept>
 
 #include "NGram/wz_utilities.h"
+#include "NGram/FlatTable.h"
+#include "NGram/NexusTrie.h"
+#include "NGram/BinaryTrigramModel.h"
 #include "Json CPP/json.h"
 
 
@@ -23,39 +27,17 @@
 namespace waitzar
 {
 
-//Helper class
-class Nexus {
-public:
-	std::string moveOn;
-	std::vector<Nexus> moveTo;
-
-	std::vector<unsigned int> matchedWords;
-
-	int getMoveID(char c) {
-		//Convert to lowercase
-		if (c>='A'&&c<='Z')
-			c = (c-'A')+'a';
-
-		//Search
-		size_t x = 0;
-		for (; x<moveOn.size(); x++) {
-			if (moveOn[x]==c)
-				return x;
-		}
-		return -1;
-	}
-};
-
-
 
 /**
  * This class replaces WordBuilder with something more focused: it only deals with
  *    loading our binary model file and looking up candidates. Selection of these
  *    candidates is handled separately.
+ * The model may be either JSON or compiled (see BinaryTrigramModel); compiled models are
+ *    used in place, so matched words are just views into the mapped file.
  */
 class TrigramLookup {
 public:
-	//Construct from an in-memory stream or a *.model file.
+	//Construct from an in-memory stream or a model file (JSON or compiled).
 	TrigramLookup(const std::string& modelBufferOrFile, bool stringIsBuffer=false);
 
 	//Adding words to the model
@@ -82,11 +64,29 @@ public:
 		);
 	}
 
-	//Retrieving words
-	const std::vector<std::wstring>& getMatchedWords() {
+	//Retrieving words. These point into the model; they are valid until the model is modified.
+	//Candidates are kept as word IDs; getMatchedWords() builds the full list of views the first
+	//  time it's asked for, while getMatchedWord() and getMatchedPage() only touch what they return.
+	const std::vector<FlatRow<wchar_t> >& getMatchedWords() {
 		rebuildCachedResults();
+		if (cachedMatchedWords.size()!=getMatchedWordCount()) {
+			cachedMatchedWords.assign(cachedShortcutWords.begin(), cachedShortcutWords.end());
+			for (auto it=cachedWordIDs.begin(); it!=cachedWordIDs.end(); it++)
+				cachedMatchedWords.push_back(tables.words[*it]);
+		}
 		return cachedMatchedWords;
 	}
+	size_t getMatchedWordCount() {
+		rebuildCachedResults();
+		return cachedShortcutWords.size() + cachedWordIDs.size();
+	}
+	FlatRow<wchar_t> getMatchedWord(size_t id) {
+		rebuildCachedResults();
+		if (id<cachedShortcutWords.size())
+			return cachedShortcutWords[id];
+		return tables.words[cachedWordIDs.at(id-cachedShortcutWords.size())];
+	}
+	void getMatchedPage(size_t first, size_t count, std::vector<std::wstring>& page);
 	size_t getMatchedDefaultIndex() {
 		rebuildCachedResults();
 		return cachedStartID;
@@ -98,22 +98,22 @@ public:
 
 	//Additional useful methods
 	size_t getTotalDefinedNonShortcutWords() {
-		return words.size();
-	}
-	std::string reverseLookupWord(const std::wstring& myanmar) {
-		auto it = revLookup.find(myanmar);
-		if (it!=revLookup.end())
-			return it->second;
-		return "";
+		return tables.words.size();
 	}
+	std::string reverseLookupWord(const std::wstring& myanmar) const;
+
+	//Save the current model (including any added words) in the compiled format.
+	void saveBinaryModel(const std::string& path) const;
 
 
 	//TODO:
 	void reset() {
-		currLookup = &lookup;
-		actualLookup = NULL;
-		currNgram = NULL;
-		currShortcutLookup = NULL;
+		currLookup = 0;
+		actualLookup = -1;
+		typedNodes.assign(1, 0);
+		currNgram = -1;
+		currShortcutBase.clear();
+		shortcutFirst = shortcutLast = 0;
 		typedRoman = "";
 		cacheDirty = true;
 	}
@@ -121,37 +121,76 @@ public:
 
 
 private:
-	//Primary data, converted from JSON
-	std::vector<std::wstring> words;
-	Nexus lookup;
-	std::vector<std::wstring> lastChanceRegexes;
-	std::map<std::string, std::map<std::wstring, std::vector<unsigned int>>> ngrams;
-	std::map<std::wstring, std::map<std::wstring, std::wstring>> shortcuts;
-	std::map<std::wstring, std::string> revLookup;
-
-	//Build helper
-	void buildLookupRecursively(std::string roman, Json::Value& currObj, Nexus& currNode);
+	//Primary data; either built from JSON or attached to a compiled model.
+	TrigramTables tables;
+	std::shared_ptr<BinaryTrigramModel> binaryModel;
+	std::string modelBuffer; //Holds an in-memory compiled model, if we were given one.
+
+	//A last-chance pattern like "a?g=aung", compiled. The letters are stored right-to-left, since
+	//  that's how we match them against what the user typed.
+	struct LastChanceRule {
+		std::string letters;
+		std::vector<bool> optional;
+		std::string replacement;
+	};
+	std::vector<LastChanceRule> lastChanceRules;
+
+	//Additions made after loading
+	std::map<std::wstring, unsigned int> extraWordIDs;
+	std::map<std::wstring, std::wstring> extraShortcuts;
+
+	//Build helpers
+	void loadJsonModel(const std::string& buffer);
+	void buildLookupRecursively(const std::string& roman, Json::Value& currObj, unsigned int currNode, std::vector< std::vector<unsigned int> >& links, std::vector< std::vector<unsigned int> >& matched, std::map<std::wstring, std::string>& revLookup);
+	static std::wstring makeKey(const std::wstring& prefix, const std::wstring& suffix);
+	static int compareKey(const FlatRow<wchar_t>& row, const std::wstring& prefix, const wchar_t* suffix, size_t suffixLen, bool prefixOnly);
+	static int findKey(const FlatTable<wchar_t>& keys, size_t first, size_t last, const std::wstring& prefix, const wchar_t* suffix, size_t suffixLen);
+	static void findKeyRange(const FlatTable<wchar_t>& keys, const std::wstring& prefix, size_t& first, size_t& last);
+	static unsigned int HashNgram(unsigned int node, unsigned int ultimate, unsigned int penultimate, unsigned int antepenultimate);
+	int findWordID(const std::wstring& word) const;
+	int findNgram(unsigned int node, unsigned int ultimate, unsigned int penultimate, unsigned int antepenultimate) const;
+	void buildNgramHash(const std::map<std::vector<unsigned int>, std::vector<unsigned int> >& ngrams);
 
 	//State of a search
 	std::string typedRoman;
-	Nexus* currLookup;
-	Nexus* actualLookup;  //Where we left off for "shortcut" words, or NULL.
-	std::vector<unsigned int>* currNgram;
-	std::map<std::wstring, std::wstring>* currShortcutLookup;
+	unsigned int currLookup;
+	int actualLookup;  //Where we left off for "shortcut" words, or -1.
+	std::vector<int> typedNodes; //The node reached by each prefix of typedRoman (ignoring last-chance matches), or -1
+	int currNgram;     //Row in tables.ngramValues, or -1
+	std::wstring currShortcutBase; //Empty if the previous word has no shortcuts
+	size_t shortcutFirst;  //The rows of tables.shortcutKeys for currShortcutBase
+	size_t shortcutLast;
 
 
-	//Cached results
+	//Cached results. Shortcut words come first, then word IDs: n-grams, then the rest of the node's words.
 	std::string cachedParenStr;
-	std::vector<std::wstring> cachedMatchedWords;
+	std::vector<FlatRow<wchar_t> > cachedShortcutWords;
+	std::vector<unsigned int> cachedWordIDs;
+	std::vector<FlatRow<wchar_t> > cachedMatchedWords; //Only filled by getMatchedWords()
 	unsigned int cachedStartID;
 	bool cacheDirty;
 
+	//What the cache was built from. If a "dirty" cache matches this, we can keep it.
+	unsigned int cachedNode;
+	int cachedNgram;
+	size_t cachedShortcutFirst;
+	size_t cachedShortcutLast;
+	unsigned int modelRevision; //Bumped whenever words or shortcuts are added
+	unsigned int cachedRevision;
+
+	//Marks the words already in cachedWordIDs (wordStamps[id]==currStamp), so that we
+	//  don't need a set to remove duplicates.
+	std::vector<unsigned int> wordStamps;
+	unsigned int currStamp;
+
 
 	//Internal functions
 	void rebuildCachedResults();
-	std::string getAltString(const std::string& orig, const std::string& pattern);
-	Nexus* walkRomanizedString(const std::string& roman);
+	static bool CompileLastChance(const std::string& pattern, LastChanceRule& rule);
+	int applyLastChance(const LastChanceRule& rule, char letter) const;
+	int walkRomanizedString(const std::string& roman);
 	void resolvePatSint(const std::wstring& prevWord);
+	bool findShortcut(const FlatRow<wchar_t>& word, FlatRow<wchar_t>& result) const;
 
 };
 
@@ -0,0 +1,269 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#include "Utf8Transcoder.h"
+
+#include <cstring>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define WZ_UTF8_SSE2
+#include <emmintrin.h>
+#endif
+
+
+namespace waitzar
+{
+
+
+namespace {
+	void fail(const char* msg) {
+		throw std::runtime_error(std::string("Error: invalid UTF-8 sequence (") + msg + ")");
+	}
+
+	//Widen a run of ASCII bytes; returns the length of the run.
+	size_t copyAscii(const unsigned char* src, const unsigned char* end, wchar_t* dest)
+	{
+		const unsigned char* start = src;
+
+#ifdef WZ_UTF8_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		while (end-src >= 16) {
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			if (_mm_movemask_epi8(bytes) != 0)
+				break;
+			if (dest!=NULL) {
+				__m128i lo = _mm_unpacklo_epi8(bytes, zero);
+				__m128i hi = _mm_unpackhi_epi8(bytes, zero);
+				if (sizeof(wchar_t)==2) {
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), lo);
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dest+8), hi);
+				} else {
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpacklo_epi16(lo, zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dest+4), _mm_unpackhi_epi16(lo, zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dest+8), _mm_unpacklo_epi16(hi, zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dest+12), _mm_unpackhi_epi16(hi, zero));
+				}
+				dest += 16;
+			}
+			src += 16;
+		}
+#else
+		//Check 8 bytes at a time for a high bit.
+		while (end-src >= 8) {
+			unsigned int w1, w2;
+			memcpy(&w1, src, 4);
+			memcpy(&w2, src+4, 4);
+			if (((w1|w2)&0x80808080) != 0)
+				break;
+			if (dest!=NULL) {
+				for (size_t i=0; i<8; i++)
+					*dest++ = src[i];
+			}
+			src += 8;
+		}
+#endif
+
+		//Finish the run one byte at a time
+		while (src<end && *src<0x80) {
+			if (dest!=NULL)
+				*dest++ = *src;
+			src++;
+		}
+		return src-start;
+	}
+
+	//Write a code point, checking it first. Returns the number of characters written.
+	size_t emit(unsigned int val, unsigned int minVal, wchar_t* dest)
+	{
+		if (val<minVal)
+			fail("overlong form");
+		if (val>0x10FFFF)
+			fail("value out of range");
+		if (sizeof(wchar_t)==2 && val>0xFFFF) {
+			if (dest!=NULL) {
+				val -= 0x10000;
+				dest[0] = (wchar_t)(0xD800 | (val>>10));
+				dest[1] = (wchar_t)(0xDC00 | (val&0x3FF));
+			}
+			return 2;
+		}
+		if (dest!=NULL)
+			*dest = (wchar_t)val;
+		return 1;
+	}
+}
+
+
+
+size_t Utf8Decoder::decode(const char* srcBytes, size_t numBytes, wchar_t* dest)
+{
+	const unsigned char* src = reinterpret_cast<const unsigned char*>(srcBytes);
+	const unsigned char* end = src + numBytes;
+	size_t numOut = 0;
+
+	for (;;) {
+		//Continue a sequence (possibly one started in an earlier chunk)
+		while (pendingLeft>0 && src<end) {
+			if ((*src&0xC0)!=0x80)
+				fail("missing continuation byte");
+			pending = (pending<<6) | (*src++&0x3F);
+			if (--pendingLeft==0)
+				numOut += emit(pending, pendingMin, dest?dest+numOut:NULL);
+		}
+		if (src>=end)
+			break;
+
+		//ASCII
+		if (*src<0x80) {
+			size_t run = copyAscii(src, end, dest?dest+numOut:NULL);
+			src += run;
+			numOut += run;
+			continue;
+		}
+
+		//Start of a multi-byte sequence
+		unsigned int lead = *src++;
+		if ((lead>>5)==0x6) {
+			pending = lead&0x1F;
+			pendingLeft = 1;
+			pendingMin = 0x80;
+		} else if ((lead>>4)==0xE) {
+			pending = lead&0xF;
+			pendingLeft = 2;
+			pendingMin = 0x800;
+		} else if ((lead>>3)==0x1E) {
+			pending = lead&0x7;
+			pendingLeft = 3;
+			pendingMin = 0x10000;
+		} else
+			fail("unexpected byte");
+
+		//Most sequences are complete, so decode them right here.
+		if ((size_t)(end-src) >= pendingLeft) {
+			for (; pendingLeft>0; pendingLeft--) {
+				if ((*src&0xC0)!=0x80)
+					fail("missing continuation byte");
+				pending = (pending<<6) | (*src++&0x3F);
+			}
+			numOut += emit(pending, pendingMin, dest?dest+numOut:NULL);
+		}
+	}
+
+	return numOut;
+}
+
+
+void Utf8Decoder::finish() const
+{
+	if (pendingLeft>0)
+		fail("input ends in the middle of a character");
+}
+
+
+size_t Utf8Decoder::Decode(const char* src, size_t numBytes, wchar_t* dest)
+{
+	Utf8Decoder dec;
+	size_t res = dec.decode(src, numBytes, dest);
+	dec.finish();
+	return res;
+}
+
+
+
+size_t Utf8Encoder::encode(const wchar_t* src, size_t numChars, char* dest)
+{
+	size_t numOut = 0;
+	for (const wchar_t* end=src+numChars; src<end; src++) {
+		unsigned int val = (unsigned int)*src;
+		if (sizeof(wchar_t)==2)
+			val &= 0xFFFF;
+
+		//Pair up surrogates
+		if (highSurrogate!=0) {
+			if (val>=0xDC00 && val<=0xDFFF) {
+				val = 0x10000 + ((highSurrogate-0xD800)<<10) + (val-0xDC00);
+				highSurrogate = 0;
+			} else
+				numOut += finish(dest?dest+numOut:NULL);
+		}
+		if (sizeof(wchar_t)==2 && val>=0xD800 && val<=0xDBFF) {
+			highSurrogate = val;
+			continue;
+		}
+
+		//Write it
+		char* out = dest ? dest+numOut : NULL;
+		if (val<=0x7F) {
+			if (out) out[0] = (char)val;
+			numOut += 1;
+		} else if (val<=0x7FF) {
+			if (out) {
+				out[0] = (char)(0xC0 | (val>>6));
+				out[1] = (char)(0x80 | (val&0x3F));
+			}
+			numOut += 2;
+		} else if (val<=0xFFFF) {
+			if (out) {
+				out[0] = (char)(0xE0 | (val>>12));
+				out[1] = (char)(0x80 | ((val>>6)&0x3F));
+				out[2] = (char)(0x80 | (val&0x3F));
+			}
+			numOut += 3;
+		} else if (val<=0x10FFFF) {
+			if (out) {
+				out[0] = (char)(0xF0 | (val>>18));
+				out[1] = (char)(0x80 | ((val>>12)&0x3F));
+				out[2] = (char)(0x80 | ((val>>6)&0x3F));
+				out[3] = (char)(0x80 | (val&0x3F));
+			}
+			numOut += 4;
+		} else
+			throw std::runtime_error("Unicode value out of range.");
+	}
+	return numOut;
+}
+
+
+size_t Utf8Encoder::finish(char* dest)
+{
+	if (highSurrogate==0)
+		return 0;
+	if (dest!=NULL) {
+		dest[0] = (char)(0xE0 | (highSurrogate>>12));
+		dest[1] = (char)(0x80 | ((highSurrogate>>6)&0x3F));
+		dest[2] = (char)(0x80 | (highSurrogate&0x3F));
+	}
+	highSurrogate = 0;
+	return 3;
+}
+
+
+size_t Utf8Encoder::Encode(const wchar_t* src, size_t numChars, char* dest)
+{
+	Utf8Encoder enc;
+	size_t res = enc.encode(src, numChars, dest);
+	return res + enc.finish(dest?dest+res:NULL);
+}
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+
+namespace waitzar
+{
+
+
+/**
+ * Single-pass UTF-8 to wide-character decoder. The output is UTF-16 when wchar_t is 16 bits
+ *   (Windows), and UTF-32 otherwise (Linux).
+ * Nothing is allocated; the caller provides the output buffer, which must hold at least
+ *   MaxDecodedLength(numBytes) characters. Input may be given in arbitrary chunks: a sequence
+ *   split across two calls to decode() is completed on the second call. Call finish() after the
+ *   last chunk to make sure nothing was cut off.
+ * Runs of ASCII are copied 16 bytes at a time (with SSE2, where available).
+ * Invalid input (bad lead or continuation bytes, overlong forms, values past U+10FFFF) throws
+ *   a std::runtime_error.
+ */
+class Utf8Decoder {
+public:
+	Utf8Decoder() { reset(); }
+
+	//Each byte produces at most one character, plus the tail of a sequence left over from the last chunk.
+	static size_t MaxDecodedLength(size_t numBytes) { return numBytes+2; }
+
+	//Decode a chunk, returning the number of characters written. If "dest" is NULL, just count them.
+	size_t decode(const char* src, size_t numBytes, wchar_t* dest);
+
+	//Throws if the input so far ended in the middle of a sequence.
+	void finish() const;
+
+	//Forget any partial sequence
+	void reset() { pending = pendingLeft = pendingMin = 0; }
+
+	//Convenience: decode a complete buffer.
+	static size_t Decode(const char* src, size_t numBytes, wchar_t* dest);
+
+private:
+	unsigned int pending;      //Value decoded so far
+	unsigned int pendingLeft;  //Continuation bytes still expected
+	unsigned int pendingMin;   //Smallest legal value for this sequence's length (to catch overlong forms)
+};
+
+
+/**
+ * Single-pass wide-character to UTF-8 encoder; the counterpart to Utf8Decoder.
+ * The output buffer must hold at least MaxEncodedLength(numChars) bytes. Surrogate pairs (when
+ *   wchar_t is 16 bits) may be split across chunks. Unpaired surrogates are encoded as-is, as they always have been.
+ */
+class Utf8Encoder {
+public:
+	Utf8Encoder() { reset(); }
+
+	static size_t MaxEncodedLength(size_t numChars) { return numChars*4; }
+
+	//Encode a chunk, returning the number of bytes written. If "dest" is NULL, just count them.
+	size_t encode(const wchar_t* src, size_t numChars, char* dest);
+
+	//Flush an unpaired high surrogate left at the end of the input. Returns the number of bytes written.
+	size_t finish(char* dest);
+
+	void reset() { highSurrogate = 0; }
+
+	//Convenience: encode a complete buffer.
+	static size_t Encode(const wchar_t* src, size_t numChars, char* dest);
+
+private:
+	unsigned int highSurrogate; //Waiting for its partner
+};
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
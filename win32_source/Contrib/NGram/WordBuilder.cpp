@@ -5,6 +5,9 @@
  */
 
 #include "WordBuilder.h"
+#include "NGram/Utf8Transcoder.h"
+
+#include <cstring>
 
 
 //I prefer to only shorthand STL components I use a lot, 
@@ -25,7 +28,7 @@ namespace waitzar
 /**
  * Empty constructor. Intended only to allow use of WordBuilder by value (not reference)
  */
-WordBuilder::WordBuilder() {}
+WordBuilder::WordBuilder() : indexedWords(0) {}
 
 
 /**
@@ -35,7 +38,7 @@ WordBuilder::WordBuilder() {}
  * If an exact match (roman+myanmar) is encountered in userWordsFiles[n+1] that was already in userWordsFiles[n], the 
  * newest entry is ignored.
  */	
- WordBuilder::WordBuilder (const char* modelFile, std::vector<std::string> userWordsFiles)
+ WordBuilder::WordBuilder (const char* modelFile, std::vector<std::string> userWordsFiles) : indexedWords(0)
 {
 	//Load the model
 	loadModel(modelFile, userWordsFiles);
@@ -52,7 +55,7 @@ WordBuilder::WordBuilder() {}
  * If userWordsFile doesn't exist, it is ignored. If modelFile doesn't exist, it
  *  causes unpredictable behavior.
  */
-WordBuilder::WordBuilder (const char* modelFilePath, const char* userWordsFilePath)
+WordBuilder::WordBuilder (const char* modelFilePath, const char* userWordsFilePath) : indexedWords(0)
 {
 	//Load the model
 	std::vector<std::string> oneFile;
@@ -80,19 +83,30 @@ void WordBuilder::loadModel(const char* modelFilePath, vector<string> userWordsF
 	fseek (modelFile, 0, SEEK_END);
 	long modelFileSize = ftell(modelFile);
 	rewind(modelFile);
-	char * model_buff = new char[modelFileSize];
-	size_t model_buff_size = fread(model_buff, 1, modelFileSize, modelFile);
-	fclose(modelFile);
 
+	//Compiled models are mapped and used in place, rather than read.
+	char header[sizeof(BinaryModel::Header)];
+	size_t headerSize = fread(header, 1, sizeof(header), modelFile);
+	if (BinaryModel::IsBinaryModel(header, headerSize)) {
+		fclose(modelFile);
+		std::shared_ptr<BinaryModel> binModel(new BinaryModel(modelFilePath));
+		loadBinaryModel(binModel, binModel->allowsAnyChar());
+	} else {
+		rewind(modelFile);
+		char * model_buff = new char[modelFileSize];
+		size_t model_buff_size = fread(model_buff, 1, modelFileSize, modelFile);
+		fclose(modelFile);
 
 
-	//Delegate to another loading function
-	loadModel(model_buff, model_buff_size, !this->restrictToMyanmar);
 
+		//Delegate to another loading function
+		loadModel(model_buff, model_buff_size, !this->restrictToMyanmar);
 
 
-	//Reclaim memory
-	delete [] model_buff;
+
+		//Reclaim memory
+		delete [] model_buff;
+	}
 
 	//Now, load the user's custom words (optional)
 	for (size_t i=0; i<userWordsFilePaths.size(); i++) {
@@ -107,31 +121,29 @@ void WordBuilder::loadModel(const char* modelFilePath, vector<string> userWordsF
 	  rewind(userFile);
 
 	  //Read it all into an array, close the file.
-	  char * buffer = new char[fileSize]; // (char*) malloc(sizeof(char)*fileSize);
-	  size_t buff_size = fread(buffer, 1, fileSize, userFile);
+	  std::vector<char> buffer(fileSize>0 ? fileSize : 0);
+	  size_t buff_size = buffer.empty() ? 0 : fread(&buffer[0], 1, buffer.size(), userFile);
 	  fclose(userFile);
 	  if (buff_size==0) {
 	    return; //Empty file.
 	  }
 
-	  //Finally, convert this array to unicode
-	  wchar_t * uniBuffer = new wchar_t[buff_size];
-	  
-	  //old:
-	  //size_t numUniChars = MultiByteToWideChar(CP_UTF8, 0, buffer, (int)buff_size, NULL, 0);
-	  //new:
-	  size_t numUniChars = mymbstowcs(NULL, buffer, buff_size);
+	  //Finally, convert this array to unicode (in one pass). Invalid UTF-8 is reported below.
+	  std::vector<wchar_t> uniBuffer(Utf8Decoder::MaxDecodedLength(buff_size));
+	  size_t numUniChars = 0;
+	  try {
+	    numUniChars = Utf8Decoder::Decode(&buffer[0], buff_size, &uniBuffer[0]);
+	  } catch (std::runtime_error&) {
+	    numUniChars = 0;
+	  }
 	  if (buff_size==numUniChars) {
 	    wprintf(L"Warning! Conversion to wide-character string of mywords.txt probably failed...\n");
 	    return;
 	  }
-
-	  uniBuffer = new wchar_t[numUniChars]; // (wchar_t*) malloc(sizeof(wchar_t)*numUniChars);
-	  if (mymbstowcs(uniBuffer, buffer, buff_size)==0) {
+	  if (numUniChars==0) {
 	    printf("mywords.txt contains invalid UTF-8 characters.\n\nWait Zar will still function properly; however, your custom dictionary will be ignored.");
 	    return;
 	  }
-	  delete [] buffer;
 
 	  //Skip the BOM, if it exists
 	  size_t currPosition = 0;
@@ -143,15 +155,15 @@ void WordBuilder::loadModel(const char* modelFilePath, vector<string> userWordsF
 	  }
 
 	  //Read each line
-	  wchar_t* name = new wchar_t[100];
-	  char* value = new char[100];
+	  std::vector<wchar_t> name(100);
+	  std::vector<char> value(100);
 	  while (currPosition<numUniChars) {
 	    //Get the name/value pair using our nifty template function....
-		  readLine(uniBuffer, currPosition, numUniChars, true, true, false, !this->restrictToMyanmar, true, false, false, false, name, value);
+		  readLine(&uniBuffer[0], currPosition, numUniChars, true, true, false, !this->restrictToMyanmar, true, false, false, false, &name[0], &value[0]);
 
 	    //Make sure both name and value are non-empty
-		wstring wname = wstring(name);
-		string wvalue = string(value);
+		wstring wname = wstring(&name[0]);
+		string wvalue = string(&value[0]);
 	    if (wvalue.empty() || wname.empty())
 	      continue;
 	    
@@ -160,15 +172,11 @@ void WordBuilder::loadModel(const char* modelFilePath, vector<string> userWordsF
 	      printf("Error adding Romanisation");
 	    }
 	  }
-
-	  delete [] uniBuffer;
-	  delete [] name;
-	  delete [] value;
       }
 }
 
 
-WordBuilder::WordBuilder(char *model_buff, size_t model_buff_size, bool allowAnyChar)
+WordBuilder::WordBuilder(char *model_buff, size_t model_buff_size, bool allowAnyChar) : indexedWords(0)
 {
 	//Load the model
 	loadModel(model_buff, model_buff_size, allowAnyChar);
@@ -180,6 +188,13 @@ WordBuilder::WordBuilder(char *model_buff, size_t model_buff_size, bool allowAny
 
 void WordBuilder::loadModel(char *model_buff, size_t model_buff_size, bool allowAnyChar)
 {
+	//Is this a compiled model? If so, use it in place. (This is the case for embedded resources,
+	//  which remain locked in memory for the lifetime of the process.)
+	if (BinaryModel::IsBinaryModel(model_buff, model_buff_size)) {
+		loadBinaryModel(std::shared_ptr<BinaryModel>(new BinaryModel(model_buff, model_buff_size)), allowAnyChar);
+		return;
+	}
+
 	//The user has passed in the option to use any character or only myanmar ones
 	this->restrictToMyanmar = !allowAnyChar;
 
@@ -189,7 +204,7 @@ void WordBuilder::loadModel(char *model_buff, size_t model_buff_size, bool allow
 	unsigned short mode = 0;
 
 	//For global usage; should be faster
-	wstring newWord;
+	vector<unsigned short> newWord;
 	newWord.reserve(150);
 	vector<unsigned int> newArr;
 	newArr.reserve(150);
@@ -253,17 +268,17 @@ void WordBuilder::loadModel(char *model_buff, size_t model_buff_size, bool allow
 					unsigned int currLetter = 0x1000;
 					currLetter |= (toHex(model_buff[currLineStart++])<<4);
 					currLetter |= (toHex(model_buff[currLineStart++]));
-					newWord += (wchar_t)currLetter;
+					newWord.push_back((unsigned short)currLetter);
 
 					//Continue?
 					char nextChar = model_buff[currLineStart++];
 					if (nextChar == ',' || nextChar == ']') {
 						//Double check our digits
 						if (dictionary.size() < 10) {
-							if (newWord.length()!=1 || newWord[0] != 0x1040+dictionary.size()) {
+							if (newWord.size()!=1 || newWord[0] != 0x1040+dictionary.size()) {
 								wstringstream msg;
 								msg << "Model MUST begin with numbers 0 through 9 (e.g., 1040 through 1049) for reasons"
-									<< " of parsimony.\nFound: [" <<(int)newWord[0]  <<"] at " <<newWord.length();
+									<< " of parsimony.\nFound: [" <<(int)newWord[0]  <<"] at " <<newWord.size();
 								mostRecentError = msg.str();
 								return;
 							}
@@ -274,7 +289,7 @@ void WordBuilder::loadModel(char *model_buff, size_t model_buff_size, bool allow
 						}
 
 						//Add this word to the dictionary (copy semantics)
-						dictionary.push_back(newWord);
+						dictionary.pushRow(newWord);
 						newWord.clear();
 
 						//Continue?
@@ -316,8 +331,8 @@ void WordBuilder::loadModel(char *model_buff, size_t model_buff_size, bool allow
 						currLineStart++;
 				}
 
-				//Push-back copies and shrinks the array.
-				nexus.push_back(newArr);
+				//Push-back copies the array into the trie (sorted by letter).
+				nexus.pushNode(newArr);
 
 				break;
 			}
@@ -386,8 +401,8 @@ void WordBuilder::loadModel(char *model_buff, size_t model_buff_size, bool allow
 				//Set the halfway marker to the number of PAIRS
 				newArr[0] = lastCommentedNumber/2;
 
-				//Copy and shrink & store
-				prefix.push_back(newArr);
+				//Copy & store
+				prefix.pushRow(newArr);
 
 				break;
 			}
@@ -430,7 +445,7 @@ void WordBuilder::loadModel(char *model_buff, size_t model_buff_size, bool allow
  *       few profile runs) tiny hash tables offer virtually no performance improvement at a
  *       substantial increase in the memory footprint. So, deal with the C-style arrays.
  */
-WordBuilder::WordBuilder(const vector<wstring> &dictionary, const vector< vector<unsigned int> > &nexus, const vector< vector<unsigned int> > &prefix)
+WordBuilder::WordBuilder(const vector<wstring> &dictionary, const vector< vector<unsigned int> > &nexus, const vector< vector<unsigned int> > &prefix) : indexedWords(0)
 {
     //Load the model
 	loadModel(dictionary, nexus, prefix);
@@ -455,16 +470,46 @@ void WordBuilder::loadModel(const vector<wstring> &dictionary, const vector< vec
 	//Assume the user only wants Burmese words
 	this->restrictToMyanmar = true;
 
-	//Store for later. 
+	//Reserve space, to avoid a slow startup
+	this->dictionary.reserve(std::max<size_t>(dictionary.size(), 2000));
+	this->nexus.reserve(std::max<size_t>(nexus.size(), 4000));
+	this->prefix.reserve(std::max<size_t>(prefix.size(), 3000));
+
+	//Store for later.
 	// We copy values in manually for now, since I'm not good with the constructor post-scripting notation
-	this->dictionary = dictionary;
-	this->nexus = nexus;
-	this->prefix = prefix;
+	for (size_t i=0; i<dictionary.size(); i++)
+		addDictionaryWord(dictionary[i]);
+	for (size_t i=0; i<nexus.size(); i++)
+		this->nexus.pushNode(nexus[i]);
+	for (size_t i=0; i<prefix.size(); i++)
+		this->prefix.pushRow(prefix[i]);
+}
 
-	//Reserve space, to avoid a slow startup
-	this->dictionary.reserve(2000);
-	this->nexus.reserve(4000);
-	this->prefix.reserve(3000);
+
+/**
+ * Use a compiled model in place; nothing is parsed or copied. User words added later
+ *   are kept on the side, so the mapped memory itself is never modified.
+ */
+void WordBuilder::loadBinaryModel(std::shared_ptr<BinaryModel> model, bool allowAnyChar)
+{
+	this->restrictToMyanmar = !allowAnyChar;
+	this->binaryModel = model;
+	model->attach(dictionary, nexus, prefix);
+
+	//Cache our numerals, if the model begins with them (it should, unless it's a wordlist).
+	bool hasNumerals = dictionary.size()>=10;
+	for (size_t i=0; i<10 && hasNumerals; i++) {
+		FlatRow<unsigned short> word = dictionary[i];
+		hasNumerals = (word.size()==1 && word[0]==0x1040+i);
+	}
+	for (size_t i=0; i<10 && hasNumerals; i++)
+		cachedNumerals.push_back(std::pair<bool, unsigned short>(true, i));
+}
+
+
+void WordBuilder::saveBinaryModel(const std::string& path) const
+{
+	BinaryModel::Write(path, dictionary, nexus, prefix, !restrictToMyanmar);
 }
 
 
@@ -553,26 +598,14 @@ bool WordBuilder::addShortcut(const wstring &baseWord, const wstring &toStack, c
 	// trick.
 	for (unsigned int toStackNexusID=0; toStackNexusID<nexus.size(); toStackNexusID++) {
 		//Is this nexus ID valid?
-		vector<unsigned int> &thisNexus = nexus[toStackNexusID];
-		unsigned int prefixID = 0;
-		bool considerThisNexus = false;
-		for (unsigned int x=0; x<thisNexus.size(); x++) {
-			//Is this the resolving letter?
-			char letter = (char)(0xFF&thisNexus[x]);
-			if (letter!='~')
-				continue;
-
-			//Ok, save it
-			prefixID = (thisNexus[x]>>8);
-			considerThisNexus = true;
-			break;
-		}
+		int prefixID = nexus.jump(toStackNexusID, NexusTrie::PrefixLink);
+		bool considerThisNexus = (prefixID!=-1);
 		if (considerThisNexus) {
 			//Now, test this prefix to see if its base pair contains our word in question.
 			considerThisNexus = false;
-			vector<unsigned int>::iterator prefWord = prefix[prefixID].begin();
-			std::advance(prefWord, prefix[prefixID][0]*2+1);
-			for (; prefWord!=prefix[prefixID].end(); prefWord++) {
+			FlatRow<unsigned int> thisPrefix = prefix[prefixID];
+			const unsigned int* prefWord = thisPrefix.begin() + thisPrefix[0]*2+1;
+			for (; prefWord!=thisPrefix.end(); prefWord++) {
 				if (*prefWord == toStackID) {
 					considerThisNexus = true;
 					break;
@@ -600,6 +633,93 @@ bool WordBuilder::addShortcut(const wstring &baseWord, const wstring &toStack, c
 }
 
 
+//Read a list of shortcuts, one "pre + curr = post" per line. Blank lines and "#" comments are skipped.
+//return false in error
+bool WordBuilder::addShortcuts(const char* data, size_t size)
+{
+	//We, unfortunately, have to convert this to unicode now...
+	std::vector<wchar_t> uniData(Utf8Decoder::MaxDecodedLength(size));
+	size_t uniSize = (size==0) ? 0 : mymbstowcs(&uniData[0], data, size);
+	if (uniSize==0 && size>0) {
+		mostRecentError = L"Shortcuts contain invalid UTF-8 characters.";
+		return false;
+	}
+
+	//Now, read through each line and add it to the external words list.
+	wchar_t pre[200];
+	wchar_t curr[200];
+	wchar_t post[200];
+	size_t index = 0;
+
+	bool res = true;
+	while(index<uniSize && res) {
+		//Left-trim
+		while (uniData[index] == ' ')
+			index++;
+
+		//Comment? Empty line? If so, skip...
+		if (uniData[index]=='#' || uniData[index]=='\n') {
+			while (uniData[index] != '\n')
+				index++;
+			index++;
+			continue;
+		}
+
+		//Init
+		pre[0] = 0x0000;
+		int pre_pos = 0;
+		bool pre_done = false;
+		curr[0] = 0x0000;
+		int curr_pos = 0;
+		bool curr_done = false;
+		post[0] = 0x0000;
+		int post_pos = 0;
+
+		//Ok, look for pre + curr = post
+		while (index<uniSize) {
+			if (uniData[index] == '\n') {
+				index++;
+				break;
+			} else if (uniData[index] == '+') {
+				//Switch modes
+				pre_done = true;
+				index++;
+			} else if (uniData[index] == '=') {
+				//Switch modes
+				pre_done = true;
+				curr_done = true;
+				index++;
+			} else if (uniData[index] >= 0x1000 && uniData[index] <= 0x109F) {
+				//Add this to the current string
+				if (curr_done) {
+					post[post_pos++] = uniData[index++];
+				} else if (pre_done) {
+					curr[curr_pos++] = uniData[index++];
+				} else {
+					pre[pre_pos++] = uniData[index++];
+				}
+			} else {
+				//Ignore it; avoid weird errors
+				index++;
+			}
+		}
+
+		//Ok, seal the strings
+		post[post_pos++] = 0x0000;
+		curr[curr_pos++] = 0x0000;
+		pre[pre_pos++] = 0x0000;
+
+		//Do we have anything?
+		if (wcslen(post)!=0 && wcslen(curr)!=0 && wcslen(pre)!=0) {
+			//Ok, process these strings and store them
+			res = addShortcut(pre, curr, post);
+		}
+	}
+
+	return res;
+}
+
+
 
 unsigned short WordBuilder::getStopCharacter(bool isFull) const
 {
@@ -826,20 +946,17 @@ void WordBuilder::reset(bool fullReset)
  */
 int WordBuilder::jumpToNexus(int fromNexus, char jumpChar) const
 {
-	for (unsigned int i=0; i<this->nexus[fromNexus].size(); i++) {
-		if ( (this->nexus[fromNexus][i]&0xFF) == jumpChar )
-			return (this->nexus[fromNexus][i]>>8);
-	}
-	return -1;
+	return this->nexus.jump(fromNexus, jumpChar);
 }
 
 
 int WordBuilder::jumpToPrefix(int fromPrefix, int jumpID) const
 {
-	size_t numPrefixPairs = this->prefix[fromPrefix][0];
+	FlatRow<unsigned int> thisPrefix = this->prefix[fromPrefix];
+	size_t numPrefixPairs = thisPrefix[0];
 	for (size_t i=0; i<numPrefixPairs; i++) {
-		if ( (int)this->prefix[fromPrefix][i*2+1] == jumpID )
-			return this->prefix[fromPrefix][i*2+2];
+		if ( (int)thisPrefix[i*2+1] == jumpID )
+			return thisPrefix[i*2+2];
 	}
 	return -1;
 }
@@ -874,10 +991,11 @@ void WordBuilder::resolveWords()
 	//What possible characters are available after this point?
 	int lowestPrefix = -1;
 	possibleChars.clear();
-	for (unsigned int i=0; i<this->nexus[speculativeNexusID].size(); i++) {
-		char currChar = (this->nexus[speculativeNexusID][i]&0xFF);
+	FlatRow<unsigned int> specNexus = this->nexus[speculativeNexusID];
+	for (unsigned int i=0; i<specNexus.size(); i++) {
+		char currChar = (specNexus[i]&0xFF);
 		if (currChar == '~')
-			lowestPrefix = (this->nexus[speculativeNexusID][i]>>8);
+			lowestPrefix = (specNexus[i]>>8);
 		else
 			this->possibleChars.push_back(currChar);
 	}
@@ -901,16 +1019,16 @@ void WordBuilder::resolveWords()
 
 	//First, put all high-informative entries into the resultant vector
 	//  Then, add any remaining low-information entries
-	vector<unsigned int>::iterator possWord = prefix[highPrefix].begin();
-	std::advance(possWord, prefix[highPrefix][0]*2+1);
-	for (; possWord!=prefix[highPrefix].end(); possWord++) {
+	FlatRow<unsigned int> highRow = prefix[highPrefix];
+	const unsigned int* possWord = highRow.begin() + highRow[0]*2+1;
+	for (; possWord!=highRow.end(); possWord++) {
 		possibleWords.push_back(*possWord);
 		wordCombinations.push_back(-1);
 	}
 	if (highPrefix != lowestPrefix) {
-		possWord = prefix[lowestPrefix].begin();
-		std::advance(possWord, prefix[lowestPrefix][0]*2+1);
-		for (; possWord!=prefix[lowestPrefix].end(); possWord++) {
+		FlatRow<unsigned int> lowRow = prefix[lowestPrefix];
+		possWord = lowRow.begin() + lowRow[0]*2+1;
+		for (; possWord!=lowRow.end(); possWord++) {
 			if (!vectorContains(possibleWords, *possWord)) {
 				possibleWords.push_back(*possWord);
 				wordCombinations.push_back(-1);
@@ -952,12 +1070,12 @@ void WordBuilder::addPrefix(unsigned int latestPrefix)
 }
 
 
-vector<char> WordBuilder::getPossibleChars() const
+const vector<char>& WordBuilder::getPossibleChars() const
 {
 	return this->possibleChars;
 }
 
-vector<int> WordBuilder::getWordCombinations() const
+const vector<int>& WordBuilder::getWordCombinations() const
 {
 	return this->wordCombinations;
 }
@@ -967,7 +1085,7 @@ unsigned int WordBuilder::getFirstWordIndex() const
 	return this->firstRegularWordIndex;
 }
 
-vector<unsigned int> WordBuilder::getPossibleWords() const
+const vector<unsigned int>& WordBuilder::getPossibleWords() const
 {
 	return this->possibleWords;
 }
@@ -1000,10 +1118,14 @@ wstring WordBuilder::getWordKeyStrokes(unsigned int id, unsigned int encoding)
 	if (!this->restrictToMyanmar)
 		return getWordString(id);
 
+	//The dictionary is already in Zawgyi
+	if (encoding!=ENCODING_WININNWA && encoding!=ENCODING_UNICODE)
+		return getWordString(id);
+
 	//Get a reference to our dictionary value... it looks a bit odd, but changing this
 	//  WILL change the word itself.
-	wstring &myWord = (encoding==ENCODING_WININNWA) ? winInnwaDictionary[id] : (encoding==ENCODING_UNICODE) ? unicodeDictionary[id] : dictionary[id];
-	
+	wstring &myWord = (encoding==ENCODING_WININNWA) ? winInnwaDictionary[id] : unicodeDictionary[id];
+
 	//Determine our font... use Soe Min's names
 	int destFont = Zawgyi_One;
 	if (encoding==ENCODING_WININNWA) {
@@ -1070,7 +1192,8 @@ wstring WordBuilder::getParenString() const
  */
 wstring WordBuilder::getWordString(unsigned int id) const
 {
-	return this->dictionary[id];
+	FlatRow<unsigned short> word = this->dictionary[id];
+	return wstring(word.begin(), word.end());
 }
 
 
@@ -1117,7 +1240,7 @@ void WordBuilder::buildReverseLookup()
 	while (!currNexi.empty()) {
 		//Deal with all nexi on this level.
 		for (size_t i=0; i<currNexi.size(); i++) {
-			const vector<unsigned int> &thisNexus = nexus[currNexi[i]];
+			FlatRow<unsigned int> thisNexus = nexus[currNexi[i]];
 			for (unsigned int x=0; x<thisNexus.size(); x++) {
 				int jmpToID = thisNexus[x]>>8;
 				char letter = (char)(0xFF&thisNexus[x]);
@@ -1140,9 +1263,10 @@ void WordBuilder::buildReverseLookup()
 	for (size_t i=0; i<nexus.size(); i++) {
 		//Find out if this has a prefix entry
 		int prefixID = -1;
-		for (unsigned int x=0; x<nexus[i].size(); x++) {
-			if ((char)(0xFF&nexus[i][x])=='~') {
-				prefixID = nexus[i][x]>>8;
+		FlatRow<unsigned int> thisNexus = nexus[i];
+		for (unsigned int x=0; x<thisNexus.size(); x++) {
+			if ((char)(0xFF&thisNexus[x])=='~') {
+				prefixID = thisNexus[x]>>8;
 				break;
 			}
 		}
@@ -1156,9 +1280,9 @@ void WordBuilder::buildReverseLookup()
 		//Else, reference this string in every prefix this refers to.
 		//  Note that we only have to check prefix level zero, which by 
 		//  definition contains every prefix.
-		vector<unsigned int>::iterator currWord = prefix[prefixID].begin();
-		std::advance(currWord, prefix[prefixID][0]*2+1);
-		for (; currWord!=prefix[prefixID].end(); currWord++) {
+		FlatRow<unsigned int> thisPrefix = prefix[prefixID];
+		const unsigned int* currWord = thisPrefix.begin() + thisPrefix[0]*2+1;
+		for (; currWord!=thisPrefix.end(); currWord++) {
 			if (*currWord>=0 && *currWord<dictionary.size()) {
 				addReverseLookupItem(*currWord, nexiStrings[i]);
 			}
@@ -1222,15 +1346,29 @@ bool WordBuilder::addRomanization(const wstring &myanmar, const string &roman)
 //returns dictionary.size()
 unsigned int WordBuilder::getWordID(const wstring &wordStr) const
 {
-	for (size_t canID=0; canID<dictionary.size(); canID++) {
-		if (wordStr == dictionary[canID])
-			return canID;
+	//Bring the index up to date with any words added since we last looked.
+	//Words are only ever appended to the dictionary, so this is incremental.
+	for (; indexedWords<dictionary.size(); indexedWords++) {
+		FlatRow<unsigned short> word = dictionary[indexedWords];
+		wordIndex.insert(std::pair<wstring, unsigned int>(wstring(word.begin(), word.end()), indexedWords)); //Keeps the first ID on duplicates
 	}
 
+	std::unordered_map<wstring, unsigned int>::const_iterator it = wordIndex.find(wordStr);
+	if (it!=wordIndex.end())
+		return it->second;
+
 	//Not found
 	return dictionary.size();
 }
 
+
+//Dictionary words are stored as 16-bit code units, regardless of the size of wchar_t
+void WordBuilder::addDictionaryWord(const wstring &word)
+{
+	vector<unsigned short> letters(word.begin(), word.end());
+	dictionary.pushRow(letters);
+}
+
 bool WordBuilder::addRomanization(const wstring &myanmar, const string &roman, bool ignoreDuplicates)
 {
 	//First task: find the word; add it if necessary
@@ -1241,7 +1379,7 @@ bool WordBuilder::addRomanization(const wstring &myanmar, const string &roman, b
 			mostRecentError = L"Too many custom words!";
 			return false;
 		}
-		dictionary.push_back(myanmar);
+		addDictionaryWord(myanmar);
 		unicodeDictionary.push_back(wstring());
 		winInnwaDictionary.push_back(wstring());
 
@@ -1263,54 +1401,42 @@ bool WordBuilder::addRomanization(const wstring &myanmar, const string &roman, b
 	size_t currNodeID = 0;
 	for (size_t rmID=0; rmID<roman.length(); rmID++) {
 		//Does a path exist from our current node to the next step?
-		size_t nextNexusID;
-		for (nextNexusID=0; nextNexusID<nexus[currNodeID].size(); nextNexusID++) {
-			if (((nexus[currNodeID][nextNexusID])&0xFF) == roman[rmID]) {
-				break;
-			}
-		}
-		if (nextNexusID==nexus[currNodeID].size()) {
+		int nextNodeID = nexus.jump(currNodeID, roman[rmID]);
+		if (nextNodeID==-1) {
 			//First step: make a blank nexus entry at the END of this list
-			if (nexus.size() == std::numeric_limits<size_t>::max()) {
+			if (nexus.size() >= (std::numeric_limits<unsigned int>::max()>>8)) {
 				mostRecentError = L"Too many custom nexi!";
 				return false;
 			}
-			nexus.push_back(vector<unsigned int>());
+			nextNodeID = nexus.addNode();
 
 			//Now, link to this from the current nexus list.
-			nexus[currNodeID].push_back(((nexus.size()-1)<<8) | (0xFF&roman[rmID]));
+			nexus.addLink(currNodeID, roman[rmID], nextNodeID);
 		}
 
-		currNodeID = ((nexus[currNodeID][nextNexusID])>>8);
+		currNodeID = nextNodeID;
 	}
 
 
 	//Final task: add (just the first) prefix entry.
-	size_t currPrefixID;
-	for (currPrefixID=0; currPrefixID<nexus[currNodeID].size(); currPrefixID++) {
-		if (((nexus[currNodeID][currPrefixID])&0xFF) == '~') {
-			break;
-		}
-	}
-	if (currPrefixID == nexus[currNodeID].size()) {
+	int currPrefixID = nexus.jump(currNodeID, NexusTrie::PrefixLink);
+	if (currPrefixID == -1) {
 		//We need to add a prefix entry
-		if (prefix.size() == std::numeric_limits<size_t>::max()) {
+		if (prefix.size() >= (std::numeric_limits<unsigned int>::max()>>8)) {
 			mostRecentError = L"Too many custom prefixes!";
 			return false;
 		}
-		prefix.push_back(vector<unsigned int>(1, 0));
+		prefix.pushRow(vector<unsigned int>(1, 0));
+		currPrefixID = prefix.size()-1;
 
 		//Now, point the nexus to this entry
-		nexus[currNodeID].push_back((unsigned int) (((prefix.size()-1)<<8) | ('~')));
+		nexus.addLink(currNodeID, NexusTrie::PrefixLink, currPrefixID);
 	}
 
-	//Translate
-	currPrefixID = (nexus[currNodeID][currPrefixID])>>8;
-
 	//Does our prefix entry contain this dictionary word?
-	vector<unsigned int>::iterator currWord = prefix[currPrefixID].begin();
-	std::advance(currWord, prefix[currPrefixID][0]*2+1);
-	for (; currWord!=prefix[currPrefixID].end(); currWord++) {
+	FlatRow<unsigned int> currPrefix = prefix[currPrefixID];
+	const unsigned int* currWord = currPrefix.begin() + currPrefix[0]*2+1;
+	for (; currWord!=currPrefix.end(); currWord++) {
 		if (*currWord == dictID) {
 			if (!ignoreDuplicates) {
 				wstringstream msg;
@@ -1324,7 +1450,7 @@ bool WordBuilder::addRomanization(const wstring &myanmar, const string &roman, b
 	}
 
 	//Ok, copy it over
-	prefix[currPrefixID].push_back(dictID);
+	prefix.append(currPrefixID, dictID);
 
 	return true;
 }
@@ -1332,68 +1458,19 @@ bool WordBuilder::addRomanization(const wstring &myanmar, const string &roman, b
 
 
 
-//Return 0: error
-// This follows RFC 3629's recommendations, although it is not strictly compliant.
-size_t mymbstowcs(wchar_t *dest, const char *srcPtr, size_t maxCount)
+//Returns the number of characters written (or that would be written, if "dest" is NULL).
+// If maxCount is zero, "src" is treated as null-terminated.
+//Return 0: error (invalid UTF-8). Older callers check for this, so unlike Utf8Decoder, we don't throw.
+// This is a thin wrapper around Utf8Decoder, kept for those callers.
+size_t mymbstowcs(wchar_t *dest, const char *src, size_t maxCount)
 {
-	size_t lenStr = maxCount;
-	size_t destIndex = 0;
-	const string src = string(srcPtr);
-	if (lenStr==0) {
-		lenStr = src.size();
+	if (maxCount==0)
+		maxCount = strlen(src);
+	try {
+		return Utf8Decoder::Decode(src, maxCount, dest);
+	} catch (std::runtime_error&) {
+		return 0;
 	}
-	for (unsigned int i=0; i<lenStr; i++) {
-		unsigned short curr = (src[i]&0xFF);
-
-		//Handle carefully to avoid the security risk...
-		if (((curr>>3)^0x1E)==0) {
-			//We can't handle anything outside the BMP
-			throw std::runtime_error("Error: mymbstowcs does not handle bytes outside the BMP");
-		} else if (((curr>>4)^0xE)==0) {
-			//Verify the next two bytes
-			if (i>=lenStr-2 || (((src[i+1]&0xFF)>>6)^0x2)!=0 || (((src[i+2]&0xFF)>>6)^0x2)!=0)
-				throw std::runtime_error("Error: 2-byte character error in UTF-8 file");
-
-			//Combine all three bytes, check, increment
-			wchar_t destVal = 0x0000 | ((curr&0xF)<<12) | ((src[i+1]&0x3F)<<6) | (src[i+2]&0x3F);
-			if (destVal>=0x0800 && destVal<=0xFFFF) {
-				destIndex++;
-				i+=2;
-			} else
-				throw std::runtime_error("Error: 2-byte character error in UTF-8 file");
-
-			//Set
-			if (dest!=NULL)
-				dest[destIndex-1] = destVal;
-		} else if (((curr>>5)^0x6)==0) {
-			//Verify the next byte
-			if (i>=lenStr-1 || (((src[i+1]&0xFF)>>6)^0x2)!=0)
-				throw std::runtime_error("Error: 1-byte character error in UTF-8 file");
-
-			//Combine both bytes, check, increment
-			wchar_t destVal = 0x0000 | ((curr&0x1F)<<6) | (src[i+1]&0x3F);
-			if (destVal>=0x80 && destVal<=0x07FF) {
-				destIndex++;
-				i++;
-			} else
-				throw std::runtime_error("Error: 1-byte character error in UTF-8 file");
-
-			//Set
-			if (dest!=NULL)
-				dest[destIndex-1] = destVal;
-		} else if ((curr>>7)==0) {
-			wchar_t destVal = 0x0000 | curr;
-			destIndex++;
-
-			//Set
-			if (dest!=NULL)
-				dest[destIndex-1] = destVal;
-		} else {
-			throw std::runtime_error("Error: Unknown sequence in UTF-8 file");
-		}
-	}
-
-	return destIndex;
 }
 
 
@@ -1409,7 +1486,7 @@ void WordBuilder::debugOut(FILE *out)
 		}
 
 		//Print this word
-		for (size_t x=0; x<dictionary[i].length(); x++) {
+		for (size_t x=0; x<dictionary[i].size(); x++) {
 			if (x!=0)
 				fprintf(out, "-");
 			fprintf(out, "%02X", dictionary[i][x]-0x1000);
@@ -1454,10 +1531,10 @@ void WordBuilder::debugOut(FILE *out)
 
 		fprintf(out, "} [");
 
-		vector<unsigned int>::iterator prefWord = prefix[i].begin();
-		std::advance(prefWord, prefix[i][0]*2+1);
+		FlatRow<unsigned int> thisPrefix = prefix[i];
+		const unsigned int* prefWord = thisPrefix.begin() + thisPrefix[0]*2+1;
 		bool comma = false;
-		for (; prefWord!=prefix[i].end(); prefWord++) {
+		for (; prefWord!=thisPrefix.end(); prefWord++) {
 			if (comma)
 				fprintf(out, ",");
 			comma = true;
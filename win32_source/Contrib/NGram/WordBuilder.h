@@ -18,16 +18,22 @@
 //#include <string.h>
 //#include <stdio.h>
 //#include <stdlib.h> //strtol
+#include <cstdio>
 #include <vector>
 #include <algorithm>
 #include <string>
 #include <iostream>
 #include <sstream>
 #include <map>
+#include <unordered_map>
 #include <limits>
+#include <memory>
 #include <stdexcept>
 #include "Burglish/fontconv.h"
 #include "NGram/LookupEngine.h"
+#include "NGram/FlatTable.h"
+#include "NGram/NexusTrie.h"
+#include "NGram/BinaryModel.h"
 
 
 namespace waitzar
@@ -67,9 +73,9 @@ public:
 
 	//Information on the model's state
 	int getCurrSelectedID() const; //Returns -1 if PS, etc.
-	std::vector<char> getPossibleChars() const;
-	std::vector<unsigned int> getPossibleWords() const;
-	std::vector<int> getWordCombinations() const; //Tied to getPossibleWords
+	const std::vector<char>& getPossibleChars() const;
+	const std::vector<unsigned int>& getPossibleWords() const;
+	const std::vector<int>& getWordCombinations() const; //Tied to getPossibleWords
 	void insertTrigram(const std::vector<unsigned int> &trigrams);
 	unsigned int getFirstWordIndex() const;
 	int getNumberOfPages() const;
@@ -91,6 +97,7 @@ public:
 	std::pair<int, std::string> reverseLookupWord(std::wstring word);
 	unsigned short getSingleDigitID(unsigned short arabicNumeral);
 	bool addShortcut(const std::wstring &baseWord, const std::wstring &toStack, const std::wstring &resultStacked);
+	bool addShortcuts(const char* data, size_t size); //Every "pre + curr = post" line of, e.g., easypatsint.txt
 	bool isAllowNonBurmese();
 
 	//Re-order the model
@@ -108,14 +115,25 @@ public:
 	//For now
 	void debugOut(FILE *out);
 
+	//Save this model (including any user words) in the memory-mappable binary format
+	void saveBinaryModel(const std::string& path) const;
+
 private:
-	//Essential static data
-	std::vector< std::wstring > dictionary;
-	std::vector< std::vector<unsigned int> > nexus;
-	std::vector< std::vector<unsigned int> > prefix;
+	//Essential static data. These are flat tables, which can reference a mapped binary model in place.
+	FlatTable<unsigned short> dictionary;
+	NexusTrie nexus;
+	FlatTable<unsigned int> prefix;
 	std::vector< std::string > revLookup;
 	bool revLookupOn;
 
+	//Word -> dictionary ID, for getWordID(). Built lazily (a binary model may never need it),
+	//  then kept up to date as words are appended to the dictionary.
+	mutable std::unordered_map<std::wstring, unsigned int> wordIndex;
+	mutable size_t indexedWords;
+
+	//Keeps the mapped binary model (if any) alive as long as we reference it.
+	std::shared_ptr<BinaryModel> binaryModel;
+
 	//We could use a multimap of pairs, but I think a map of maps works better.
 	// This is arranged as: nexus -> pre_word_id -> combined_word_id
 	std::map<unsigned int, std::map<unsigned int, unsigned int> > shortcuts;
@@ -154,6 +172,7 @@ private:
 	void loadModel(char * model_buff, size_t model_buff_size, bool allowAnyChar);
     void loadModel(const char* modelFile, std::vector<std::string> userWordsFiles);
     void loadModel(const std::vector<std::wstring> &dictionary, const std::vector< std::vector<unsigned int> > &nexus, const std::vector< std::vector<unsigned int> > &prefix);
+	void loadBinaryModel(std::shared_ptr<BinaryModel> model, bool allowAnyChar);
 	void initModel();
 
 	//Internal stuff
@@ -179,6 +198,7 @@ private:
 	void buildReverseLookup();
 	void addReverseLookupItem(int wordID, const std::string &roman);
 	unsigned int getWordID(const std::wstring &wordStr) const;
+	void addDictionaryWord(const std::wstring &word);
 
 	//Inline
 	unsigned int toHex(char letter) const {
@@ -5,6 +5,7 @@
  */
 
 #include "wz_utilities.h"
+#include "NGram/Utf8Transcoder.h"
 
 using std::vector;
 using std::wstringstream;
@@ -208,7 +209,6 @@ namespace
 		uint64_t match_flags;
 		wstring match_additional;
 		wchar_t replace;
-		bool blacklisted;
 
 		Rule(int type, wchar_t atLetter, uint64_t matchFlags, const wstring& matchAdditional, wchar_t replace) {
 			this->type = type;
@@ -216,7 +216,6 @@ namespace
 			this->match_flags = matchFlags;
 			this->match_additional = matchAdditional;
 			this->replace = replace;
-			this->blacklisted = false;
 		}
 
 		wstring matchFlagsBin() const {
@@ -243,259 +242,158 @@ namespace
 			return res.str();
 		}
 	};
-	vector<Rule*> matchRules;
-	vector<wstring> reorderPairs;
 
+	//Our rules never change once built, so they can be shared between threads.
+	vector<Rule*> makeMatchRules()
+	{
+		vector<Rule*> res;
+		//Add initial rules; do this manually for now
+		//1-7
+		res.push_back(new Rule(RULE_MODIFY, L'\u102F', 0x7FFE00000, L"\u1009\u1025\u100A", ZG_TALL_SINGLE_LEG));
+		res.push_back(new Rule(RULE_MODIFY, L'\u1030', 0x7FFE00000, L"\u1009\u1025\u100A", ZG_TALL_DOUBLE_LEG));
+		res.push_back(new Rule(RULE_COMBINE, L'\u102F', 0x180000, L"", ZG_LEGS_BOTH_WAYS));
+		res.push_back(new Rule(RULE_COMBINE, L'\u1030', 0x180000, L"", ZG_LEGS_OF_THREE));
+		res.push_back(new Rule(RULE_MODIFY, L'\u1037', 0x1580018C000, L"\u1014", ZG_DOT_BELOW_SHIFT_1));
+		res.push_back(new Rule(RULE_MODIFY, L'\u1037', 0xA700E00000, L"\u101B", ZG_DOT_BELOW_SHIFT_2));
+		res.push_back(new Rule(RULE_MODIFY, ZG_DOT_BELOW_SHIFT_1, 0xA700E00000, L"\u101B", ZG_DOT_BELOW_SHIFT_2));
+		res.push_back(new Rule(RULE_COMBINE, L'\u103A', 0x8000, L"", ZG_TALL_WITH_ASAT));
 
-	bool isMyanmar(wchar_t letter)
+		//8
+		res.push_back(new Rule(RULE_COMBINE, L'\u1036', 0x800, L"", ZG_DOTTED_CIRCLE_ABOVE));
+
+		//A new rule! Combine "stacked TA" with "circle below"
+		res.push_back(new Rule(RULE_COMBINE, ZG_STACK_TA, 0x400000, L"", ZG_COMPLEX_5));
+
+		//9-14
+		res.push_back(new Rule(RULE_COMBINE, L'\u1036', 0x100, L"", ZG_KINZI_1036));
+		res.push_back(new Rule(RULE_COMBINE, L'\u102D', 0x100, L"", ZG_KINZI_102D));
+		res.push_back(new Rule(RULE_COMBINE, L'\u102E', 0x100, L"", ZG_KINZI_102E));
+		res.push_back(new Rule(RULE_COMBINE, L'\u102E', 0, L"\u1025", L'\u1026'));
+		res.push_back(new Rule(RULE_MODIFY, L'\u103E', 0xFF000000, L"\u1020\u100A", ZG_LEG_FWD_SMALL));
+		res.push_back(new Rule(RULE_COMBINE, L'\u103E', 0x400000, L"", ZG_LEGGED_CIRCLE_BELOW));
+		res.push_back(new Rule(RULE_COMBINE, ZG_LEG_FWD_SMALL, 0x400000, L"", ZG_LEGGED_CIRCLE_BELOW));
+		res.push_back(new Rule(RULE_ORDER, L'\u1036', 0xFF000000, L"", 0x0000));
+
+		//15-20
+		res.push_back(new Rule(RULE_ORDER, L'\u103C', 0x7, L"", 0x0000));
+		res.push_back(new Rule(RULE_ORDER, L'\u1031', 0x7, L"", 0x0000));
+		res.push_back(new Rule(RULE_ORDER, L'\u1031', 0xFF000000, L"", 0x0000));
+		res.push_back(new Rule(RULE_COMBINE, ZG_STACK_SA, 0x600000000, L"", ZG_YA_PIN_SA));
+		res.push_back(new Rule(RULE_MODIFY, L'\u103C', 0x4, L"", ZG_YA_YIT_LONG));
+		res.push_back(new Rule(RULE_MODIFY, L'\u103B', 0x100E00000, L"", ZG_YA_PIN_CUT));
+
+		//21-30
+		res.push_back(new Rule(RULE_MODIFY, ZG_STACK_SSA, 0x2, L"", ZG_STACK_SSA_INDENT));
+		res.push_back(new Rule(RULE_MODIFY, ZG_STACK_TA, 0x2, L"", ZG_STACK_TA_INDENT));
+		res.push_back(new Rule(RULE_MODIFY, ZG_STACK_HTA2, 0x2, L"", ZG_STACK_HTA2_INDENT));
+		res.push_back(new Rule(RULE_MODIFY, L'\u1014', 0x15F00F80000, L"", ZG_NA_CUT));
+		res.push_back(new Rule(RULE_MODIFY, L'\u1009', 0x15800800000, L"\u103A", L'\u1025'));
+		res.push_back(new Rule(RULE_MODIFY, L'\u101B', 0x1800000000, L"", ZG_YA_CUT));
+		res.push_back(new Rule(RULE_MODIFY, L'\u100A', 0x4000600000, L"", ZG_NYA_CUT));
+		res.push_back(new Rule(RULE_MODIFY, L'\u1025', 0x800000, L"", ZG_O_CUT));
+		res.push_back(new Rule(RULE_MODIFY, ZG_DOT_BELOW_SHIFT_1, 0x2000, L"", L'\u1037'));
+		res.push_back(new Rule(RULE_MODIFY, ZG_DOT_BELOW_SHIFT_2, 0x2000, L"", L'\u1037'));
+
+		//renderAsZawgyi() blacklists rules with a bitmask
+		if (res.size()>64)
+			throw std::runtime_error("Too many Zawgyi match rules");
+		return res;
+	}
+	const vector<Rule*>& getMatchRules()
 	{
-		return (letter>=0x1000 && letter<=0x1021)
-			|| (letter>=0x1023 && letter<=0x1032 && letter!=0x1028)
-			|| (letter>=0x1036 && letter<=0x104F);
+		static vector<Rule*> res = makeMatchRules();
+		return res;
 	}
 
-	bool isConsonant(wchar_t letter)
+	vector<wstring> makeReorderPairs()
+	{
+		vector<wstring> res;
+		res.push_back(L"\u102F\u102D");
+		res.push_back(L"\u103A\u102D");
+		res.push_back(L"\u103D\u102D");
+		res.push_back(L"\u1075\u102D");
+		res.push_back(L"\u102D\u1087");
+		res.push_back(L"\u103D\u102E");
+		res.push_back(L"\u103D\u103A");
+		res.push_back(L"\u1039\u103A");
+		res.push_back(L"\u1030\u102D");
+		res.push_back(L"\u1037\u1039");
+		res.push_back(L"\u1032\u1037");
+		res.push_back(L"\u1032\u1094");
+		res.push_back(L"\u1064\u1094");
+		res.push_back(L"\u102D\u1094");
+		res.push_back(L"\u102D\u1071");
+		res.push_back(L"\u1036\u1037");
+		res.push_back(L"\u1036\u1088");
+		res.push_back(L"\u1039\u1037");
+		res.push_back(L"\u102D\u1033");
+		res.push_back(L"\u103C\u1032");
+		res.push_back(L"\u103C\u102D");
+		res.push_back(L"\u103C\u102E");
+		res.push_back(L"\u1036\u102F");
+		res.push_back(L"\u1036\u1088");
+		res.push_back(L"\u1036\u103D");
+		res.push_back(L"\u1036\u103C");
+		res.push_back(L"\u103C\u107D");
+		res.push_back(L"\u1088\u102D");
+		res.push_back(L"\u1039\u103D");
+		res.push_back(L"\u108A\u107D");
+		res.push_back(L"\u103A\u1064");
+		res.push_back(L"\u1036\u1033");
+		return res;
+	}
+	const vector<wstring>& getReorderPairs()
 	{
-		return (letter>=0x1000 && letter<=0x1021)
-			|| (letter>=0x1023 && letter<=0x1027)
-			|| (letter==0x103F)
-			|| (letter==0x200B);
+		static vector<wstring> res = makeReorderPairs();
+		return res;
 	}
 
-	bool isDigit(wchar_t letter)
+
+	bool isMyanmar(wchar_t letter)
 	{
-		return (letter>=0x1040 && letter<=0x1049);
+		return (waitzar::GetMyanmarLetter(letter).classes&waitzar::MC_SORTABLE)!=0;
 	}
 
-	bool isPunctuation(wchar_t letter)
+	bool isConsonant(wchar_t letter)
 	{
-		return (letter==0x104A || letter==0x104B);
+		return (waitzar::GetMyanmarLetter(letter).classes&waitzar::MC_CONSONANT)!=0 || letter==0x200B;
 	}
 
 	bool shouldRestartCount(wchar_t letter)
 	{
-		return isConsonant(letter) || letter==0x1029 || letter==0x102A || isDigit(letter) || isPunctuation(letter) || !isMyanmar(letter);
+		return (waitzar::GetMyanmarLetter(letter).classes&waitzar::MC_RESTART)!=0;
 	}
 
 	//There are several other stopping conditions besides a stopping character
 	//For example, the last character in a string triggers a stop.
 	//uniString[i+1]==0x103A catches "vowell_a" followed by "asat". This might be hackish; not sure.
-	bool atStoppingPoint(const wstring &uniString, size_t id, size_t length)
+	bool atStoppingPoint(const wchar_t* uniString, size_t id, size_t length)
 	{
-		return id==length || (isMyanmar(uniString[id])&&uniString[id+1]==0x103A) || uniString[id]==0x103A || uniString[id]==0x1039;
+		return id==length || (isMyanmar(uniString[id])&&id+1<length&&uniString[id+1]==0x103A) || uniString[id]==0x103A || uniString[id]==0x1039;
 	}
 
 	int getRhymeID(wchar_t letter)
 	{
-		switch (letter)
-		{
-			case L'\u103B':
-				return ID_MED_Y;
-			case L'\u103C':
-				return ID_MED_R;
-			case L'\u103D':
-				return ID_MED_W;
-			case L'\u103E':
-				return ID_MED_H;
-			case L'\u1031':
-				return ID_VOW_E;
-			case L'\u102D':
-			case L'\u102E':
-			case L'\u1032':
-				return ID_VOW_ABOVE;
-			case L'\u102F':
-			case L'\u1030':
-				return ID_VOW_BELOW;
-			case L'\u102B':
-			case L'\u102C':
-				return ID_VOW_A;
-			case L'\u1036':
-				return ID_ANUSVARA;
-			case L'\u1037':
-				return ID_DOW_BELOW;
-			case L'\u1038':
-				return ID_VISARGA;
-			default:
-				return -1;
-		}
+		return waitzar::GetMyanmarLetter(letter).rhymeID;
 	}
 
 
 	int getBitflag(wchar_t uniLetter)
 	{
-		switch (uniLetter)
-		{
-			case L'\u1039':
-				return BF_STACKER;
-			case L'\u1037':
-				return BF_DOT_LOW;
-			case L'\u1036':
-				return BF_DOT_OVER;
-			case L'\u102B':
-			case L'\u102C':
-				return BF_VOW_AR;
-			case L'\u102F':
-			case L'\u1030':
-				return BF_LEG_NORM;
-			case L'\u102D':
-			case L'\u102E':
-			case L'\u1032':
-				return BF_VOW_OVER;
-			case L'\u1031':
-				return BF_VOW_A;
-			case L'\u103E':
-				return BF_LEG_REV;
-			case L'\u103D':
-				return BF_CIRC_LOW;
-			case L'\u103B':
-			case L'\u103C':
-				return BF_MED_YA;
-			case L'\u103A':
-				return BF_ASAT;
-			case L'\u1025':
-			case L'\u1027':
-			case L'\u1029':
-			case L'\u103F':
-			case ZG_DASH:
-				return BF_CONSONANT;
-			default:
-				if (uniLetter>=L'\u1000' && uniLetter<=L'\u1021')
-					return BF_CONSONANT;
-				return BF_OTHER;
-		}
+		return waitzar::GetMyanmarLetter(uniLetter).renderType;
 	}
 
 
+	//The bit index of getStage3BitFlags(letter), or -1
+	int getStage3LetterID(wchar_t letter)
+	{
+		return waitzar::GetMyanmarLetter(letter).stage3ID;
+	}
 
 	uint64_t getStage3BitFlags(wchar_t letter)
 	{
-		switch (letter) {
-			case L'\u1038':
-				return S3_VISARGA;
-			case L'\u102F':
-				return S3_LEG_SINGLE;
-			case ZG_TALL_SINGLE_LEG:
-				return S3_LEG_SINGLE_TALL;
-			case L'\u1030':
-				return S3_LEG_DOUBLE;
-			case ZG_TALL_DOUBLE_LEG:
-				return S3_LEG_DOUBLE_TALL;
-			case ZG_LEGS_BOTH_WAYS:
-				return S3_TWO_LEGS;
-			case ZG_LEGS_OF_THREE:
-				return S3_THREE_LEGS;
-			case L'\u103B':
-				return S3_MED_YA_PIN;
-			case ZG_YA_PIN_CUT:
-				return S3_MED_YA_PIN_SHORT;
-			case ZG_YA_PIN_SA:
-				return S3_MED_YA_PIN_SSA_STACK;
-			case L'\u103C':
-				return S3_MED_YA_YIT;
-			case ZG_YA_YIT_LONG:
-				return S3_MED_YA_YIT_LONG;
-			case ZG_YA_YIT_HIGHCUT:
-				return S3_MED_YA_YIT_HIGH_CUT;
-			case ZG_YA_YIT_LONG_HIGHCUT:
-				return S3_MED_YA_YIT_LONG_HIGH_CUT;
-			case ZG_YA_YIT_LOWCUT:
-				return S3_MED_YA_YIT_LOW_CUT;
-			case ZG_YA_YIT_LONG_LOWCUT:
-				return S3_MED_YA_YIT_LONG_LOW_CUT;
-			case ZG_YA_YIT_BOTHCUT:
-				return S3_MED_YA_YIT_BOTH_CUT;
-			case ZG_YA_YIT_LONG_BOTHCUT:
-				return S3_MED_YA_YIT_LONG_BOTH_CUT;
-			case L'\u103D':
-				return S3_CIRC_BELOW;
-			case ZG_LEGGED_CIRCLE_BELOW:
-				return S3_CIRC_BELOW_W_LEG;
-			case L'\u103E':
-				return S3_LEG_FWD;
-			case ZG_LEG_FWD_SMALL:
-				return S3_LEG_FWD_SMALL;
-			case L'\u1037':
-				return S3_DOT_BELOW;
-			case ZG_DOT_BELOW_SHIFT_1:
-				return S3_DOT_BELOW_2;
-			case ZG_DOT_BELOW_SHIFT_2:
-				return S3_DOT_BELOW_3;
-			case L'\u102B':
-				return S3_VOW_AR_TALL;
-			case ZG_TALL_WITH_ASAT:
-				return S3_VOW_AR_TALL_ASAT;
-			case L'\u102C':
-				return S3_VOW_AR_SHORT;
-			case L'\u1036':
-				return S3_DOT_ABOVE;
-			case L'\u102D':
-				return S3_CIRCLE_ABOVE;
-			case ZG_DOTTED_CIRCLE_ABOVE:
-				return S3_CIRCLE_DOT_ABOVE;
-			case L'\u102E':
-				return S3_CIRCLE_CROSSED_ABOVE;
-			case ZG_KINZI:
-				return S3_KINZI;
-			case ZG_KINZI_1036:
-				return S3_KINZI_DOT;
-			case ZG_KINZI_102D:
-				return S3_KINZI_CIRC;
-			case ZG_KINZI_102E:
-				return S3_KINZI_CIRC_CROSSED;
-			case L'\u1032':
-				return S3_MED_SLANT_ABOVE;
-			case L'\u1031':
-				return S3_VOW_A;
-			case L'\u1000':
-			case L'\u1003':
-			case L'\u1006':
-			case L'\u100F':
-			case L'\u1010':
-			case L'\u1011':
-			case L'\u1018':
-			case L'\u101A':
-			case L'\u101C':
-			case L'\u101E':
-			case L'\u101F':
-			case L'\u1021':
-			case L'\u103F':
-				return S3_CONSONANT_WIDE;
-			case L'\u1001':
-			case L'\u1002':
-			case L'\u1004':
-			case L'\u1005':
-			case L'\u1007':
-			case L'\u100E':
-			case L'\u1012':
-			case L'\u1013':
-			case L'\u1014':
-			case L'\u1015':
-			case L'\u1016':
-			case L'\u1017':
-			case L'\u1019':
-			case L'\u101B':
-			case L'\u101D':
-			case L'\u1027':
-			case ZG_NA_CUT:
-			case ZG_YA_CUT:
-				return S3_CONSONANT_NARROW;
-			case L'\u1008':
-			case L'\u1009':
-			case L'\u100A':
-			case ZG_NYA_CUT:
-			case L'\u100B':
-			case L'\u100C':
-			case L'\u100D':
-			case L'\u1020':
-			case L'\u1025':
-			case ZG_O_CUT:
-			case L'\u1029':
-				return S3_CONSONANT_OTHER;
-			default:
-				if (letter>=ZG_STACK_KA && letter<=ZG_STACK_HTA2_INDENT)
-					return S3_STACKED;
-				return S3_OTHER;
-		}
+		int id = getStage3LetterID(letter);
+		return id==-1 ? S3_OTHER : (((uint64_t)1)<<id);
 	}
 
 
@@ -836,60 +734,322 @@ namespace waitzar
 {
 
 
-//TODO: This will sometimes append "\0" to a string for no apparent reason.
-//      Try: U+1000 U+1037
-//      Need to fix eventually...
-std::wstring sortMyanmarString(const std::wstring &uniString)
+//Our pseudo-letters are looked up in runs of 32, starting at U+E000, U+E100 and U+E200.
+static_assert(ZG_KINZI<ZG_DASH+0x20 && ZG_STACK_HTA2_INDENT<ZG_STACK_KA+0x20 && ZG_O_CUT<ZG_COMPLEX_1+0x20, "Pseudo-letters don't fit in the MyanmarLetters table");
+
+//Columns: {classes, rhymeID, normalizeID, stage3ID, renderType}
+const MyanmarLetter MyanmarLetters[] = {
+	//The Myanmar block
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 2, BF_CONSONANT}, //U+1000
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+1001
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+1002
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 2, BF_CONSONANT}, //U+1003
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+1004
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+1005
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 2, BF_CONSONANT}, //U+1006
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+1007
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 0, BF_CONSONANT}, //U+1008
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 0, BF_CONSONANT}, //U+1009
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 0, BF_CONSONANT}, //U+100A
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 0, BF_CONSONANT}, //U+100B
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 0, BF_CONSONANT}, //U+100C
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 0, BF_CONSONANT}, //U+100D
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+100E
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 2, BF_CONSONANT}, //U+100F
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 2, BF_CONSONANT}, //U+1010
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 2, BF_CONSONANT}, //U+1011
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+1012
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+1013
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+1014
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+1015
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+1016
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+1017
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 2, BF_CONSONANT}, //U+1018
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+1019
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 2, BF_CONSONANT}, //U+101A
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+101B
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 2, BF_CONSONANT}, //U+101C
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+101D
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 2, BF_CONSONANT}, //U+101E
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 2, BF_CONSONANT}, //U+101F
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 0, BF_CONSONANT}, //U+1020
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 2, BF_CONSONANT}, //U+1021
+	{MC_BLOCK|MC_BASE|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1022
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1023
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1024
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 0, BF_CONSONANT}, //U+1025
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1026
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 1, BF_CONSONANT}, //U+1027
+	{MC_BLOCK|MC_BASE|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1028
+	{MC_BLOCK|MC_SORTABLE|MC_BASE|MC_RESTART, -1, -1, 0, BF_CONSONANT}, //U+1029
+	{MC_BLOCK|MC_SORTABLE|MC_BASE|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+102A
+	{MC_BLOCK|MC_SORTABLE, ID_VOW_A, 4, 15, BF_VOW_AR}, //U+102B
+	{MC_BLOCK|MC_SORTABLE, ID_VOW_A, 4, 13, BF_VOW_AR}, //U+102C
+	{MC_BLOCK|MC_SORTABLE, ID_VOW_ABOVE, 6, 11, BF_VOW_OVER}, //U+102D
+	{MC_BLOCK|MC_SORTABLE, ID_VOW_ABOVE, 6, 9, BF_VOW_OVER}, //U+102E
+	{MC_BLOCK|MC_SORTABLE, ID_VOW_BELOW, 5, 40, BF_LEG_NORM}, //U+102F
+	{MC_BLOCK|MC_SORTABLE, ID_VOW_BELOW, 5, 38, BF_LEG_NORM}, //U+1030
+	{MC_BLOCK|MC_SORTABLE, ID_VOW_E, 7, 3, BF_VOW_A}, //U+1031
+	{MC_BLOCK|MC_SORTABLE, ID_VOW_ABOVE, 3, 4, BF_VOW_OVER}, //U+1032
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1033
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1034
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1035
+	{MC_BLOCK|MC_SORTABLE, ID_ANUSVARA, 2, 12, BF_DOT_OVER}, //U+1036
+	{MC_BLOCK|MC_SORTABLE, ID_DOW_BELOW, 1, 18, BF_DOT_LOW}, //U+1037
+	{MC_BLOCK|MC_SORTABLE, ID_VISARGA, 0, 41, BF_OTHER}, //U+1038
+	{MC_BLOCK|MC_SORTABLE, -1, -1, -1, BF_STACKER}, //U+1039
+	{MC_BLOCK|MC_SORTABLE, -1, 12, -1, BF_ASAT}, //U+103A
+	{MC_BLOCK|MC_SORTABLE, ID_MED_Y, 11, 34, BF_MED_YA}, //U+103B
+	{MC_BLOCK|MC_SORTABLE, ID_MED_R, 10, 31, BF_MED_YA}, //U+103C
+	{MC_BLOCK|MC_SORTABLE, ID_MED_W, 9, 22, BF_CIRC_LOW}, //U+103D
+	{MC_BLOCK|MC_SORTABLE, ID_MED_H, 8, 20, BF_LEG_REV}, //U+103E
+	{MC_BLOCK|MC_SORTABLE|MC_CONSONANT|MC_BASE|MC_RESTART, -1, -1, 2, BF_CONSONANT}, //U+103F
+	{MC_BLOCK|MC_SORTABLE|MC_DIGIT|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1040
+	{MC_BLOCK|MC_SORTABLE|MC_DIGIT|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1041
+	{MC_BLOCK|MC_SORTABLE|MC_DIGIT|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1042
+	{MC_BLOCK|MC_SORTABLE|MC_DIGIT|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1043
+	{MC_BLOCK|MC_SORTABLE|MC_DIGIT|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1044
+	{MC_BLOCK|MC_SORTABLE|MC_DIGIT|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1045
+	{MC_BLOCK|MC_SORTABLE|MC_DIGIT|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1046
+	{MC_BLOCK|MC_SORTABLE|MC_DIGIT|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1047
+	{MC_BLOCK|MC_SORTABLE|MC_DIGIT|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1048
+	{MC_BLOCK|MC_SORTABLE|MC_DIGIT|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1049
+	{MC_BLOCK|MC_SORTABLE|MC_PUNCTUATION|MC_SIGN|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+104A
+	{MC_BLOCK|MC_SORTABLE|MC_PUNCTUATION|MC_SIGN|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+104B
+	{MC_BLOCK|MC_SORTABLE|MC_SIGN, -1, -1, -1, BF_OTHER}, //U+104C
+	{MC_BLOCK|MC_SORTABLE|MC_SIGN, -1, -1, -1, BF_OTHER}, //U+104D
+	{MC_BLOCK|MC_SORTABLE|MC_SIGN|MC_BASE, -1, -1, -1, BF_OTHER}, //U+104E
+	{MC_BLOCK|MC_SORTABLE|MC_SIGN, -1, -1, -1, BF_OTHER}, //U+104F
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1050
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1051
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1052
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1053
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1054
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1055
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1056
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1057
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1058
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1059
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+105A
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+105B
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+105C
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+105D
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+105E
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+105F
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1060
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1061
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1062
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1063
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1064
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1065
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1066
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1067
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1068
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1069
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+106A
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+106B
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+106C
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+106D
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+106E
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+106F
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1070
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1071
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1072
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1073
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1074
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1075
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1076
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1077
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1078
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1079
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+107A
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+107B
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+107C
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+107D
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+107E
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+107F
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1080
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1081
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1082
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1083
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1084
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1085
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1086
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1087
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1088
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1089
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+108A
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+108B
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+108C
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+108D
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+108E
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+108F
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1090
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1091
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1092
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1093
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1094
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1095
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1096
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1097
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1098
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+1099
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+109A
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+109B
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+109C
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+109D
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+109E
+	{MC_BLOCK|MC_RESTART, -1, -1, -1, BF_OTHER}, //U+109F
+	//Pseudo-letters, from U+E000
+	{MC_RESTART, -1, -1, -1, BF_CONSONANT}, //ZG_DASH
+	{MC_RESTART, -1, -1, 8, BF_OTHER}, //ZG_KINZI
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //(unused)
+	//Pseudo-letters, from U+E100
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_KA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_KHA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_GA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_GHA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_NGA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_SA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_SSA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_ZA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_ZHA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_NYA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_TTA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_HTA1
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_DHA1
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_EXTRA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_NHA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_TA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_HTA2
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_DDA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_DHA2
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_NA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_PA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_PHA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_VA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_BA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_MA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_YA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_LA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_THA
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_A
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_SSA_INDENT
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_TA_INDENT
+	{MC_RESTART, -1, -1, 23, BF_OTHER}, //ZG_STACK_HTA2_INDENT
+	//Pseudo-letters, from U+E200
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //ZG_COMPLEX_1
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //ZG_COMPLEX_2
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //ZG_COMPLEX_3
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //ZG_COMPLEX_4
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //ZG_COMPLEX_5
+	{MC_RESTART, -1, -1, -1, BF_OTHER}, //ZG_COMPLEX_NA
+	{MC_RESTART, -1, -1, 14, BF_OTHER}, //ZG_TALL_WITH_ASAT
+	{MC_RESTART, -1, -1, 10, BF_OTHER}, //ZG_DOTTED_CIRCLE_ABOVE
+	{MC_RESTART, -1, -1, 21, BF_OTHER}, //ZG_LEGGED_CIRCLE_BELOW
+	{MC_RESTART, -1, -1, 36, BF_OTHER}, //ZG_LEGS_BOTH_WAYS
+	{MC_RESTART, -1, -1, 35, BF_OTHER}, //ZG_LEGS_OF_THREE
+	{MC_RESTART, -1, -1, 6, BF_OTHER}, //ZG_KINZI_102D
+	{MC_RESTART, -1, -1, 5, BF_OTHER}, //ZG_KINZI_102E
+	{MC_RESTART, -1, -1, 7, BF_OTHER}, //ZG_KINZI_1036
+	{MC_RESTART, -1, -1, 17, BF_OTHER}, //ZG_DOT_BELOW_SHIFT_1
+	{MC_RESTART, -1, -1, 16, BF_OTHER}, //ZG_DOT_BELOW_SHIFT_2
+	{MC_RESTART, -1, -1, 39, BF_OTHER}, //ZG_TALL_SINGLE_LEG
+	{MC_RESTART, -1, -1, 37, BF_OTHER}, //ZG_TALL_DOUBLE_LEG
+	{MC_RESTART, -1, -1, 33, BF_OTHER}, //ZG_YA_PIN_CUT
+	{MC_RESTART, -1, -1, 32, BF_OTHER}, //ZG_YA_PIN_SA
+	{MC_RESTART, -1, -1, 30, BF_OTHER}, //ZG_YA_YIT_LONG
+	{MC_RESTART, -1, -1, 29, BF_OTHER}, //ZG_YA_YIT_HIGHCUT
+	{MC_RESTART, -1, -1, 28, BF_OTHER}, //ZG_YA_YIT_LONG_HIGHCUT
+	{MC_RESTART, -1, -1, 27, BF_OTHER}, //ZG_YA_YIT_LOWCUT
+	{MC_RESTART, -1, -1, 26, BF_OTHER}, //ZG_YA_YIT_LONG_LOWCUT
+	{MC_RESTART, -1, -1, 25, BF_OTHER}, //ZG_YA_YIT_BOTHCUT
+	{MC_RESTART, -1, -1, 24, BF_OTHER}, //ZG_YA_YIT_LONG_BOTHCUT
+	{MC_RESTART, -1, -1, 19, BF_OTHER}, //ZG_LEG_FWD_SMALL
+	{MC_RESTART, -1, -1, 1, BF_OTHER}, //ZG_NA_CUT
+	{MC_RESTART, -1, -1, 1, BF_OTHER}, //ZG_YA_CUT
+	{MC_RESTART, -1, -1, 0, BF_OTHER}, //ZG_NYA_CUT
+	{MC_RESTART, -1, -1, 0, BF_OTHER}, //ZG_O_CUT
+	//Everything else
+	{MC_RESTART, -1, -1, -1, BF_OTHER}
+};
+static_assert(sizeof(MyanmarLetters)/sizeof(MyanmarLetter)==0xA0+3*0x20+1, "MyanmarLetters is the wrong size");
+
+
+size_t sortMyanmarString(const wchar_t* uniString, size_t length, wchar_t* dest)
 {
 	//Count array for use with counting sort
-	//We store a count, but we also need separate strings for the types.
-	wstring res;
+	//Most rhymes have only one letter, so we just count them. Vowels above, below and "ar"
+	//  can differ, so we re-scan the syllable for those (in order) rather than buffering them.
 	int rhyme_flags[ID_TOTAL];
 	wchar_t rhyme_vals[ID_TOTAL];
-	size_t len = uniString.length();
-	wstring vow_above_buffer;
-	wstring vow_below_buffer;
-	wstring vow_ar_buffer;
-	for (int res=0; res<ID_TOTAL; res++) {
-		rhyme_flags[res] = 0;
-		rhyme_vals[res] = 0x0000;
+	for (int id=0; id<ID_TOTAL; id++) {
+		rhyme_flags[id] = 0;
+		rhyme_vals[id] = 0x0000;
 	}
 
 	//Scan each letter
-	//size_t destI = 0;    //Allows us to eliminate duplicate letters
+	size_t destID = 0;
 	size_t prevStop = 0; //What was our last-processed letter
-	for (size_t i=0; i<=len;) { //We count up to the trailing 0x0
+	for (size_t i=0; i<=length;) { //The end of the string counts as a stop
 		//Does this letter restart our algorithm?
-		if (atStoppingPoint(uniString, i, len) || shouldRestartCount(uniString[i]) || getRhymeID(uniString[i])==-1) {
+		if (atStoppingPoint(uniString, i, length) || shouldRestartCount(uniString[i]) || getRhymeID(uniString[i])==-1) {
 			//Now that we've counted, sort
 			if (i!=prevStop) {
 				for (int x=0; x<ID_TOTAL; x++) {
+					if (rhyme_flags[x]==0)
+						continue;
+
 					//Add and restart
-					for (int r_i=0; r_i <rhyme_flags[x]; r_i++) {
-						wchar_t letter = rhyme_vals[x];
-						if (x==ID_VOW_ABOVE)
-							letter = vow_above_buffer[r_i];
-						else if (x==ID_VOW_BELOW)
-							letter = vow_below_buffer[r_i];
-						else if (x==ID_VOW_A)
-							letter = vow_ar_buffer[r_i];
-						res += letter;
+					if (x==ID_VOW_ABOVE || x==ID_VOW_BELOW || x==ID_VOW_A) {
+						for (size_t r_i=prevStop; r_i<i; r_i++) {
+							if (getRhymeID(uniString[r_i])==x)
+								dest[destID++] = uniString[r_i];
+						}
+					} else {
+						for (int r_i=0; r_i <rhyme_flags[x]; r_i++)
+							dest[destID++] = rhyme_vals[x];
 					}
 					rhyme_flags[x] = 0;
 					rhyme_vals[x] = 0x0000;
 				}
-				vow_above_buffer.clear();
-				vow_below_buffer.clear();
-				vow_ar_buffer.clear();
-				//vow_above_index = 0;
-				//vow_below_index = 0;
-				//vow_ar_index = 0;
 			}
 
 			//Increment if this is asat or virama
-			res += uniString[i++];
-			while (i<len && (uniString[i]==0x103A||uniString[i]==0x1039||shouldRestartCount(uniString[i])))
-				 res += uniString[i++];
+			if (i==length)
+				break;
+			dest[destID++] = uniString[i++];
+			while (i<length && (uniString[i]==0x103A||uniString[i]==0x1039||shouldRestartCount(uniString[i])))
+				 dest[destID++] = uniString[i++];
 
 			//Don't sort until after this point
 			prevStop = i;
@@ -900,23 +1060,27 @@ std::wstring sortMyanmarString(const std::wstring &uniString)
 		int rhymeID = getRhymeID(uniString[i]);
 		rhyme_flags[rhymeID] += 1;
 		rhyme_vals[rhymeID] = uniString[i];
-		if (rhymeID == ID_VOW_ABOVE)
-			vow_above_buffer.push_back(uniString[i]);
-		else if (rhymeID == ID_VOW_BELOW)
-			vow_below_buffer.push_back(uniString[i]);
-		else if (rhymeID == ID_VOW_A)
-			vow_ar_buffer.push_back(uniString[i]);
 
 		//Standard increment
 		i++;
 	}
 
+	dest[destID] = 0x0000;
+	return destID;
+}
+
+
+//TODO: This has always returned the sorted string with a trailing "\0".
+//      Some callers (e.g., BurglishBuilder) rely on this; fix them first.
+std::wstring sortMyanmarString(const std::wstring &uniString)
+{
+	wstring res(uniString.length()+1, L'\0');
+	sortMyanmarString(uniString.data(), uniString.length(), &res[0]);
 	return res;
 }
 
 
 
-//TODO: Merge readUTF8File with this, and also clean up mymbstowcs
 string ReadBinaryFile(const string& path)
 {
 	//Open the file, read-only, binary.
@@ -929,16 +1093,13 @@ string ReadBinaryFile(const string& path)
 	long fileSize = ftell(userFile);
 	rewind(userFile);
 
-	//Read that file as a sequence of bytes
-	char* buffer = new char[fileSize];
-	size_t buff_size = fread(buffer, 1, fileSize, userFile);
+	//Read that file directly into our result
+	string res;
+	if (fileSize>0) {
+		res.resize(fileSize);
+		res.resize(fread(&res[0], 1, fileSize, userFile));
+	}
 	fclose(userFile);
-	if (buff_size==0)
-		return ""; //Empty file
-
-	//Done, clean up resources
-	string res = string(buffer, fileSize);
-	delete [] buffer;
 
 	//And return
 	return res;
@@ -954,54 +1115,65 @@ wstring readUTF8File(const string& path)
 	if (userFile == NULL)
 		throw std::runtime_error(std::string("File doesn't exist: " + path).c_str()); //File doesn't exist
 
-	//Get file size
+	//Get file size; the decoded text is never longer than this.
 	fseek (userFile, 0, SEEK_END);
 	long fileSize = ftell(userFile);
 	rewind(userFile);
-
-	//Read that file as a sequence of bytes
-	char* buffer = new char[fileSize];
-	size_t buff_size = fread(buffer, 1, fileSize, userFile);
+	wstring res;
+	res.resize(Utf8Decoder::MaxDecodedLength(fileSize>0?fileSize:0));
+
+	//Decode the file in chunks, straight into our result.
+	char buffer[16*1024];
+	Utf8Decoder decoder;
+	size_t numUniChars = 0;
+	try {
+		for (;;) {
+			size_t numRead = fread(buffer, 1, sizeof(buffer), userFile);
+			if (numRead==0)
+				break;
+			if (res.size() < numUniChars+Utf8Decoder::MaxDecodedLength(numRead)) //File grew?
+				res.resize(numUniChars+Utf8Decoder::MaxDecodedLength(numRead));
+			numUniChars += decoder.decode(buffer, numRead, &res[numUniChars]);
+		}
+		decoder.finish();
+	} catch (std::exception& ex) {
+		fclose(userFile);
+		throw std::runtime_error(std::string(ex.what()) + " in file: " + path); //Invalid UTF-8 characters
+	}
 	fclose(userFile);
-	if (buff_size==0)
-		return L""; //Empty file
-
-	//Finally, convert this array to unicode
-	wchar_t * uniBuffer = new wchar_t[buff_size];
-	size_t numUniChars = mymbstowcs(NULL, buffer, buff_size);
-	/*if (buff_size==numUniChars) {
-		std::stringstream msg;
-		msg <<"Error reading file. Buffer size: " <<buff_size << " , numUniChars: " <<numUniChars;
-		throw std::runtime_error(msg.str().c_str()); //Conversion probably failed.
-	}*/ //Not true! What about an ascii-only file?
-	uniBuffer = new wchar_t[numUniChars]; // (wchar_t*) malloc(sizeof(wchar_t)*numUniChars);
-	if (mymbstowcs(uniBuffer, buffer, buff_size)==0)
-		throw std::runtime_error("Invalid UTF-8 characters in file."); //Invalid UTF-8 characters
-
-	//Done, clean up resources
-	wstring res = wstring(uniBuffer, numUniChars);
-	delete [] buffer;
-	delete [] uniBuffer;
 
 	//And return
+	res.resize(numUniChars);
 	return res;
 }
 
 
 
-wstring renderAsZawgyi(const wstring &uniString)
+size_t ZawgyiScratchSize(size_t length)
 {
-	//Temp:
-	if (uniString.empty())
-		return uniString;
+	//Step 1 can grow each letter to three (dash, U+1005, U+103B); nothing after that adds letters.
+	return length*3 + 1;
+}
 
-	const std::wstring tab = L"   ";
-	Logger::writeLogLine('Z', tab + L"norm: {" + uniString + L"}");
 
-	//For now, just wrap a low-level data structure.
-	//  I want to re-write the entire algorithm to use
-	//  bitflags, so for now we'll just preserve the STL interface.
-	wchar_t zawgyiStr[1000];
+size_t renderAsZawgyi(const wchar_t* uniString, size_t length, wchar_t* scratch, size_t scratchSize)
+{
+	if (scratchSize < ZawgyiScratchSize(length))
+		throw std::runtime_error("Not enough scratch space to render Zawgyi text");
+
+	//Anything after an embedded zero was always ignored.
+	length = std::find(uniString, uniString+length, L'\0') - uniString;
+
+	//Building log lines is expensive; only do it if someone's reading them.
+	const bool logging = Logger::isLogging('Z');
+	const std::wstring tab(logging ? 3 : 0, L' ');
+	if (logging)
+		Logger::writeLogLine('Z', tab + L"norm: {" + wstring(uniString, length) + L"}");
+
+	//Every step works in the scratch buffer. Step 1 writes at most three letters for each one
+	//  it reads, so it can read from the same buffer as long as the input starts at least 2*length letters in.
+	//  Every other step only shrinks the string, so they all work in-place.
+	wchar_t* zawgyiStr = scratch;
 
 	//Perform conversion
 	//Step 1: Determine which finals won't likely combine; add
@@ -1011,7 +1183,6 @@ wstring renderAsZawgyi(const wstring &uniString)
 	int prevType = BF_OTHER;
 	int currType;
 	size_t destID = 0;
-	size_t length = uniString.length();
 	for (size_t i=0; i<length; i++) {
 		//Get the current letter and type
 		currLetter = uniString[i];
@@ -1063,13 +1234,14 @@ wstring renderAsZawgyi(const wstring &uniString)
 	zawgyiStr[destID] = 0x0000;
 
 
-	Logger::writeLogLine('Z', tab + L"dash: {" + wstring(zawgyiStr, destID) + L"}");
+	if (logging)
+		Logger::writeLogLine('Z', tab + L"dash: {" + wstring(zawgyiStr, destID) + L"}");
 
 
 	//Step 2: Stack letters. This will only reduce the string's length, so
 	//  we can perform it in-place.
+	length = destID;
 	destID = 0;
-	length = wcslen(zawgyiStr);
 	prevLetter = 0x0000;
 	prevType = BF_OTHER;
 	for (size_t i=0; i<length; i++) {
@@ -1087,7 +1259,7 @@ wstring renderAsZawgyi(const wstring &uniString)
 			wchar_t stacked = getStackedVersion(currLetter);
 			if (stacked!=0) {
 				//General case
-				int oldDestID = destID;
+				size_t oldDestID = destID;
 				if (zawgyiLetter(stacked)!=0x003F) {
 					destID--;
 					currLetter = stacked;
@@ -1104,7 +1276,7 @@ wstring renderAsZawgyi(const wstring &uniString)
 					} else if (stacked==ZG_STACK_DHA1 && zawgyiStr[oldDestID-2]==L'\u100F') {
 						destID = oldDestID-2;
 						currLetter = ZG_COMPLEX_NA;
-					} else if (zawgyiStr[destID-2]==L'\u100D' && zawgyiStr[destID-1]==L'\u1039') {
+					} else if (destID>=2 && zawgyiStr[destID-2]==L'\u100D' && zawgyiStr[destID-1]==L'\u1039') {
 						//There are a few letters without a rendering in Zawgyi that can stack specially.
 						// So, the "if" block might look different for this one.
 						if (zawgyiStr[destID]==L'\u100D') {
@@ -1129,60 +1301,16 @@ wstring renderAsZawgyi(const wstring &uniString)
 	zawgyiStr[destID++] = 0x0000;
 
 
-	Logger::writeLogLine('Z', tab + L"stck: {" + wstring(zawgyiStr, destID) + L"}");
+	if (logging)
+		Logger::writeLogLine('Z', tab + L"stck: {" + wstring(zawgyiStr, destID) + L"}");
 
 
 	//Step 3: Apply a series of specific rules
-	if (matchRules.empty()) {
-		//Add initial rules; do this manually for now
-		//1-7
-		matchRules.push_back(new Rule(RULE_MODIFY, L'\u102F', 0x7FFE00000, L"\u1009\u1025\u100A", ZG_TALL_SINGLE_LEG));
-		matchRules.push_back(new Rule(RULE_MODIFY, L'\u1030', 0x7FFE00000, L"\u1009\u1025\u100A", ZG_TALL_DOUBLE_LEG));
-		matchRules.push_back(new Rule(RULE_COMBINE, L'\u102F', 0x180000, L"", ZG_LEGS_BOTH_WAYS));
-		matchRules.push_back(new Rule(RULE_COMBINE, L'\u1030', 0x180000, L"", ZG_LEGS_OF_THREE));
-		matchRules.push_back(new Rule(RULE_MODIFY, L'\u1037', 0x1580018C000, L"\u1014", ZG_DOT_BELOW_SHIFT_1));
-		matchRules.push_back(new Rule(RULE_MODIFY, L'\u1037', 0xA700E00000, L"\u101B", ZG_DOT_BELOW_SHIFT_2));
-		matchRules.push_back(new Rule(RULE_MODIFY, ZG_DOT_BELOW_SHIFT_1, 0xA700E00000, L"\u101B", ZG_DOT_BELOW_SHIFT_2));
-		matchRules.push_back(new Rule(RULE_COMBINE, L'\u103A', 0x8000, L"", ZG_TALL_WITH_ASAT));
+	const vector<Rule*>& matchRules = getMatchRules();
+	uint64_t blacklisted = 0; //One bit per rule
 
-		//8
-		matchRules.push_back(new Rule(RULE_COMBINE, L'\u1036', 0x800, L"", ZG_DOTTED_CIRCLE_ABOVE));
-
-		//A new rule! Combine "stacked TA" with "circle below"
-		matchRules.push_back(new Rule(RULE_COMBINE, ZG_STACK_TA, 0x400000, L"", ZG_COMPLEX_5));
-
-		//9-14
-		matchRules.push_back(new Rule(RULE_COMBINE, L'\u1036', 0x100, L"", ZG_KINZI_1036));
-		matchRules.push_back(new Rule(RULE_COMBINE, L'\u102D', 0x100, L"", ZG_KINZI_102D));
-		matchRules.push_back(new Rule(RULE_COMBINE, L'\u102E', 0x100, L"", ZG_KINZI_102E));
-		matchRules.push_back(new Rule(RULE_COMBINE, L'\u102E', 0, L"\u1025", L'\u1026'));
-		matchRules.push_back(new Rule(RULE_MODIFY, L'\u103E', 0xFF000000, L"\u1020\u100A", ZG_LEG_FWD_SMALL));
-		matchRules.push_back(new Rule(RULE_COMBINE, L'\u103E', 0x400000, L"", ZG_LEGGED_CIRCLE_BELOW));
-		matchRules.push_back(new Rule(RULE_COMBINE, ZG_LEG_FWD_SMALL, 0x400000, L"", ZG_LEGGED_CIRCLE_BELOW));
-		matchRules.push_back(new Rule(RULE_ORDER, L'\u1036', 0xFF000000, L"", 0x0000));
-
-		//15-20
-		matchRules.push_back(new Rule(RULE_ORDER, L'\u103C', 0x7, L"", 0x0000));
-		matchRules.push_back(new Rule(RULE_ORDER, L'\u1031', 0x7, L"", 0x0000));
-		matchRules.push_back(new Rule(RULE_ORDER, L'\u1031', 0xFF000000, L"", 0x0000));
-		matchRules.push_back(new Rule(RULE_COMBINE, ZG_STACK_SA, 0x600000000, L"", ZG_YA_PIN_SA));
-		matchRules.push_back(new Rule(RULE_MODIFY, L'\u103C', 0x4, L"", ZG_YA_YIT_LONG));
-		matchRules.push_back(new Rule(RULE_MODIFY, L'\u103B', 0x100E00000, L"", ZG_YA_PIN_CUT));
-
-		//21-30
-		matchRules.push_back(new Rule(RULE_MODIFY, ZG_STACK_SSA, 0x2, L"", ZG_STACK_SSA_INDENT));
-		matchRules.push_back(new Rule(RULE_MODIFY, ZG_STACK_TA, 0x2, L"", ZG_STACK_TA_INDENT));
-		matchRules.push_back(new Rule(RULE_MODIFY, ZG_STACK_HTA2, 0x2, L"", ZG_STACK_HTA2_INDENT));
-		matchRules.push_back(new Rule(RULE_MODIFY, L'\u1014', 0x15F00F80000, L"", ZG_NA_CUT));
-		matchRules.push_back(new Rule(RULE_MODIFY, L'\u1009', 0x15800800000, L"\u103A", L'\u1025'));
-		matchRules.push_back(new Rule(RULE_MODIFY, L'\u101B', 0x1800000000, L"", ZG_YA_CUT));
-		matchRules.push_back(new Rule(RULE_MODIFY, L'\u100A', 0x4000600000, L"", ZG_NYA_CUT));
-		matchRules.push_back(new Rule(RULE_MODIFY, L'\u1025', 0x800000, L"", ZG_O_CUT));
-		matchRules.push_back(new Rule(RULE_MODIFY, ZG_DOT_BELOW_SHIFT_1, 0x2000, L"", L'\u1037'));
-		matchRules.push_back(new Rule(RULE_MODIFY, ZG_DOT_BELOW_SHIFT_2, 0x2000, L"", L'\u1037'));
-	}
-
-	Logger::writeLogLine('Z', tab + L"Begin Match");
+	if (logging)
+		Logger::writeLogLine('Z', tab + L"Begin Match");
 
 
 	//We maintain a series of offsets for the most recent match. This is used to speed up the process of
@@ -1194,7 +1322,7 @@ wstring renderAsZawgyi(const wstring &uniString)
 	uint64_t currMatchFlags = 0;
 	for (size_t i=0; i<S3_TOTAL_FLAGS; i++)
 		firstOccurrence[i] = -1;
-	length = wcslen(zawgyiStr);
+	length = destID-1; //Not counting the trailing zero
 	size_t prevConsonant = 0;
 	//int kinziCascade = 0;
 	bool switchedKinziOnce = false;
@@ -1202,7 +1330,7 @@ wstring renderAsZawgyi(const wstring &uniString)
 		//Get properties on this letter
 		wchar_t currLetter = zawgyiStr[i];
 		uint64_t currFlag = getStage3BitFlags(currLetter);
-		int currFlagID = getStage3ID(currFlag);
+		int currFlagID = getStage3LetterID(currLetter);
 
 		//Are we at a stopping point?
 		//NOTE: kinzi occurs before the consonant for Unicode
@@ -1210,7 +1338,7 @@ wstring renderAsZawgyi(const wstring &uniString)
 			//First, scan for and fix "tall leg"s
 			for (size_t x=i-1; x>=prevConsonant&&x<length; x--) { //Note: checking x<length is a very weird way of handling overflow (it works, though)
 				if (zawgyiStr[x]==0x102F || zawgyiStr[x]==0x1030) {
-					Rule *r = matchRules[zawgyiStr[x]-0x102F];
+					const Rule *r = matchRules[zawgyiStr[x]-0x102F];
 					bool matches = ((r->match_flags&currMatchFlags)!=0);
 					if (!matches) {
 						for (size_t sID=0; sID<r->match_additional.length()&&!matches; sID++) {
@@ -1223,10 +1351,11 @@ wstring renderAsZawgyi(const wstring &uniString)
 					}
 
 					if (matches) {
-						Logger::writeLogLine('Z', tab+tab + r->toString() + L"  (pre)");
+						if (logging)
+							Logger::writeLogLine('Z', tab+tab + r->toString() + L"  (pre)");
 
-						int currID = getStage3ID(getStage3BitFlags(zawgyiStr[x]));
-						int replacementID = getStage3ID(getStage3BitFlags(r->replace));
+						int currID = getStage3LetterID(zawgyiStr[x]);
+						int replacementID = getStage3LetterID(r->replace);
 						if (currID!=-1) {
 							currMatchFlags ^= getStage3BitFlags(zawgyiStr[x]);
 							firstOccurrence[currID] = -1;
@@ -1241,10 +1370,12 @@ wstring renderAsZawgyi(const wstring &uniString)
 			}
 
 			//Apply our filters, from right-to-left
-			wstringstream lLine;
-			if ((i-1)<length)
-				lLine <<L"Dealing with syllable from " <<(i-1) <<" to " <<prevConsonant;
-			Logger::writeLogLine('Z', tab+tab + lLine.str());
+			if (logging) {
+				wstringstream lLine;
+				if ((i-1)<length)
+					lLine <<L"Dealing with syllable from " <<(i-1) <<" to " <<prevConsonant;
+				Logger::writeLogLine('Z', tab+tab + lLine.str());
+			}
 			for (size_t x=i-1; x>=prevConsonant&&x<length; x--) {
 				bool resetRules = false;
 				for (size_t ruleID=2; ruleID<matchRules.size(); ruleID++) {
@@ -1254,7 +1385,7 @@ wstring renderAsZawgyi(const wstring &uniString)
 					}
 
 					//Unfortunately, we have to apply ALL filters.
-					Rule *r = matchRules[ruleID];
+					const Rule *r = matchRules[ruleID];
 					if (r->at_letter!=zawgyiStr[x])
 						continue;
 
@@ -1282,14 +1413,15 @@ wstring renderAsZawgyi(const wstring &uniString)
 							matchLoc = firstOccurrence[matchLoc];
 					}
 
-					Logger::writeLogLine('Z', tab+tab + r->toString());
+					if (logging)
+						Logger::writeLogLine('Z', tab+tab + r->toString());
 
 					//Then, apply the rule. Make sure to keep our index array up-to-date
 					//Note that protocol specifies that we DON'T re-scan for the next occurrence of a medial
 					//  after modifying or combining it.
 					int matchResID = getStage3ID(matchRes);
-					int replacementID = getStage3ID(getStage3BitFlags(r->replace));
-					int currID = getStage3ID(getStage3BitFlags(zawgyiStr[x]));
+					int replacementID = getStage3LetterID(r->replace);
+					int currID = getStage3LetterID(zawgyiStr[x]);
 					bool checkMissingRules = false;
 					switch (r->type) {
 						case RULE_MODIFY:
@@ -1313,16 +1445,18 @@ wstring renderAsZawgyi(const wstring &uniString)
 								break; //Our rules shouldn't have this problem.
 							if ((int)x<matchLoc)
 								break; //Don't shift right
-							if (r->blacklisted)
+							if ((blacklisted&(1ULL<<ruleID))!=0)
 								break; //Avoid cycles
 
-							wstringstream logLine;
-							logLine <<L"shift sequence[" <<matchLoc <<".." <<x <<"] right 1, wrap around";
-							Logger::writeLogLine('Z', tab+tab+tab + logLine.str());
+							if (logging) {
+								wstringstream logLine;
+								logLine <<L"shift sequence[" <<matchLoc <<".." <<x <<"] right 1, wrap around";
+								Logger::writeLogLine('Z', tab+tab+tab + logLine.str());
+							}
 
 							wchar_t prevLetter = zawgyiStr[x];
 							for (size_t repID=matchLoc; repID<=x; repID++) {
-								int prevID = getStage3ID(getStage3BitFlags(prevLetter));
+								int prevID = getStage3LetterID(prevLetter);
 								if (prevID!=-1)
 									firstOccurrence[prevID] = repID;
 								wchar_t cached = zawgyiStr[repID];
@@ -1333,7 +1467,7 @@ wstring renderAsZawgyi(const wstring &uniString)
 							//We actually have to apply rules from the beginning, unfortunately. However,
 							// we prevent an infinite cycle by blacklisting this rule until the next
 							// consonant occurs.
-							r->blacklisted = true;
+							blacklisted |= (1ULL<<ruleID);
 							resetRules = true;
 
 							break;
@@ -1367,8 +1501,8 @@ wstring renderAsZawgyi(const wstring &uniString)
 					//Double-check for missing rules
 					if (checkMissingRules && /*TEMP*/false/*ENDTEMP*/  /*Logger::isLogging('L')*/) {
 						for (size_t prevRule=2; prevRule < ruleID; prevRule++) {
-							Rule *r = matchRules[prevRule];
-							if (r->at_letter==zawgyiStr[x] && ((r->match_flags&currMatchFlags)!=0) && !r->blacklisted) {
+							const Rule *r = matchRules[prevRule];
+							if (r->at_letter==zawgyiStr[x] && ((r->match_flags&currMatchFlags)!=0) && (blacklisted&(1ULL<<prevRule))==0) {
 								matchLoc = -1;
 								matchLoc = getStage3ID(r->match_flags&currMatchFlags);
 								if (r->type==RULE_ORDER && (int)x<matchLoc)
@@ -1440,9 +1574,11 @@ wstring renderAsZawgyi(const wstring &uniString)
 				}
 				zawgyiStr[yaYitID] = yaFinal;
 
-				std::wstringstream logline;
-				logline <<L"YA at [" <<yaYitID <<L"], cut? " <<cutTop <<"T  " <<cutBottom <<"B";
-				Logger::writeLogLine('Z', tab+tab + logline.str());
+				if (logging) {
+					std::wstringstream logline;
+					logline <<L"YA at [" <<yaYitID <<L"], cut? " <<cutTop <<"T  " <<cutBottom <<"B";
+					Logger::writeLogLine('Z', tab+tab + logline.str());
+				}
 			}
 
 
@@ -1465,13 +1601,12 @@ wstring renderAsZawgyi(const wstring &uniString)
 				}
 
 				//Reset our black-list.
-				for (size_t rID=0; rID<matchRules.size(); rID++)
-					matchRules[rID]->blacklisted = false;
+				blacklisted = 0;
 
 				//Reeset letter & flags
 				currLetter = zawgyiStr[i];
 				currFlag = getStage3BitFlags(currLetter);
-				currFlagID = getStage3ID(currFlag);
+				currFlagID = getStage3LetterID(currLetter);
 
 				//Propagate
 				if (currFlagID!=-1) {
@@ -1507,8 +1642,10 @@ wstring renderAsZawgyi(const wstring &uniString)
 		}
 	}
 
-	Logger::writeLogLine('Z', tab + L"End Match");
-	Logger::writeLogLine('Z', tab + L"mtch: {" + wstring(zawgyiStr, length) + L"}");
+	if (logging) {
+		Logger::writeLogLine('Z', tab + L"End Match");
+		Logger::writeLogLine('Z', tab + L"mtch: {" + wstring(zawgyiStr, length) + L"}");
+	}
 
 	//Step 4: Convert each letter to its Zawgyi-equivalent
 	//length = wcslen(zawgyiStr); //Keep embedded zeroes
@@ -1521,52 +1658,22 @@ wstring renderAsZawgyi(const wstring &uniString)
 	zawgyiStr[destID++] = 0x0000;
 
 
-	Logger::writeLogLine('Z', tab + L"subs: {" + wstring(zawgyiStr, destID) + L"}");
-	Logger::writeLogLine('Z', tab + L"Begin Re-Ordering");
+	if (logging) {
+		Logger::writeLogLine('Z', tab + L"subs: {" + wstring(zawgyiStr, destID) + L"}");
+		Logger::writeLogLine('Z', tab + L"Begin Re-Ordering");
+	}
 
 
 	//Stage 5: Apply rules for re-ordering the Zawgyi text to fit our weird model.
-	length = wcslen(zawgyiStr);
-	if (reorderPairs.size()==0) {
-		reorderPairs.push_back(L"\u102F\u102D");
-		reorderPairs.push_back(L"\u103A\u102D");
-		reorderPairs.push_back(L"\u103D\u102D");
-		reorderPairs.push_back(L"\u1075\u102D");
-		reorderPairs.push_back(L"\u102D\u1087");
-		reorderPairs.push_back(L"\u103D\u102E");
-		reorderPairs.push_back(L"\u103D\u103A");
-		reorderPairs.push_back(L"\u1039\u103A");
-		reorderPairs.push_back(L"\u1030\u102D");
-		reorderPairs.push_back(L"\u1037\u1039");
-		reorderPairs.push_back(L"\u1032\u1037");
-		reorderPairs.push_back(L"\u1032\u1094");
-		reorderPairs.push_back(L"\u1064\u1094");
-		reorderPairs.push_back(L"\u102D\u1094");
-		reorderPairs.push_back(L"\u102D\u1071");
-		reorderPairs.push_back(L"\u1036\u1037");
-		reorderPairs.push_back(L"\u1036\u1088");
-		reorderPairs.push_back(L"\u1039\u1037");
-		reorderPairs.push_back(L"\u102D\u1033");
-		reorderPairs.push_back(L"\u103C\u1032");
-		reorderPairs.push_back(L"\u103C\u102D");
-		reorderPairs.push_back(L"\u103C\u102E");
-		reorderPairs.push_back(L"\u1036\u102F");
-		reorderPairs.push_back(L"\u1036\u1088");
-		reorderPairs.push_back(L"\u1036\u103D");
-		reorderPairs.push_back(L"\u1036\u103C");
-		reorderPairs.push_back(L"\u103C\u107D");
-		reorderPairs.push_back(L"\u1088\u102D");
-		reorderPairs.push_back(L"\u1039\u103D");
-		reorderPairs.push_back(L"\u108A\u107D");
-		reorderPairs.push_back(L"\u103A\u1064");
-		reorderPairs.push_back(L"\u1036\u1033");
-	}
+	length = destID-1;
+	const vector<wstring>& reorderPairs = getReorderPairs();
 	for (size_t i=1; i<length; i++) {
 		//Apply stage-2 rules
 		for (size_t ruleID=0; ruleID<reorderPairs.size(); ruleID++) {
 			const wstring& rule = reorderPairs[ruleID];
 			if (zawgyiStr[i]==rule[0] && zawgyiStr[i-1]==rule[1]) {
-				Logger::writeLogLine('Z', tab+tab + L"Order{" + wstring(rule) + L"}");
+				if (logging)
+					Logger::writeLogLine('Z', tab+tab + L"Order{" + wstring(rule) + L"}");
 
 				zawgyiStr[i-1] = rule[0];
 				zawgyiStr[i] = rule[1];
@@ -1576,31 +1683,36 @@ wstring renderAsZawgyi(const wstring &uniString)
 		//Apply stage 3 fixed rules
 		if (i>1) {
 			if (zawgyiStr[i-2]==0x1019 && zawgyiStr[i-1]==0x102C && zawgyiStr[i]==0x107B) {
-				Logger::writeLogLine('Z', tab+tab + L"Order{L3[1]}");
+				if (logging)
+					Logger::writeLogLine('Z', tab+tab + L"Order{L3[1]}");
 
 				zawgyiStr[i-1]=0x107B;
 				zawgyiStr[i]=0x102C;
 			}
 			if (zawgyiStr[i-2]==0x103A && zawgyiStr[i-1]==0x102D && zawgyiStr[i]==0x1033) {
-				Logger::writeLogLine('Z', tab+tab + L"Order{L3[2]}");
+				if (logging)
+					Logger::writeLogLine('Z', tab+tab + L"Order{L3[2]}");
 
 				zawgyiStr[i-1]=0x1033;
 				zawgyiStr[i]=0x102D;
 			}
 			if (zawgyiStr[i-2]==0x103C && zawgyiStr[i-1]==0x1033 && zawgyiStr[i]==0x102D) {
-				Logger::writeLogLine('Z', tab+tab + L"Order{L3[3]}");
+				if (logging)
+					Logger::writeLogLine('Z', tab+tab + L"Order{L3[3]}");
 
 				zawgyiStr[i-1]=0x102D;
 				zawgyiStr[i]=0x1033;
 			}
 			if (zawgyiStr[i-2]==0x103A && zawgyiStr[i-1]==0x1033 && zawgyiStr[i]==0x1036) {
-				Logger::writeLogLine('Z', tab+tab + L"Order{L3[4]}");
+				if (logging)
+					Logger::writeLogLine('Z', tab+tab + L"Order{L3[4]}");
 
 				zawgyiStr[i-1]=0x1036;
 				zawgyiStr[i]=0x1033;
 			}
 			if (zawgyiStr[i-2]==0x103A && zawgyiStr[i-1]==0x108B && zawgyiStr[i]==0x1033) {
-				Logger::writeLogLine('Z', tab+tab + L"Order{L3[5]}");
+				if (logging)
+					Logger::writeLogLine('Z', tab+tab + L"Order{L3[5]}");
 
 				zawgyiStr[i-1]=0x1033;
 				zawgyiStr[i]=0x108B;
@@ -1608,7 +1720,8 @@ wstring renderAsZawgyi(const wstring &uniString)
 
 			//This one's a little different
 			if (zawgyiStr[i]==0x1036 && zawgyiStr[i-2]==0x103C && zawgyiStr[i-1]==0x107D) {
-				Logger::writeLogLine('Z', tab+tab + L"Order{L3[6]}");
+				if (logging)
+					Logger::writeLogLine('Z', tab+tab + L"Order{L3[6]}");
 
 				zawgyiStr[i-2]=0x1036;
 				zawgyiStr[i-1]=0x103C;
@@ -1624,14 +1737,16 @@ wstring renderAsZawgyi(const wstring &uniString)
 					  ||(zawgyiStr[i-2]==0x102C && zawgyiStr[i-1]==0x1037 && zawgyiStr[i]==0x107B)
 					  ||(zawgyiStr[i-2]==0x1037 && zawgyiStr[i-1]==0x107B && zawgyiStr[i]==0x102C)
 					)) {
-				Logger::writeLogLine('Z', tab+tab + L"Order{L4[1]}");
+				if (logging)
+					Logger::writeLogLine('Z', tab+tab + L"Order{L4[1]}");
 
 				zawgyiStr[i-2]=0x107B;
 				zawgyiStr[i-1]=0x102C;
 				zawgyiStr[i]=0x1037;
 			}
 			if (zawgyiStr[i-3]==0x107E && zawgyiStr[i-1]==0x1033 && zawgyiStr[i]==0x1036) {
-				Logger::writeLogLine('Z', tab+tab + L"Order{L4[2]}");
+				if (logging)
+					Logger::writeLogLine('Z', tab+tab + L"Order{L4[2]}");
 
 				zawgyiStr[i-1]=0x1036;
 				zawgyiStr[i]=0x1033;
@@ -1640,10 +1755,35 @@ wstring renderAsZawgyi(const wstring &uniString)
 	}
 
 
-	Logger::writeLogLine('Z', tab + L"End Re-Ordering");
+	if (logging)
+		Logger::writeLogLine('Z', tab + L"End Re-Ordering");
 
 
-	return wstring(zawgyiStr);
+	return length;
+}
+
+
+wstring renderAsZawgyi(const wstring &uniString)
+{
+	//Temp:
+	if (uniString.empty())
+		return uniString;
+
+	wstring res(ZawgyiScratchSize(uniString.length()), L'\0');
+	res.resize(renderAsZawgyi(uniString.data(), uniString.length(), &res[0], res.size()));
+	return res;
+}
+
+
+size_t convertToZawgyi(const wchar_t* uniString, size_t length, wchar_t* scratch, size_t scratchSize)
+{
+	if (scratchSize < ZawgyiScratchSize(length))
+		throw std::runtime_error("Not enough scratch space to render Zawgyi text");
+
+	//Sort into the end of the buffer, then render from there.
+	wchar_t* sorted = scratch + length*2;
+	size_t sortedLength = sortMyanmarString(uniString, length, sorted);
+	return renderAsZawgyi(sorted, sortedLength, scratch, scratchSize);
 }
 
 
@@ -1665,74 +1805,19 @@ std::string escape_wstr(const std::wstring& str, bool errOnUnicode)
 
 std::string wcs2mbs(const std::wstring& str)
 {
-	std::stringstream res;
-	for (wstring::const_iterator c=str.begin(); c!=str.end(); c++) {
-		if (*c >= 0x0000 && *c <= 0x007F)
-			res << static_cast<char>(*c);
-		else if (*c >= 0x0080 && *c <= 0x07FF) {
-			char c1 = (((*c)>>6)&0x1F) | 0xC0;
-			char c2 = ((*c)&0x3F) | 0x80;
-			res <<c1 <<c2;
-		} else if (*c >= 0x0800 && *c <= 0xFFFF) {
-			char c1 = (((*c)>>12)&0xF) | 0xE0;
-			char c2 = (((*c)>>6)&0x3F) | 0x80;
-			char c3 = ((*c)&0x3F) | 0x80;
-			res <<c1 <<c2 <<c3;
-		} else
-			throw std::runtime_error("Unicode value out of range.");
-
-	}
-	return res.str();
+	string res;
+	res.resize(Utf8Encoder::MaxEncodedLength(str.size()));
+	res.resize(str.empty() ? 0 : Utf8Encoder::Encode(str.data(), str.size(), &res[0]));
+	return res;
 }
 
 
 std::wstring mbs2wcs(const std::string& src)
 {
-	std::wstringstream res;
-	for (size_t i=0; i<src.size(); i++) {
-		unsigned short curr = (src[i]&0xFF);
-		if (((curr>>3)^0x1E)==0) {
-			//We can't handle anything outside the BMP
-			throw std::runtime_error("Error: mbs2wcs does not handle bytes outside the BMP");
-		} else if (((curr>>4)^0xE)==0) {
-			//Verify the next two bytes
-			if (i>=src.length()-2 || (((src[i+1]&0xFF)>>6)^0x2)!=0 || (((src[i+2]&0xFF)>>6)^0x2)!=0)
-				throw std::runtime_error("Error: 2-byte character error in UTF-8 file");
-
-			//Combine all three bytes, check, increment
-			wchar_t destVal = 0x0000 | ((curr&0xF)<<12) | ((src[i+1]&0x3F)<<6) | (src[i+2]&0x3F);
-			if (destVal>=0x0800 && destVal<=0xFFFF) {
-				i+=2;
-			} else
-				throw std::runtime_error("Error: 2-byte character error in UTF-8 file");
-
-			//Set
-			res <<destVal;
-		} else if (((curr>>5)^0x6)==0) {
-			//Verify the next byte
-			if (i>=src.length()-1 || (((src[i+1]&0xFF)>>6)^0x2)!=0)
-				throw std::runtime_error("Error: 1-byte character error in UTF-8 file");
-
-			//Combine both bytes, check, increment
-			wchar_t destVal = 0x0000 | ((curr&0x1F)<<6) | (src[i+1]&0x3F);
-			if (destVal>=0x80 && destVal<=0x07FF) {
-				i++;
-			} else
-				throw std::runtime_error("Error: 1-byte character error in UTF-8 file");
-
-			//Set
-			res <<destVal;
-		} else if ((curr>>7)==0) {
-			wchar_t destVal = 0x0000 | curr;
-
-			//Set
-			res <<destVal;
-		} else {
-			throw std::runtime_error("Error: Unknown sequence in UTF-8 file");
-		}
-	}
-
-	return res.str();
+	wstring res;
+	res.resize(Utf8Decoder::MaxDecodedLength(src.size()));
+	res.resize(Utf8Decoder::Decode(src.data(), src.size(), &res[0]));
+	return res;
 }
 
 
@@ -1794,24 +1879,25 @@ std::wstring normalize_bgunicode(const std::wstring& str)
 	//   if found, return the orig. word.
 	//This function is very fragile; we'll have to replace it with something better eventually.
 	//We can assume kinzi & stacked letters aren't abused. Also consonant.
-	wstringstream res;
+	wstring res;
 	bool flags[] = {false,false,false,false,false,false,false,false,false,false,false,false,false};
 	size_t numFlags = 13;
 	for (size_t i=0; i<str.size(); i++) {
 		//First, skip stuff we don't care about
 		if (str[i]==L'\u1004' && i+2<str.size() && str[i+1]==L'\u103A' && str[i+2]==L'\u1039') {
 			//Kinzi, skip
-			res <<L"\u1004\u103A\u1039";
+			res += L"\u1004\u103A\u1039";
 			i += 2;
 			continue;
 		} else if (str[i]==L'\u1039' && i+1<str.size()) {
 			//Stacked letter, skip
-			res <<str[i] <<str[i+1];
+			res += str[i];
+			res += str[i+1];
 			i += 1;
 			continue;
-		} else if ((str[i]>=L'\u1000' && str[i]<=L'\u102A') || str[i]==L'\u103F' || str[i]==L'\u104E') {
+		} else if ((GetMyanmarLetter(str[i]).classes&MC_BASE)!=0) {
 			//Consonant, skip
-			res <<str[i];
+			res += str[i];
 
 			//Also, reset our "flags" array so that multiple killed consants parse ok.
 			for (size_t x=0; x<numFlags; x++)
@@ -1821,28 +1907,12 @@ std::wstring normalize_bgunicode(const std::wstring& str)
 		}
 
 		//Now, we're at some definite data. Skip duplicates, return early if we don't know this letter.
-		int x=-1; //Use fallthrough to build up an array index, 0..12 (-1 is filtered by the default statement)
-		switch (str[i]) {
-			case L'\u103A':                   x++;
-			case L'\u103B':                   x++;
-			case L'\u103C':                   x++;
-			case L'\u103D':                   x++;
-			case L'\u103E':                   x++;
-			case L'\u1031':                   x++;
-			case L'\u102D': case L'\u102E':   x++;
-			case L'\u102F': case L'\u1030':   x++;
-			case L'\u102B': case L'\u102C':   x++;
-			case L'\u1032':                   x++;
-			case L'\u1036':                   x++;
-			case L'\u1037':                   x++;
-			case L'\u1038':                   x++;
-				break;
-			default:
-				return str;
-		}
+		int x = GetMyanmarLetter(str[i]).normalizeID;
+		if (x==-1)
+			return str;
 
 		//Check our ID anyway
-		if (x<0 || x>=(int)numFlags)
+		if (x>=(int)numFlags)
 			throw std::runtime_error("normalize_bgunicode id error!");
 
 		//Now, append the letter ONLY if this flag is false
@@ -1880,13 +1950,13 @@ std::wstring normalize_bgunicode(const std::wstring& str)
 				if (match)
 					toAppend=L'\u102B';
 			}
-			res <<toAppend;
+			res += toAppend;
 		}
 	}
 
 
 	//Every test passed
-	return res.str();
+	return res;
 }
 
 
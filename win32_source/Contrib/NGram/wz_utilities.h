@@ -45,6 +45,41 @@ namespace waitzar
 	const std::wstring WZSystemDefinedWords = L"`~!@#$%^&*()-_=+[{]}\\|;:'\"<>/? 1234567890\u200B";
 
 
+	/**
+	 * Character classes for the Myanmar block (U+1000 to U+109F), and for the pseudo-letters that
+	 *  renderAsZawgyi() uses internally (in the Private Use Area). Everything comes from one table, so
+	 *  classifying a letter is a range check and a load rather than a chain of comparisons.
+	 *  All other letters share a single entry.
+	 */
+	enum MYANMAR_CLASS {
+		MC_BLOCK       = 0x01, //In the Myanmar block
+		MC_SORTABLE    = 0x02, //A letter that sortMyanmarString() understands
+		MC_CONSONANT   = 0x04, //A consonant, for sorting and rendering (U+200B also counts, but isn't in the table)
+		MC_DIGIT       = 0x08, //U+1040 to U+1049
+		MC_PUNCTUATION = 0x10, //U+104A and U+104B
+		MC_SIGN        = 0x20, //Punctuation and symbols, which stand alone (U+104A to U+104F)
+		MC_BASE        = 0x40, //Consonants and independent vowels (U+1000 to U+102A, U+103F, U+104E)
+		MC_RESTART     = 0x80, //Anything that restarts sortMyanmarString()'s counting
+	};
+	struct MyanmarLetter {
+		unsigned char classes;     //MC_* flags
+		signed char rhymeID;       //Where sortMyanmarString() puts it; -1 for none
+		signed char normalizeID;   //Which slot normalize_bgunicode() allows it in; -1 for none
+		signed char stage3ID;      //Which flag renderAsZawgyi() matches it on; -1 for none
+		unsigned short renderType; //How renderAsZawgyi() dashes and stacks it
+	};
+	extern const MyanmarLetter MyanmarLetters[];
+	inline const MyanmarLetter& GetMyanmarLetter(wchar_t letter) {
+		unsigned int id = (unsigned int)letter - 0x1000;
+		if (id<0xA0)
+			return MyanmarLetters[id];
+		id = (unsigned int)letter - 0xE000;
+		if (id<0x300 && (id&0xFF)<0x20)
+			return MyanmarLetters[0xA0 + (id>>8)*0x20 + (id&0xFF)];
+		return MyanmarLetters[0xA0 + 3*0x20];
+	}
+
+
 	/**
 	 * Sort a unicode string according to the rules defined in UTN-11 and K. Soe Min's blog.
 	 *  Works in-place, and has a complexity of O(size(uniString)), single-pass
@@ -57,6 +92,19 @@ namespace waitzar
 	 */
 	std::wstring sortMyanmarString(const std::wstring &uniString);
 	std::wstring renderAsZawgyi(const std::wstring &uniString);
+
+	/**
+	 * Allocation-free versions of the above, for converting large amounts of text.
+	 *  sortMyanmarString() writes length+1 letters (including a trailing zero) to "dest", which may not overlap the input.
+	 *  renderAsZawgyi() and convertToZawgyi() (sort, then render) work entirely in "scratch", which must hold
+	 *  at least ZawgyiScratchSize(length) letters; they throw a std::runtime_error otherwise. renderAsZawgyi()'s
+	 *  input may itself live in the scratch buffer, provided it starts at least 2*length letters in.
+	 * Each returns the length of its result, which is zero-terminated and starts at dest/scratch.
+	 */
+	size_t sortMyanmarString(const wchar_t* uniString, size_t length, wchar_t* dest);
+	size_t renderAsZawgyi(const wchar_t* uniString, size_t length, wchar_t* scratch, size_t scratchSize);
+	size_t convertToZawgyi(const wchar_t* uniString, size_t length, wchar_t* scratch, size_t scratchSize);
+	size_t ZawgyiScratchSize(size_t length);
 	std::string ReadBinaryFile(const std::string& path);
 	std::wstring readUTF8File(const std::string& path);
 
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#include "GlyphAtlas.h"
+
+#include "PngDecoder.h"
+
+
+namespace waitzar
+{
+
+
+GlyphMetrics::GlyphMetrics() : firstChar(0), lastChar(-1), tracking(0), uppercaseOnly(false), fallbackIndex(0)
+{
+}
+
+
+void GlyphMetrics::init(int firstChar, int lastChar, int tracking, const int* positions, const int* bearingLeft, const int* bearingRight)
+{
+	this->firstChar = firstChar;
+	this->lastChar = lastChar;
+	this->tracking = tracking;
+	this->uppercaseOnly = (lastChar < 'a');
+
+	glyphs.resize(lastChar - firstChar + 1);
+	for (size_t i=0; i<glyphs.size(); i++) {
+		GlyphInfo& g = glyphs[i];
+		g.position = positions[i];
+		g.width = positions[i+1] - positions[i];
+		g.bearingLeft = bearingLeft[i];
+		g.bearingRight = bearingRight[i];
+
+		//Tracking is skipped if the glyph's advance is under half its width.
+		g.tracked = (g.width + g.bearingLeft + g.bearingRight >= g.width/2);
+	}
+
+	fallbackIndex = (charIsOutOfRange('?') ? lastChar : '?') - firstChar;
+}
+
+
+bool GlyphMetrics::charIsOutOfRange(wchar_t ch) const
+{
+	//Special-case (not in WZ)
+	if (uppercaseOnly && ch>='a' &&ch<= 'z')
+		ch += 'A' - 'a';
+	return (ch<firstChar || ch>lastChar);
+}
+
+
+int GlyphMetrics::getCharIndex(wchar_t ch) const
+{
+	//Special-case (not in WZ)
+	if (uppercaseOnly && ch>='a' &&ch<= 'z')
+		ch += 'A' - 'a';
+
+	//Bound (default to '?')
+	if (ch<firstChar || ch>lastChar)
+		return fallbackIndex;
+	return ch - firstChar;
+}
+
+
+int GlyphMetrics::layout(const std::wstring& str, size_t start, size_t end, const std::wstring& filterStr, size_t filterLetterWidth, std::vector<Glyph>* res) const
+{
+	if (res!=NULL)
+		res->clear();
+	if (end <= start)
+		return 0;
+
+	//Each character starts where the last one ended, plus the kerning between them.
+	int x = 0;
+	Glyph prev = {0, 0, 0, false};
+	for (size_t i=start; i<end; i++) {
+		Glyph curr;
+		curr.index = getCharIndex(str[i]);
+		curr.filtered = !filterStr.empty() && filterStr.find(str[i])!=std::wstring::npos;
+		curr.width = curr.filtered ? static_cast<int>(filterLetterWidth) : glyphs[curr.index].width;
+		if (i>start) {
+			x += prev.width;
+			if (!prev.filtered && !curr.filtered)
+				x += getKerning(prev.index, curr.index);
+		}
+		curr.x = x;
+
+		if (res!=NULL)
+			res->push_back(curr);
+		prev = curr;
+	}
+	return x + prev.width;
+}
+
+
+
+GlyphTintCache::GlyphTintCache() : maxPages(1), numPagesUsed(1), clock(0)
+{
+}
+
+
+void GlyphTintCache::init(int numGlyphs, int maxPages, unsigned int color)
+{
+	this->maxPages = maxPages<1 ? 1 : maxPages;
+	slots.resize(numGlyphs * this->maxPages);
+	reset(color);
+}
+
+
+void GlyphTintCache::reset(unsigned int color)
+{
+	Slot empty = {0xFFFFFFFF, 0};
+	Slot first = {color&0xFFFFFF, 0};
+	for (size_t i=0; i<slots.size(); i++)
+		slots[i] = (i%maxPages==0) ? first : empty;
+	numPagesUsed = 1;
+	clock = 0;
+}
+
+
+int GlyphTintCache::acquire(int glyph, unsigned int color, bool& needsTint)
+{
+	//Clock wrapped? Start everyone over; that's only a tiny bit unfair.
+	if (++clock==0) {
+		for (size_t i=0; i<slots.size(); i++)
+			slots[i].lastUsed = 0;
+		clock = 1;
+	}
+
+	//Already tinted? Else, re-tint the page we've used least recently. Pages we've never drawn
+	//  from count as least recent, and ties go to the lowest page.
+	color &= 0xFFFFFF;
+	Slot* glyphSlots = &slots[glyph*maxPages];
+	int victim = 0;
+	for (int page=0; page<maxPages; page++) {
+		if (glyphSlots[page].color==color) {
+			glyphSlots[page].lastUsed = clock;
+			needsTint = false;
+			return page;
+		}
+		if (glyphSlots[page].lastUsed<glyphSlots[victim].lastUsed)
+			victim = page;
+	}
+
+	glyphSlots[victim].color = color;
+	glyphSlots[victim].lastUsed = clock;
+	if (victim>=numPagesUsed)
+		numPagesUsed = victim+1;
+	needsTint = true;
+	return victim;
+}
+
+
+
+void TintPixels(unsigned int* pixels, int stride, int x, int y, int w, int h, unsigned int rgbColor)
+{
+	//Every pixel comes out as one of 256 colors (one per alpha), so work those out first.
+	unsigned int tinted[256];
+	for (unsigned int a=0; a<256; a++)
+		tinted[a] = PngDecoder::Premultiply((a<<24) | (rgbColor&0x00FFFFFF));
+
+	for (int row=y; row<y+h; row++) {
+		unsigned int* px = pixels + row*stride + x;
+		for (int i=0; i<w; i++)
+			px[i] = tinted[px[i]>>24];
+	}
+}
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
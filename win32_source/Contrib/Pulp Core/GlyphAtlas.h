@@ -0,0 +1,135 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace waitzar
+{
+
+
+/**
+ * Metrics for each glyph in a PulpCore font, and the layout of strings built from them. Nothing here
+ *   touches pixels (or GDI), so a string can be measured exactly as it will be drawn.
+ * Kerning in PulpCore is the left glyph's right bearing, plus the right glyph's left bearing, plus
+ *   the font's tracking (unless either glyph is too narrow to take it). A full pair table would need
+ *   one entry for every pair of glyphs (millions, for Zawgyi), so instead each glyph's half of the
+ *   sum is worked out once, in init().
+ */
+class GlyphMetrics {
+public:
+	//Where one character of a string ends up.
+	struct Glyph {
+		int index;     //Which glyph
+		int x;         //Offset from the start of the string
+		int width;
+		bool filtered; //Part of the "filter" string (e.g., a zero-width space); not drawn
+	};
+
+	GlyphMetrics();
+
+	//"positions" has (lastChar-firstChar+2) entries; each glyph runs from its position to the next one.
+	void init(int firstChar, int lastChar, int tracking, const int* positions, const int* bearingLeft, const int* bearingRight);
+
+	//Characters outside the font become '?' (or the last character, if the font has no '?')
+	int getCharIndex(wchar_t ch) const;
+	bool charIsOutOfRange(wchar_t ch) const;
+
+	int getNumGlyphs() const { return static_cast<int>(glyphs.size()); }
+	int getPosition(int index) const { return glyphs[index].position; }
+	int getWidth(int index) const { return glyphs[index].width; }
+	int getKerning(int leftIndex, int rightIndex) const {
+		const GlyphInfo& left = glyphs[leftIndex];
+		const GlyphInfo& right = glyphs[rightIndex];
+		return left.bearingRight + right.bearingLeft + ((left.tracked && right.tracked) ? tracking : 0);
+	}
+
+	//Lay out str[start..end), returning its width. Characters in "filterStr" are given a width of
+	//  "filterLetterWidth", and aren't kerned against their neighbors. If "res" is given, it's
+	//  filled with each character's glyph and position.
+	int layout(const std::wstring& str, size_t start, size_t end, const std::wstring& filterStr, size_t filterLetterWidth, std::vector<Glyph>* res) const;
+
+private:
+	struct GlyphInfo {
+		int position;
+		int width;
+		int bearingLeft;
+		int bearingRight;
+		bool tracked;
+	};
+
+	std::vector<GlyphInfo> glyphs;
+	int firstChar;
+	int lastChar;
+	int tracking;
+	bool uppercaseOnly;
+	int fallbackIndex;
+};
+
+
+/**
+ * Remembers which colors each glyph has been tinted in. A font keeps several copies ("pages") of its
+ *   glyph strip, and each glyph may be a different color on each page; page 0 is the font image itself.
+ *   When a glyph is needed in a color it doesn't have, the least-recently-used page for that glyph is
+ *   re-tinted. So text which alternates between a few colors (like a shadow, or a highlight) is
+ *   only tinted once.
+ * Pages nobody has drawn from are re-used first, lowest first. So a font which is only ever drawn
+ *   in one color (even if it's not the one it was loaded with) never needs more than page 0.
+ */
+class GlyphTintCache {
+public:
+	GlyphTintCache();
+
+	//Every glyph starts out in "color", on page 0.
+	void init(int numGlyphs, int maxPages, unsigned int color);
+
+	//Forget every other page; all glyphs are now "color" on page 0.
+	void reset(unsigned int color);
+
+	//Returns the page to draw "glyph" from. If "needsTint" is set, that page must first be tinted to "color".
+	int acquire(int glyph, unsigned int color, bool& needsTint);
+
+	//The highest page handed out so far, plus one.
+	int getNumPagesUsed() const { return numPagesUsed; }
+
+private:
+	struct Slot {
+		unsigned int color;    //0xFFFFFFFF if not tinted yet (all colors are RGB)
+		unsigned int lastUsed;
+	};
+
+	std::vector<Slot> slots;  //maxPages for each glyph
+	int maxPages;
+	int numPagesUsed;
+	unsigned int clock;
+};
+
+
+//Set every pixel in a rectangle to "rgbColor", keeping its alpha (and premultiplying by it).
+//  "stride" is the width of a row, in pixels.
+void TintPixels(unsigned int* pixels, int stride, int x, int y, int w, int h, unsigned int rgbColor);
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
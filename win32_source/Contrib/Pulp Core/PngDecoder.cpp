@@ -0,0 +1,813 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#include "PngDecoder.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define WZ_PNG_SSE2
+#include <emmintrin.h>
+#endif
+
+
+namespace waitzar
+{
+
+namespace {
+	//Deflate tables (RFC 1951, section 3.2.5)
+	const unsigned short LENGTH_BASE[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned char LENGTH_EXTRA[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const unsigned short DIST_BASE[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const unsigned char DIST_EXTRA[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	const unsigned char CODE_LENGTH_ORDER[] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	//PNG bits we need
+	const char PNG_MAGIC[] = "\x89PNG\x0D\x0A\x1A\x0A";
+	const unsigned int PNG_IHDR = 0x49484452;
+	const unsigned int PNG_PLTE = 0x504c5445;
+	const unsigned int PNG_TRNS = 0x74524e53;
+	const unsigned int PNG_IDAT = 0x49444154;
+	const unsigned int PNG_IEND = 0x49454e44;
+	enum { PNG_GRAY=0, PNG_RGB=2, PNG_PALETTE=3, PNG_GRAY_ALPHA=4, PNG_RGBA=6 };
+	const size_t PNG_SAMPLES[] = { 1, 0, 3, 1, 2, 0, 4 };
+
+	//Codes up to this length are resolved with a single table lookup.
+	const unsigned int FAST_BITS = 10;
+	const unsigned int FAST_MASK = (1<<FAST_BITS) - 1;
+
+
+	unsigned int reverseBits(unsigned int code, unsigned int numBits) {
+		unsigned int res = 0;
+		for (unsigned int i=0; i<numBits; i++) {
+			res = (res<<1) | (code&1);
+			code >>= 1;
+		}
+		return res;
+	}
+
+
+	//A canonical Huffman code. Each fast[] entry holds (length<<9)|symbol for the code which
+	//  matches those (bit-reversed) bits, or 0 if the code is longer than FAST_BITS.
+	struct HuffmanTable {
+		unsigned short fast[1<<FAST_BITS];
+		unsigned int maxCode[17];        //First (left-justified, 16-bit) code which is too long for each length
+		unsigned short firstCode[16];
+		unsigned short firstSymbol[16];  //Index into "symbols" of each length's first code
+		unsigned short symbols[288];     //Sorted by code
+
+		void build(const unsigned char* lengths, unsigned int numSymbols) {
+			unsigned int count[16];
+			std::memset(count, 0, sizeof(count));
+			std::memset(fast, 0, sizeof(fast));
+			for (unsigned int i=0; i<numSymbols; i++)
+				count[lengths[i]]++;
+			count[0] = 0;
+
+			//Assign the first code of each length
+			unsigned int nextCode[16];
+			unsigned int code = 0;
+			unsigned int index = 0;
+			for (unsigned int len=1; len<16; len++) {
+				nextCode[len] = code;
+				firstCode[len] = static_cast<unsigned short>(code);
+				firstSymbol[len] = static_cast<unsigned short>(index);
+				code += count[len];
+				if (count[len]>0 && code > (1U<<len))
+					throw std::runtime_error("Inflater: over-subscribed Huffman code");
+				maxCode[len] = code << (16-len);
+				code <<= 1;
+				index += count[len];
+			}
+			maxCode[16] = 0x10000;
+
+			//Fill in the symbols (and the lookup table)
+			for (unsigned int sym=0; sym<numSymbols; sym++) {
+				unsigned int len = lengths[sym];
+				if (len==0)
+					continue;
+				unsigned int c = nextCode[len]++;
+				symbols[firstSymbol[len] + c - firstCode[len]] = static_cast<unsigned short>(sym);
+				if (len<=FAST_BITS) {
+					unsigned short entry = static_cast<unsigned short>((len<<9) | sym);
+					for (unsigned int j=reverseBits(c, len); j<(1U<<FAST_BITS); j+=(1<<len))
+						fast[j] = entry;
+				}
+			}
+		}
+	};
+
+
+	//Reads bits least-significant first, 64 at a time. Reading past the end yields zeroes; we only
+	//  complain if those are actually consumed.
+	class BitReader {
+	public:
+		BitReader(const unsigned char* src, size_t length) : curr(src), end(src+length), bits(0), numBits(0), overrun(0) {}
+
+		void refill() {
+			while (numBits<=56) {
+				unsigned long long next = 0;
+				if (curr<end)
+					next = *curr++;
+				else
+					overrun++;
+				bits |= next << numBits;
+				numBits += 8;
+			}
+			if (overrun*8 > numBits)
+				throw std::runtime_error("Inflater ran out of input");
+		}
+
+		unsigned int get(unsigned int count) {
+			if (numBits<count)
+				refill();
+			unsigned int res = static_cast<unsigned int>(bits & ((1ULL<<count)-1));
+			bits >>= count;
+			numBits -= count;
+			return res;
+		}
+
+		unsigned int decode(const HuffmanTable& table) {
+			if (numBits<16)
+				refill();
+			unsigned int entry = table.fast[bits&FAST_MASK];
+			if (entry!=0) {
+				unsigned int len = entry>>9;
+				bits >>= len;
+				numBits -= len;
+				return entry&0x1FF;
+			}
+
+			//Slow path: search each longer length.
+			unsigned int k = reverseBits(static_cast<unsigned int>(bits&0xFFFF), 16);
+			unsigned int len = FAST_BITS+1;
+			while (k>=table.maxCode[len])
+				len++;
+			if (len>=16)
+				throw std::runtime_error("Inflater: invalid Huffman code");
+			unsigned int index = table.firstSymbol[len] + (k>>(16-len)) - table.firstCode[len];
+			bits >>= len;
+			numBits -= len;
+			return table.symbols[index];
+		}
+
+		//Drop bits up to the next byte boundary, then give back any whole bytes we read ahead.
+		const unsigned char* alignToByte() {
+			get(numBits%8);
+			if (overrun*8 > numBits)
+				throw std::runtime_error("Inflater ran out of input");
+			curr -= (numBits/8 - overrun);
+			bits = numBits = overrun = 0;
+			return curr;
+		}
+
+		void skipTo(const unsigned char* pos) { curr = pos; }
+		const unsigned char* getEnd() const { return end; }
+
+	private:
+		const unsigned char* curr;
+		const unsigned char* end;
+		unsigned long long bits;
+		unsigned int numBits;
+		unsigned int overrun;
+	};
+
+
+	unsigned int adler32(const unsigned char* data, size_t length) {
+		unsigned int a = 1;
+		unsigned int b = 0;
+		while (length>0) {
+			//5552 is the most bytes we can sum before "b" could overflow.
+			size_t block = length<5552 ? length : 5552;
+			length -= block;
+#ifdef WZ_PNG_SSE2
+			//16 bytes at a time: "a" gains their sum, and "b" gains 16 of the old "a"s plus each byte
+			//  weighted by how many sums it's part of (16 for the first, 1 for the last).
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i weightsLo = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+			const __m128i weightsHi = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+			__m128i sumA = _mm_cvtsi32_si128(static_cast<int>(a));
+			__m128i sumB = _mm_cvtsi32_si128(static_cast<int>(b));
+			__m128i prevA = zero;
+			for (; block>=16; block-=16) {
+				__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+				prevA = _mm_add_epi32(prevA, sumA);
+				sumA = _mm_add_epi32(sumA, _mm_sad_epu8(bytes, zero));
+				sumB = _mm_add_epi32(sumB, _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), weightsLo));
+				sumB = _mm_add_epi32(sumB, _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), weightsHi));
+				data += 16;
+			}
+			sumB = _mm_add_epi32(sumB, _mm_slli_epi32(prevA, 4));
+			unsigned int lanes[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sumA);
+			a = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sumB);
+			b = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+			while (block>0) {
+				a += *data++;
+				b += a;
+				block--;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		return (b<<16) | a;
+	}
+
+
+	void readCodeLengths(BitReader& in, HuffmanTable& lit, HuffmanTable& dist) {
+		unsigned int numLit = in.get(5) + 257;
+		unsigned int numDist = in.get(5) + 1;
+		unsigned int numCodeLen = in.get(4) + 4;
+
+		unsigned char lengths[286+32+138];
+		std::memset(lengths, 0, 19);
+		for (unsigned int i=0; i<numCodeLen; i++)
+			lengths[CODE_LENGTH_ORDER[i]] = static_cast<unsigned char>(in.get(3));
+		HuffmanTable codeLen;
+		codeLen.build(lengths, 19);
+
+		//The literal and distance lengths are one run; repeats may cross from one to the other.
+		unsigned int total = numLit + numDist;
+		unsigned int i = 0;
+		while (i<total) {
+			unsigned int sym = in.decode(codeLen);
+			if (sym<16) {
+				lengths[i++] = static_cast<unsigned char>(sym);
+				continue;
+			}
+
+			unsigned char value = 0;
+			unsigned int repeat = 0;
+			if (sym==16) {
+				if (i==0)
+					throw std::runtime_error("Inflater: length repeat with no previous length");
+				value = lengths[i-1];
+				repeat = in.get(2) + 3;
+			} else if (sym==17)
+				repeat = in.get(3) + 3;
+			else
+				repeat = in.get(7) + 11;
+			if (i+repeat > total)
+				throw std::runtime_error("Inflater: code lengths overflow");
+			std::memset(&lengths[i], value, repeat);
+			i += repeat;
+		}
+
+		lit.build(lengths, numLit);
+		dist.build(&lengths[numLit], numDist);
+	}
+
+
+	void inflateBlock(BitReader& in, const HuffmanTable& lit, const HuffmanTable& dist, unsigned char* dest, size_t& pos, size_t destLength) {
+		for (;;) {
+			unsigned int sym = in.decode(lit);
+			if (sym<256) {
+				if (pos>=destLength)
+					throw std::runtime_error("Inflater: too much data");
+				dest[pos++] = static_cast<unsigned char>(sym);
+				continue;
+			}
+			if (sym==256)
+				return;
+
+			//Length/distance pair
+			sym -= 257;
+			if (sym>=29)
+				throw std::runtime_error("Inflater: bad length code");
+			size_t length = LENGTH_BASE[sym] + in.get(LENGTH_EXTRA[sym]);
+			unsigned int dsym = in.decode(dist);
+			if (dsym>=30)
+				throw std::runtime_error("Inflater: bad distance code");
+			size_t distance = DIST_BASE[dsym] + in.get(DIST_EXTRA[dsym]);
+			if (distance>pos)
+				throw std::runtime_error("Inflater: distance too far back");
+			if (length>destLength-pos)
+				throw std::runtime_error("Inflater: too much data");
+
+			unsigned char* out = dest + pos;
+			const unsigned char* from = out - distance;
+			pos += length;
+			if (distance==1)
+				std::memset(out, *from, length);
+			else if (distance>=length)
+				std::memcpy(out, from, length);
+			else {
+				while (length-->0)
+					*out++ = *from++;
+			}
+		}
+	}
+
+
+	//Scalar un-filtering. "bpp" is the distance (in bytes) to the corresponding byte of the previous pixel.
+	void subScalar(unsigned char* curr, size_t start, size_t length, size_t bpp) {
+		for (size_t i=start; i<length; i++)
+			curr[i] = static_cast<unsigned char>(curr[i] + curr[i-bpp]);
+	}
+	void avgScalar(unsigned char* curr, const unsigned char* prev, size_t start, size_t length, size_t bpp) {
+		for (size_t i=start; i<length; i++)
+			curr[i] = static_cast<unsigned char>(curr[i] + ((curr[i-bpp] + prev[i])>>1));
+	}
+	void paethScalar(unsigned char* curr, const unsigned char* prev, size_t start, size_t length, size_t bpp) {
+		for (size_t i=start; i<length; i++) {
+			int a = curr[i-bpp];
+			int b = prev[i];
+			int c = prev[i-bpp];
+			int pa = std::abs(b - c);
+			int pb = std::abs(a - c);
+			int pc = std::abs(a + b - 2*c);
+			int pred = (pa<=pb && pa<=pc) ? a : (pb<=pc ? b : c);
+			curr[i] = static_cast<unsigned char>(curr[i] + pred);
+		}
+	}
+
+
+#ifdef WZ_PNG_SSE2
+	//Pixels of 3 or 4 bytes are handled one at a time, in the low lanes of a register.
+	template <int BPP>
+	__m128i loadPixel(const unsigned char* src) {
+		int res = 0;
+		std::memcpy(&res, src, BPP);
+		return _mm_cvtsi32_si128(res);
+	}
+	template <int BPP>
+	void storePixel(unsigned char* dest, __m128i pixel) {
+		int res = _mm_cvtsi128_si32(pixel);
+		std::memcpy(dest, &res, BPP);
+	}
+
+	//Sub is a running sum across the row. For pixels of 1, 2 or 4 bytes (which divide 16 evenly) we
+	//  sum each 16-byte block in log2 steps, then add the last pixel of the previous block.
+	template <int BPP>
+	void subSse2(unsigned char* curr, size_t length) {
+		__m128i carry = _mm_setzero_si128();
+		size_t i = 0;
+		for (; i+16<=length; i+=16) {
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(curr+i));
+			x = _mm_add_epi8(x, _mm_slli_si128(x, BPP));
+			x = _mm_add_epi8(x, _mm_slli_si128(x, 2*BPP));
+			if (BPP<4)
+				x = _mm_add_epi8(x, _mm_slli_si128(x, 4*BPP));
+			if (BPP<2)
+				x = _mm_add_epi8(x, _mm_slli_si128(x, 8*BPP));
+			x = _mm_add_epi8(x, carry);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(curr+i), x);
+
+			int last = 0;
+			std::memcpy(&last, curr+i+16-BPP, BPP);
+			carry = (BPP==1) ? _mm_set1_epi8(static_cast<char>(last)) : (BPP==2) ? _mm_set1_epi16(static_cast<short>(last)) : _mm_set1_epi32(last);
+		}
+		subScalar(curr, i<BPP?BPP:i, length, BPP);
+	}
+
+	template <int BPP>
+	void subPixels(unsigned char* curr, size_t length) {
+		__m128i a = _mm_setzero_si128();
+		for (size_t i=0; i+BPP<=length; i+=BPP) {
+			a = _mm_add_epi8(a, loadPixel<BPP>(curr+i));
+			storePixel<BPP>(curr+i, a);
+		}
+	}
+
+	template <int BPP>
+	void avgPixels(unsigned char* curr, const unsigned char* prev, size_t length) {
+		const __m128i one = _mm_set1_epi8(1);
+		__m128i a = _mm_setzero_si128();
+		for (size_t i=0; i+BPP<=length; i+=BPP) {
+			__m128i b = loadPixel<BPP>(prev+i);
+			//_mm_avg_epu8 rounds up; PNG rounds down.
+			__m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+			a = _mm_add_epi8(loadPixel<BPP>(curr+i), avg);
+			storePixel<BPP>(curr+i, a);
+		}
+	}
+
+	__m128i abs16(__m128i x) {
+		return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+	}
+	__m128i select16(__m128i mask, __m128i ifTrue, __m128i ifFalse) {
+		return _mm_or_si128(_mm_and_si128(mask, ifTrue), _mm_andnot_si128(mask, ifFalse));
+	}
+
+	template <int BPP>
+	void paethPixels(unsigned char* curr, const unsigned char* prev, size_t length) {
+		const __m128i zero = _mm_setzero_si128();
+		__m128i a = zero;
+		__m128i c = zero;
+		for (size_t i=0; i+BPP<=length; i+=BPP) {
+			__m128i b = _mm_unpacklo_epi8(loadPixel<BPP>(prev+i), zero);
+
+			//p = a+b-c, so |p-a| = |b-c|, |p-b| = |a-c|, and |p-c| = |(b-c)+(a-c)|
+			__m128i bc = _mm_sub_epi16(b, c);
+			__m128i ac = _mm_sub_epi16(a, c);
+			__m128i pa = abs16(bc);
+			__m128i pb = abs16(ac);
+			__m128i pc = abs16(_mm_add_epi16(bc, ac));
+			__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+			//Ties go to a, then b, then c
+			__m128i pred = select16(_mm_cmpeq_epi16(pc, smallest), c, b);
+			pred = select16(_mm_cmpeq_epi16(pb, smallest), b, pred);
+			pred = select16(_mm_cmpeq_epi16(pa, smallest), a, pred);
+
+			__m128i res = _mm_add_epi8(loadPixel<BPP>(curr+i), _mm_packus_epi16(pred, pred));
+			storePixel<BPP>(curr+i, res);
+			a = _mm_unpacklo_epi8(res, zero);
+			c = b;
+		}
+	}
+
+
+	//Premultiply 4 ARGB pixels, exactly as PngDecoder::Premultiply() does. (t+1+(t>>8))>>8 is t/255
+	//  for every t we can get here.
+	__m128i premultiply4(__m128i argb) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i half = _mm_set1_epi16(127);
+		const __m128i one = _mm_set1_epi16(1);
+		const __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+
+		__m128i lo = _mm_unpacklo_epi8(argb, zero);
+		__m128i hi = _mm_unpackhi_epi8(argb, zero);
+		__m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xFF), 0xFF);
+		__m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xFF), 0xFF);
+		lo = _mm_add_epi16(_mm_mullo_epi16(lo, alo), half);
+		hi = _mm_add_epi16(_mm_mullo_epi16(hi, ahi), half);
+		lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+
+		__m128i res = _mm_packus_epi16(lo, hi);
+		return _mm_or_si128(_mm_andnot_si128(alphaMask, res), _mm_and_si128(alphaMask, argb));
+	}
+#endif
+
+
+	unsigned int readUInt(const unsigned char* src) {
+		return (static_cast<unsigned int>(src[0])<<24) | (src[1]<<16) | (src[2]<<8) | src[3];
+	}
+} //End anonymous namespace
+
+
+
+void ZlibInflater::Inflate(const unsigned char* src, size_t srcLength, unsigned char* dest, size_t destLength)
+{
+	//zlib header
+	if (srcLength<6)
+		throw std::runtime_error("Inflater: stream too short");
+	if ((src[0]&0x0F)!=8 || (src[0]>>4)>7 || ((src[0]<<8)|src[1])%31!=0)
+		throw std::runtime_error("Inflater: bad zlib header");
+	if (src[1]&0x20)
+		throw std::runtime_error("Inflater: preset dictionaries are not supported");
+
+	BitReader in(src+2, srcLength-2);
+	size_t pos = 0;
+	HuffmanTable lit;
+	HuffmanTable dist;
+	bool haveFixed = false;
+	for (bool lastBlock=false; !lastBlock;) {
+		lastBlock = in.get(1)==1;
+		unsigned int type = in.get(2);
+		if (type==0) {
+			//Stored
+			const unsigned char* data = in.alignToByte();
+			if (in.getEnd()-data < 4)
+				throw std::runtime_error("Inflater ran out of input");
+			size_t length = data[0] | (data[1]<<8);
+			size_t check = data[2] | (data[3]<<8);
+			if ((length^0xFFFF) != check)
+				throw std::runtime_error("Inflater: stored block length is corrupt");
+			data += 4;
+			if (static_cast<size_t>(in.getEnd()-data) < length)
+				throw std::runtime_error("Inflater ran out of input");
+			if (length>destLength-pos)
+				throw std::runtime_error("Inflater: too much data");
+			std::memcpy(dest+pos, data, length);
+			pos += length;
+			in.skipTo(data+length);
+		} else if (type==1) {
+			//Fixed codes; rebuilt only if a dynamic block replaced them.
+			if (!haveFixed) {
+				unsigned char lengths[288];
+				std::memset(lengths, 8, 144);
+				std::memset(lengths+144, 9, 112);
+				std::memset(lengths+256, 7, 24);
+				std::memset(lengths+280, 8, 8);
+				lit.build(lengths, 288);
+				std::memset(lengths, 5, 30);
+				dist.build(lengths, 30);
+				haveFixed = true;
+			}
+			inflateBlock(in, lit, dist, dest, pos, destLength);
+		} else if (type==2) {
+			readCodeLengths(in, lit, dist);
+			haveFixed = false;
+			inflateBlock(in, lit, dist, dest, pos, destLength);
+		} else
+			throw std::runtime_error("Inflater: bad block type");
+	}
+
+	if (pos!=destLength)
+		throw std::runtime_error("Inflater ran out of input");
+
+	//Adler-32 of the uncompressed data follows, big-endian.
+	const unsigned char* check = in.alignToByte();
+	if (in.getEnd()-check < 4)
+		throw std::runtime_error("Inflater: missing checksum");
+	if (readUInt(check) != adler32(dest, destLength))
+		throw std::runtime_error("Inflater: checksum mismatch");
+}
+
+
+
+PngDecoder::PngDecoder(int width, int height, int bitDepth, int colorType) : width(width), height(height), bitDepth(bitDepth), colorType(colorType)
+{
+	bool supportedBitDepth = (bitDepth == 8 || (bitDepth == 4 && colorType == PNG_PALETTE));
+	bool supportedColorType = (colorType == PNG_GRAY || colorType == PNG_RGB || colorType == PNG_PALETTE || colorType == PNG_GRAY_ALPHA || colorType == PNG_RGBA);
+	if (width<=0 || height<=0 || !supportedBitDepth || !supportedColorType)
+		throw std::runtime_error("PNG header requires unsupported options");
+
+	size_t bitsPerPixel = bitDepth * PNG_SAMPLES[colorType];
+	bytesPerPixel = (bitsPerPixel + 7) / 8;
+	bytesPerScanline = (width * bitsPerPixel + 7) / 8;
+}
+
+
+void PngDecoder::unfilter(unsigned char* curr, const unsigned char* prev, size_t length, int filter, size_t bpp)
+{
+	if (filter == 1) {
+		// Input = Sub
+		// Raw(x) = Sub(x) + Raw(x-bpp)
+#ifdef WZ_PNG_SSE2
+		if (bpp==1)
+			subSse2<1>(curr, length);
+		else if (bpp==2)
+			subSse2<2>(curr, length);
+		else if (bpp==4)
+			subSse2<4>(curr, length);
+		else if (bpp==3)
+			subPixels<3>(curr, length);
+		else
+			subScalar(curr, bpp, length, bpp);
+#else
+		subScalar(curr, bpp, length, bpp);
+#endif
+	} else if (filter == 2) {
+		// Input = Up
+		// Raw(x) = Up(x) + Prior(x)
+		size_t i = 0;
+#ifdef WZ_PNG_SSE2
+		for (; i+16<=length; i+=16) {
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(curr+i));
+			__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev+i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(curr+i), _mm_add_epi8(c, p));
+		}
+#endif
+		for (; i<length; i++)
+			curr[i] = static_cast<unsigned char>(curr[i] + prev[i]);
+	} else if (filter == 3) {
+		// Input = Average
+		// Raw(x) = Average(x) + floor((Raw(x-bpp)+Prior(x))/2)
+#ifdef WZ_PNG_SSE2
+		if (bpp==3 || bpp==4) {
+			if (bpp==3)
+				avgPixels<3>(curr, prev, length);
+			else
+				avgPixels<4>(curr, prev, length);
+			return;
+		}
+#endif
+		for (size_t i=0; i<bpp; i++)
+			curr[i] = static_cast<unsigned char>(curr[i] + (prev[i]>>1));
+		avgScalar(curr, prev, bpp, length, bpp);
+	} else if (filter == 4) {
+		// Input = Paeth
+		// Raw(x) = Paeth(x) + PaethPredictor(Raw(x-bpp), Prior(x), Prior(x-bpp))
+#ifdef WZ_PNG_SSE2
+		if (bpp==3 || bpp==4) {
+			if (bpp==3)
+				paethPixels<3>(curr, prev, length);
+			else
+				paethPixels<4>(curr, prev, length);
+			return;
+		}
+#endif
+		for (size_t i=0; i<bpp; i++)
+			curr[i] = static_cast<unsigned char>(curr[i] + prev[i]);
+		paethScalar(curr, prev, bpp, length, bpp);
+	} else if (filter != 0) {
+		std::stringstream msg;
+		msg <<"Illegal filter type: " <<filter;
+		throw std::runtime_error(msg.str().c_str());
+	}
+}
+
+
+void PngDecoder::convertRow(const unsigned char* row, unsigned int* dest, const unsigned int* palette) const
+{
+	int j = 0;
+	switch (colorType) {
+		case PNG_GRAY:
+#ifdef WZ_PNG_SSE2
+			for (; j+16<=width; j+=16) {
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row+j));
+				__m128i vv = _mm_unpacklo_epi8(v, v);
+				__m128i va = _mm_unpacklo_epi8(v, _mm_set1_epi8(-1));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest+j), _mm_unpacklo_epi16(vv, va));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest+j+4), _mm_unpackhi_epi16(vv, va));
+				vv = _mm_unpackhi_epi8(v, v);
+				va = _mm_unpackhi_epi8(v, _mm_set1_epi8(-1));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest+j+8), _mm_unpacklo_epi16(vv, va));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest+j+12), _mm_unpackhi_epi16(vv, va));
+			}
+#endif
+			for (; j<width; j++) {
+				unsigned int v = row[j];
+				dest[j] = 0xFF000000 | (v<<16) | (v<<8) | v;
+			}
+			break;
+
+		case PNG_RGB:
+			for (; j<width; j++) {
+				const unsigned char* px = row + j*3;
+				dest[j] = 0xFF000000 | (px[0]<<16) | (px[1]<<8) | px[2];
+			}
+			break;
+
+		case PNG_PALETTE:
+			if (bitDepth == 8) {
+				for (; j+4<=width; j+=4) {
+					dest[j] = palette[row[j]];
+					dest[j+1] = palette[row[j+1]];
+					dest[j+2] = palette[row[j+2]];
+					dest[j+3] = palette[row[j+3]];
+				}
+				for (; j<width; j++)
+					dest[j] = palette[row[j]];
+			} else {
+				//Each byte is two pixels; "palette" holds both pixels for all 256 bytes, after the palette itself.
+				const unsigned int* pairs = palette + 256;
+				for (; j+2<=width; j+=2)
+					std::memcpy(dest+j, pairs + 2*row[j/2], 2*sizeof(unsigned int));
+				if (j<width)
+					dest[j] = palette[row[j/2]>>4];
+			}
+			break;
+
+		case PNG_GRAY_ALPHA:
+#ifdef WZ_PNG_SSE2
+			for (; j+8<=width; j+=8) {
+				//Each 16-bit (v,a) becomes (v,v,v,a)
+				__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row+j*2));
+				__m128i v = _mm_and_si128(va, _mm_set1_epi16(0xFF));
+				__m128i vv = _mm_or_si128(v, _mm_slli_epi16(v, 8));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest+j), premultiply4(_mm_unpacklo_epi16(vv, va)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest+j+4), premultiply4(_mm_unpackhi_epi16(vv, va)));
+			}
+#endif
+			for (; j<width; j++) {
+				unsigned int v = row[j*2];
+				unsigned int a = row[j*2+1];
+				dest[j] = Premultiply((a<<24) | (v<<16) | (v<<8) | v);
+			}
+			break;
+
+		case PNG_RGBA:
+#ifdef WZ_PNG_SSE2
+			for (; j+4<=width; j+=4) {
+				//Loaded as (little-endian) ABGR; swap R and B.
+				__m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row+j*4));
+				__m128i ag = _mm_and_si128(px, _mm_set1_epi32(0xFF00FF00));
+				__m128i rb = _mm_and_si128(px, _mm_set1_epi32(0x00FF00FF));
+				rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest+j), premultiply4(_mm_or_si128(ag, rb)));
+			}
+#endif
+			for (; j<width; j++) {
+				const unsigned char* px = row + j*4;
+				dest[j] = Premultiply((static_cast<unsigned int>(px[3])<<24) | (px[0]<<16) | (px[1]<<8) | px[2]);
+			}
+			break;
+	}
+}
+
+
+void PngDecoder::decode(const char* data, size_t length, unsigned int* dest, ptrdiff_t rowStride, const int* palette, int paletteLength) const
+{
+	//Missing palette entries come out as transparent black. For 4-bit images, also
+	//  build the table of pixel pairs used by convertRow().
+	std::vector<unsigned int> table;
+	if (colorType == PNG_PALETTE) {
+		if (palette==NULL)
+			throw std::runtime_error("PNG has no palette");
+		table.resize(bitDepth==4 ? 256*3 : 256, 0);
+		for (int i=0; i<paletteLength && i<256; i++)
+			table[i] = static_cast<unsigned int>(palette[i]);
+		if (bitDepth==4) {
+			for (unsigned int b=0; b<256; b++) {
+				table[256+2*b] = table[b>>4];
+				table[256+2*b+1] = table[b&0xF];
+			}
+		}
+	}
+
+	//Inflate everything at once: a filter byte, then the scanline, for each row.
+	size_t stride = bytesPerScanline + 1;
+	std::vector<unsigned char> raw(stride*height);
+	ZlibInflater::Inflate(reinterpret_cast<const unsigned char*>(data), length, &raw[0], raw.size());
+
+	//Un-filter in place; the first row's "previous" row is all zeroes.
+	std::vector<unsigned char> zeroRow(bytesPerScanline, 0);
+	const unsigned char* prev = &zeroRow[0];
+	for (int y=0; y<height; y++) {
+		unsigned char* row = &raw[y*stride];
+		unfilter(row+1, prev, bytesPerScanline, row[0], bytesPerPixel);
+		convertRow(row+1, dest + y*rowStride, table.empty() ? NULL : &table[0]);
+		prev = row+1;
+	}
+}
+
+
+void PngDecoder::DecodeFile(const char* data, size_t size, std::vector<unsigned int>& pixels, int& width, int& height)
+{
+	const unsigned char* src = reinterpret_cast<const unsigned char*>(data);
+	if (size<8 || std::memcmp(data, PNG_MAGIC, 8)!=0)
+		throw std::runtime_error("Not a PNG file");
+
+	PngDecoder* png = NULL;
+	std::vector<int> palette;
+	std::string imageData;
+	try {
+		for (size_t pos=8;;) {
+			if (size-pos < 12)
+				throw std::runtime_error("PNG chunk runs past the end of the file");
+			size_t length = readUInt(src+pos);
+			unsigned int type = readUInt(src+pos+4);
+			const unsigned char* chunk = src + pos + 8;
+			if (length > size-pos-12)
+				throw std::runtime_error("PNG chunk runs past the end of the file");
+			pos += length + 12;
+
+			if (type==PNG_IHDR) {
+				if (length<13)
+					throw std::runtime_error("PNG header is too short");
+				if (chunk[10]!=0 || chunk[11]!=0 || chunk[12]!=0)
+					throw std::runtime_error("PNG header requires unsupported options");
+				if (png!=NULL)
+					throw std::runtime_error("PNG has two headers");
+				png = new PngDecoder(readUInt(chunk), readUInt(chunk+4), chunk[8], chunk[9]);
+			} else if (type==PNG_PLTE) {
+				if (length%3!=0)
+					throw std::runtime_error("Palette length is not mod 3");
+				palette.clear();
+				for (size_t i=0; i<length; i+=3)
+					palette.push_back(0xFF000000 | (chunk[i]<<16) | (chunk[i+1]<<8) | chunk[i+2]);
+			} else if (type==PNG_TRNS) {
+				if (length>palette.size())
+					throw std::runtime_error("Pallete is null or too short.");
+				for (size_t i=0; i<length; i++)
+					palette[i] = Premultiply((static_cast<unsigned int>(chunk[i])<<24) | (palette[i]&0xFFFFFF));
+			} else if (type==PNG_IDAT) {
+				if (png==NULL)
+					throw std::runtime_error("PNG image data comes before the header");
+				imageData.append(reinterpret_cast<const char*>(chunk), length);
+			} else if (type==PNG_IEND)
+				break;
+		}
+		if (png==NULL)
+			throw std::runtime_error("PNG has no header");
+
+		width = png->width;
+		height = png->height;
+		pixels.resize(static_cast<size_t>(width)*height);
+		png->decode(imageData.data(), imageData.size(), &pixels[0], width, palette.empty() ? NULL : &palette[0], static_cast<int>(palette.size()));
+	} catch (...) {
+		delete png;
+		throw;
+	}
+	delete png;
+}
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+namespace waitzar
+{
+
+
+/**
+ * One-shot zlib (RFC 1950/1951) decompressor. The whole stream is inflated into a buffer of known
+ *   size, which is how PNG image data is always read. Huffman codes are decoded through a lookup
+ *   table indexed by the next few bits of input; only the rare longer codes fall back to a search.
+ * Corrupt streams, a bad Adler-32 checksum, or output that doesn't exactly fill "dest" all throw
+ *   a std::runtime_error.
+ */
+class ZlibInflater {
+public:
+	static void Inflate(const unsigned char* src, size_t srcLength, unsigned char* dest, size_t destLength);
+};
+
+
+/**
+ * Decodes the PNG subset used by PulpCore images and fonts (8-bit grayscale, RGB, palette, and
+ *   their alpha variants; 4-bit palettes; no interlacing) into premultiplied ARGB pixels, with no
+ *   dependency on Win32 or Java ports.
+ * The caller collects the image data (the contents of every IDAT chunk, in order), which is then
+ *   inflated in one pass. Scanlines are un-filtered in place, and the Up, Sub, Average and Paeth
+ *   filters use SSE2 where available. The same goes for converting to ARGB: grayscale and RGBA are
+ *   expanded and premultiplied 4 pixels at a time, and 4-bit palettes are expanded two pixels per lookup.
+ * Palette entries are given as ARGB (already premultiplied by their tRNS alpha), since that's how
+ *   PulpCoreImage keeps them.
+ */
+class PngDecoder {
+public:
+	//Throws if the header describes something we can't read.
+	PngDecoder(int width, int height, int bitDepth, int colorType);
+
+	//Decode the image data into "dest". Each row is "rowStride" pixels after the previous one; pass a
+	//  negative stride (and a pointer to the last row) to produce a bottom-up bitmap.
+	void decode(const char* data, size_t length, unsigned int* dest, ptrdiff_t rowStride, const int* palette, int paletteLength) const;
+
+	//Convenience: decode an entire PNG file into a top-down ARGB buffer. Custom chunks are skipped.
+	static void DecodeFile(const char* data, size_t size, std::vector<unsigned int>& pixels, int& width, int& height);
+
+	//Premultiplied alpha, as PulpCore (and AlphaBlend) expect it.
+	static unsigned int Premultiply(unsigned int argb) {
+		unsigned int a = argb>>24;
+		unsigned int r = (a*((argb>>16)&0xFF) + 127) / 255;
+		unsigned int g = (a*((argb>>8)&0xFF) + 127) / 255;
+		unsigned int b = (a*(argb&0xFF) + 127) / 255;
+		return (a<<24) | (r<<16) | (g<<8) | b;
+	}
+
+private:
+	int width;
+	int height;
+	int bitDepth;
+	int colorType;
+	size_t bytesPerPixel;
+	size_t bytesPerScanline;
+
+	static void unfilter(unsigned char* curr, const unsigned char* prev, size_t length, int filter, size_t bpp);
+	void convertRow(const unsigned char* row, unsigned int* dest, const unsigned int* palette) const;
+};
+
+
+} //End waitzar namespace
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
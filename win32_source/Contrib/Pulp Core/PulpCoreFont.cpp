@@ -26,6 +26,12 @@ PulpCoreFont::PulpCoreFont()
 {
 }
 
+PulpCoreFont::~PulpCoreFont()
+{
+	//Delete our extra copies of the font bitmap
+	releaseTintPages();
+}
+
 
 /**
  * Copy initializers.
@@ -47,8 +53,8 @@ void PulpCoreFont::init(PulpCoreFont *copyFrom, HDC currDC, unsigned int default
 	this->bearingRight = copyFrom->bearingRight;
 
 	//Color, however, should be re-created
-	this->cachedColor = new unsigned int[num_char_pos-1];
-	this->tintSelf(defaultColor);
+	this->metrics = copyFrom->metrics;
+	this->initGlyphs(defaultColor);
 	this->greenPen = CreatePen(PS_SOLID, 1, RGB(0, 255, 0));
 }
 
@@ -62,7 +68,7 @@ void PulpCoreFont::init(const std::string& buffer, HDC currDC, const std::wstrin
 
 	//Tint the default color
 	this->currColor = defaultColor;
-	this->tintSelf(defaultColor);
+	this->initGlyphs(defaultColor);
 	this->greenPen = CreatePen(PS_SOLID, 1, RGB(0, 255, 0));
 }
 
@@ -73,28 +79,78 @@ void PulpCoreFont::init(char *data, DWORD size, HDC currDC, unsigned int default
 
 	//Tint the default color
 	this->currColor = defaultColor;
-	this->tintSelf(defaultColor);
+	this->initGlyphs(defaultColor);
 	this->greenPen = CreatePen(PS_SOLID, 1, RGB(0, 255, 0));
 }
 
 
+void PulpCoreFont::initGlyphs(unsigned int defaultColor)
+{
+	//Our own bitmap is page 0; the others are made when first needed.
+	releaseTintPages();
+	TintPage ownPage = {directDC, directBitmap, directPixels};
+	tintPages.assign(1, ownPage);
+	tintPages.resize(PULP_MAX_TINTS, TintPage());
+	tintCache.init(metrics.getNumGlyphs(), PULP_MAX_TINTS, defaultColor);
+
+	this->tintSelf(defaultColor);
+}
+
+
+void PulpCoreFont::releaseTintPages()
+{
+	//Page 0 belongs to PulpCoreImage
+	for (size_t i=1; i<tintPages.size(); i++) {
+		if (tintPages[i].dc!=NULL)
+			DeleteDC(tintPages[i].dc);
+		if (tintPages[i].bitmap!=NULL)
+			DeleteObject(tintPages[i].bitmap);
+	}
+	tintPages.clear();
+}
+
+
 void PulpCoreFont::tintSelf(UINT rgbColor)
 {
 	//Same functionality
 	PulpCoreImage::tintSelf(rgbColor);
 
-	//Now set the color cache entries properly
-	for (int i=0; i<num_char_pos-1; i++) 
-		cachedColor[i] = (0xFFFFFF&rgbColor); //Don't save the alpha component.
+	//Every glyph on page 0 is now this color; the other pages are stale.
+	tintCache.reset(rgbColor);
 }
 
-void PulpCoreFont::tintLetter(int letterID, unsigned int color)
+
+void PulpCoreFont::drawGlyph(HDC bufferDC, int index, int xPos, int yPos)
 {
-	//Get the bounds of the letter to tint
-	PulpCoreImage::tintSelf(color, charPositions[letterID], 0, charPositions[letterID+1]-charPositions[letterID], height);
+	//Find (or make) a copy of this glyph in the right color
+	bool needsTint = false;
+	int pageID = tintCache.acquire(index, currColor, needsTint);
+	TintPage& page = tintPages[pageID];
+	if (page.dc==NULL) {
+		page.dc = CreateCompatibleDC(directDC);
+		page.bitmap = CreateDIBSection(page.dc, &bmpInfo,  DIB_RGB_COLORS, (void**) &page.pixels, NULL, 0);
+		if (page.bitmap==NULL) {
+			DeleteDC(page.dc);
+			page.dc = NULL;
+			throw std::runtime_error("Couldn't create font bitmap.");
+		}
+		SelectObject(page.dc, page.bitmap);
+
+		//Only the alpha matters; tinting sets the rest.
+		memcpy(page.pixels, directPixels, width*height*sizeof(UINT));
+	}
+
+	int pos = metrics.getPosition(index);
+	int charWidth = metrics.getWidth(index);
+	if (needsTint)
+		waitzar::TintPixels(page.pixels, width, pos, 0, charWidth, height, currColor);
 
-	//Finally, save
-	cachedColor[letterID] = (0xFFFFFF&color); //Don't save the alpha component.
+	//Draw this letter
+	AlphaBlend(
+		bufferDC, xPos, yPos, charWidth, height,   //Destination
+		page.dc, pos, 0, charWidth, height,    //Source
+		blendFunc				   //Method
+	);
 }
 
 
@@ -131,7 +187,6 @@ void PulpCoreFont::fontSet()
     charPositions = new int[num_char_pos];
     bearingLeft = new int[numChars];
     bearingRight = new int[numChars];
-	cachedColor = new unsigned int[numChars];
 
 	//Java inits...
 	for (int i=0; i<num_char_pos; i++) 
@@ -153,6 +208,9 @@ void PulpCoreFont::fontSet()
         }
 	}
 	uppercaseOnly = (lastChar < 'a');
+
+	//Pre-compute everything needed to lay out a string
+	metrics.init(firstChar, lastChar, tracking, charPositions, bearingLeft, bearingRight);
 }
 
 
@@ -163,21 +221,8 @@ void PulpCoreFont::drawChar(HDC bufferDC, char letter, int xPos, int yPos)
 	if (directPixels==NULL)
 		return;
 
-	//Get metrics
-	int index = getCharIndex(letter);
-	int pos = charPositions[index];
-    int charWidth = charPositions[index+1] - pos;
-
-	//Re-tint?
-	if (cachedColor[index]!=currColor)
-		tintLetter(index, currColor);
-
 	//Draw this letter
-	AlphaBlend(
-	   bufferDC, xPos, yPos, charWidth, height,   //Destination
-	   directDC, pos, 0, charWidth, height,    //Source
-	   blendFunc				   //Method
-	);
+	drawGlyph(bufferDC, getCharIndex(letter), xPos, yPos);
 }
 
 
@@ -185,21 +230,19 @@ void PulpCoreFont::drawChar(HDC bufferDC, char letter, int xPos, int yPos)
 void PulpCoreFont::drawString(HDC bufferDC, const wstring &str, int xPos, int yPos, const std::wstring& filterStr, size_t filterLetterWidth)
 {
 	//Don't loop through null or zero-lengthed strings
-	int numChars = str.length();
-	if (str.empty() || numChars==0 || directPixels==NULL)
+	if (str.empty() || directPixels==NULL)
 		return;
 
+	//Place every letter first; this is the same layout getStringWidth() measures.
+	metrics.layout(str, 0, str.length(), filterStr, filterLetterWidth, &layoutBuffer);
+
 	//Loop through all letters...
-	int nextIndex = getCharIndex(str[0]);
-	int startX = xPos;
-    for (int i=0; i<numChars; i++) {
-		int index = nextIndex;
-        int pos = charPositions[index];
-        int charWidth = charPositions[index+1] - pos;
-		bool thisCharIsZWS = filterStr.find(str[i])!=wstring::npos;
+	for (size_t i=0; i<layoutBuffer.size(); i++) {
+		const waitzar::GlyphMetrics::Glyph& glyph = layoutBuffer[i];
+		int startX = xPos + glyph.x;
 
 		//Modify for our special spaces
-		if (thisCharIsZWS) {
+		if (glyph.filtered) {
 			//Draw the separator
 			if (filterLetterWidth>0) {
 				HPEN oldPen = (HPEN)SelectObject(bufferDC, greenPen);
@@ -207,62 +250,11 @@ void PulpCoreFont::drawString(HDC bufferDC, const wstring &str, int xPos, int yP
 				LineTo(bufferDC, startX, yPos+height);
 				SelectObject(bufferDC, oldPen);
 			}
-
-			//New width/kerning
-			charWidth = filterLetterWidth;
 		} else {
-			//Re-tint?
-			if (cachedColor[index]!=currColor)
-				tintLetter(index, currColor);
-
 			//Draw this letter
-			AlphaBlend(
-				bufferDC, startX, yPos, charWidth, height,   //Destination
-				directDC, pos, 0, charWidth, height,    //Source
-				blendFunc				   //Method
-			);
+			drawGlyph(bufferDC, glyph.index, startX, yPos);
 		}
-
-		//Prepare next character.... if any
-        if (i < numChars-1) {
-            nextIndex = getCharIndex(str[i + 1]);
-
-			//Fix kerning on ZWS letters
-			bool nextCharIsZWS = filterStr.find(str[i+1])!=wstring::npos;
-			int nextKerning = getKerning(index, nextIndex);
-			if (thisCharIsZWS || nextCharIsZWS)
-				nextKerning = 0; 
-
-            int dx = charWidth + nextKerning;
-			startX += dx;
-        }
-    }
-}
-
-
-int PulpCoreFont::getCharIndex(wchar_t ch) const
-{
-	//Special-case (not in WZ)
-	if (uppercaseOnly && ch>='a' &&ch<= 'z')
-		ch += 'A' - 'a';
-
-	//Also...
-	int fallback = charIsOutOfRange('?') ? lastChar : '?';
-
-	//Bound (default to last character)
-	if (charIsOutOfRange(ch))
-		ch = fallback;
-
-	return ch - firstChar;
-}
-
-
-bool PulpCoreFont::charIsOutOfRange(wchar_t ch) const
-{
-	//Special-case (not in WZ)
-	if (uppercaseOnly && ch>='a' &&ch<= 'z')
-		ch += 'A' - 'a';
-	return (ch<firstChar || ch>lastChar);
+	}
 }
 
 
@@ -277,24 +269,15 @@ void PulpCoreFont::drawString(HDC bufferDC, const string &str, int xPos, int yPo
 	int startX = xPos;
 	for (size_t i=0; i<str.length(); i++) {
 		int index = nextIndex;
-        int pos = charPositions[index];
-        int charWidth = charPositions[index+1] - pos;
-
-		//Re-tint?
-		if (cachedColor[index]!=currColor)
-			tintLetter(index, currColor);
+		int charWidth = metrics.getWidth(index);
 
 		//Draw this letter
-		AlphaBlend(
-			   bufferDC, startX, yPos, charWidth, height,   //Destination
-			   directDC, pos, 0, charWidth, height,    //Source
-			   blendFunc				   //Method
-		);
+		drawGlyph(bufferDC, index, startX, yPos);
 
 		//Prepare next character.... if any
 		if (i < str.length()-1) {
             nextIndex = getCharIndex(str[i + 1]);
-            int dx = charWidth + getKerning(index, nextIndex);
+            int dx = charWidth + metrics.getKerning(index, nextIndex);
 			startX += dx;
         }
     }
@@ -315,32 +298,9 @@ int PulpCoreFont::getCharIndex(char ch) const
 
 
 
-int PulpCoreFont::getKerning(int leftIndex, int rightIndex) const
-{
-	// Future versions of this method might handle kerning pairs, like "WA" and "Yo"
-	if (tracking!=0 && (shouldIgnoreTracking(rightIndex) || shouldIgnoreTracking(leftIndex)))
-        return bearingRight[leftIndex] + bearingLeft[rightIndex];
-	else
-		return bearingRight[leftIndex] + tracking + bearingLeft[rightIndex];
-}
-
-
-
-bool PulpCoreFont::shouldIgnoreTracking(int index) const
-{
-	int width = (charPositions[index+1] - charPositions[index]);
-	int lsb = bearingLeft[index];
-    int rsb = bearingRight[index];
-    int advance = width + lsb + rsb;
-    return advance < width/2;
-}
-
-
 int PulpCoreFont::getCharWidth(char letter)
 {
-	int index = getCharIndex(letter);
-	int pos = charPositions[index];
-	return charPositions[index+1] - pos;
+	return metrics.getWidth(getCharIndex(letter));
 }
 
 int PulpCoreFont::getHeight(HDC currDC) const
@@ -357,27 +317,6 @@ int PulpCoreFont::getStringWidth(const wstring &str, HDC currDC, const std::wstr
 
 int PulpCoreFont::getStringWidth(const wstring &str, int start, int end, const std::wstring& filterStr, size_t filterLetterWidth) const
 {
-        if (end <= start) {
-            return 0;
-        }
-        int stringWidth = 0;
-        
-        int lastIndex = -1;
-        for (int i=start; i<end; i++) { 
-            int index = getCharIndex(str[i]);
-            int charWidth = charPositions[index+1] - charPositions[index];
-
-			//Special case: ZWS letter:
-			if (filterStr.find(str[i])!=wstring::npos) {
-				stringWidth += filterLetterWidth;
-			} else {
-				if (lastIndex!=-1)
-	                stringWidth += getKerning(lastIndex, index);
-				stringWidth += charWidth;
-			}
-            lastIndex = index;
-        }
-        return stringWidth;
+	//Same layout as drawString(), but nothing is drawn.
+	return metrics.layout(str, start, end, filterStr, filterLetterWidth, NULL);
 }
-
-
@@ -28,8 +28,11 @@
 //#include <stdio.h>
 
 #include <string>
+#include <vector>
+#include <cstring>
 
 #include "PulpCoreImage.h"
+#include "GlyphAtlas.h"
 #include "Display/DisplayMethod.h"
 
 //Magic number for Pulp Core font header.
@@ -38,6 +41,9 @@ const char PULP_MAGICNUM[] = "pulpfnt\x0B";              //0x70756c70666e740b
 //Pulp Core chunk IDs
 #define CHUNK_FONT 0x666f4e74
 
+//How many colors each glyph can be kept in at once (see GlyphTintCache)
+const int PULP_MAX_TINTS = 4;
+
 
 /**
  * PulpCore is a Java project; see the link in the license file. 
@@ -66,6 +72,7 @@ class PulpCoreFont : public PulpCoreImage, public DisplayMethod
 public:
 	//Empty constructor
 	PulpCoreFont();
+	virtual ~PulpCoreFont();
 
 	//Initializers
 	void init(const std::string& buffer, HDC currDC, const std::wstring& fontFaceName, int pointSize, int devLogPixelsY, unsigned int defaultColor);
@@ -88,6 +95,13 @@ public:
 	void tintSelf(UINT rgbColor);
 
 private:
+	//A copy of our bitmap, with some glyphs tinted in other colors.
+	struct TintPage {
+		HDC dc;
+		HBITMAP bitmap;
+		UINT* pixels;
+	};
+
 	//PulpCoreFont-specific properties
 	int firstChar;
 	int lastChar;
@@ -96,22 +110,23 @@ private:
 	int num_char_pos;
 	int* bearingLeft;
 	int* bearingRight;
-	unsigned int* cachedColor;
 	bool uppercaseOnly;
 
+	//Layout, and which colors our glyphs have been tinted
+	waitzar::GlyphMetrics metrics;
+	waitzar::GlyphTintCache tintCache;
+	std::vector<TintPage> tintPages; //Page 0 is our own bitmap
+	std::vector<waitzar::GlyphMetrics::Glyph> layoutBuffer;
+
 	//Internal Methods
 	void readChunk(int chunkType, int length, HDC currDC);
 	void fontSet();
-	int getCharIndex(wchar_t ch) const;
+	void initGlyphs(unsigned int defaultColor);
+	void releaseTintPages();
 	int getCharIndex(char ch) const;
-	bool charIsOutOfRange(wchar_t ch) const;
-	//int getKerning(TCHAR left, TCHAR right);
-	//int getKerning(char left, char right);
-	int getKerning(int leftIndex, int rightIndex) const;
-	bool shouldIgnoreTracking(int index) const;
-
-	//Added
-	void tintLetter(int letterID, unsigned int color);
+
+	//Draw one glyph in the current color, tinting it first if we have to.
+	void drawGlyph(HDC bufferDC, int index, int xPos, int yPos);
 
 	//Drawing...
 	HPEN greenPen;
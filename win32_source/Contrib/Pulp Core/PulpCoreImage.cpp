@@ -131,21 +131,13 @@ void PulpCoreImage::initBmpInfo()
  */
 void PulpCoreImage::tintSelf(UINT rgbColor)
 {
-	for (int i=0; i<width*height; i++) {
-		directPixels[i] = premultiply((directPixels[i]&0xff000000)|(rgbColor&0x00ffffff));
-	} 
+	waitzar::TintPixels(directPixels, width, 0, 0, width, height, rgbColor);
 }
 
 //Tint only part of the rectangle
 void PulpCoreImage::tintSelf(UINT rgbColor, int sX, int sY, int w, int h)
 {
-	//Loop through all relevant pixels
-	for (int y=sY; y<sY+h; y++) {
-		for (int x=sX; x<sX+w; x++) {
-			int i = y*width+x;
-			directPixels[i] = premultiply((directPixels[i]&0xff000000)|(rgbColor&0x00ffffff));
-		}
-	}
+	waitzar::TintPixels(directPixels, width, sX, sY, w, h, rgbColor);
 }
 
 
@@ -441,15 +433,10 @@ void PulpCoreImage::init(const char *data, DWORD size, HDC currDC)
 		throw std::runtime_error(msg.str().c_str());
 	}
 
-
-	//Why are bitmaps loading upside-down....?
-	for (int x=0; x<width; x++) {
-		for (int y=0; y<height/2; y++) {
-			UINT temp = directPixels[y*width + x];
-			directPixels[y*width + x] = directPixels[(height-1-y)*width + x];
-			directPixels[(height-1-y)*width + x] = temp;
-		}
-	}
+	//Now decode the image data. DIBs are stored bottom-up, so start from the last row.
+	waitzar::PngDecoder png(width, height, bitDepth, colorType);
+	png.decode(imageData.data(), imageData.size(), directPixels + (height-1)*width, -width, palette, pal_length);
+	imageData.clear();
 
 	//Note: Absolutely NEVER do this:
 	//SelectObject(directDC, previousObject);
@@ -545,6 +532,9 @@ void PulpCoreImage::readHeader(HDC currDC)
 
 	//Create a new image
     isOpaque = true;
+	palette = NULL;
+	pal_length = 0;
+	imageData.clear();
     if (colorType == COLOR_TYPE_GRAYSCALE_WITH_ALPHA || colorType == COLOR_TYPE_RGB_WITH_ALPHA)
 		isOpaque = false;
 
@@ -631,190 +621,9 @@ void PulpCoreImage::readAnimation()
 
 void PulpCoreImage::readData(int length)
 {
-	Inflater* inflater = new Inflater();
-	inflater->setInput(res_data, currPos, length);
-
-    int bitsPerPixel = bitDepth * SAMPLES_PER_PIXEL[colorType];
-    int bytesPerPixel = (bitsPerPixel + 7) / 8;
-    int bytesPerScanline = (width * bitsPerPixel + 7) / 8;
-    char* prevScanline = new char[bytesPerScanline];
-	char* currScanline = new char[bytesPerScanline];
-    char* filterBuffer = new char[1];
-    int index = 0;
-
-	//Java inits...
-	filterBuffer[0] = 0;
-	for (int i=0; i<bytesPerScanline; i++)
-		currScanline[i] = 0;
-
-    for (int i=0; i<height; i++) {
-		inflateFully(inflater, filterBuffer, 1);
-		inflateFully(inflater, currScanline, bytesPerScanline);
-        
-		//Apply filter
-		int filter = filterBuffer[0];
-        if (filter > 0 && filter < 5)
-			decodeFilter(currScanline, bytesPerScanline, prevScanline, filter, bytesPerPixel);
-		else if (filter!=0) {
-			std::stringstream msg;
-			msg <<"Illegal filter type: " <<filter;
-			throw std::runtime_error(msg.str().c_str());
-        }
-
-        //Convert bytes into ARGB pixels
-        int srcIndex = 0;
-        switch (colorType) {
-			default: case COLOR_TYPE_GRAYSCALE:
-				for (int j = 0; j < width; j++) {
-					int v = currScanline[j] & 0xff;
-                    directPixels[index++] = (0xff << 24) | (v << 16) | (v << 8) | v;
-                }
-                break;
-			case COLOR_TYPE_RGB:
-				for (int j = 0; j < width; j++) {
-                    int r = currScanline[srcIndex++] & 0xff;
-                    int g = currScanline[srcIndex++] & 0xff;
-                    int b = currScanline[srcIndex++] & 0xff;
-                    directPixels[index++] = (0xff << 24) | (r << 16) | (g << 8) | b;
-                }
-                break;
-            case COLOR_TYPE_PALETTE:
-                if (bitDepth == 8) {
-                    for (int j = 0; j < width; j++)
-                        directPixels[index++] = palette[currScanline[j] & 0xff];
-                } else {
-                    //Assume bitDepth == 4
-                    bool isOdd = (width & 1) == 1;
-                    int s = width & ~1;
-                    for (int j = 0; j < s; j+=2) {
-                        int b = currScanline[srcIndex++] & 0xff;
-                        directPixels[index++] = palette[doubleRightShift(b, 4)];
-                        directPixels[index++] = palette[b & 0x0f];
-                    }
-                    if (isOdd) {
-                        int b = currScanline[srcIndex++] & 0xff;
-                        directPixels[index++] = palette[doubleRightShift(b, 4)];
-                    }
-                }
-                break;
-            case COLOR_TYPE_GRAYSCALE_WITH_ALPHA:
-                for (int j = 0; j < width; j++) {
-                    int v = currScanline[srcIndex++] & 0xff;
-                    int a = currScanline[srcIndex++] & 0xff;
-                    directPixels[index++] = (a << 24) | (v << 16) | (v << 8) | v;
-                }
-                break;
-            case COLOR_TYPE_RGB_WITH_ALPHA:
-                for (int j = 0; j < width; j++) {
-                    int r = currScanline[srcIndex++] & 0xff;
-                    int g = currScanline[srcIndex++] & 0xff;
-                    int b = currScanline[srcIndex++] & 0xff;
-                    int a = currScanline[srcIndex++] & 0xff;
-                    directPixels[index++] = (a << 24) | (r << 16) | (g << 8) | b;
-                }
-                break;
-        }
-
-        //Swap curr and prev scanlines
-        char* temp = currScanline;
-        currScanline = prevScanline;
-        prevScanline = temp;
-    }
-
-    if (/*CoreGraphics.PREMULTIPLIED_ALPHA &&*/
-        (colorType == COLOR_TYPE_GRAYSCALE_WITH_ALPHA ||
-        colorType == COLOR_TYPE_RGB_WITH_ALPHA))
-    {
-        premultiply(directPixels, width*height);
-    }
-
-    inflater->end();
+	//Image data may be split across any number of chunks; we decode it all at the end.
+	imageData.append(res_data+currPos, length);
 	currPos += length;
-
-	delete [] prevScanline;
-	delete [] currScanline;
-    delete [] filterBuffer;
-
-	delete inflater;
-}
-
-
-void PulpCoreImage::inflateFully(Inflater* inflater, char* result, int res_length)
-{
-	int bytesRead = 0;
-
-    while (bytesRead < res_length) {
-		if (inflater->needsInput())
-			throw std::runtime_error("Inflater ran out of input");
-
-		int res = inflater->inflate(result, res_length, bytesRead, res_length - bytesRead);
-		if (res==-1)
-			throw std::runtime_error("0 > off || off > off + len || off + len > buf_length");
-
-        bytesRead += res;
-    }
-}
-
-
-void PulpCoreImage::decodeFilter(char* curr, int curr_len, char* prev, int filter, int bpp)
-{
-    int length = curr_len;
-
-    if (filter == 1) {
-        // Input = Sub
-        // Raw(x) = Sub(x) + Raw(x-bpp)
-        // For all x < 0, assume Raw(x) = 0.
-        for (int i = bpp; i < length; i++) {
-            curr[i] = (char)(curr[i] + curr[i - bpp]);
-        }
-    } else if (filter == 2) {
-        // Input = Up
-        // Raw(x) = Up(x) + Prior(x)
-        for (int i = 0; i < length; i++) {
-            curr[i] = (char)(curr[i] + prev[i]);
-        }
-    } else if (filter == 3) {
-        // Input = Average
-        // Raw(x) = Average(x) + floor((Raw(x-bpp)+Prior(x))/2)
-        for (int i = 0; i < bpp; i++) {
-			curr[i] = (char)(curr[i] + doubleRightShift((prev[i] & 0xff), 1));
-        }
-        for (int i = bpp; i < length; i++) {
-            curr[i] = (char)(curr[i] + doubleRightShift(((curr[i - bpp] & 0xff) + (prev[i] & 0xff)), 1));
-        }
-    } else if (filter == 4) {
-        // Input = Paeth
-        // Raw(x) = Paeth(x) + PaethPredictor(Raw(x-bpp), Prior(x), Prior(x-bpp))
-        for (int i = 0; i < bpp; i++) {
-            curr[i] = (char)(curr[i] + prev[i]);
-        }
-        for (int i = bpp; i < length; i++) {
-            curr[i] = (char)(curr[i] +
-                paethPredictor(curr[i - bpp] & 0xff, prev[i] & 0xff, prev[i - bpp] & 0xff));
-        }
-    }
-}
-
-
-// a = left, b = above, c = upper left
-int PulpCoreImage::paethPredictor(int a, int b, int c)
-{
-    // Initial estimate
-    int p = a + b - c;
-
-    // Distances to a, b, c
-    int pa = abs(p - a);
-    int pb = abs(p - b);
-    int pc = abs(p - c);
-
-    // Return nearest of a,b,c, breaking ties in order a,b,c.
-    if (pa <= pb && pa <= pc) {
-        return a;
-    } else if (pb <= pc) {
-        return b;
-    } else {
-        return c;
-    }
 }
 
 
@@ -827,9 +636,9 @@ void PulpCoreImage::premultiply(UINT* arbg, int argb_len)
 
 int PulpCoreImage::premultiply(UINT arbg)
 {
-	int a = doubleRightShift(arbg, 24) & 0xFF;
-	int r = doubleRightShift(arbg, 16) & 0xFF;
-	int g = doubleRightShift(arbg, 8) & 0xFF;
+	int a = (arbg>>24) & 0xFF;
+	int r = (arbg>>16) & 0xFF;
+	int g = (arbg>>8) & 0xFF;
     int b = arbg & 0xFF;
 
 	return premultiply(a, r, g, b);
@@ -848,9 +657,9 @@ int PulpCoreImage::premultiply(int a, int r, int g, int b)
 
 void PulpCoreImage::unpremultiply(UINT arbg, int& a, int& r, int& g, int& b)
 {
-	a = doubleRightShift(arbg, 24) & 0xFF;
-	r = doubleRightShift(arbg, 16) & 0xFF;
-	g = doubleRightShift(arbg, 8) & 0xFF;
+	a = (arbg>>24) & 0xFF;
+	r = (arbg>>16) & 0xFF;
+	g = (arbg>>8) & 0xFF;
     b = arbg & 0xFF;
 
 	//Undo~
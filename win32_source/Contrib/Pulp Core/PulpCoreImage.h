@@ -29,7 +29,8 @@
 #include <sstream>
 #include <stdexcept>
 
-#include "Jazzlib/Inflater.h"
+#include "PngDecoder.h"
+#include "GlyphAtlas.h"
 
 //Magic number for .PNG header.
 const char PNG_SIGNATURE[] = "\x89PNG\x0D\x0A\x1A\x0A";  //0x89504e470d0a1a0a
@@ -127,6 +128,7 @@ protected:
 	DWORD currPos;
 	const char* res_data;
 	DWORD res_size;
+	std::string imageData; //All IDAT chunks, decoded together once we've read them
 
 	//Error tracking
 	//BOOL error;
@@ -140,13 +142,10 @@ protected:
 	virtual void readChunk(int chunkType, int length, HDC currDC);
 	void readAnimation();
 	void readData(int length);
-	void decodeFilter(char* curr, int curr_len, char* prev, int filter, int bpp);
-	int paethPredictor(int a, int b, int c);
 	int premultiply(UINT arbg);
 	int premultiply(int a, int r, int g, int b);
 	void unpremultiply(UINT arbg, int& a, int& r, int& g, int& b);
 	void premultiply(UINT* arbg, int argb_len);
-	void inflateFully(Inflater* inflater, char* result, int res_length);
 
 	//Now updated to allow unsigned values (makes more sense for "size" parameters)
 	int readInt();
@@ -13,6 +13,8 @@ void InputMethod::init(MyWin32Window* mainWindow, MyWin32Window* sentenceWindow,
 	providingHelpFor = NULL;
 	viewChanged = false;
 	requestToTypeSentence = false;
+	dirtyRegions = VR_ALL;
+	cachedSentenceStrings.resize(4);
 	//myenc2Uni = NULL;
 	//uni2Romanenc = NULL;
 
@@ -48,6 +50,7 @@ bool InputMethod::isHelpInput()
 void InputMethod::forceViewChanged()
 {
 	viewChanged = true;
+	invalidate(VR_ALL);
 }
 
 bool InputMethod::getAndClearViewChanged()
@@ -197,9 +200,46 @@ std::wstring InputMethod::getTypedRomanString(bool asLowercase)
 	return ret;
 }
 
-std::pair<int, int> InputMethod::getPagingInfo() const
+void InputMethod::buildPagingInfo(std::pair<int, int>& res) const
 {
-	return std::pair<int, int>(0, 0);
+	res = std::pair<int, int>(0, 0);
+}
+
+
+const std::vector<std::wstring>& InputMethod::getTypedSentenceStrings()
+{
+	//A help input shows another input method's sentence, which we can't track; always rebuild it.
+	bool untracked = this->isHelpInput();
+	if (untracked)
+		invalidate(VR_SENTENCE);
+
+	if (dirtyRegions&VR_SENTENCE) {
+		buildTypedSentenceStrings(dirtyRegions&VR_SENTENCE, cachedSentenceStrings);
+		if (!untracked)
+			dirtyRegions &= ~VR_SENTENCE;
+	}
+	return cachedSentenceStrings;
+}
+
+
+const std::vector< std::pair<std::wstring, unsigned int> >& InputMethod::getTypedCandidateStrings()
+{
+	if (dirtyRegions&VR_CANDIDATES) {
+		cachedCandidateStrings.clear();
+		buildTypedCandidateStrings(cachedCandidateStrings);
+		dirtyRegions &= ~VR_CANDIDATES;
+	}
+	return cachedCandidateStrings;
+}
+
+
+const std::pair<int, int>& InputMethod::getPagingInfo()
+{
+	if (dirtyRegions&VR_PAGING) {
+		buildPagingInfo(cachedPagingInfo);
+		dirtyRegions &= ~VR_PAGING;
+	}
+	return cachedPagingInfo;
 }
 
 
@@ -21,6 +21,11 @@
 //Hilite styles
 enum HILITE_FLAGS {HF_NOTHING=0, HF_PATSINT=1, HF_CURRSELECTION=2, HF_LABELTILDE=4};
 
+//Regions of the view, for tracking what has changed since it was last drawn.
+//The first three match the strings returned by getTypedSentenceStrings().
+enum VIEW_REGION {VR_BEFORE_HILITE=1, VR_HILITE=2, VR_AFTER_CURSOR=4, VR_CANDIDATES=8, VR_PAGING=16,
+                  VR_SENTENCE=VR_BEFORE_HILITE|VR_HILITE|VR_AFTER_CURSOR, VR_ALL=0x1F};
+
 
 
 //Expected interface: "Input Method"
@@ -36,7 +41,7 @@ public:
 	//Useful functionality
 	virtual void treatAsHelpKeyboard(InputMethod* providingHelpFor, std::function<void (const std::wstring& fromEnc, const std::wstring& toEnc, std::wstring& src)> ConfigGetAndTransformSrc = std::function<void (const std::wstring& fromEnc, const std::wstring& toEnc, std::wstring& src)>()) = 0;
 	bool isHelpInput();
-	void forceViewChanged();
+	void forceViewChanged(); //Also rebuilds every region
 	bool getAndClearViewChanged();
 	bool getAndClearRequestToTypeSentence();
 	std::pair <std::string, std::wstring> getAndClearMostRecentRomanizationCheck();
@@ -116,6 +121,24 @@ protected:
 	//Must be maintained by the subclass
 	std::wstringstream typedRomanStr;
 
+	//Flag regions (VIEW_REGION) whose strings are out of date. Subclasses must call this whenever
+	//  they change anything that these strings are built from; the next call to getTypedSentenceStrings(),
+	//  getTypedCandidateStrings() or getPagingInfo() will rebuild only those regions.
+	void invalidate(unsigned int regions) { dirtyRegions |= regions; }
+
+	//Rebuild the cached strings. "res" holds the previous result; only the flagged sentence regions need
+	//  to be replaced, but the full string (res[3]) must be rebuilt if any of them are.
+	virtual void buildTypedSentenceStrings(unsigned int regions, std::vector<std::wstring>& res) = 0;
+	virtual void buildTypedCandidateStrings(std::vector< std::pair<std::wstring, unsigned int> >& res) = 0;
+	virtual void buildPagingInfo(std::pair<int, int>& res) const;
+
+private:
+	//What's been rebuilt since the last change.
+	unsigned int dirtyRegions;
+	std::vector<std::wstring> cachedSentenceStrings;
+	std::vector< std::pair<std::wstring, unsigned int> > cachedCandidateStrings;
+	std::pair<int, int> cachedPagingInfo;
+
 
 public:  //Abstract methods
 
@@ -134,8 +157,9 @@ public:  //Abstract methods
 	//  2) The string before the cursor (highlighted string).
 	//  3) The string after the cursor.
 	// In addition, a fourth string is returned containing the entire typed string.
+	//These are cached, and are valid until the next call to any other method of this class.
 	//TODO: Eventually redo with tuples
-	virtual std::vector< std::wstring > getTypedSentenceStrings() = 0;
+	const std::vector< std::wstring >& getTypedSentenceStrings();
 	virtual void appendToSentence(wchar_t letter, int id) = 0; //Used for system letters only, for perf. reasons. (id is optional)
 
 	//The current "candidate" string, which will be displayed in the top
@@ -143,7 +167,7 @@ public:  //Abstract methods
 	//The same warnings apply as to the typedSentenceString.
 	//NOTE: for now, the "int" part is just the highlight level: 1 for red and 2 for green (3 for both, which means green)
 	//      TODO: Make this cleaner.
-	virtual std::vector< std::pair<std::wstring, unsigned int> > getTypedCandidateStrings() = 0;
+	const std::vector< std::pair<std::wstring, unsigned int> >& getTypedCandidateStrings();
 
 
 	//Get the typed romanized string. This consists ONLY of all typed valid letters
@@ -152,7 +176,7 @@ public:  //Abstract methods
 
 	//Get the status of paging
 	// Returns <currIndex, maxPages>
-	virtual std::pair<int, int> getPagingInfo() const;
+	const std::pair<int, int>& getPagingInfo();
 
 	//Called periodically
 	virtual void reset(bool resetCandidates, bool resetRoman, bool resetSentence, bool performFullReset) = 0;
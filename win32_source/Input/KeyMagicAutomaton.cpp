@@ -0,0 +1,191 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#include "KeyMagicAutomaton.h"
+
+#include <algorithm>
+
+using std::vector;
+using std::map;
+using std::wstring;
+
+
+bool KeyMagicAutomaton::Element::matches(wchar_t letter) const
+{
+	switch (type) {
+		case KMAE_LETTER:
+			return letter==this->letter;
+		case KMAE_ANY_LETTER:
+			//Same range as KeyMagicInputMethod::getCandidateMatch()
+			return ((letter>=L'\x21') && (letter<=L'\x7D')) || ((letter>=L'\xFF') && (letter<=L'\uFFFD'));
+		case KMAE_IN_SET:
+			return set.find(letter)!=wstring::npos;
+		case KMAE_NOT_IN_SET:
+			return set.find(letter)==wstring::npos;
+		default:
+			return false; //Virtual keys are handled separately.
+	}
+}
+
+
+void KeyMagicAutomaton::clear()
+{
+	slotElements.clear();
+	slotRules.clear();
+	slotAccepts.clear();
+	startsByLetter.clear();
+	startsByVirtualKey.clear();
+	otherStarts.clear();
+	clearCache();
+}
+
+
+void KeyMagicAutomaton::clearCache()
+{
+	states.clear();
+	stateLookup.clear();
+	addState(vector<unsigned int>());
+}
+
+
+void KeyMagicAutomaton::addRule(unsigned int ruleID, const vector<Element>& pattern)
+{
+	if (pattern.empty())
+		throw std::runtime_error("Error: KeyMagic automaton can't match an empty pattern.");
+
+	//Index the first slot
+	unsigned int start = slotElements.size();
+	if (pattern[0].type==KMAE_LETTER)
+		startsByLetter[pattern[0].letter].push_back(start);
+	else if (pattern[0].type==KMAE_VIRTUAL_KEY)
+		startsByVirtualKey[pattern[0].vkey].push_back(start);
+	else
+		otherStarts.push_back(start);
+
+	//Add all slots
+	for (size_t i=0; i<=pattern.size(); i++) {
+		slotElements.push_back(i<pattern.size() ? pattern[i] : Element(KMAE_IN_SET));
+		slotRules.push_back(ruleID);
+		slotAccepts.push_back(i==pattern.size());
+	}
+
+	//Any cached states are now incomplete
+	clearCache();
+}
+
+
+unsigned int KeyMagicAutomaton::addState(const vector<unsigned int>& slots)
+{
+	map<vector<unsigned int>, unsigned int>::iterator it = stateLookup.find(slots);
+	if (it!=stateLookup.end())
+		return it->second;
+
+	State res;
+	res.slots = slots;
+	for (size_t i=0; i<slots.size(); i++) {
+		if (slotAccepts[slots[i]])
+			res.accepted.push_back(slotRules[slots[i]]);
+	}
+	std::sort(res.accepted.begin(), res.accepted.end());
+	res.accepted.erase(std::unique(res.accepted.begin(), res.accepted.end()), res.accepted.end());
+
+	states.push_back(res);
+	stateLookup[slots] = states.size()-1;
+	return states.size()-1;
+}
+
+
+unsigned int KeyMagicAutomaton::getNextState(unsigned int stateID, wchar_t letter)
+{
+	//Cached?
+	map<wchar_t, unsigned int>::iterator it = states[stateID].next.find(letter);
+	if (it!=states[stateID].next.end())
+		return it->second;
+
+	//Continue the rules we're in the middle of
+	vector<unsigned int> res;
+	const vector<unsigned int>& curr = states[stateID].slots;
+	for (size_t i=0; i<curr.size(); i++) {
+		if (!slotAccepts[curr[i]] && slotElements[curr[i]].matches(letter))
+			res.push_back(curr[i]+1);
+	}
+
+	//Start new ones
+	map<wchar_t, vector<unsigned int> >::const_iterator byLetter = startsByLetter.find(letter);
+	if (byLetter!=startsByLetter.end()) {
+		for (size_t i=0; i<byLetter->second.size(); i++)
+			res.push_back(byLetter->second[i]+1);
+	}
+	for (size_t i=0; i<otherStarts.size(); i++) {
+		if (slotElements[otherStarts[i]].matches(letter))
+			res.push_back(otherStarts[i]+1);
+	}
+	std::sort(res.begin(), res.end());
+	res.erase(std::unique(res.begin(), res.end()), res.end());
+
+	//Save it (careful; addState() may move our states around)
+	unsigned int nextID = addState(res);
+	states[stateID].next[letter] = nextID;
+	return nextID;
+}
+
+
+void KeyMagicAutomaton::match(const wstring& input, unsigned int vkeyCode, bool allowVirtualKey, vector<unsigned int>& ruleIDs)
+{
+	ruleIDs.clear();
+	if (input.empty())
+		return;
+
+	//Keep the cache from growing forever.
+	if (states.size()>MaxCachedStates)
+		clearCache();
+
+	//Run all but the last letter
+	unsigned int stateID = 0;
+	for (size_t i=0; i+1<input.length(); i++)
+		stateID = getNextState(stateID, input[i]);
+
+	//Key combinations only match the last letter, and only if they finish a rule.
+	if (allowVirtualKey) {
+		const vector<unsigned int>& curr = states[stateID].slots;
+		for (size_t i=0; i<curr.size(); i++) {
+			const Element& elem = slotElements[curr[i]];
+			if (!slotAccepts[curr[i]] && elem.type==KMAE_VIRTUAL_KEY && elem.vkey==vkeyCode && slotAccepts[curr[i]+1])
+				ruleIDs.push_back(slotRules[curr[i]]);
+		}
+		map<unsigned int, vector<unsigned int> >::const_iterator byVkey = startsByVirtualKey.find(vkeyCode);
+		if (byVkey!=startsByVirtualKey.end()) {
+			for (size_t i=0; i<byVkey->second.size(); i++) {
+				if (slotAccepts[byVkey->second[i]+1])
+					ruleIDs.push_back(slotRules[byVkey->second[i]]);
+			}
+		}
+	}
+
+	//Now the last letter
+	stateID = getNextState(stateID, input[input.length()-1]);
+	const vector<unsigned int>& accepted = states[stateID].accepted;
+	ruleIDs.insert(ruleIDs.end(), accepted.begin(), accepted.end());
+
+	std::sort(ruleIDs.begin(), ruleIDs.end());
+	ruleIDs.erase(std::unique(ruleIDs.begin(), ruleIDs.end()), ruleIDs.end());
+}
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
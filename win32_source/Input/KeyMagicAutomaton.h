@@ -0,0 +1,102 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#ifndef _KEYMAGIC_AUTOMATON
+#define _KEYMAGIC_AUTOMATON
+
+#include <map>
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+
+/**
+ * Matches every rule of a KeyMagic keyboard in one left-to-right pass over the input.
+ * The KeyMagicInputMethod flattens each rule's match (expanding $var, $var[n], $var[*], $var[^]
+ *   and wildcards) into a fixed sequence of letter classes. KeyMagic patterns have no repetition
+ *   or alternatives, so a rule matches exactly when the last few letters of the input fall into
+ *   its classes, in order.
+ * All rules are simulated together, Thompson-style: a state is a set of <rule,position> slots,
+ *   and every rule is started again at every letter. Sets are numbered and their transitions
+ *   cached as they're found, so after a little typing this runs as a DFA: one lookup per letter.
+ *   The cache is bounded; a pathological layout just costs us a rebuild now and then.
+ * Key combinations only match the last letter, and only if the virtual key is right.
+ * This only says WHICH rules match; the caller recovers groups (back-references) afterwards.
+ */
+class KeyMagicAutomaton {
+public:
+	enum ELEMENT_TYPE {
+		KMAE_LETTER,       //One particular letter
+		KMAE_ANY_LETTER,   //The wildcard: U+0021 to U+007D, U+00FF to U+FFFD
+		KMAE_IN_SET,       //Any letter in "set" (an empty set never matches)
+		KMAE_NOT_IN_SET,   //Any letter not in "set"
+		KMAE_VIRTUAL_KEY,  //The last letter, if typed with "vkey"
+	};
+
+	struct Element {
+		ELEMENT_TYPE type;
+		wchar_t letter;
+		std::wstring set;
+		unsigned int vkey;
+
+		Element(ELEMENT_TYPE type1, wchar_t letter1=L'\0', const std::wstring& set1=L"", unsigned int vkey1=0) : type(type1), letter(letter1), set(set1), vkey(vkey1) {}
+		bool matches(wchar_t letter) const;
+	};
+
+	KeyMagicAutomaton() { clear(); }
+
+	//Building. Patterns may not be empty.
+	void clear();
+	void addRule(unsigned int ruleID, const std::vector<Element>& pattern);
+
+	//Find all rules whose patterns end at the end of the input, in increasing order of rule ID.
+	void match(const std::wstring& input, unsigned int vkeyCode, bool allowVirtualKey, std::vector<unsigned int>& ruleIDs);
+
+	//For testing
+	size_t getNumCachedStates() const { return states.size(); }
+
+private:
+	//Each rule gets one slot per element, plus a final "accepting" slot.
+	std::vector<Element> slotElements; //Accepting slots hold a placeholder
+	std::vector<unsigned int> slotRules;
+	std::vector<bool> slotAccepts;
+
+	//Slots that start a rule, indexed by what they match first.
+	std::map<wchar_t, std::vector<unsigned int> > startsByLetter;
+	std::map<unsigned int, std::vector<unsigned int> > startsByVirtualKey;
+	std::vector<unsigned int> otherStarts;
+
+	//The cached DFA. State 0 is the empty set.
+	struct State {
+		std::vector<unsigned int> slots;    //Sorted; always a valid key into stateLookup
+		std::vector<unsigned int> accepted; //Rules that end at this state
+		std::map<wchar_t, unsigned int> next;
+	};
+	std::vector<State> states;
+	std::map<std::vector<unsigned int>, unsigned int> stateLookup;
+	static const size_t MaxCachedStates = 4096;
+
+	void clearCache();
+	unsigned int addState(const std::vector<unsigned int>& slots);
+	unsigned int getNextState(unsigned int stateID, wchar_t letter);
+};
+
+
+#endif //_KEYMAGIC_AUTOMATON
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
@@ -125,10 +125,12 @@ void KeyMagicInputMethod::loadRulesFile(const string& rulesFilePath, const strin
 		}
 	}
 
-	//If we have to reload the text file,do that here.
-	if (reloadSourceText)
+	//If we have to reload the text file,do that here. We also need to build the index.
+	//The binary file already contains the index.
+	if (reloadSourceText) {
 		loadTextRulesFile(rulesFilePath);
-	else
+		buildRuleIndex();
+	} else
 		loadBinaryRulesFile(binaryFilePath);
 
 
@@ -136,19 +138,277 @@ void KeyMagicInputMethod::loadRulesFile(const string& rulesFilePath, const strin
 	if (!disableCache && reloadSourceText)
 		saveBinaryRulesFile(binaryFilePath, actualMD5);
 
+	//The automaton is built when it's first needed.
+	automatonReady = false;
+}
 
-	//After-final step: re-build the index
-	//TODO: Save this in the binary format somehow.
-	switchLookup.clear();
-	for (size_t id=0; id<replacements.size(); id++) {
-		//Don't index rules with no switches
-		if (replacements[id].requiredSwitches.size()==0)
-			continue;
 
-		//Build an identifier for this rule's switch set; save it.
-		unsigned int switchIndexID = KeyMagicInputMethod::getSwitchUniqueID(replacements[id].requiredSwitches);
-		switchLookup[switchIndexID].push_back(id);
+void KeyMagicInputMethod::setUseAutomaton(bool useAutomaton, bool crossCheck)
+{
+	this->useAutomaton = useAutomaton || crossCheck;
+	this->checkAutomaton = crossCheck;
+}
+
+
+void KeyMagicInputMethod::buildAutomaton()
+{
+	automaton.clear();
+	automatonFallbackRules.clear();
+
+	//Rules are searched backwards, so keep the fallback list in that order.
+	vector<KeyMagicAutomaton::Element> pattern;
+	for (size_t id=replacements.size(); id-->0;) {
+		pattern.clear();
+		if (flattenRules(replacements[id].match, pattern, 0))
+			automaton.addRule(id, pattern);
+		else
+			automatonFallbackRules.push_back(id);
+	}
+
+	automatonReady = true;
+}
+
+
+//Flatten a match into a sequence of letter classes. Returns false for anything the automaton
+//  can't reproduce exactly (back-references, empty strings or variables, complex arrays).
+bool KeyMagicInputMethod::flattenRules(const vector<Rule>& rules, vector<KeyMagicAutomaton::Element>& res, unsigned int depth)
+{
+	if (rules.empty() || depth>variables.size())
+		return false;
+
+	for (size_t i=0; i<rules.size(); i++) {
+		const Rule& rule = rules[i];
+		switch (rule.type) {
+			case KMRT_STRING:
+				if (rule.str.empty())
+					return false;
+				for (size_t c=0; c<rule.str.length(); c++)
+					res.push_back(KeyMagicAutomaton::Element(KeyMagicAutomaton::KMAE_LETTER, rule.str[c]));
+				break;
+
+			case KMRT_WILDCARD:
+				res.push_back(KeyMagicAutomaton::Element(KeyMagicAutomaton::KMAE_ANY_LETTER));
+				break;
+
+			case KMRT_VARIABLE:
+				if (rule.id<0 || rule.id>=(int)variables.size() || !flattenRules(variables[rule.id], res, depth+1))
+					return false;
+				break;
+
+			//As in getCandidateMatch(), these only work on simple strings. A bad index (or a
+			//  special value other than '*' or '^') simply never matches.
+			case KMRT_VARARRAY:
+			case KMRT_VARARRAY_SPECIAL:
+			{
+				wstring str;
+				try {
+					str = compressToSingleStringRule(variables[rule.id], variables).str;
+				} catch (std::exception& ex) {
+					return false;
+				}
+				if (rule.type==KMRT_VARARRAY && rule.val>0 && rule.val<=(int)str.length())
+					res.push_back(KeyMagicAutomaton::Element(KeyMagicAutomaton::KMAE_LETTER, str[rule.val-1]));
+				else if (rule.type==KMRT_VARARRAY_SPECIAL && rule.val=='*')
+					res.push_back(KeyMagicAutomaton::Element(KeyMagicAutomaton::KMAE_IN_SET, L'\0', str));
+				else if (rule.type==KMRT_VARARRAY_SPECIAL && rule.val=='^')
+					res.push_back(KeyMagicAutomaton::Element(KeyMagicAutomaton::KMAE_NOT_IN_SET, L'\0', str));
+				else
+					res.push_back(KeyMagicAutomaton::Element(KeyMagicAutomaton::KMAE_IN_SET));
+				break;
+			}
+
+			case KMRT_KEYCOMBINATION:
+				res.push_back(KeyMagicAutomaton::Element(KeyMagicAutomaton::KMAE_VIRTUAL_KEY, L'\0', L"", rule.val));
+				break;
+
+			default:
+				return false;
+		}
+	}
+
+	return true;
+}
+
+
+//Get the IDs of all rules which match this input (ignoring switches), highest priority first.
+void KeyMagicInputMethod::getAutomatonRules(const wstring& input, unsigned int vkeyCode, bool matchedOneVirtualKey, vector<unsigned int>& res)
+{
+	if (!automatonReady)
+		buildAutomaton();
+
+	res.clear();
+	if (input.empty())
+		return;
+
+	vector<unsigned int> matched;
+	automaton.match(input, vkeyCode, !matchedOneVirtualKey, matched);
+	std::merge(matched.rbegin(), matched.rend(), automatonFallbackRules.begin(), automatonFallbackRules.end(), std::back_inserter(res), std::greater<unsigned int>());
+}
+
+
+void KeyMagicInputMethod::buildRuleIndex()
+{
+	rulesByLastLetter.clear();
+	rulesByVirtualKey.clear();
+	rulesForAnyKey.clear();
+
+	//Rules are searched backwards, so add them in that order.
+	vector<wchar_t> letters;
+	for (size_t id=replacements.size(); id-->0;) {
+		RuleSet& rule = replacements[id];
+		rule.switchID = KeyMagicInputMethod::getSwitchUniqueID(rule.requiredSwitches);
+
+		//Cache the size of this rule's match, and what it must end with.
+		rule.minMatchLength = 0;
+		rule.hasVkeys = false;
+		for (size_t i=0; i<rule.match.size(); i++) {
+			if (rule.match[i].type==KMRT_STRING)
+				rule.minMatchLength += rule.match[i].str.length();
+			else if (rule.match[i].type!=KMRT_SWITCH)
+				rule.minMatchLength++;
+			if (rule.match[i].type==KMRT_KEYCOMBINATION)
+				rule.hasVkeys = true;
+		}
+		rule.maxMatchLength = getMaxMatchLength(rule.match, 0);
+		rule.literalSuffixLength = 0;
+		rule.literalSuffixHash = 0;
+		if (!rule.match.empty() && rule.match.back().type==KMRT_STRING) {
+			rule.literalSuffixLength = rule.match.back().str.length();
+			rule.literalSuffixHash = getSuffixHash(rule.match.back().str.c_str(), rule.literalSuffixLength);
+		}
+
+		//Key combinations only ever match the last letter typed.
+		letters.clear();
+		if (!rule.match.empty() && rule.match.back().type==KMRT_KEYCOMBINATION)
+			rulesByVirtualKey[rule.match.back().val].push_back(id);
+		else if (!rule.match.empty() && getPossibleLastLetters(rule.match.back(), letters, 0)) {
+			//No letters means this rule can never match; we don't need to index it at all.
+			std::sort(letters.begin(), letters.end());
+			letters.erase(std::unique(letters.begin(), letters.end()), letters.end());
+			for (size_t i=0; i<letters.size(); i++)
+				rulesByLastLetter[letters[i]].push_back(id);
+		} else
+			rulesForAnyKey.push_back(id);
+	}
+}
+
+
+//Which letters could this rule match, if it is the last part of a match? Returns false if it might match anything.
+bool KeyMagicInputMethod::getPossibleLastLetters(const Rule& rule, vector<wchar_t>& letters, unsigned int depth)
+{
+	switch (rule.type) {
+		case KMRT_STRING:
+			if (rule.str.empty())
+				return false;
+			letters.push_back(rule.str[rule.str.length()-1]);
+			return true;
+
+		//Look inside the variable (circular references aren't possible, but be safe)
+		case KMRT_VARIABLE:
+			if (depth>=variables.size() || rule.id<0 || rule.id>=(int)variables.size() || variables[rule.id].empty())
+				return false;
+			return getPossibleLastLetters(variables[rule.id].back(), letters, depth+1);
+
+		//As in getCandidateMatch(), these only work on simple strings.
+		case KMRT_VARARRAY:
+		case KMRT_VARARRAY_SPECIAL:
+		{
+			wstring str;
+			try {
+				str = compressToSingleStringRule(variables[rule.id], variables).str;
+			} catch (std::exception& ex) {
+				return false;
+			}
+			if (rule.type==KMRT_VARARRAY) {
+				if (rule.val>0 && rule.val<=(int)str.length())
+					letters.push_back(str[rule.val-1]);
+				return true;
+			}
+			if (rule.val=='*')
+				letters.insert(letters.end(), str.begin(), str.end());
+			return rule.val!='^';
+		}
+
+		//Wildcards (and anything else) are not indexed.
+		default:
+			return false;
+	}
+}
+
+
+//The longest string these rules could match, or -1 if we can't tell.
+int KeyMagicInputMethod::getMaxMatchLength(const vector<Rule>& rules, unsigned int depth)
+{
+	int res = 0;
+	for (size_t i=0; i<rules.size(); i++) {
+		const Rule& rule = rules[i];
+		switch (rule.type) {
+			case KMRT_STRING:
+				res += rule.str.length();
+				break;
+
+			//These match exactly one letter.
+			case KMRT_WILDCARD:
+			case KMRT_VARARRAY:
+			case KMRT_VARARRAY_SPECIAL:
+			case KMRT_KEYCOMBINATION:
+				res++;
+				break;
+
+			case KMRT_SWITCH:
+				break;
+
+			case KMRT_VARIABLE:
+			{
+				if (depth>=variables.size() || rule.id<0 || rule.id>=(int)variables.size())
+					return -1;
+				int varLen = getMaxMatchLength(variables[rule.id], depth+1);
+				if (varLen==-1)
+					return -1;
+				res += varLen;
+				break;
+			}
+
+			default:
+				return -1;
+		}
+	}
+
+	//Make sure we can save it.
+	return res<0xFFFF ? res : -1;
+}
+
+
+//FNV-1a, which is plenty for a few letters.
+unsigned int KeyMagicInputMethod::getSuffixHash(const wchar_t* str, size_t length)
+{
+	unsigned int res = 2166136261U;
+	for (size_t i=0; i<length; i++) {
+		res ^= (unsigned int)(str[i]&0xFFFF);
+		res *= 16777619U;
 	}
+	return res;
+}
+
+
+//Get the IDs of all rules which might match this input, highest priority first.
+void KeyMagicInputMethod::getPossibleRules(const wstring& input, unsigned int vkeyCode, bool matchedOneVirtualKey, vector<unsigned int>& res) const
+{
+	res.clear();
+	if (input.empty())
+		return;
+
+	//Collect the (up to) three lists that apply.
+	static const vector<unsigned int> noRules;
+	map<wchar_t, vector<unsigned int> >::const_iterator byLetter = rulesByLastLetter.find(input[input.length()-1]);
+	map<unsigned int, vector<unsigned int> >::const_iterator byVkey = rulesByVirtualKey.find(vkeyCode);
+	const vector<unsigned int>& letterRules = (byLetter!=rulesByLastLetter.end()) ? byLetter->second : noRules;
+	const vector<unsigned int>& vkeyRules = (!matchedOneVirtualKey && byVkey!=rulesByVirtualKey.end()) ? byVkey->second : noRules;
+
+	//Merge them, preserving priority order.
+	vector<unsigned int> temp;
+	std::merge(letterRules.begin(), letterRules.end(), vkeyRules.begin(), vkeyRules.end(), std::back_inserter(temp), std::greater<unsigned int>());
+	std::merge(temp.begin(), temp.end(), rulesForAnyKey.begin(), rulesForAnyKey.end(), std::back_inserter(res), std::greater<unsigned int>());
 }
 
 
@@ -164,6 +424,25 @@ int KeyMagicInputMethod::readInt(unsigned char* buffer, size_t& currPos, size_t
 	return res;
 }
 
+unsigned int KeyMagicInputMethod::readInt32(unsigned char* buffer, size_t& currPos, size_t bufferSize)
+{
+	if (currPos+4>bufferSize)
+		throw std::runtime_error("Error: buffer overrun when reading KeyMagic file");
+
+	unsigned int res = 0;
+	for (size_t i=0; i<4; i++)
+		res = (res<<8) | buffer[currPos++];
+	return res;
+}
+
+void KeyMagicInputMethod::readRuleList(unsigned char* buffer, size_t& currPos, size_t bufferSize, vector<unsigned int>& ruleIDs)
+{
+	size_t numRules = readInt(buffer, currPos, bufferSize);
+	ruleIDs.clear();
+	for (size_t i=0; i<numRules; i++)
+		ruleIDs.push_back(readInt(buffer, currPos, bufferSize));
+}
+
 void KeyMagicInputMethod::loadBinaryRulesFile(const string& binaryFilePath)
 {
 	//Open the file
@@ -258,10 +537,35 @@ void KeyMagicInputMethod::loadBinaryRulesFile(const string& binaryFilePath)
 			res.match = left;
 			res.replace = right;
 			res.requiredSwitches = switches;
+
+			//Read the cached data
+			res.minMatchLength = readInt(buffer, pos, file_size);
+			res.maxMatchLength = readInt(buffer, pos, file_size);
+			if (pos>=(size_t)file_size)
+				throw std::runtime_error("Error: buffer overrun when reading KeyMagic file");
+			res.hasVkeys = buffer[pos++]!=0;
+			res.switchID = readInt32(buffer, pos, file_size);
+			res.literalSuffixLength = readInt(buffer, pos, file_size);
+			res.literalSuffixHash = readInt32(buffer, pos, file_size);
 			replacements.push_back(res);
 		}
 	}
 
+	//Step 3: Read the rule index
+	rulesByLastLetter.clear();
+	rulesByVirtualKey.clear();
+	int numLetters = readInt(buffer, pos, file_size);
+	for (int i=0; i<numLetters; i++) {
+		wchar_t letter = (wchar_t)readInt(buffer, pos, file_size);
+		readRuleList(buffer, pos, file_size, rulesByLastLetter[letter]);
+	}
+	int numVkeys = readInt(buffer, pos, file_size);
+	for (int i=0; i<numVkeys; i++) {
+		unsigned int vkey = readInt(buffer, pos, file_size);
+		readRuleList(buffer, pos, file_size, rulesByVirtualKey[vkey]);
+	}
+	readRuleList(buffer, pos, file_size, rulesForAnyKey);
+
 	//Done
 	delete [] buffer;
 }
@@ -288,6 +592,19 @@ void KeyMagicInputMethod::writeInt(vector<unsigned char>& stream, int intVal)
 	stream.push_back(intVal&0xFF);
 }
 
+void KeyMagicInputMethod::writeInt32(vector<unsigned char>& stream, unsigned int intVal)
+{
+	for (int shift=24; shift>=0; shift-=8)
+		stream.push_back((intVal>>shift)&0xFF);
+}
+
+void KeyMagicInputMethod::writeRuleList(vector<unsigned char>& stream, const vector<unsigned int>& ruleIDs)
+{
+	writeInt(stream, ruleIDs.size());
+	for (size_t i=0; i<ruleIDs.size(); i++)
+		writeInt(stream, ruleIDs[i]);
+}
+
 //TODO: Save and load the "options" stored in comment headers.
 void KeyMagicInputMethod::saveBinaryRulesFile(const string& binaryFilePath, const string& checksum)
 {
@@ -376,7 +693,31 @@ void KeyMagicInputMethod::saveBinaryRulesFile(const string& binaryFilePath, cons
 				throw std::runtime_error(msg.str().c_str());
 			}
 		}
+
+		//Write the cached data (if this is a replacement)
+		if (!isVar) {
+			const RuleSet& rule = replacements[actID];
+			writeInt(binStream, rule.minMatchLength);
+			writeInt(binStream, rule.maxMatchLength);
+			binStream.push_back(rule.hasVkeys ? 1 : 0);
+			writeInt32(binStream, rule.switchID);
+			writeInt(binStream, rule.literalSuffixLength);
+			writeInt32(binStream, rule.literalSuffixHash);
+		}
+	}
+
+	//Write the rule index
+	writeInt(binStream, rulesByLastLetter.size());
+	for (map<wchar_t, vector<unsigned int> >::const_iterator it=rulesByLastLetter.begin(); it!=rulesByLastLetter.end(); it++) {
+		writeInt(binStream, it->first);
+		writeRuleList(binStream, it->second);
+	}
+	writeInt(binStream, rulesByVirtualKey.size());
+	for (map<unsigned int, vector<unsigned int> >::const_iterator it=rulesByVirtualKey.begin(); it!=rulesByVirtualKey.end(); it++) {
+		writeInt(binStream, it->first);
+		writeRuleList(binStream, it->second);
 	}
+	writeRuleList(binStream, rulesForAnyKey);
 
 	//Now, convert what we've written into a native array.
 	ofstream binFile;
@@ -1208,34 +1549,30 @@ pair<Candidate, bool> KeyMagicInputMethod::getCandidateMatch(RuleSet& rule, cons
 	//Skip entries that obviously will never match?
 	//NOTE: This only checks TOP-level key_combination matches. If someone were to put
 	//      a match inside a $var[*], we'd have to catch that later.
-	//TODO: Cache this upon loading the rule.
-	if (matchedOneVirtualKey) {
-		for (size_t i=0; i<rule.match.size(); i++) {
-			if (rule.match[i].type==KMRT_KEYCOMBINATION) {
-				//Can't work; we've already matched a key combination. 
-				return pair<Candidate, bool>(Candidate(), false);
-			}
-		}
+	if (matchedOneVirtualKey && rule.hasVkeys)
+		return pair<Candidate, bool>(Candidate(), false);
+
+	//Is the input long enough, and does it end with the right letters?
+	if (rule.minMatchLength > (int)input.length())
+		return pair<Candidate, bool>(Candidate(), false);
+	if (rule.literalSuffixLength>0) {
+		size_t suffixStart = input.length()-rule.literalSuffixLength;
+		if (rule.literalSuffixLength>input.length() || getSuffixHash(input.c_str()+suffixStart, rule.literalSuffixLength)!=rule.literalSuffixHash)
+			return pair<Candidate, bool>(Candidate(), false);
 	}
 
-	//Get an estimate of rule size (useful later)
-	//NOTE: This will always be <= the actual size of the match.
-	//TODO: Cache and build this when the rule first loads.
-	int estRuleSize = 0;
-	for (size_t i=0; i<rule.match.size(); i++) {
-		if (rule.match[i].type==KMRT_STRING)
-			estRuleSize += rule.match[i].str.length();
-		else if (rule.match[i].type!=KMRT_SWITCH)
-			estRuleSize++;
-	}
+	//Matches must finish at the end of the string, so there's no point starting too far back.
+	size_t firstDot = 0;
+	if (rule.maxMatchLength>=0 && (size_t)rule.maxMatchLength<input.length())
+		firstDot = input.length()-rule.maxMatchLength;
 
 	vector<Candidate> candidates; //NOTE: Since this is local, we can't return references to its values. (Null pointer cause, I think)
-	for (size_t dot=0; dot<input.length(); dot++) {
+	for (size_t dot=firstDot; dot<input.length(); dot++) {
 		//Skip entries that are obviously too big to finish at the end of the string
 		int lenLeft = input.length()-dot;
 
 		//Add a new empty candidate
-		if (estRuleSize <= lenLeft)
+		if (rule.minMatchLength <= lenLeft)
 			candidates.push_back(Candidate(rule, dot));
 
 		//Continue matching.
@@ -1484,6 +1821,7 @@ void KeyMagicInputMethod::handleStop(bool isFull, VirtKey& vkey)
 		typedSentenceStr.str(L"");
 		typedSentenceStr <<next.first;
 	}
+	invalidate(this->isHelpInput() ? VR_CANDIDATES : VR_SENTENCE);
 	viewChanged = true;
 }
 
@@ -1512,6 +1850,7 @@ void KeyMagicInputMethod::handleBackspace(VirtKey& vkey)
 				typedSentenceStr.str(L"");
 				typedSentenceStr <<currStr;
 			}
+			invalidate(this->isHelpInput() ? VR_CANDIDATES : VR_SENTENCE);
 			viewChanged = true;
 		}
 	} else {
@@ -1523,6 +1862,7 @@ void KeyMagicInputMethod::handleBackspace(VirtKey& vkey)
 			typedSentenceStr.str(L"");
 			typedSentenceStr <<next.first;
 		}
+		invalidate(this->isHelpInput() ? VR_CANDIDATES : VR_SENTENCE);
 		viewChanged = true;
 	}
 }
@@ -1563,6 +1903,51 @@ pair<wstring, bool> KeyMagicInputMethod::appendTypedLetter(const wstring& prevSt
 
 
 
+//Find the first rule that matches, checking rules for the current switches first.
+//NOTE: This function will update matchedOneVirtualKey
+pair<Candidate, bool> KeyMagicInputMethod::findMatch(const vector<unsigned int>& possibleRules, const wstring& input, unsigned int vkeyCode, bool& matchedOneVirtualKey, int& matchedRuleID)
+{
+	//What rules have we checked already?
+	vector<bool> checkFlags(possibleRules.size(), false);
+
+	//First step: match rules for the current switch context
+	unsigned int switchIndexID = KeyMagicInputMethod::getSwitchUniqueID(switches);
+	for (size_t i=0; i<possibleRules.size(); i++) {
+		unsigned int rID = possibleRules[i];
+		if (replacements[rID].requiredSwitches.empty() || replacements[rID].switchID!=switchIndexID)
+			continue;
+
+		//Avoid checking this again
+		checkFlags[i] = true;
+
+		//Does it match?
+		pair<Candidate, bool> res = getCandidateMatch(replacements[rID], input, vkeyCode, matchedOneVirtualKey);
+		if (res.second) {
+			matchedRuleID = rID;
+			return res;
+		}
+	}
+
+	//Second step: iterate backwards, skipping rules that we've already matched.
+	for (size_t i=0; i<possibleRules.size(); i++) {
+		//Avoid checking a rule twice
+		unsigned int rID = possibleRules[i];
+		if (checkFlags[i])
+			continue;
+
+		//Match this rule
+		pair<Candidate, bool> res = getCandidateMatch(replacements[rID], input, vkeyCode, matchedOneVirtualKey);
+		if (res.second) {
+			matchedRuleID = rID;
+			return res;
+		}
+	}
+
+	matchedRuleID = -1;
+	return pair<Candidate, bool>(Candidate(), false);
+}
+
+
 wstring KeyMagicInputMethod::applyRules(const wstring& origInput, unsigned int vkeyCode)
 {
 	KeyMagicInputMethod::writeLogLine(L"User typed:  " + origInput);
@@ -1584,54 +1969,36 @@ wstring KeyMagicInputMethod::applyRules(const wstring& origInput, unsigned int v
 	bool breakLoop = false;
 	unsigned int totalMatchesOverall = 0;
 	vector<int> switchesToOn;
+	vector<unsigned int> possibleRules;
 
 	while (!breakLoop) {
-		//Found result
-		pair<Candidate, bool> finalResult = pair<Candidate, bool>(Candidate(), false);
-		wstring logLine;
-
-		//What rules have we checked already?
-		vector<bool> checkFlags(replacements.size(), false);
-
-		//First step: match rules for the current switch context
-		unsigned int switchIndexID = KeyMagicInputMethod::getSwitchUniqueID(switches);
-		if (switchLookup.count(switchIndexID)>0) {
-			for (vector<unsigned int>::reverse_iterator it=switchLookup[switchIndexID].rbegin(); it!=switchLookup[switchIndexID].rend(); it++) {
-				//Avoid checking this again
-				checkFlags[*it] = true;
-
-				//Does it match?
-				finalResult = getCandidateMatch(replacements[*it], input, vkeyCode, matchedOneVirtualKey);
-				if (finalResult.second) {
-					logLine = L"   " + (!replacements[*it].debugRuleText.empty() ? replacements[*it].debugRuleText : L"<Empty Rule Text>");
-					break; //Break and deal with the current rule.
-				}
-			}
-		}
-
-		//Second step: iterate backwards, skipping rules that we've already matched.
-		if (!finalResult.second) {
-			for (int rID=replacements.size()-1; rID>=0; rID--) {
-				//Avoid checking a rule twice
-				if (checkFlags[rID])
-					continue;
+		//Only consider rules that could end with the last letter (or virtual key) typed.
+		//These are already in the order we'd check them.
+		bool prevMatchedOneVirtualKey = matchedOneVirtualKey;
+		if (useAutomaton)
+			getAutomatonRules(input, vkeyCode, matchedOneVirtualKey, possibleRules);
+		else
+			getPossibleRules(input, vkeyCode, matchedOneVirtualKey, possibleRules);
 
-				//Match this rule
-				finalResult = getCandidateMatch(replacements[rID], input, vkeyCode, matchedOneVirtualKey);
-
-				//Did we match anything?
-				if (finalResult.second) {
-					logLine = L"   " + (!replacements[rID].debugRuleText.empty() ? replacements[rID].debugRuleText : L"<Empty Rule Text>");
-					break; //Break and deal with the current rule.
-				}
-			}
+		//Found result
+		int ruleID = -1;
+		pair<Candidate, bool> finalResult = findMatch(possibleRules, input, vkeyCode, matchedOneVirtualKey, ruleID);
+
+		//Make sure the automaton picked the same rule the index would have.
+		if (checkAutomaton) {
+			vector<unsigned int> checkRules;
+			int checkRuleID = -1;
+			getPossibleRules(input, vkeyCode, prevMatchedOneVirtualKey, checkRules);
+			findMatch(checkRules, input, vkeyCode, prevMatchedOneVirtualKey, checkRuleID);
+			if (checkRuleID != ruleID)
+				throw std::runtime_error(waitzar::glue(L"Error: KeyMagic automaton chose the wrong rule on input: \n   ", input).c_str());
 		}
 
 
 		//Deal with our match (if any)
 		if (finalResult.second) {
 				//Log match rule
-				KeyMagicInputMethod::writeLogLine(logLine);
+				KeyMagicInputMethod::writeLogLine(L"   " + (!replacements[ruleID].debugRuleText.empty() ? replacements[ruleID].debugRuleText : L"<Empty Rule Text>"));
 
 
 			//Before we apply the rule, check if we've looped "forever"
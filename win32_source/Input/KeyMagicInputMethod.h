@@ -13,6 +13,7 @@
 
 #include "MyWin32Window.h"
 #include "Input/LetterInputMethod.h"
+#include "Input/KeyMagicAutomaton.h"
 #include "Input/keymagic_vkeys.h"
 #include "NGram/Logger.h"
 #include "NGram/wz_utilities.h"
@@ -37,7 +38,7 @@ enum RULE_TYPE {
 
 //Current version of our binary file format.
 enum {
-	KEYMAGIC_BINARY_VERSION = 1
+	KEYMAGIC_BINARY_VERSION = 2
 };
 
 struct Rule {
@@ -63,6 +64,16 @@ struct RuleSet {
 	std::wstring debugRuleText;
 	unsigned int tempOriginalSortID;
 
+	//Cached once the rules are loaded (and saved in the binary file); see KeyMagicInputMethod::buildRuleIndex()
+	int minMatchLength;                //Never more than the length of an actual match
+	int maxMatchLength;                //-1 if there's no limit
+	bool hasVkeys;                     //Any top-level key combinations?
+	unsigned int switchID;             //getSwitchUniqueID() of the required switches
+	unsigned int literalSuffixLength;  //The match must end with this many known letters...
+	unsigned int literalSuffixHash;    //...which hash to this value.
+
+	RuleSet() : tempOriginalSortID(0), minMatchLength(0), maxMatchLength(-1), hasVkeys(false), switchID(0), literalSuffixLength(0), literalSuffixHash(0) {}
+
 	//Helpers
 	size_t getNumVkeys() const {
 		size_t total = 0;
@@ -307,7 +318,7 @@ public:
 class KeyMagicInputMethod : public LetterInputMethod {
 
 public:
-	KeyMagicInputMethod() {
+	KeyMagicInputMethod() : useAutomaton(false), checkAutomaton(false), automatonReady(false) {
 		KeyMagicInputMethod::clearLogFile();
 	}
 
@@ -318,6 +329,10 @@ public:
 	void loadRulesFile(const std::string& rulesFilePath, const std::string& binaryFilePath, bool disableCache/*, std::string (*fileMD5Function)(const std::string&)*/);
 	std::wstring applyRules(const std::wstring& origInput, unsigned int vkeyCode);
 
+	//Match with a KeyMagicAutomaton instead of the rule index. If "crossCheck" is set, every
+	//  match is also found the old way, and a std::runtime_error is thrown if they differ.
+	void setUseAutomaton(bool useAutomaton, bool crossCheck=false);
+
 	//Additional useful stuff
 	const std::wstring& getOption(const std::wstring& optName);
 	std::vector< std::pair<std::wstring, std::wstring> > convertToRulePairs();
@@ -343,6 +358,10 @@ private:
 	static void writeLogLine(const std::wstring& logLine); //We'll escape MM outselves
 	static void writeInt(std::vector<unsigned char>& stream, int intVal);
 	static int readInt(unsigned char* buffer, size_t& currPos, size_t bufferSize);
+	static void writeInt32(std::vector<unsigned char>& stream, unsigned int intVal);
+	static unsigned int readInt32(unsigned char* buffer, size_t& currPos, size_t bufferSize);
+	static void writeRuleList(std::vector<unsigned char>& stream, const std::vector<unsigned int>& ruleIDs);
+	static void readRuleList(unsigned char* buffer, size_t& currPos, size_t bufferSize, std::vector<unsigned int>& ruleIDs);
 	
 	//Ugh
 	static const std::wstring emptyStr;
@@ -358,8 +377,29 @@ private:
 	//Used for smart backspace
 	std::vector<std::wstring> typedStack;
 
-	//Another index (helps search with switches quickly)
-	std::map<unsigned int, std::vector<unsigned int> > switchLookup;
+	//Rule dispatch index. A rule can only match at the end of the input, so we file each rule under
+	//  the letter (or virtual key) that its match must end with. Each list is sorted by priority,
+	//  highest first. Rules that might end with any letter are kept in their own list.
+	//This is saved in the binary file along with each rule's cached data.
+	std::map<wchar_t, std::vector<unsigned int> > rulesByLastLetter;
+	std::map<unsigned int, std::vector<unsigned int> > rulesByVirtualKey;
+	std::vector<unsigned int> rulesForAnyKey;
+	void buildRuleIndex();
+	bool getPossibleLastLetters(const Rule& rule, std::vector<wchar_t>& letters, unsigned int depth);
+	int getMaxMatchLength(const std::vector<Rule>& rules, unsigned int depth);
+	static unsigned int getSuffixHash(const wchar_t* str, size_t length);
+
+	//Optional matching engine. Rules it can't handle are always checked.
+	bool useAutomaton;
+	bool checkAutomaton;
+	bool automatonReady;
+	KeyMagicAutomaton automaton;
+	std::vector<unsigned int> automatonFallbackRules;
+	void buildAutomaton();
+	bool flattenRules(const std::vector<Rule>& rules, std::vector<KeyMagicAutomaton::Element>& res, unsigned int depth);
+	void getAutomatonRules(const std::wstring& input, unsigned int vkeyCode, bool matchedOneVirtualKey, std::vector<unsigned int>& res);
+	std::pair<Candidate, bool> findMatch(const std::vector<unsigned int>& possibleRules, const std::wstring& input, unsigned int vkeyCode, bool& matchedOneVirtualKey, int& matchedRuleID);
+	void getPossibleRules(const std::wstring& input, unsigned int vkeyCode, bool matchedOneVirtualKey, std::vector<unsigned int>& res) const;
 	static unsigned int getSwitchUniqueID(const std::vector<unsigned int>& reqSw);
 	static unsigned int getSwitchUniqueID(const std::vector<bool>& switchVals);
 
@@ -23,6 +23,7 @@ void LetterInputMethod::handleEsc()
 	} else {
 		//Cancle the current sentence if not in help mode
 		typedSentenceStr.str(L"");
+		invalidate(VR_SENTENCE);
 	}
 }
 
@@ -67,6 +68,7 @@ void LetterInputMethod::handleBackspace(VirtKey& vkey)
 		//If help mode, delete a letter but don't hide the window
 		typedCandidateStr.str(L"");
 		typedCandidateStr <<newStr;
+		invalidate(VR_CANDIDATES);
 
 		updateRomanHelpString();
 		viewChanged = true;
@@ -74,6 +76,7 @@ void LetterInputMethod::handleBackspace(VirtKey& vkey)
 		// Otherwise, delete a letter from the sentece, and hide if nothing left
 		typedSentenceStr.str(L"");
 		typedSentenceStr <<newStr;
+		invalidate(VR_SENTENCE);
 		viewChanged = true;
 	}
 }
@@ -242,9 +245,11 @@ void LetterInputMethod::handleKeyPress(VirtKey& vkey)
 		if (isHelpInput()) {
 			typedCandidateStr.str(L"");
 			typedCandidateStr <<next.first;
+			invalidate(VR_CANDIDATES);
 		} else {
 			typedSentenceStr.str(L"");
 			typedSentenceStr <<next.first;
+			invalidate(VR_SENTENCE);
 		}
 
 		//Save a romanized string if in help mode
@@ -288,61 +293,55 @@ void LetterInputMethod::updateRomanHelpString()
 
 
 
-vector<wstring> LetterInputMethod::getTypedSentenceStrings()
+//Our sentence is all one region, so any change rebuilds the whole thing.
+void LetterInputMethod::buildTypedSentenceStrings(unsigned int regions, vector<wstring>& res)
 {
 	//Special case: don't overwrite the sentence string if we're just showing help.
 	if (this->isHelpInput()) {
 		//Easy
 		//bool noEncChange = (romanenc2Uni->fromEncoding==uni2Myenc->toEncoding);
+		res = providingHelpFor->getTypedSentenceStrings();
 		bool noEncChange = (providingHelpFor->getEncoding()==this->encoding);
 		if (noEncChange)
-			return providingHelpFor->getTypedSentenceStrings();
+			return;
 
 		//Major pain converting encodings, but it has to be done.
-		vector<wstring> res;
-		{
-			vector<wstring> romanRes = providingHelpFor->getTypedSentenceStrings();
-			for (vector<wstring>::iterator i=romanRes.begin(); i!=romanRes.end(); i++) {
-				//Convert & add
-				wstring candidate = *i;
-				//romanenc2Uni->convertInPlace(candidate);
-				//uni2Myenc->convertInPlace(candidate);
-				ConfigGetAndTransformText(providingHelpFor->getEncoding(), L"unicode", candidate);
-				ConfigGetAndTransformText(L"unicode", this->encoding, candidate);
-				res.push_back(candidate);
-			}
+		for (vector<wstring>::iterator i=res.begin(); i!=res.end(); i++) {
+			//Convert in place
+			//romanenc2Uni->convertInPlace(*i);
+			//uni2Myenc->convertInPlace(*i);
+			ConfigGetAndTransformText(providingHelpFor->getEncoding(), L"unicode", *i);
+			ConfigGetAndTransformText(L"unicode", this->encoding, *i);
 		}
-
-		return res;
+		return;
 	}
 
-	vector<wstring> res;
-	//res.push_back(waitzar::removeZWS(typedSentenceStr.str()));
-	res.push_back(typedSentenceStr.str());
-	res.push_back(L"");
-	res.push_back(L"");
-	//res.push_back(waitzar::removeZWS(typedSentenceStr.str()));
-	res.push_back(typedSentenceStr.str());
-	return res;
+	//res[0] = waitzar::removeZWS(typedSentenceStr.str());
+	res[0] = typedSentenceStr.str();
+	res[1] = L"";
+	res[2] = L"";
+	//res[3] = waitzar::removeZWS(typedSentenceStr.str());
+	res[3] = res[0];
 }
 
 
-vector< pair<wstring, unsigned int> > LetterInputMethod::getTypedCandidateStrings()
+void LetterInputMethod::buildTypedCandidateStrings(vector< pair<wstring, unsigned int> >& res)
 {
-	vector< pair<wstring, unsigned int> > res;
 	//res.push_back(pair<wstring, unsigned int>(waitzar::removeZWS(typedCandidateStr.str()), 0));
 	res.push_back(pair<wstring, unsigned int>(typedCandidateStr.str(), 0));
-	return res;
 }
 
 
 void LetterInputMethod::appendToSentence(wchar_t letter, int id)
 {
 	//Used for system keys and ZWS
-	if (this->isHelpInput())
+	if (this->isHelpInput()) {
 		typedCandidateStr <<letter;
-	else
+		invalidate(VR_CANDIDATES);
+	} else {
 		typedSentenceStr <<letter;
+		invalidate(VR_SENTENCE);
+	}
 }
 
 
@@ -354,12 +353,16 @@ void LetterInputMethod::reset(bool resetCandidates, bool resetRoman, bool resetS
 		userDefinedWords.clear();
 	}
 
-	if (resetCandidates)
+	if (resetCandidates) {
 		typedCandidateStr.str(L"");
+		invalidate(VR_CANDIDATES);
+	}
 	if (resetRoman)
 		typedRomanStr.str(L"");
-	if (resetSentence)
+	if (resetSentence) {
 		typedSentenceStr.str(L"");
+		invalidate(VR_SENTENCE);
+	}
 }
 
 
@@ -33,8 +33,6 @@ public:
 	virtual std::pair<std::wstring, bool> appendTypedLetter(const std::wstring& prevStr, VirtKey& vkey);
 
 	//Abstract implementation - sentence and word
-	std::vector< std::wstring > getTypedSentenceStrings();
-	std::vector< std::pair<std::wstring, unsigned int> > getTypedCandidateStrings();
 	void appendToSentence(wchar_t letter, int id);
 
 	//Abstract implementation - simple
@@ -52,6 +50,10 @@ protected:
 	std::wstringstream typedSentenceStr;
 	std::wstringstream typedCandidateStr;
 
+	//Abstract implementation - cached strings
+	void buildTypedSentenceStrings(unsigned int regions, std::vector<std::wstring>& res);
+	void buildTypedCandidateStrings(std::vector< std::pair<std::wstring, unsigned int> >& res);
+
 	//General
 	void updateRomanHelpString();
 
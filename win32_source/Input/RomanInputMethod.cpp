@@ -14,6 +14,13 @@ using std::string;
 using std::wstring;
 
 
+namespace {
+	//Everything that depends on the model: the candidates and paging, plus the pat-sint highlight
+	//  (and the word it replaces). The text after the cursor never depends on the model.
+	const unsigned int VR_MODEL = VR_BEFORE_HILITE|VR_HILITE|VR_CANDIDATES|VR_PAGING;
+}
+
+
 //This takes responsibility for the model and sentence memory.
 
 void RomanInputMethod::init(MyWin32Window* mainWindow, MyWin32Window* sentenceWindow, MyWin32Window* helpWindow,MyWin32Window* memoryWindow, const std::vector< std::pair <int, unsigned short> > &systemWordLookup, OnscreenKeyboard *helpKeyboard, std::wstring systemDefinedWords, LookupEngine* model, waitzar::SentenceList* sentence, const std::wstring& encoding, CONTROL_KEY_TYPE controlKeyStyle, bool typeBurmeseNumbers, bool typeNumeralConglomerates, bool suppressUppercase)
@@ -68,6 +75,7 @@ void RomanInputMethod::handleEsc()
 	if (!mainWindow->isVisible()) {
 		//Kill the entire sentence
 		sentence->clear();
+		invalidate(VR_SENTENCE);
 	} else {
 		//Cancel the current word
 		typedRomanStr.str(L"");
@@ -82,11 +90,14 @@ void RomanInputMethod::handleBackspace(VirtKey& vkey)
 {
 	if (!mainWindow->isVisible()) {
 		//Delete the previous word in the sentence
-		if (sentence->deletePrev(*model))
+		if (sentence->deletePrev(*model)) {
+			invalidate(VR_SENTENCE);
 			viewChanged = true;
+		}
 	} else {
 		//Delete the previously-typed letter
-		model->backspace(sentence->getPrevTypedWord(*model, userDefinedWords));
+		model->backspace(sentence->getPrevTypedWord());
+		invalidate(VR_MODEL);
 
 		//Truncate...
 		wstring newStr = !typedRomanStr.str().empty() ? typedRomanStr.str().substr(0, typedRomanStr.str().length()-1) : L"";
@@ -102,8 +113,10 @@ void RomanInputMethod::handleDelete()
 {
 	if (!mainWindow->isVisible()) {
 		//Delete the next word
-		if (sentence->deleteNext())
+		if (sentence->deleteNext()) {
+			invalidate(VR_SENTENCE);
 			viewChanged = true;
+		}
 	}
 }
 
@@ -114,17 +127,21 @@ void RomanInputMethod::handleLeftRight(bool isRight, bool loopToZero)
 	int amt = isRight ? 1 : -1;
 	if (mainWindow->isVisible()) {
 		//Move right/left within the current selection.
-		if (model->moveRight(amt) == TRUE)
+		if (model->moveRight(amt) == TRUE) {
+			invalidate(VR_MODEL);
 			viewChanged = true;
-		else if (isRight && loopToZero) {
+		} else if (isRight && loopToZero) {
 			//Force back to index zero
 			model->moveRight(-1000); //Hacky, we should eventually set a better wraparound method.
+			invalidate(VR_MODEL);
 			viewChanged = true;
 		}
 	} else {
 		//Move right/left within the current phrase.
-		if (sentence->moveCursorRight(amt, *model))
+		if (sentence->moveCursorRight(amt, *model)) {
+			invalidate(VR_SENTENCE);
 			viewChanged = true;
+		}
 	}
 }
 
@@ -150,8 +167,10 @@ void RomanInputMethod::handleTab()
 void RomanInputMethod::handleUpDown(bool isDown)
 {
 	if (mainWindow->isVisible()) {
-		if (model->pageUp(!isDown))
+		if (model->pageUp(!isDown)) {
+			invalidate(VR_MODEL);
 			viewChanged = true;
+		}
 	}
 }
 
@@ -161,8 +180,9 @@ void RomanInputMethod::handleNumber(VirtKey& vkey)
 {
 	//Special case: conglomerate numbers
 	if ((vkey.alphanum()>='0'&&vkey.alphanum()<='9') && typeNumeralConglomerates && typeBurmeseNumbers && typedStrContainsNoAlpha) {
-	 if (model->typeLetter(vkey.alphanum(), vkey.modShift, sentence->getPrevTypedWord(*model, userDefinedWords))) {
+	 if (model->typeLetter(vkey.alphanum(), vkey.modShift, sentence->getPrevTypedWord())) {
 		 typedRomanStr <<vkey.alphanum();
+		 invalidate(VR_MODEL);
 		 viewChanged = true;
 	 }
 	} else if (mainWindow->isVisible()) {
@@ -191,8 +211,10 @@ void RomanInputMethod::handleNumber(VirtKey& vkey)
 		//Main window is not visible and we are typing 0-9. But what about BurmeseNumerals?
 		if (typeBurmeseNumbers) {
 			//Type this number --ask the model for the number directly, to avoid crashing Burglish.
-			sentence->insert(model->getSingleDigitID(vkey.alphanum() - '0'));
+			int digitID = model->getSingleDigitID(vkey.alphanum() - '0');
+			sentence->insert(digitID, getWordString(digitID));
 			sentence->moveCursorRight(0, true, *model);
+			invalidate(VR_SENTENCE);
 		} else /*if (sentenceWindow->isVisible())*/ {
 			//As long as the numbers 0-9 are in the "system key" list (they are) then we can just pass this off.
 			InputMethod::handleKeyPress(vkey);
@@ -210,6 +232,7 @@ void RomanInputMethod::handleStop(bool isFull, VirtKey& vkey)
 	if (!mainWindow->isVisible()) {
 		//Otherwise, we perform the normal "enter" routine.
 		typedStopChar = (wchar_t)stopChar;
+		invalidate(VR_SENTENCE);
 		requestToTypeSentence = true;
 	}
 }
@@ -243,6 +266,7 @@ void RomanInputMethod::handleCommit(bool strongCommit)
 		} else {
 			if (sentence->getCursorIndex()==-1 || sentence->getCursorIndex()<((int)sentence->size()-1)) {
 				sentence->moveCursorRight(1, *model);
+				invalidate(VR_SENTENCE);
 				viewChanged = true;
 			} else {
 				//Type the entire sentence
@@ -263,7 +287,9 @@ void RomanInputMethod::handleKeyPress(VirtKey& vkey)
 	wchar_t alpha = vkey.alphanum();
 	if ((alpha>='a' && alpha<='z') || alpha==';') {
 		//Run this keypress into the model. Accomplish anything?
-		if (!model->typeLetter(vkey.alphanum(), suppressUppercase?false:vkey.modShift, sentence->getPrevTypedWord(*model, userDefinedWords))) {
+		bool typed = model->typeLetter(vkey.alphanum(), suppressUppercase?false:vkey.modShift, sentence->getPrevTypedWord());
+		invalidate(VR_MODEL);
+		if (!typed) {
 			//That's the end of the story if we're typing Chinese-style; or if there's no roman string.
 			if (controlKeyStyle==CONTROL_KEY_TYPE::CHINESE || typedRomanStr.str().empty())
 				return;
@@ -273,7 +299,9 @@ void RomanInputMethod::handleKeyPress(VirtKey& vkey)
 			viewChanged = true;
 
 			//Nothing left on the new string?
-			if (!model->typeLetter(vkey.alphanum(), suppressUppercase?false:vkey.modShift, sentence->getPrevTypedWord(*model, userDefinedWords)))
+			typed = model->typeLetter(vkey.alphanum(), suppressUppercase?false:vkey.modShift, sentence->getPrevTypedWord());
+			invalidate(VR_MODEL);
+			if (!typed)
 				return;
 		}
 
@@ -308,6 +336,7 @@ bool RomanInputMethod::selectWord(int id)
 {
 	//Are there any words to use?
 	std::pair<int, int> typedVal = model->typeSpace(id);
+	invalidate(VR_ALL);
 	if (typedVal.first<0)
 		return false;
 	int wordID = typedVal.first;
@@ -319,7 +348,7 @@ bool RomanInputMethod::selectWord(int id)
 	}
 
 	//Insert into the current sentence, return
-	sentence->insert(wordID);
+	sentence->insert(wordID, getWordString(wordID));
 	return true;
 }
 
@@ -348,74 +377,46 @@ void RomanInputMethod::typeHelpWord(std::string roman, std::wstring myanmar, int
 
 
 
-vector<wstring> RomanInputMethod::getTypedSentenceStrings()
+wstring RomanInputMethod::getWordString(int id) const
 {
-	//Results
-	//TODO: Cache the results.
-	vector<wstring> res;
-	std::wstringstream line;
-	std::wstringstream full;
-
-	//Build
-	int currID = -1;
-	int actID = model->getCurrSelectedID()+model->getFirstWordIndex();
-	int currReplacementID = (model->getPossibleWords().empty()) ? -1 : model->getWordCombinations()[actID];
-	for (std::list<int>::const_iterator it=sentence->begin(); it!=sentence->end(); it++) {
-		//Get the word. This depends on the ID's negativity, size, etc.
-		wstring currWord;
-		if (*it>=0)
-			currWord = model->getWordString(*it);
-		else {
-			int modID = -(*it)-1;
-			if (modID<(int)systemDefinedWords.size())
-				currWord = wstring(1, systemDefinedWords[modID]);
-			else
-				currWord = userDefinedWords[modID-systemDefinedWords.size()];
-		}
-
-		//Have we reached a transition?
-		if (currID==sentence->getCursorIndex()-1 && currReplacementID!=-1) {
-			//We're about to start the highlighted word.
-			res.push_back(line.str());
-			line.str(L"");
-
-			//CHANGE the current word to the pat-sint replacement.
-			currWord = model->getWordString(currReplacementID);
-		} else if (currID==sentence->getCursorIndex()) {
-			//We're at the cursor
-			res.push_back(line.str());
-			line.str(L"");
-			if (res.size()==1)
-				res.push_back(L"");
-		}
+	//This depends on the ID's negativity, size, etc.
+	if (id>=0)
+		return model->getWordString(id);
+	int modID = -id-1;
+	if (modID<(int)systemDefinedWords.size())
+		return wstring(1, systemDefinedWords[modID]);
+	return userDefinedWords[modID-systemDefinedWords.size()];
+}
 
-		//Append the word
-		line <<currWord;
-		full <<currWord;
 
-		//Increment
-		currID++;
-	}
 
-	//Add the final entry, and the typedStopChar if necessary
-	if (typedStopChar!=L'\0') {
-		line <<typedStopChar;
-		full <<typedStopChar;
+void RomanInputMethod::buildTypedSentenceStrings(unsigned int regions, vector<wstring>& res)
+{
+	//The sentence keeps its own text, split at the cursor. If the previous word can be
+	//  pat-sint combined, the combination is shown (highlighted) in its place.
+	int actID = model->getCurrSelectedID()+model->getFirstWordIndex();
+	int currReplacementID = (model->getPossibleWords().empty()) ? -1 : model->getWordCombinations()[actID];
+	bool replacePrev = currReplacementID!=-1 && sentence->getCursorIndex()>=0;
+
+	//The typedStopChar goes on the last non-empty segment
+	int stopRegion = -1;
+	if (typedStopChar!=L'\0')
+		stopRegion = !sentence->getTextAfterCursor().empty() ? 2 : replacePrev ? 1 : 0;
+
+	//Only rebuild what's changed
+	if (regions&VR_BEFORE_HILITE)
+		res[0] = sentence->getTextBeforeCursor(replacePrev);
+	if (regions&VR_HILITE)
+		res[1] = replacePrev ? model->getWordString(currReplacementID) : L"";
+	if (regions&VR_AFTER_CURSOR)
+		res[2] = sentence->getTextAfterCursor();
+	for (int i=0; i<3; i++) {
+		if (i==stopRegion && (regions&(1<<i)))
+			res[i] += typedStopChar;
 	}
-	res.push_back(line.str());
-
-	//I think this might always be true...
-	//TODO: Check the source and remove these tests.
-	while (res.size()<3)
-		res.push_back(L"");
-	if (res.size()!=3)
-		throw std::runtime_error("Error! getTypedSentenceStr() must always return a vector of size 3+1");
 
 	//Finally, add the full entry
-	res.push_back(full.str());
-
-	//Done
-	return res;
+	res[3] = res[0] + res[1] + res[2];
 }
 
 
@@ -424,18 +425,14 @@ vector<wstring> RomanInputMethod::getTypedSentenceStrings()
 //2 = selected
 //4 = give it a "tilde" label
 
-vector< pair<wstring, unsigned int> > RomanInputMethod::getTypedCandidateStrings()
+void RomanInputMethod::buildTypedCandidateStrings(vector< pair<wstring, unsigned int> >& res)
 {
-	//TODO: cache the results
-	std::vector< std::pair<std::wstring, unsigned int> > res;
-	std::vector<unsigned int> words = model->getPossibleWords();
-	std::vector<int> combinations = model->getWordCombinations();
+	const std::vector<unsigned int>& words = model->getPossibleWords();
+	const std::vector<int>& combinations = model->getWordCombinations();
+	res.reserve(words.size());
 	for (size_t i=0; i<words.size(); i++) {
 		std::pair<std::wstring, unsigned int> item = std::pair<std::wstring, unsigned int>(model->getWordString(words[i]), HF_NOTHING);
 
-		//Get the previous word
-		std::wstring prevWord = sentence->getPrevTypedWord(*model, userDefinedWords);
-
 		//Color properly.
 		if (combinations[i]!=-1) {
 			item.second |= HF_PATSINT;
@@ -446,8 +443,6 @@ vector< pair<wstring, unsigned int> > RomanInputMethod::getTypedCandidateStrings
 			item.second |= HF_CURRSELECTION;
 		res.push_back(item);
 	}
-
-	return res;
 }
 
 
@@ -456,12 +451,13 @@ void RomanInputMethod::appendToSentence(wchar_t letter, int id)
 {
 	//Type it
 	//selectWord(id);
-	sentence->insert(id);
+	sentence->insert(id, getWordString(id));
 
 	//We need to reset the trigrams here...
 	sentence->updateTrigrams(*model);
 
 	//Repaint
+	invalidate(VR_SENTENCE);
 	viewChanged = true;
 }
 
@@ -479,6 +475,7 @@ void RomanInputMethod::reset(bool resetCandidates, bool resetRoman, bool resetSe
 	if (resetCandidates || resetRoman)  {
 		typedRomanStr.str(L"");
 		model->reset(performFullReset);
+		invalidate(VR_MODEL);
 	}
 
 	//Reset the sentence?
@@ -490,6 +487,7 @@ void RomanInputMethod::reset(bool resetCandidates, bool resetRoman, bool resetSe
 
 	//Either way
 	typedStopChar = L'\0';
+	invalidate(VR_SENTENCE);
 }
 
 //Add our paren string
@@ -509,9 +507,9 @@ std::wstring RomanInputMethod::getTypedRomanString(bool asLowercase)
 }
 
 
-std::pair<int, int> RomanInputMethod::getPagingInfo() const
+void RomanInputMethod::buildPagingInfo(std::pair<int, int>& res) const
 {
-	return std::pair<int, int>(model->getCurrPage(), model->getNumberOfPages());
+	res = std::pair<int, int>(model->getCurrPage(), model->getNumberOfPages());
 }
 
 
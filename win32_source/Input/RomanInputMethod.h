@@ -39,8 +39,6 @@ public:
 
 
 	//Abstract implementation - sentence and word
-	std::vector< std::wstring > getTypedSentenceStrings();
-	std::vector< std::pair<std::wstring, unsigned int> > getTypedCandidateStrings();
 	void appendToSentence(wchar_t letter, int id);
 
 
@@ -59,7 +57,11 @@ public:
 	//Real override
 	std::wstring getTypedRomanString(bool asLowercase);
 
-	std::pair<int, int> getPagingInfo() const;
+protected:
+	//Abstract implementation - cached strings
+	void buildTypedSentenceStrings(unsigned int regions, std::vector<std::wstring>& res);
+	void buildTypedCandidateStrings(std::vector< std::pair<std::wstring, unsigned int> >& res);
+	void buildPagingInfo(std::pair<int, int>& res) const;
 
 
 private:
@@ -70,6 +72,7 @@ private:
 
 	bool selectCurrWord();
 	bool selectWord(int id);
+	std::wstring getWordString(int id) const;
 
 	//Properties
 	CONTROL_KEY_TYPE controlKeyStyle;
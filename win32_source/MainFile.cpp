@@ -150,6 +150,7 @@ string pathLocalFolder;      //Path to WZ's "local" folder in the AppData direct
 string pathLocalTinySave;    //Path to the "tiny" save file we use for quickly remembering last-used input methods, etc.
 string pathLocalLastSavedVersionInfo; //Path to the last locally cached copy of the "latest version" file.
 string pathLocalConfig;      //Path to WZ's "local" config.json.txt file in the AppData folder.
+string pathLocalConfigSnapshot; //Path to the last validated config tree, so we don't have to re-parse every config file.
 string pathUserConfig;       //Path to the user's config.json.txt file in his "My Documents" directory.
 
 
@@ -1577,13 +1578,13 @@ void recalculate()
 	//TODO: The typed sentence string might have a highlight, which changes things slightly.
 	vector<wstring> dispSentenceStr;
 	{
-		vector<wstring> inputSentenceStr = currInput->getTypedSentenceStrings();
+		const vector<wstring>& inputSentenceStr = currInput->getTypedSentenceStrings();
 		/*if (!config.getSettings().unmarkedWhitespace.empty()) {
 			for (size_t i=0; i<inputSentenceStr.size(); i++) {
 				inputSentenceStr[i] = waitzar::removeZWS(inputSentenceStr[i], config.getSettings().unmarkedWhitespace);
 			}
 		}*/
-		for (vector<wstring>::iterator i=inputSentenceStr.begin(); i!=inputSentenceStr.end(); i++) {
+		for (vector<wstring>::const_iterator i=inputSentenceStr.begin(); i!=inputSentenceStr.end(); i++) {
 			wstring candidate = *i;
 			if (!noEncChange) {
 				input2Uni->getImpl()->convertInPlace(candidate);
@@ -3952,6 +3953,7 @@ void buildFilePathNames()
 		try {
 			pathLocalFolder = waitzar::escape_wstr(wstring(localAppPath), true) + fs + "WaitZar";
 			pathLocalConfig = pathLocalFolder + fs + "config.override.json.txt";
+			pathLocalConfigSnapshot = pathLocalFolder + fs + "config.snapshot.bin";
 			pathLocalTinySave = pathLocalFolder + fs + "tinysave.txt";
 			pathLocalLastSavedVersionInfo = pathLocalFolder + fs + "waitzar_version.txt";
 		} catch (std::exception ex) {}
@@ -3977,6 +3979,7 @@ bool findAndLoadAllConfigFiles()
 	//Find all config files
 	bool localConfigError = false;
 	bool suppressThisException = false;
+	bool fromSnapshot = false;
 	map<wstring, vector<wstring> > lastUsedSettings;
 	try {
 		//Build up known path names, save globally for future use.
@@ -3991,8 +3994,13 @@ bool findAndLoadAllConfigFiles()
 			lastUsedSettings.clear();
 		}
 
+		//Find every config file we'll merge, in order. The local config file also reports
+		//  every option it sets, so remember which one that is.
+		vector<pair<string, CfgPerm> > cfgFiles;
+		int localCfgID = -1;
+
 		//Set the main config file
-		cfgMgr.mergeInConfigFile(pathMainConfig, PrimaryCfgPerm());
+		cfgFiles.push_back(pair<string, CfgPerm>(pathMainConfig, PrimaryCfgPerm()));
 
 		//Browse for all language directories, add them
 		vector<string> langFolderNames = GetConfigSubDirs(cfgDir, cfgFile);
@@ -4006,17 +4014,17 @@ bool findAndLoadAllConfigFiles()
 
 			//Handle "Common" here; it's a directory for DLLs, not languages.
 			if (*fold == "Common") {
-				cfgMgr.mergeInConfigFile(langCfgFile, ExtendCfgPerm());
+				cfgFiles.push_back(pair<string, CfgPerm>(langCfgFile, ExtendCfgPerm()));
 				continue;
 			} else {
-				cfgMgr.mergeInConfigFile(langCfgFile, LangLevelCfgPerm());
+				cfgFiles.push_back(pair<string, CfgPerm>(langCfgFile, LangLevelCfgPerm()));
 			}
 
 			//Now, get the sub-config files
 			vector<string> modFolders = GetConfigSubDirs(langCfgDir, cfgFile);
 			for (vector<string>::iterator mod = modFolders.begin(); mod!=modFolders.end(); mod++) {
 				string modCfgFile = langCfgDir + fs + *mod + fs + cfgFile;
-				cfgMgr.mergeInConfigFile(modCfgFile, LangLevelCfgPerm());
+				cfgFiles.push_back(pair<string, CfgPerm>(modCfgFile, LangLevelCfgPerm()));
 			}
 
 			//Handle errors:
@@ -4034,7 +4042,7 @@ bool findAndLoadAllConfigFiles()
 		};
 
 
-		//Now, load the local config file
+		//Now, the local config file
 		if (!pathLocalFolder.empty() && !pathLocalConfig.empty()) {
 			//Try to create the folder if it doesn't exist
 			std::wstringstream temp;
@@ -4046,17 +4054,8 @@ bool findAndLoadAllConfigFiles()
 			temp.str(L"");
 			temp << pathLocalConfig.c_str();
 			if (WZFactory::FileExists(temp.str())) {
-				cfgMgr.mergeInConfigFile(pathLocalConfig, UserLocalCfgPerm(), false,
-					//On option set
-					[&locallySetOptions](const StringNode& n) {
-						std::cout <<"Option: " <<waitzar::escape_wstr(n.getFullyQualifiedKeyName()) <<std::endl;
-
-						locallySetOptions.setOption(n.getFullyQualifiedKeyName(), n.str());
-					},
-					//On error
-					errorFunc
-				);
-				//config.initLocalConfig(pathLocalConfig);
+				localCfgID = cfgFiles.size();
+				cfgFiles.push_back(pair<string, CfgPerm>(pathLocalConfig, UserLocalCfgPerm()));
 			} else {
 				//Create the file
 				ConfigManager::SaveLocalConfigFile(temp.str());
@@ -4070,14 +4069,47 @@ bool findAndLoadAllConfigFiles()
 			std::wstringstream temp;
 			temp << pathUserConfig.c_str();
 			if (WZFactory::FileExists(temp.str())) {
-				//config.initUserConfig(pathUserConfig);
-				cfgMgr.mergeInConfigFile(pathUserConfig, UserLocalCfgPerm());
+				cfgFiles.push_back(pair<string, CfgPerm>(pathUserConfig, UserLocalCfgPerm()));
 			} else {
 				//Create the file
 				ConfigManager::SaveUserConfigFile(temp.str());
 			}
 		}
 
+
+		//If none of these files have changed since we last validated them, skip the parsing entirely.
+		vector<string> cfgPaths;
+		for (auto it=cfgFiles.begin(); it!=cfgFiles.end(); it++)
+			cfgPaths.push_back(it->first);
+		ConfigSnapshot snapshot(cfgPaths);
+		fromSnapshot = !pathLocalConfigSnapshot.empty() && snapshot.load(pathLocalConfigSnapshot);
+		if (fromSnapshot) {
+			cfgMgr.restoreSnapshot(snapshot);
+			for (auto it=snapshot.localOptions.begin(); it!=snapshot.localOptions.end(); it++)
+				locallySetOptions.setOption(it->first, it->second);
+			Logger::markLogTime('L', L"Config snapshot loaded");
+		} else {
+			for (size_t i=0; i<cfgFiles.size(); i++) {
+				if ((int)i!=localCfgID) {
+					cfgMgr.mergeInConfigFile(cfgFiles[i].first, cfgFiles[i].second);
+					continue;
+				}
+
+				cfgMgr.mergeInConfigFile(cfgFiles[i].first, cfgFiles[i].second, false,
+					//On option set
+					[&locallySetOptions, &snapshot](const StringNode& n) {
+						std::cout <<"Option: " <<waitzar::escape_wstr(n.getFullyQualifiedKeyName()) <<std::endl;
+
+						locallySetOptions.setOption(n.getFullyQualifiedKeyName(), n.str());
+						snapshot.localOptions[n.getFullyQualifiedKeyName()] = n.str();
+					},
+					//On error
+					errorFunc
+				);
+			}
+			cfgMgr.takeSnapshot(snapshot);
+		}
+
 		Logger::markLogTime('L', L"Config files loaded");
 
 		//First test: does "config" not exist at all? If so, throw a special exception,
@@ -4095,6 +4127,10 @@ bool findAndLoadAllConfigFiles()
 
 		Logger::endLogTimer('L');
 		Logger::markLogTime('L', L"Config files validated");
+
+		//They're valid, so save them for next time. This doesn't need to hold up start-up.
+		if (!fromSnapshot && !pathLocalConfigSnapshot.empty())
+			snapshot.saveInBackground(pathLocalConfigSnapshot);
 	} catch (std::exception& ex) {
 		//In case of errors, just reset & use the embedded file
 		cfgMgr = ConfigManager();
@@ -4115,6 +4151,9 @@ bool findAndLoadAllConfigFiles()
 				msg << "WaitZar has deleted an invalid setting in the LOCAL config cache. Try restarting WaitZar to see if this fixed the problem.\n";
 			msg << "\nDetails:\n";
 			msg << ex.what();
+
+			//The config log says what went wrong; make sure it's on disk before we stop to ask.
+			Logger::flush();
 			MessageBox(NULL, msg.str().c_str(), L"Config File Error", MB_ICONWARNING | MB_OK);
 		}
 
@@ -4135,6 +4174,7 @@ bool findAndLoadAllConfigFiles()
 			std::wstringstream msg2;
 			msg2 << "Error loading default config file.\nWaitZar will not be able to function, and is shutting down.\n\nDetails:\n";
 			msg2 << ex2.what();
+			Logger::flush();
 			MessageBox(NULL, msg2.str().c_str(), L"Default Config Error", MB_ICONERROR | MB_OK);
 			return false;
 		}
@@ -4243,6 +4283,11 @@ bool checkUserSpecifiedRegressionTests(wstring testFileName)
 			ChangeLangInputOutput(language, inputMethod, outEncoding);
 		}
 
+		//Key Magic keyboards also check their automaton against the normal matcher.
+		KeyMagicInputMethod* kmInput = dynamic_cast<KeyMagicInputMethod*>(currInput);
+		if (kmInput!=NULL)
+			kmInput->setUseAutomaton(true, true);
+
 		//Construct the output file name
 		size_t lastSlash = string::npos;
 		{
@@ -4623,7 +4668,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 	std::cout <<"kam-ba  ";
 	auto words = model.getMatchedWords();
 	for (auto it=words.begin(); it!=words.end(); it++)
-		std::cout <<"," <<waitzar::escape_wstr(*it);
+		std::cout <<"," <<waitzar::escape_wstr(wstring(it->begin(), it->end()));
 	std::cout <<std::endl <<"  start-id: " <<model.getMatchedDefaultIndex() <<std::endl;
 
 	return 0;
@@ -56,6 +56,27 @@ void ConfigManager::mergeInConfigFile(const string& cfgFile, const CfgPerm& perm
 }
 
 
+void ConfigManager::restoreSnapshot(const ConfigSnapshot& snapshot)
+{
+	//Can't modify a sealed configuration
+	if (this->sealed)
+		throw std::runtime_error("Can't restore a snapshot; ConfigManager instance has been sealed.");
+
+	//The StringNode tree is only needed to merge in more files; the snapshot already has everything.
+	troot = snapshot.root;
+}
+
+
+void ConfigManager::takeSnapshot(ConfigSnapshot& snapshot) const
+{
+	//Sealing adds implementations, which we can't save.
+	if (this->sealed)
+		throw std::runtime_error("Can't take a snapshot; ConfigManager instance has been sealed.");
+
+	snapshot.root = troot;
+}
+
+
 //
 // This is the only way to get an instance of TNode from the config manager; use it to load a RuntimeConfig() object
 //
@@ -26,6 +26,7 @@
 #include "Settings/TransformNode.h"
 #include "Settings/StringNode.h"
 #include "Settings/JsonFile.h"
+#include "Settings/ConfigSnapshot.h"
 #include "NGram/wz_utilities.h"
 #include "NGram/BurglishBuilder.h"
 
@@ -47,6 +48,11 @@ public:
 	const ConfigRoot& sealConfig(const std::map<std::wstring, std::vector<std::wstring> >& lastUsedSettings, std::function<void (const std::wstring& k)> OnError=std::function<void (const std::wstring& k)>());
 	static void OverrideSingleSetting(RuntimeConfig& currConfig, const std::wstring& name, const std::wstring& value);
 
+	//Skip all of the merging by restoring a snapshot, or save one once all files have been merged.
+	//  Either must be done before the config is sealed.
+	void restoreSnapshot(const ConfigSnapshot& snapshot);
+	void takeSnapshot(ConfigSnapshot& snapshot) const;
+
 	//Static helpers for loading/saving the "automated" config files.
 	static void SaveLocalConfigFile(const std::wstring& path, const std::map<std::wstring, std::wstring>& properties=std::map<std::wstring, std::wstring>());
 	static void SaveUserConfigFile(const std::wstring& path);
@@ -0,0 +1,492 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#include "ConfigSnapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "NGram/wz_utilities.h"
+#include "NGram/MappedFile.h"
+
+
+using std::map;
+using std::vector;
+using std::string;
+using std::wstring;
+
+
+//Appends values to a buffer
+class ConfigSnapshot::Writer {
+public:
+	Writer(vector<char>& out) : out(out) {}
+
+	void num(unsigned int val) {
+		bytes(&val, sizeof(val));
+	}
+	void flag(bool val) {
+		num(val?1:0);
+	}
+	void str(const string& val) {
+		num(val.size());
+		bytes(val.c_str(), val.size());
+	}
+	void str(const wstring& val) {
+		num(val.size());
+		bytes(val.c_str(), val.size()*sizeof(wchar_t));
+	}
+	void strs(const vector<wstring>& vals) {
+		num(vals.size());
+		for (auto it=vals.begin(); it!=vals.end(); it++)
+			str(*it);
+	}
+
+private:
+	vector<char>& out;
+
+	void bytes(const void* src, size_t size) {
+		if (size==0)
+			return;
+		size_t pos = out.size();
+		out.resize(pos + size);
+		memcpy(&out[pos], src, size);
+	}
+};
+
+
+//Reads values back; throws if we run out of data.
+class ConfigSnapshot::Reader {
+public:
+	Reader(const char* begin, const char* end) : pos(begin), end(end) {}
+
+	unsigned int num() {
+		unsigned int res = 0;
+		bytes(&res, sizeof(res));
+		return res;
+	}
+	bool flag() {
+		return num()!=0;
+	}
+	void str(string& res) {
+		size_t size = num();
+		need(size);
+		res.assign(pos, size);
+		pos += size;
+	}
+	void str(wstring& res) {
+		size_t size = num();
+		need(size*sizeof(wchar_t));
+		res.resize(size);
+		bytes(size>0?&res[0]:NULL, size*sizeof(wchar_t));
+	}
+	void strs(vector<wstring>& res) {
+		res.resize(num());
+		for (auto it=res.begin(); it!=res.end(); it++)
+			str(*it);
+	}
+	bool done() const {
+		return pos==end;
+	}
+
+private:
+	const char* pos;
+	const char* end;
+
+	void need(size_t size) const {
+		if (size > (size_t)(end-pos))
+			throw std::runtime_error("Config snapshot is truncated");
+	}
+	void bytes(void* dest, size_t size) {
+		need(size);
+		if (size>0)
+			memcpy(dest, pos, size);
+		pos += size;
+	}
+};
+
+
+
+template <class T>
+void ConfigSnapshot::WriteMap(Writer& out, const map<wstring, T>& nodes)
+{
+	out.num(nodes.size());
+	for (auto it=nodes.begin(); it!=nodes.end(); it++) {
+		out.str(it->first);
+		Write(out, it->second);
+	}
+}
+
+template <class T>
+void ConfigSnapshot::ReadMap(Reader& in, map<wstring, T>& nodes)
+{
+	for (unsigned int count=in.num(); count>0; count--) {
+		wstring key;
+		in.str(key);
+		Read(in, nodes[key]);
+	}
+}
+
+
+
+ConfigSnapshot::ConfigSnapshot(const vector<string>& paths) : validSources(true)
+{
+	for (auto it=paths.begin(); it!=paths.end(); it++) {
+		Source src;
+		src.path = *it;
+		try {
+			src.md5 = waitzar::GetMD5Hash(*it);
+		} catch (std::exception& ex) {
+			//Let the ConfigManager report this properly.
+			validSources = false;
+		}
+		sources.push_back(src);
+	}
+}
+
+
+bool ConfigSnapshot::load(const string& path)
+{
+	if (!validSources)
+		return false;
+
+	//Missing or unreadable files are expected; we just haven't saved one yet.
+	string data;
+	try {
+		data = waitzar::ReadBinaryFile(path);
+	} catch (std::exception& ex) {
+		return false;
+	}
+
+	//Check the header
+	if (data.size() < sizeof(Header))
+		return false;
+	Header head;
+	memcpy(&head, data.c_str(), sizeof(Header));
+	if (head.magic!=Magic || head.version!=Version || head.byteOrder!=ByteOrderMark || head.charSize!=sizeof(wchar_t) || head.fileSize!=data.size())
+		return false;
+	if (waitzar::MappedFile::Checksum(data.c_str()+sizeof(Header), data.size()-sizeof(Header))!=head.checksum)
+		return false;
+
+	//Read it into temporaries, so that we don't leave half a tree behind.
+	try {
+		Reader in(data.c_str()+sizeof(Header), data.c_str()+data.size());
+
+		//Our sources have to match exactly, in order.
+		if (in.num()!=sources.size())
+			return false;
+		for (auto it=sources.begin(); it!=sources.end(); it++) {
+			Source src;
+			in.str(src.path);
+			in.str(src.md5);
+			if (src.path!=it->path || src.md5!=it->md5)
+				return false;
+		}
+
+		//Local options
+		map<wstring, wstring> options;
+		for (unsigned int count=in.num(); count>0; count--) {
+			wstring key;
+			in.str(key);
+			in.str(options[key]);
+		}
+
+		//The tree itself
+		ConfigRoot tree;
+		in.str(tree.id);
+		Read(in, tree.settings);
+		ReadMap(in, tree.languages);
+		ReadMap(in, tree.extensions);
+		if (!in.done())
+			return false;
+
+		//Done
+		localOptions.swap(options);
+		root = tree;
+	} catch (std::exception& ex) {
+		return false;
+	}
+
+	return true;
+}
+
+
+void ConfigSnapshot::save(const string& path) const
+{
+	vector<char> data(sizeof(Header), 0);
+	Writer out(data);
+
+	//Sources
+	out.num(sources.size());
+	for (auto it=sources.begin(); it!=sources.end(); it++) {
+		out.str(it->path);
+		out.str(it->md5);
+	}
+
+	//Local options
+	out.num(localOptions.size());
+	for (auto it=localOptions.begin(); it!=localOptions.end(); it++) {
+		out.str(it->first);
+		out.str(it->second);
+	}
+
+	//The tree
+	out.str(root.id);
+	Write(out, root.settings);
+	WriteMap(out, root.languages);
+	WriteMap(out, root.extensions);
+
+	//Fill in the header
+	Header head;
+	memset(&head, 0, sizeof(head));
+	head.magic = Magic;
+	head.version = Version;
+	head.byteOrder = ByteOrderMark;
+	head.charSize = sizeof(wchar_t);
+	head.fileSize = data.size();
+	head.checksum = waitzar::MappedFile::Checksum(&data[sizeof(Header)], data.size()-sizeof(Header));
+	memcpy(&data[0], &head, sizeof(Header));
+
+	//Write a temporary file and then swap it in, so that a half-written snapshot is never
+	//   mistaken for a whole one (the checksum would catch it anyway).
+	string tempPath = path + ".tmp";
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (file == NULL)
+		throw std::runtime_error(string("Can't write config snapshot: ") + tempPath);
+	size_t written = fwrite(&data[0], 1, data.size(), file);
+	fclose(file);
+	if (written != data.size()) {
+		remove(tempPath.c_str());
+		throw std::runtime_error(string("Error writing config snapshot: ") + tempPath);
+	}
+	remove(path.c_str()); //Windows won't rename over an existing file
+	if (rename(tempPath.c_str(), path.c_str())!=0) {
+		remove(tempPath.c_str());
+		throw std::runtime_error(string("Can't replace config snapshot: ") + path);
+	}
+}
+
+
+void ConfigSnapshot::saveInBackground(const string& path) const
+{
+	ConfigSnapshot copy = *this;
+	std::thread([copy, path]() {
+		try {
+			copy.save(path);
+		} catch (std::exception& ex) {
+			//Nothing to do; we'll just re-parse the config files next time.
+		}
+	}).detach();
+}
+
+
+
+void ConfigSnapshot::Write(Writer& out, const SettingsNode& node)
+{
+	out.str(node.id);
+	out.str(node.hotkey.hotkeyStrRaw);
+	out.str(node.hotkey.hotkeyStrFormatted);
+	out.num(node.hotkey.hotkeyID);
+	out.num(node.hotkey.hkModifiers);
+	out.num(node.hotkey.hkVirtKeyCode);
+	out.flag(node.silenceMywordsErrors);
+	out.flag(node.balloonStart);
+	out.flag(node.alwaysElevate);
+	out.flag(node.trackCaret);
+	out.flag(node.lockWindows);
+	out.flag(node.suppressVirtualKeyboard);
+	out.str(node.whitespaceCharacters);
+	out.str(node.ignoredCharacters);
+	out.flag(node.hideWhitespaceMarkings);
+	out.str(node.defaultLanguage);
+	out.strs(node.defaultLanguageStack);
+}
+
+void ConfigSnapshot::Read(Reader& in, SettingsNode& node)
+{
+	in.str(node.id);
+	in.str(node.hotkey.hotkeyStrRaw);
+	in.str(node.hotkey.hotkeyStrFormatted);
+	node.hotkey.hotkeyID = in.num();
+	node.hotkey.hkModifiers = in.num();
+	node.hotkey.hkVirtKeyCode = in.num();
+	node.silenceMywordsErrors = in.flag();
+	node.balloonStart = in.flag();
+	node.alwaysElevate = in.flag();
+	node.trackCaret = in.flag();
+	node.lockWindows = in.flag();
+	node.suppressVirtualKeyboard = in.flag();
+	in.str(node.whitespaceCharacters);
+	in.str(node.ignoredCharacters);
+	node.hideWhitespaceMarkings = in.flag();
+	in.str(node.defaultLanguage);
+	in.strs(node.defaultLanguageStack);
+}
+
+
+void ConfigSnapshot::Write(Writer& out, const ExtendNode& node)
+{
+	out.str(node.id);
+	out.str(node.libraryFilePath);
+	out.str(node.libraryFileChecksum);
+	out.flag(node.enabled);
+	out.flag(node.requireChecksum);
+}
+
+void ConfigSnapshot::Read(Reader& in, ExtendNode& node)
+{
+	in.str(node.id);
+	in.str(node.libraryFilePath);
+	in.str(node.libraryFileChecksum);
+	node.enabled = in.flag();
+	node.requireChecksum = in.flag();
+}
+
+
+void ConfigSnapshot::Write(Writer& out, const LangNode& node)
+{
+	out.str(node.id);
+	out.str(node.displayName);
+	out.str(node.defaultOutputEncoding);
+	out.str(node.defaultDisplayMethodReg);
+	out.str(node.defaultDisplayMethodSmall);
+	out.str(node.defaultInputMethod);
+	WriteMap(out, node.inputMethods);
+	WriteMap(out, node.encodings);
+	WriteMap(out, node.transformations);
+	WriteMap(out, node.displayMethods);
+	out.strs(node.defaultInMethStack);
+	out.strs(node.defaultOutEncStack);
+}
+
+void ConfigSnapshot::Read(Reader& in, LangNode& node)
+{
+	in.str(node.id);
+	in.str(node.displayName);
+	in.str(node.defaultOutputEncoding);
+	in.str(node.defaultDisplayMethodReg);
+	in.str(node.defaultDisplayMethodSmall);
+	in.str(node.defaultInputMethod);
+	ReadMap(in, node.inputMethods);
+	ReadMap(in, node.encodings);
+	ReadMap(in, node.transformations);
+	ReadMap(in, node.displayMethods);
+	in.strs(node.defaultInMethStack);
+	in.strs(node.defaultOutEncStack);
+}
+
+
+void ConfigSnapshot::Write(Writer& out, const EncNode& node)
+{
+	out.str(node.id);
+	out.flag(node.canUseAsOutput);
+	out.str(node.displayName);
+	out.str(node.initial);
+	out.str(node.imagePath);
+}
+
+void ConfigSnapshot::Read(Reader& in, EncNode& node)
+{
+	in.str(node.id);
+	node.canUseAsOutput = in.flag();
+	in.str(node.displayName);
+	in.str(node.initial);
+	in.str(node.imagePath);
+}
+
+
+void ConfigSnapshot::Write(Writer& out, const TransNode& node)
+{
+	out.str(node.id);
+	out.flag(node.hasPriority);
+	out.num(static_cast<unsigned int>(node.type));
+	out.str(node.sourceFile);
+	out.str(node.fromEncoding);
+	out.str(node.toEncoding);
+}
+
+void ConfigSnapshot::Read(Reader& in, TransNode& node)
+{
+	in.str(node.id);
+	node.hasPriority = in.flag();
+	node.type = static_cast<TRANSFORM_TYPE>(in.num());
+	in.str(node.sourceFile);
+	in.str(node.fromEncoding);
+	in.str(node.toEncoding);
+}
+
+
+void ConfigSnapshot::Write(Writer& out, const InMethNode& node)
+{
+	out.str(node.id);
+	out.str(node.displayName);
+	out.num(static_cast<unsigned int>(node.type));
+	out.flag(node.suppressUppercase);
+	out.flag(node.typeNumeralConglomerates);
+	out.flag(node.disableCache);
+	out.flag(node.useAutomaton);
+	out.flag(node.typeBurmeseNumbers);
+	out.num(static_cast<unsigned int>(node.controlKeyStyle));
+	out.str(node.userWordsFile);
+	out.str(node.extraWordsFile);
+	out.str(node.keyboardFile);
+	out.str(node.encoding);
+}
+
+void ConfigSnapshot::Read(Reader& in, InMethNode& node)
+{
+	in.str(node.id);
+	in.str(node.displayName);
+	node.type = static_cast<INPUT_TYPE>(in.num());
+	node.suppressUppercase = in.flag();
+	node.typeNumeralConglomerates = in.flag();
+	node.disableCache = in.flag();
+	node.useAutomaton = in.flag();
+	node.typeBurmeseNumbers = in.flag();
+	node.controlKeyStyle = static_cast<CONTROL_KEY_TYPE>(in.num());
+	in.str(node.userWordsFile);
+	in.str(node.extraWordsFile);
+	in.str(node.keyboardFile);
+	in.str(node.encoding);
+}
+
+
+void ConfigSnapshot::Write(Writer& out, const DispMethNode& node)
+{
+	out.str(node.id);
+	out.num(static_cast<unsigned int>(node.type));
+	out.num(static_cast<unsigned int>(node.pointSize));
+	out.str(node.fontFaceName);
+	out.str(node.fontFile);
+	out.str(node.encoding);
+}
+
+void ConfigSnapshot::Read(Reader& in, DispMethNode& node)
+{
+	in.str(node.id);
+	node.type = static_cast<DISPLAY_TYPE>(in.num());
+	node.pointSize = static_cast<int>(in.num());
+	in.str(node.fontFaceName);
+	in.str(node.fontFile);
+	in.str(node.encoding);
+}
+
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+#pragma once
+
+#include <map>
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+#include "Settings/ConfigTreeContainers.h"
+
+
+/**
+ * A saved copy of the config tree, as it stands after every config file has been merged in,
+ *   but before it's been sealed. Reading and walking all of the config.json.txt files is most
+ *   of our start-up cost, and the result only changes when one of those files does. So we key the
+ *   snapshot by the path and MD5 hash of each file that went into it (in the order they were
+ *   merged); if they all match, the ConfigManager can skip straight to sealConfig().
+ * Only what the tree walker sets is saved: the "impl" pointers are built by sealConfig() as usual.
+ *   We also save any options set by the "local" config file, since the caller needs those too.
+ * Layout (native byte order and wchar_t size, like our binary models):
+ *   [Header] [sources] [local options] [ConfigRoot]
+ * The checksum is an Adler-32 of everything following the header.
+ * NOTE: If you add a property to any of the *Node classes, save it here and bump the Version.
+ */
+class ConfigSnapshot {
+public:
+	//Constants
+	static const unsigned int Magic = 0x53435A57; //"WZCS"
+	static const unsigned int Version = 1;
+	static const unsigned int ByteOrderMark = 0x01020304;
+
+	//One file that went into this snapshot
+	struct Source {
+		std::string path;
+		std::string md5;
+	};
+
+	//Hash each file, in order. A file we can't read makes the snapshot un-loadable.
+	explicit ConfigSnapshot(const std::vector<std::string>& paths=std::vector<std::string>());
+
+	//Options set by the local config file
+	std::map<std::wstring, std::wstring> localOptions;
+
+	//Load a snapshot, if it exists and exactly matches our sources. Returns false (and
+	//   leaves this object alone) if not.
+	bool load(const std::string& path);
+
+	//Save the snapshot. The background version works on its own copy, and just gives up
+	//   on an error (we'll simply rebuild it next time).
+	void save(const std::string& path) const;
+	void saveInBackground(const std::string& path) const;
+
+private:
+	struct Header {
+		unsigned int magic;
+		unsigned int version;
+		unsigned int byteOrder;
+		unsigned int checksum;
+		unsigned int charSize;  //sizeof(wchar_t) on the machine that saved it
+		unsigned int fileSize;
+	};
+
+	//Our data
+	std::vector<Source> sources;
+	bool validSources;
+	ConfigRoot root;
+
+	//Serialization (defined in the .cpp file)
+	class Writer;
+	class Reader;
+	static void Write(Writer& out, const SettingsNode& node);
+	static void Write(Writer& out, const ExtendNode& node);
+	static void Write(Writer& out, const LangNode& node);
+	static void Write(Writer& out, const EncNode& node);
+	static void Write(Writer& out, const TransNode& node);
+	static void Write(Writer& out, const InMethNode& node);
+	static void Write(Writer& out, const DispMethNode& node);
+	static void Read(Reader& in, SettingsNode& node);
+	static void Read(Reader& in, ExtendNode& node);
+	static void Read(Reader& in, LangNode& node);
+	static void Read(Reader& in, EncNode& node);
+	static void Read(Reader& in, TransNode& node);
+	static void Read(Reader& in, InMethNode& node);
+	static void Read(Reader& in, DispMethNode& node);
+	template <class T>
+	static void WriteMap(Writer& out, const std::map<std::wstring, T>& nodes);
+	template <class T>
+	static void ReadMap(Reader& in, std::map<std::wstring, T>& nodes);
+
+	//The ConfigManager moves the tree in and out
+	friend class ConfigManager;
+};
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
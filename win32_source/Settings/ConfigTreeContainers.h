@@ -140,6 +140,7 @@ public:
 	bool suppressUppercase;
 	bool typeNumeralConglomerates;
 	bool disableCache;
+	bool useAutomaton;
 	bool typeBurmeseNumbers;
 	CONTROL_KEY_TYPE controlKeyStyle;
 
@@ -166,6 +167,7 @@ public:
 		this->suppressUppercase = true;
 		this->typeNumeralConglomerates = false;
 		this->disableCache = false;
+		this->useAutomaton = false;
 		this->typeBurmeseNumbers = true;
 		this->controlKeyStyle = CONTROL_KEY_TYPE::CHINESE;
 		this->type = INPUT_TYPE::UNDEFINED;
@@ -246,6 +248,7 @@ private:
 	friend class ConfigManager;
 	friend class WZFactory;
 	friend class ConfigTreeWalker;
+	friend class ConfigSnapshot;
 
 public:
 	//Constructor: set the ID here and nowhere else
@@ -314,6 +317,7 @@ private:
 	friend class ConfigManager;
 	friend class ConfigTreeWalker;
 	friend class WZFactory;
+	friend class ConfigSnapshot;
 
 public:
 	SettingsNode() {
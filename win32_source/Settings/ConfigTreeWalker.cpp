@@ -308,6 +308,11 @@ void ConfigTreeWalker::buildVerifyTree()
 		dynamic_cast<InMethNode&>(d).disableCache = waitzar::read_bool(s.str());
 		return d;
 	});
+	verifyTree[L"languages"][L"*"][L"input-methods"][L"*"].addChild(L"use-automaton", [](const StringNode& s, GhostNode& d, const CfgPerm& perms)->GhostNode&{
+		//Cast and set
+		dynamic_cast<InMethNode&>(d).useAutomaton = waitzar::read_bool(s.str());
+		return d;
+	});
 
 
 	//Display method
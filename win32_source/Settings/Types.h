@@ -7,6 +7,7 @@
 #pragma once
 
 #include <string.h>
+#include <wchar.h>
 
 
 //Fun times!
@@ -54,6 +54,7 @@ public:
 	static Transformation* makeAndVerifyTransformation(ConfigRoot& conf, const LangNode& lang, const std::wstring& id, TransNode& tm);
 
 	//Used to "verify" things which don't need to be built
+	//NOTE: These (and makeAndVerifyInputMethod) are in WZFactoryVerify.cpp
 	static void verifyEncoding(const std::wstring& id, EncNode& enc);
 	static void verifyLanguage(const std::wstring& id, LangNode& lang, const std::wstring& lastUsedInMethID, const std::wstring& lastUsedOutEncID);
 	static void verifySettings(ConfigRoot& cfg, SettingsNode& set, const std::wstring& lastUsedLangID);
@@ -63,6 +64,7 @@ public:
 	static std::wstring MatchAvoidBackwards(const std::vector<std::wstring>& vec, const std::wstring& avoidStr);
 
 	//More specific builders/instances
+	//NOTE: All but getMywinInput are in WZFactoryInput.cpp
 	static RomanInputMethod* getWaitZarInput(std::wstring langID, const std::wstring& extraWordsFileName, const std::wstring& userWordsFileName, InMethNode& node);
 	static RomanInputMethod* getBurglishInput(std::wstring langID, InMethNode& node);
 	static RomanInputMethod* getWordlistBasedInput(std::wstring langID, std::wstring inputID, std::string wordlistFileName, InMethNode& node);
@@ -87,6 +89,11 @@ public:
 		return (GetFileAttributesEx(fileName.c_str(), GetFileExInfoStandard, &InfoFile)==TRUE);
 	}
 
+	//The config tree's paths are already native here (headless builds have to fix the slashes).
+	static std::string NativePath(const std::string& path) {
+		return path;
+	}
+
 
 private:
 	//For loading
@@ -111,6 +118,8 @@ private:
 	static void buildSystemWordLookup();
 	static waitzar::WordBuilder* readModel();
 	static void addWordsToModel(waitzar::WordBuilder* model, std::string userWordsFileName);
+	static std::string getKeyMagicCacheFile(const std::wstring& fullID, const std::string& wordlistFileName);
+	static Transformation* makeJavaScriptTransformation(ConfigRoot& conf, TransNode& tm);
 };
 
 
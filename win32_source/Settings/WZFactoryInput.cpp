@@ -0,0 +1,272 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+//The parts of WZFactory that build input methods and transformations. Like WZFactoryVerify.cpp, none
+//  of this touches Win32 directly: anything that does (loading the model from our resources, finding
+//  the Key Magic cache, javascript, and the myWin keyboard) is left to WZFactory.cpp, or to the
+//  headless stand-in that InputReplay builds with. That's why we include it by its full path.
+#include "Settings/WZFactory.h"
+
+
+using std::map;
+using std::wstring;
+using std::string;
+using std::vector;
+using std::pair;
+using waitzar::WordBuilder;
+using waitzar::SentenceList;
+
+
+
+//Static initializations
+MyWin32Window* WZFactory::mainWindow = NULL;
+MyWin32Window* WZFactory::sentenceWindow = NULL;
+MyWin32Window* WZFactory::helpWindow = NULL;
+MyWin32Window* WZFactory::memoryWindow = NULL;
+OnscreenKeyboard* WZFactory::helpKeyboard = NULL;
+std::vector< std::pair <int, unsigned short> > WZFactory::systemWordLookup = std::vector< std::pair <int, unsigned short> >();
+
+
+//Build our system lookup
+void WZFactory::buildSystemWordLookup()
+{
+	//Build our reverse lookup.
+	for (size_t i=0; i<waitzar::WZSystemDefinedWords.size(); i++) {
+		int letter_id = waitzar::WZSystemDefinedWords[i];
+		WZFactory::systemWordLookup.push_back(pair<int, unsigned short>(letter_id, i));
+	}
+}
+
+
+
+void WZFactory::addWordsToModel(WordBuilder* model, string userWordsFileName) {
+	//Read our words file, if it exists.
+	userWordsFileName = NativePath(userWordsFileName);
+	if (!FileExists(waitzar::mbs2wcs(userWordsFileName)))
+		return;
+	wstring uniBuffer = waitzar::readUTF8File(userWordsFileName);
+	size_t numUniChars = uniBuffer.size();
+	if (numUniChars==0)
+		return; //Empty file.
+
+	//Skip the BOM, if it exists
+	size_t currPosition = 0;
+	if (uniBuffer[currPosition] == UNICOD_BOM)
+		currPosition++;
+	else if (uniBuffer[currPosition] == BACKWARDS_BOM)
+		throw std::runtime_error("waitzar user wordlist file appears to be encoded backwards.");
+
+	//Read each line
+	wchar_t name[100];
+	char value[100];
+	while (currPosition<numUniChars) {
+		//Get the name/value pair using our nifty template function....
+		waitzar::readLine(&uniBuffer[0], currPosition, numUniChars, true, true, false, true/*model->isAllowNonBurmese()*/, true, false, false, false, name, value);
+
+		//Make sure both name and value are non-empty
+		if (strlen(value)==0 || wcslen(name)==0)
+			continue;
+
+		//Add this romanization
+		if (!model->addRomanization(name, value, true))
+			throw std::runtime_error(string(string("Error adding romanisation: ") + waitzar::escape_wstr(model->getLastError(), false)).c_str());
+	}
+}
+
+
+
+std::map<std::wstring, RomanInputMethod*> WZFactory::cachedWBInputs;
+std::map<std::wstring, RomanInputMethod*> WZFactory::cachedBGInputs;
+std::map<std::wstring, LetterInputMethod*> WZFactory::cachedLetterInputs;
+
+RomanInputMethod* WZFactory::getWaitZarInput(wstring langID, const wstring& extraWordsFileName, const wstring& userWordsFileName, InMethNode& node)
+{
+	wstring fullID = langID + L"." + L"waitzar";
+
+	//Singleton init
+	if (WZFactory::cachedWBInputs.count(fullID)==0) {
+		//Load model; create sentence list
+		//NOTE: These resources will not be reclaimed, but since they're
+		//      contained within a singleton class, I don't see a problem.
+		WordBuilder* model = WZFactory::readModel();
+		SentenceList* sentence = new SentenceList();
+
+		//Add extra words
+		WZFactory::addWordsToModel(model, waitzar::escape_wstr(extraWordsFileName, false));
+
+		//Add user words
+		WZFactory::addWordsToModel(model, waitzar::escape_wstr(userWordsFileName, false));
+
+		//One final check
+		if (model->isInError())
+			throw std::runtime_error(waitzar::escape_wstr(model->getLastError(), false).c_str());
+
+		//Should probably build the reverse lookup now
+		model->reverseLookupWord(0);
+
+		//Create, init
+		WZFactory::cachedWBInputs[fullID] = new RomanInputMethod();
+		WZFactory::cachedWBInputs[fullID]->init(WZFactory::mainWindow, WZFactory::sentenceWindow, WZFactory::helpWindow, WZFactory::memoryWindow, WZFactory::systemWordLookup, WZFactory::helpKeyboard, waitzar::WZSystemDefinedWords, model, sentence, node.encoding, node.controlKeyStyle, node.typeBurmeseNumbers, node.typeNumeralConglomerates, node.suppressUppercase);
+	}
+
+	return WZFactory::cachedWBInputs[fullID];
+}
+
+
+
+
+RomanInputMethod* WZFactory::getBurglishInput(wstring langID, InMethNode& node)
+{
+	wstring fullID = langID + L"." + L"burglish";
+
+	//Singleton init
+	if (WZFactory::cachedBGInputs.count(fullID)==0) {
+		//Load model; create sentence list
+		//NOTE: These resources will not be reclaimed, but since they're
+		//      contained within a singleton class, I don't see a problem.
+		waitzar::BurglishBuilder* model = new waitzar::BurglishBuilder();
+		SentenceList* sentence = new SentenceList();
+
+		//Create, init
+		WZFactory::cachedBGInputs[fullID] = new RomanInputMethod();
+		WZFactory::cachedBGInputs[fullID]->init(WZFactory::mainWindow, WZFactory::sentenceWindow, WZFactory::helpWindow, WZFactory::memoryWindow, WZFactory::systemWordLookup, WZFactory::helpKeyboard, waitzar::WZSystemDefinedWords, model, sentence, node.encoding, node.controlKeyStyle, node.typeBurmeseNumbers, node.typeNumeralConglomerates, node.suppressUppercase);
+	}
+
+	return WZFactory::cachedBGInputs[fullID];
+}
+
+
+//Get a keymagic input method
+
+LetterInputMethod* WZFactory::getKeyMagicBasedInput(std::wstring langID, std::wstring inputID, std::string wordlistFileName, bool disableCache, InMethNode& node)
+{
+	wstring fullID = langID + L"." + inputID;
+
+	if (WZFactory::cachedLetterInputs.count(fullID)==0) {
+		//Prepare our binary path/name; if there's nowhere to put it, don't cache.
+		string binaryName;
+		if (!disableCache) {
+			binaryName = WZFactory::getKeyMagicCacheFile(fullID, wordlistFileName);
+			disableCache = binaryName.empty();
+		}
+
+		//Build our result
+		KeyMagicInputMethod* res = new KeyMagicInputMethod();
+		res->init(WZFactory::mainWindow, WZFactory::sentenceWindow, WZFactory::helpWindow, WZFactory::memoryWindow, WZFactory::systemWordLookup, WZFactory::helpKeyboard, waitzar::WZSystemDefinedWords, node.encoding, node.controlKeyStyle, node.typeBurmeseNumbers, node.typeNumeralConglomerates, node.suppressUppercase);
+		res->setUseAutomaton(node.useAutomaton);
+		res->loadRulesFile(NativePath(wordlistFileName), binaryName, disableCache/*, fileMD5Function*/);
+		//res->disableCache = disableCache;
+
+		WZFactory::cachedLetterInputs[fullID] = res;
+	}
+
+	return WZFactory::cachedLetterInputs[fullID];
+}
+
+
+
+//Build a model up from scratch.
+
+RomanInputMethod* WZFactory::getWordlistBasedInput(wstring langID, wstring inputID, string wordlistFileName, InMethNode& node)
+{
+	wstring fullID = langID + L"." + inputID;
+
+	if (WZFactory::cachedWBInputs.count(fullID)==0) {
+		//Create a basically empty model (Nexus can't be empty)
+		vector< vector<unsigned int> > nexus;
+		nexus.push_back(vector<unsigned int>());
+		WordBuilder* model = new WordBuilder(vector<wstring>(), nexus, vector< vector<unsigned int> >());
+		SentenceList* sentence = new SentenceList();
+
+		//Add user words (there's ONLY user words here)
+		WZFactory::addWordsToModel(model, wordlistFileName);
+
+		//Should probably build the reverse lookup now
+		model->reverseLookupWord(0);
+
+		//One final check
+		if (model->isInError())
+			throw std::runtime_error(waitzar::escape_wstr(model->getLastError(), false).c_str());
+
+		//Now, build the romanisation method and return
+		WZFactory::cachedWBInputs[fullID] = new RomanInputMethod();
+		WZFactory::cachedWBInputs[fullID]->init(WZFactory::mainWindow, WZFactory::sentenceWindow, WZFactory::helpWindow, WZFactory::memoryWindow, WZFactory::systemWordLookup, WZFactory::helpKeyboard, waitzar::WZSystemDefinedWords, model, sentence, node.encoding, node.controlKeyStyle, node.typeBurmeseNumbers, node.typeNumeralConglomerates, node.suppressUppercase);
+	}
+
+	return WZFactory::cachedWBInputs[fullID];
+}
+//
+// TODO: A lot of our nodeset_exceptions are forced; we should really build them automatically.
+//
+Transformation* WZFactory::makeAndVerifyTransformation(ConfigRoot& conf, const LangNode& lang, const std::wstring& id, TransNode& tm)
+{
+	Transformation* res = NULL;
+
+	try {
+		//Check some required settings
+		if (tm.fromEncoding.empty())
+			throw std::runtime_error("Cannot construct transformation: no \"from-encoding\"");
+		if (tm.toEncoding.empty())
+			throw std::runtime_error("Cannot construct transformation: no \"to-encoding\"");
+
+		//Ensure we have valid encodings
+		if (lang.encodings.count(tm.fromEncoding)==0)
+			throw nodeset_exception(waitzar::glue(L"Transformation \"" , id , L"\" references non-existent from-encoding: ", tm.fromEncoding).c_str(), wstring(L"languages."+lang.id+L".transformations."+id+L".fromencoding").c_str());
+		if (lang.encodings.count(tm.toEncoding)==0)
+			throw nodeset_exception(waitzar::glue(L"Transformation \"" , id , L"\" references non-existent to-encoding: ", tm.toEncoding).c_str(), wstring(L"languages."+lang.id+L".transformations."+id+L".toencoding").c_str());
+
+
+		//First, generate an actual object, based on the type.
+		switch (tm.type) {
+			case TRANSFORM_TYPE::BUILTIN:
+				//Built-in types are known entirely by our core code
+				if (id==L"self2self")
+					res = new Self2Self();
+				else if (id==L"uni2zg")
+					res = new Uni2Zg();
+				else if (id==L"uni2wi")
+					res = new Uni2WinInnwa();
+				else if (id==L"zg2uni")
+					res = new Zg2Uni();
+				else if (id==L"uni2ayar")
+					res = new Uni2Ayar();
+				else if (id==L"ayar2uni")
+					res = new Ayar2Uni();
+				else
+					throw std::runtime_error(waitzar::glue(L"Invalid \"builtin\" Transformation: ", id).c_str());
+				break;
+
+			case TRANSFORM_TYPE::JAVASCRIPT:
+				//These need the interpreter extension
+				res = WZFactory::makeJavaScriptTransformation(conf, tm);
+				break;
+
+			default:
+				throw std::runtime_error("Cannot construct transformation: no \"type\"");
+		}
+	} catch (std::exception& ex) {
+		//Pack all exceptions into nodeset_exceptions
+		throw nodeset_exception(ex.what(), id.c_str());
+	}
+
+	return res;
+}
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
@@ -0,0 +1,232 @@
+/*
+ * Copyright 2011 by Seth N. Hetu
+ *
+ * Please refer to the end of the file for licensing information
+ */
+
+//The parts of WZFactory that only check the config tree (and pick which builder to call). None of
+//  this touches Win32, so headless builds (see InputReplay) share it with their own WZFactory.h;
+//  that's why we include it by its full path.
+#include "Settings/WZFactory.h"
+
+
+using std::map;
+using std::wstring;
+using std::vector;
+
+
+
+//
+// TODO: A lot of our nodeset_exceptions are forced; we should really build them automatically.
+//
+InputMethod* WZFactory::makeAndVerifyInputMethod(const LangNode& lang, const std::wstring& id, InMethNode& im)
+{
+	InputMethod* res = NULL;
+
+	try {
+		//Check required settings; type is checked in the "switch" statement
+		if (im.encoding.empty())
+			throw std::runtime_error("Cannot construct input manager: no \"encoding\"");
+		if (im.displayName.empty())
+			throw std::runtime_error("Cannot construct input manager: no \"display-name\"");
+
+		//Ensure that referenced encodings/etc. exist
+		if (lang.encodings.count(im.encoding)==0)
+			throw nodeset_exception(waitzar::glue(L"Input method \"" , id , L"\" references non-existent encoding: ", im.encoding).c_str(), wstring(L"languages."+lang.id+L".inputmethods."+id+L".encoding").c_str());
+
+		//Ensure that at least one transformation exists
+		if (im.encoding!=L"unicode") {
+			//Sadly, our lookup has not been built yet, so we must manually scan every transformation
+			bool transFound = false;
+			for (auto it=lang.transformations.begin(); it!=lang.transformations.end(); it++) {
+				if (it->second.fromEncoding==im.encoding && it->second.toEncoding==L"unicode") {
+					transFound = true;
+					break;
+				}
+			}
+			if (!transFound)
+				throw nodeset_exception(waitzar::glue(L"Input method \"" , id , L"\" uses an encoding with no corresponding transformation: ", im.encoding).c_str(), wstring(L"languages."+lang.id+L".inputmethods."+id+L".encoding").c_str());
+		}
+
+		//Make an object based on the type
+		switch (im.type) {
+			case INPUT_TYPE::BUILTIN:
+				if (im.id==L"waitzar") {
+					res = WZFactory::getWaitZarInput(lang.id, im.extraWordsFile, im.userWordsFile, im);
+				} else if (im.id==L"mywin") {
+					res = WZFactory::getMywinInput(lang.id, im);
+				} else if (im.id==L"burglish") {
+					res = WZFactory::getBurglishInput(lang.id, im);
+				} else {
+					throw std::runtime_error(waitzar::glue(L"Invalid \"builtin\" Input Manager: ", im.id).c_str());
+				}
+				break;
+			case INPUT_TYPE::ROMAN:
+				//Check required wordlist
+				if (im.extraWordsFile.empty())
+					throw std::runtime_error("Cannot construct \"roman\" input manager: no \"wordlist\".");
+
+				//Test
+				if (!FileExists(im.extraWordsFile))
+					throw std::runtime_error(waitzar::glue(L"Wordlist file does not exist: ", im.extraWordsFile).c_str());
+
+				//Get it, as a singleton
+				res = WZFactory::getWordlistBasedInput(lang.id, im.id, waitzar::escape_wstr(im.extraWordsFile), im);
+				break;
+			case INPUT_TYPE::KEYBOARD:
+				//Requires a keyboard file
+				if (im.keyboardFile.empty())
+					throw std::runtime_error("Cannot construct \"keymagic\" input manager: no \"keyboard-file\".");
+
+				//Test
+				if (!FileExists(im.keyboardFile))
+					throw std::runtime_error(waitzar::glue(L"Keyboard file does not exist: ", im.keyboardFile).c_str());
+
+				//Override disabling the cache, keymagic only.
+				if (Logger::isLogging('K'))
+					im.disableCache = true;
+
+				//Get it, as a singleton
+				res = WZFactory::getKeyMagicBasedInput(lang.id, im.id, waitzar::escape_wstr(im.keyboardFile, false), im.disableCache, im);
+				break;
+			default:
+				throw std::runtime_error("Cannot construct input manager: no \"type\"");
+		}
+	} catch (std::exception& ex) {
+		//Pack all exceptions into nodeset_exceptions
+		throw nodeset_exception(ex.what(), id.c_str());
+	}
+
+	return res;
+}
+
+
+
+void WZFactory::verifyEncoding(const std::wstring& id, EncNode& enc)
+{
+	try {
+		//Necessary properties
+		if (enc.displayName.empty())
+			throw std::runtime_error("Cannot construct encoding: no \"display-name\"");
+	} catch (std::exception& ex) {
+		//Pack all exceptions into nodeset_exceptions
+		throw nodeset_exception(ex.what(), id.c_str());
+	}
+}
+
+
+/**
+ * Don't ask.
+ */
+wstring WZFactory::InterpretFlashSave(const map<wstring, vector<wstring> >& flashSave, const std::wstring& langID, size_t resIndex)
+{
+	auto res = flashSave.find(langID);
+	if (res==flashSave.end())
+		return L"";
+	return res->second[resIndex];
+}
+wstring WZFactory::MatchAvoidBackwards(const vector<wstring>& vec, const wstring& avoidStr)
+{
+	for (auto it=vec.rbegin(); it!=vec.rend(); it++) {
+		if (*it != avoidStr)
+			return *it;
+	}
+	return L"";
+}
+
+
+
+//
+// TODO: A lot of our nodeset_exceptions are forced; we should really build them automatically.
+//
+void WZFactory::verifySettings(ConfigRoot& cfg, SettingsNode& set, const std::wstring& lastUsedLangID)
+{
+	//Deal with "last-used" languages
+	if (set.defaultLanguage==L"lastused") {
+		//First, try to set it to the last used language (which may not exist)
+		wstring backupDefLang = WZFactory::MatchAvoidBackwards(set.defaultLanguageStack, L"lastused");
+		if (!lastUsedLangID.empty() && cfg.languages.count(lastUsedLangID)>0)
+			set.defaultLanguage = lastUsedLangID;
+		else if (!backupDefLang.empty())
+			set.defaultLanguage = backupDefLang;
+		else
+			throw nodeset_exception("Settings chooses default-language of \"last-used\" without specifying a backup.", L"settings.defaultlanguage");
+	}
+
+	//Verify our default language
+	if (cfg.languages.count(set.defaultLanguage)==0)
+		throw nodeset_exception(waitzar::glue(L"Settings references non-existent default-language: ", set.defaultLanguage).c_str(), L"settings.defaultlanguage");
+}
+
+
+
+//
+// TODO: A lot of our nodeset_exceptions are forced; we should really build them automatically.
+//
+void WZFactory::verifyLanguage(const std::wstring& id, LangNode& lang, const std::wstring& lastUsedInMethID, const std::wstring& lastUsedOutEncID)
+{
+	try {
+		//Necessary properties
+		if (lang.displayName.empty())
+			throw std::runtime_error("Cannot construct language: no \"display-name\"");
+		if (lang.encodings.count(L"unicode")==0)
+			throw std::runtime_error(waitzar::glue(L"Language \"" , lang.id , L"\" does not include \"unicode\" as an encoding.").c_str());
+
+		//Deal with "last-used" input method
+		if (lang.defaultInputMethod==L"lastused") {
+			//First, try to set it to the last used language (which may not exist)
+			wstring backupDefIM = WZFactory::MatchAvoidBackwards(lang.defaultInMethStack, L"lastused");
+			if (!lastUsedInMethID.empty() && lang.inputMethods.count(lastUsedInMethID)>0)
+				lang.defaultInputMethod = lastUsedInMethID;
+			else if (!backupDefIM.empty())
+				lang.defaultInputMethod = backupDefIM;
+			else
+				throw nodeset_exception("Language chooses default-input-method of \"last-used\" without specifying a backup.", wstring(L"languages."+lang.id+L".defaultinputmethod").c_str());
+		}
+
+		//Deal with "last-used" display method
+		if (lang.defaultOutputEncoding==L"lastused") {
+			//First, try to set it to the last used language (which may not exist)
+			wstring backupDefOE = WZFactory::MatchAvoidBackwards(lang.defaultOutEncStack, L"lastused");
+			if (!lastUsedOutEncID.empty() && lang.encodings.count(lastUsedOutEncID)>0)
+				lang.defaultOutputEncoding = lastUsedOutEncID;
+			else if (!backupDefOE.empty())
+				lang.defaultOutputEncoding = backupDefOE;
+			else
+				throw nodeset_exception("Language chooses default-output-encoding of \"last-used\" without specifying a backup.", wstring(L"languages."+lang.id+L".defaultoutputencoding").c_str());
+		}
+
+		//Ensure dependencies are met
+		if (lang.encodings.count(lang.defaultOutputEncoding)==0)
+			throw nodeset_exception(waitzar::glue(L"Language \"" , lang.id , L"\" references non-existant default output encoding: ", lang.defaultOutputEncoding).c_str(), wstring(L"languages."+lang.id+L".defaultoutputencoding").c_str());
+		if (lang.inputMethods.count(lang.defaultInputMethod)==0)
+			throw nodeset_exception(waitzar::glue(L"Language \"" , lang.id , L"\" references non-existant default input method: ", lang.defaultInputMethod).c_str(), wstring(L"languages."+lang.id+L".defaultinputmethod").c_str());
+		if (lang.displayMethods.count(lang.defaultDisplayMethodReg)==0)
+			throw nodeset_exception(waitzar::glue(L"Language \"" , lang.id , L"\" references non-existant default (regular) display method: ", lang.defaultDisplayMethodReg).c_str(), wstring(L"languages."+lang.id+L".defaultdisplaymethod").c_str());
+		if (lang.displayMethods.count(lang.defaultDisplayMethodSmall)==0)
+			throw nodeset_exception(waitzar::glue(L"Language \"" , lang.id , L"\" references non-existant default (small) display method: ", lang.defaultDisplayMethodSmall).c_str(), wstring(L"languages."+lang.id+L".defaultdisplaymethodsmall").c_str());
+		if (!lang.encodings[lang.defaultOutputEncoding].canUseAsOutput)
+			throw nodeset_exception(waitzar::glue(L"Language \"" , lang.id , L"\" uses a default output encoding which does not support output.").c_str(), wstring(L"languages."+lang.id+L".defaultoutputencoding").c_str());
+		if (lang.displayMethods[lang.defaultDisplayMethodReg].encoding != lang.displayMethods[lang.defaultDisplayMethodSmall].encoding)
+			throw nodeset_exception(waitzar::glue(L"Language \"" , lang.id , L"\" uses two display methods with two different encodings.").c_str(), wstring(L"languages."+lang.id+L".defaultdisplaymethod").c_str());
+	} catch (std::exception& ex) {
+		//Pack all exceptions into nodeset_exceptions
+		throw nodeset_exception(ex.what(), id.c_str());
+	}
+}
+
+
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
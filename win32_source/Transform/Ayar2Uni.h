@@ -9,6 +9,7 @@
 
 #include <sstream>
 #include "Transform/Transformation.h"
+#include "NGram/wz_utilities.h"
 
 /**
  * Enable the "Ayar" encoding
@@ -18,16 +19,13 @@ class Ayar2Uni : public Transformation
 
 
 private:
+	//Consonants, independent vowels and digits
 	bool IsConsonant(wchar_t letter) const {
-		if (letter>=L'\u1000' && letter<=L'\u102A')
-			return true;
-		if (letter==L'\u103F')
-			return true;
-		if (letter>=L'\u1040' && letter<=L'\u1049')
-			return true;
-		if (letter==L'\u104E')
-			return true;
-		return false;
+		return (waitzar::GetMyanmarLetter(letter).classes&(waitzar::MC_BASE|waitzar::MC_DIGIT))!=0;
+	}
+
+	bool IsMyanmar(wchar_t letter) const {
+		return (waitzar::GetMyanmarLetter(letter).classes&waitzar::MC_BLOCK)!=0;
 	}
 
 public:
@@ -40,12 +38,12 @@ public:
 		std::wstringstream currSyllablePrefix;
 		for (size_t i=0; i<src.length(); i++) {
 			//The next syllable starts at the first non-stacked non-killed consonant, or at tha-way-htoe or ya-yit
-			if (src[i]<L'\u1000' || src[i]>L'\u109F') {  //TODO: We need to extract this out to "IsMyanmar()" to include Unicode 5.2 letters.
+			if (!IsMyanmar(src[i])) {  //TODO: Include Unicode 5.2 letters.
 				//Append all non-Myanmar letters and continue
 				res <<currSyllablePrefix.str() <<currSyllable.str();
 				currSyllablePrefix.str(L"");
 				currSyllable.str(L"");
-				while (i<src.length() && (src[i]<L'\u1000' || src[i]>L'\u109F')) {
+				while (i<src.length() && !IsMyanmar(src[i])) {
 					res <<src[i++];
 				}
 				i--;
@@ -99,6 +97,8 @@ public:
 		src = res.str();
 	}
 
+	//No state is kept between calls
+	bool isThreadSafe() const { return true; }
 };
 
 
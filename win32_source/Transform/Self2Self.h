@@ -24,6 +24,8 @@ public:
 	void convertInPlace(std::wstring& src) const {
 		//No change needed
 	}
+
+	bool isThreadSafe() const { return true; }
 };
 
 
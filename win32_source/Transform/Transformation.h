@@ -12,11 +12,17 @@
 
 class Transformation {
 public:
+	//Transformations are owned (and deleted) through this interface.
+	virtual ~Transformation() {}
 
 	//Convert from fromEncoding to toEncoding.
 	//  The references allow us to save processing if the source and destination are the same.
 	virtual void convertInPlace(std::wstring& src) const = 0;
 
+	//Can one instance be shared by several threads converting at once? If not, each thread
+	//  needs its own instance. Transformations must opt in to this.
+	virtual bool isThreadSafe() const { return false; }
+
 };
 
 #endif //_TRANSFORM
@@ -9,6 +9,7 @@
 
 #include <sstream>
 #include "Transform/Transformation.h"
+#include "NGram/wz_utilities.h"
 
 /**
  * Enable the "Ayar" encoding
@@ -16,16 +17,13 @@
 class Uni2Ayar : public Transformation
 {
 private:
+	//Consonants, independent vowels and digits
 	bool IsConsonant(wchar_t letter) const {
-		if (letter>=L'\u1000' && letter<=L'\u102A')
-			return true;
-		if (letter==L'\u103F')
-			return true;
-		if (letter>=L'\u1040' && letter<=L'\u1049')
-			return true;
-		if (letter==L'\u104E')
-			return true;
-		return false;
+		return (waitzar::GetMyanmarLetter(letter).classes&(waitzar::MC_BASE|waitzar::MC_DIGIT))!=0;
+	}
+
+	bool IsMyanmar(wchar_t letter) const {
+		return (waitzar::GetMyanmarLetter(letter).classes&waitzar::MC_BLOCK)!=0;
 	}
 
 public:
@@ -39,13 +37,13 @@ public:
 		size_t u103Ccount = 0;
 		for (size_t i=0; i<src.length(); i++) {
 			//The next syllable starts at the first non-stacked non-killed consonant, or at a non-myanmar letter
-			if (src[i]<L'\u1000' || src[i]>L'\u109F') {   //TODO: Replace with an "IsMyanmar()" function, to catch extra characters in Unicode 5.2.
+			if (!IsMyanmar(src[i])) {   //TODO: Catch extra characters in Unicode 5.2.
 				//Append all non-Myanmar letters and continue
 				res <<std::wstring(u1031count, L'\u1031') <<std::wstring(u103Ccount, L'\u103C');
 				res <<currSyllablePrefix.str() <<currSyllable.str();
 				currSyllablePrefix.str(L"");
 				currSyllable.str(L"");
-				while (i<src.length() && (src[i]<L'\u1000' || src[i]>L'\u109F')) {
+				while (i<src.length() && !IsMyanmar(src[i])) {
 					res <<src[i++];
 				}
 				i--;
@@ -105,6 +103,9 @@ public:
 
 		src = res.str();
 	}
+
+	//No state is kept between calls
+	bool isThreadSafe() const { return true; }
 };
 
 
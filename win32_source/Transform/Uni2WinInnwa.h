@@ -11,6 +11,7 @@
 
 #include "Transform/Transformation.h"
 #include "NGram/wz_utilities.h"
+#include "NGram/Logger.h"
 #include "Burglish/fontmap.h"
 #include "Burglish/fontconv.h"
 
@@ -20,39 +21,34 @@
 class Uni2WinInnwa : public Transformation
 {
 public:
+	Uni2WinInnwa() {
+		//Build the shared conversion tables now, rather than during the first conversion.
+		waitzar::FontConverter::Get(Zawgyi_One, WinInnwa);
+	}
+
 	//Convert
 	void convertInPlace(std::wstring& src) const {
 		//Use our code
 		src = waitzar::renderAsZawgyi(src);
 
 		//Use Ko Soe Min's code for now. (We can pull in some of our Java code later).
-		wchar_t srcStr[200];
-		wchar_t destStr[200];
-		if (src.size() >= 200)
-			throw std::runtime_error("String too big in Uni2WinInnwa");
-
-		//First, convert
-		wcscpy(srcStr, src.c_str());
-		wcscpy(destStr, L"");
-		waitzar::convertFont(destStr, srcStr, Zawgyi_One, WinInnwa);
+		//Strings of any length are accepted; long ones are converted in pieces, split between syllables.
+		std::wstring destStr = waitzar::FontConverter::Get(Zawgyi_One, WinInnwa).convertDocument(src);
 
 		//Next, fix a few special cases
 		//TODO: Merge this code with WordBuilder's; or just write our own conversion function.
-		if (wcscmp(srcStr, L"\u1009\u102C\u1025\u1039")==0) {
-			wcscpy(destStr, L"123");
-			destStr[0] = 211;
-			destStr[1] = 79;
-			destStr[2] = 102;
-		} else if (wcscmp(srcStr, L"\u1015\u102B\u1094")==0) {
-			wcscpy(destStr, L"123");
-			destStr[0] = 121;
-			destStr[1] = 103;
-			destStr[2] = 104;
+		if (src==L"\u1009\u102C\u1025\u1039") {
+			destStr = L"\x00D3" L"Of"; //211, 79, 102
+		} else if (src==L"\u1015\u102B\u1094") {
+			destStr = L"ygh"; //121, 103, 104
 		}
 
 		//Finally, save the value created.
-		src = std::wstring(destStr);
+		src = destStr;
 	}
+
+	//The conversion tables are read-only once built, and renderAsZawgyi() only writes to the (thread-safe) Logger.
+	bool isThreadSafe() const { return true; }
 };
 
 
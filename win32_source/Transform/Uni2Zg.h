@@ -28,13 +28,20 @@ public:
 			return;
 
 		//Use our code, from the utilities package.
-		Logger::writeLogLine('Z', std::wstring(L"Unicode: {") + src + L"}");
-		src = waitzar::sortMyanmarString(src);
-		src = waitzar::renderAsZawgyi(src);
-		Logger::writeLogLine('Z', std::wstring(L"Zawgyi1: {") + src + L"}");
-		Logger::writeLogLine('Z');
+		if (Logger::isLogging('Z'))
+			Logger::writeLogLine('Z', std::wstring(L"Unicode: {") + src + L"}");
+		std::vector<wchar_t> scratch(waitzar::ZawgyiScratchSize(src.length()));
+		size_t length = waitzar::convertToZawgyi(src.data(), src.length(), &scratch[0], scratch.size());
+		src.assign(&scratch[0], length);
+		if (Logger::isLogging('Z')) {
+			Logger::writeLogLine('Z', std::wstring(L"Zawgyi1: {") + src + L"}");
+			Logger::writeLogLine('Z');
+		}
 		//src = waitzar::removeZWS(src, L"-"); //Remove hyphens
 	}
+
+	//The conversion itself is stateless, and the Logger may be written from any thread.
+	bool isThreadSafe() const { return true; }
 };
 
 
@@ -19,35 +19,32 @@
 class Zg2Uni : public Transformation
 {
 public:
+	Zg2Uni() {
+		//Build the shared conversion tables now, rather than during the first conversion.
+		waitzar::FontConverter::Get(Zawgyi_One, Myanmar3);
+	}
+
 	//Convert
 	void convertInPlace(std::wstring& src) const {
 		//Use Ko Soe Min's code for now. (We can pull in some of our Java code later).
-		wchar_t srcStr[200];
-		wchar_t destStr[200];
-		if (src.size() >= 200)
-			throw std::runtime_error("String too big in Zg2Uni");
-
-		//First, convert
-		wcscpy(srcStr, src.c_str());
-		wcscpy(destStr, L"");
-		waitzar::convertFont(destStr, srcStr, Zawgyi_One, Myanmar3);
+		//Strings of any length are accepted; long ones are converted in pieces, split between syllables.
+		std::wstring destStr = waitzar::FontConverter::Get(Zawgyi_One, Myanmar3).convertDocument(src);
 
 		//Next, fix a few special cases
 		//TODO: Merge this code with WordBuilder's; or just write our own conversion function.
-		if (wcscmp(srcStr, L"\u1031\u101A\u102C\u1000\u1039\u103A\u102C\u1038")==0) {
-			wcscpy(destStr, L"\u101A\u1031\u102C\u1000\u103A\u103B\u102C\u1038");
-		} else if (wcscmp(srcStr, L"104E")==0) {
+		if (src==L"\u1031\u101A\u102C\u1000\u1039\u103A\u102C\u1038") {
+			destStr = L"\u101A\u1031\u102C\u1000\u103A\u103B\u102C\u1038";
+		} else if (src==L"104E") {
 			//New encoding for "lakaung"
-			wcscpy(destStr, L"1234");
-			destStr[0] = 0x104E;
-			destStr[1] = 0x1004;
-			destStr[2] = 0x103A;
-			destStr[3] = 0x1038;
+			destStr = L"\u104E\u1004\u103A\u1038";
 		}
 
 		//Finally, save the value created.
-		src = std::wstring(destStr);
+		src = destStr;
 	}
+
+	//The conversion tables are read-only once built.
+	bool isThreadSafe() const { return true; }
 };
 
 